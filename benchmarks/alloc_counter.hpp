@@ -0,0 +1,72 @@
+#ifndef BENCH_ALLOC_COUNTER_HPP
+#define BENCH_ALLOC_COUNTER_HPP
+
+#include <benchmark/benchmark.h>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+// 替换全局 operator new/delete，按线程统计分配次数
+// 每个 bench_* 可执行文件只有一个源文件，因此这里直接给出定义
+
+inline thread_local std::size_t t_alloc_count = 0;
+
+void *operator new(std::size_t __n) {
+  ++t_alloc_count;
+  if (void *__p = std::malloc(__n ? __n : 1)) {
+    return __p;
+  }
+  throw std::bad_alloc();
+}
+
+void *operator new(std::size_t __n, std::align_val_t __al) {
+  ++t_alloc_count;
+  std::size_t const __a = static_cast<std::size_t>(__al);
+  if (void *__p = std::aligned_alloc(__a, (__n + __a - 1) / __a * __a)) {
+    return __p;
+  }
+  throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t __n) { return ::operator new(__n); }
+
+void *operator new[](std::size_t __n, std::align_val_t __al) {
+  return ::operator new(__n, __al);
+}
+
+// 删除函数内联到调用处后，GCC 会把 free 与 operator new 的返回值配对误报
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+void operator delete(void *__p) noexcept { std::free(__p); }
+void operator delete(void *__p, std::size_t) noexcept { std::free(__p); }
+void operator delete(void *__p, std::align_val_t) noexcept { std::free(__p); }
+void operator delete(void *__p, std::size_t, std::align_val_t) noexcept {
+  std::free(__p);
+}
+void operator delete[](void *__p) noexcept { std::free(__p); }
+void operator delete[](void *__p, std::size_t) noexcept { std::free(__p); }
+void operator delete[](void *__p, std::align_val_t) noexcept { std::free(__p); }
+void operator delete[](void *__p, std::size_t, std::align_val_t) noexcept {
+  std::free(__p);
+}
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+// 在计时循环前构造，循环结束后调用 report，输出每次迭代的平均分配次数
+// 多线程时各线程的计数相加再除以总迭代次数
+struct AllocCounter {
+  std::size_t _M_start = t_alloc_count;
+
+  void report(benchmark::State &state) const {
+    state.counters["allocs_per_op"] =
+        benchmark::Counter(static_cast<double>(t_alloc_count - _M_start),
+                           benchmark::Counter::kAvgIterations);
+  }
+};
+
+#endif
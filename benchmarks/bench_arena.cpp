@@ -0,0 +1,103 @@
+#include "alloc_counter.hpp"
+#include "arena.hpp"
+#include "unique_ptr.hpp"
+#include <benchmark/benchmark.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+// 构建并整体释放一棵请求作用域内的对象树：
+// make_unique 逐个 new/delete，分配区只析构对象，内存按块一次性归还
+
+template <class _Ptr> struct TreeNode {
+  int value;
+  std::string label;
+  std::vector<_Ptr> children;
+};
+
+struct HeapTree {
+  struct Node;
+  using ptr = MySTL::unique_ptr<Node>;
+  struct Node : TreeNode<ptr> {};
+
+  struct Builder {
+    auto make(int v) { return MySTL::make_unique<Node>(Node{{v, "n", {}}}); }
+  };
+};
+
+struct StdHeapTree {
+  struct Node;
+  using ptr = std::unique_ptr<Node>;
+  struct Node : TreeNode<ptr> {};
+
+  struct Builder {
+    auto make(int v) { return std::make_unique<Node>(Node{{v, "n", {}}}); }
+  };
+};
+
+struct ArenaTree {
+  struct Node;
+  using ptr = MySTL::arena_unique_ptr<Node>;
+  struct Node : TreeNode<ptr> {};
+
+  struct Builder {
+    MySTL::inline_arena<4096> arena;
+
+    auto make(int v) {
+      return MySTL::make_arena_unique<Node>(arena, Node{{v, "n", {}}});
+    }
+  };
+};
+
+template <class _Tree> static void BM_BuildAndFree(benchmark::State &state) {
+  auto const n = static_cast<int>(state.range(0));
+  AllocCounter allocs;
+  for (auto _ : state) {
+    typename _Tree::Builder b;
+    std::vector<typename _Tree::Node *> nodes;
+    nodes.reserve(n);
+    auto root = b.make(0);
+    nodes.push_back(root.get());
+    for (int i = 1; i < n; ++i) {
+      auto &parent = *nodes[(i - 1) / 4];
+      parent.children.push_back(b.make(i));
+      nodes.push_back(parent.children.back().get());
+    }
+    benchmark::DoNotOptimize(root);
+  }
+  allocs.report(state);
+  state.SetItemsProcessed(state.iterations() * n);
+}
+BENCHMARK(BM_BuildAndFree<StdHeapTree>)->Arg(64)->Arg(1 << 14);
+BENCHMARK(BM_BuildAndFree<HeapTree>)->Arg(64)->Arg(1 << 14);
+BENCHMARK(BM_BuildAndFree<ArenaTree>)->Arg(64)->Arg(1 << 14);
+
+// 只看分配本身：平凡析构的小对象，分配区的析构是空操作
+template <bool _Arena> static void BM_SmallObjects(benchmark::State &state) {
+  auto const n = static_cast<int>(state.range(0));
+  AllocCounter allocs;
+  for (auto _ : state) {
+    if constexpr (_Arena) {
+      MySTL::monotonic_arena arena;
+      std::vector<MySTL::arena_unique_ptr<long>> v;
+      v.reserve(n);
+      for (int i = 0; i < n; ++i) {
+        v.push_back(MySTL::make_arena_unique<long>(arena, i));
+      }
+      benchmark::DoNotOptimize(v.data());
+    } else {
+      std::vector<MySTL::unique_ptr<long>> v;
+      v.reserve(n);
+      for (int i = 0; i < n; ++i) {
+        v.push_back(MySTL::make_unique<long>(i));
+      }
+      benchmark::DoNotOptimize(v.data());
+    }
+  }
+  allocs.report(state);
+  state.SetItemsProcessed(state.iterations() * n);
+}
+BENCHMARK(BM_SmallObjects<false>)->Arg(1 << 14);
+BENCHMARK(BM_SmallObjects<true>)->Arg(1 << 14);
+
+BENCHMARK_MAIN();
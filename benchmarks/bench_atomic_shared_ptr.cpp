@@ -0,0 +1,72 @@
+#include "atomic_shared_ptr.hpp"
+#include <atomic>
+#include <benchmark/benchmark.h>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+// 读多写少的配置快照：比较 MySTL::atomic<shared_ptr>、互斥锁保护的
+// shared_ptr 与 std::atomic<std::shared_ptr> 的读取扩展性
+
+struct Config {
+  int values[16] = {};
+};
+
+static int const kMaxThreads =
+    static_cast<int>(std::max(2u, std::thread::hardware_concurrency()));
+
+struct MySTLAtomic {
+  MySTL::atomic<MySTL::shared_ptr<Config>> cur{MySTL::make_shared<Config>()};
+  auto load() { return cur.load(); }
+  void store() { cur.store(MySTL::make_shared<Config>()); }
+};
+
+struct MutexGuarded {
+  std::mutex mtx;
+  MySTL::shared_ptr<Config> cur = MySTL::make_shared<Config>();
+  auto load() {
+    std::lock_guard<std::mutex> lk(mtx);
+    return cur;
+  }
+  void store() {
+    auto p = MySTL::make_shared<Config>();
+    std::lock_guard<std::mutex> lk(mtx);
+    cur.swap(p);
+  }
+};
+
+struct StdAtomic {
+  std::atomic<std::shared_ptr<Config>> cur{std::make_shared<Config>()};
+  auto load() { return cur.load(); }
+  void store() { cur.store(std::make_shared<Config>()); }
+};
+
+// 所有线程只读
+template <class _Holder> static void BM_ReadOnly(benchmark::State &state) {
+  static _Holder holder;
+  for (auto _ : state) {
+    auto p = holder.load();
+    benchmark::DoNotOptimize(p->values[0]);
+  }
+}
+BENCHMARK(BM_ReadOnly<MutexGuarded>)->ThreadRange(1, kMaxThreads);
+BENCHMARK(BM_ReadOnly<StdAtomic>)->ThreadRange(1, kMaxThreads);
+BENCHMARK(BM_ReadOnly<MySTLAtomic>)->ThreadRange(1, kMaxThreads);
+
+// 0号线程每1000次读取发布一次新快照
+template <class _Holder> static void BM_ReadMostly(benchmark::State &state) {
+  static _Holder holder;
+  int i = 0;
+  for (auto _ : state) {
+    if (state.thread_index() == 0 && ++i % 1000 == 0) {
+      holder.store();
+    }
+    auto p = holder.load();
+    benchmark::DoNotOptimize(p->values[0]);
+  }
+}
+BENCHMARK(BM_ReadMostly<MutexGuarded>)->ThreadRange(1, kMaxThreads);
+BENCHMARK(BM_ReadMostly<StdAtomic>)->ThreadRange(1, kMaxThreads);
+BENCHMARK(BM_ReadMostly<MySTLAtomic>)->ThreadRange(1, kMaxThreads);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,92 @@
+#include "bounded_queue.hpp"
+#include "lockfree.hpp"
+#include "unique_ptr.hpp"
+#include <benchmark/benchmark.h>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+// 有界队列与加锁的 std::deque、无界的 ms_queue 比较：
+// 每个线程交替入队出队，以及一对生产者消费者传递 unique_ptr
+
+static int const kMaxThreads =
+    static_cast<int>(std::max(2u, std::thread::hardware_concurrency()));
+
+template <class _Tp> struct MutexQueue {
+  std::mutex mutex;
+  std::deque<_Tp> items;
+
+  explicit MutexQueue(std::size_t) {}
+
+  void push(_Tp v) {
+    std::lock_guard<std::mutex> lock(mutex);
+    items.push_back(std::move(v));
+  }
+
+  auto try_pop() -> MySTL::optional<_Tp> {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (items.empty()) {
+      return MySTL::nullopt;
+    }
+    MySTL::optional<_Tp> v(std::move(items.front()));
+    items.pop_front();
+    return v;
+  }
+};
+
+template <class _Tp> struct MsQueue : MySTL::ms_queue<_Tp> {
+  explicit MsQueue(std::size_t) {}
+};
+
+template <class _Tp> struct BoundedMpmc : MySTL::mpmc_queue<_Tp> {
+  using MySTL::mpmc_queue<_Tp>::mpmc_queue;
+
+  void push(_Tp v) {
+    while (!this->try_push(std::move(v))) {
+    }
+  }
+};
+
+template <template <class> class _Queue>
+static void BM_PushPop(benchmark::State &state) {
+  static _Queue<MySTL::unique_ptr<int>> queue(1024);
+  for (auto _ : state) {
+    queue.push(MySTL::make_unique<int>(1));
+    benchmark::DoNotOptimize(queue.try_pop());
+  }
+}
+BENCHMARK(BM_PushPop<MutexQueue>)->ThreadRange(1, kMaxThreads);
+BENCHMARK(BM_PushPop<MsQueue>)->ThreadRange(1, kMaxThreads);
+BENCHMARK(BM_PushPop<BoundedMpmc>)->ThreadRange(1, kMaxThreads);
+
+// 0号线程生产，1号线程消费，每次迭代传递一个元素（或一批）
+template <class _Queue> static void BM_Handoff(benchmark::State &state) {
+  static _Queue queue(256);
+  std::size_t const batch = static_cast<std::size_t>(state.range(0));
+  MySTL::unique_ptr<int> buf[64];
+  for (auto _ : state) {
+    if (state.thread_index() == 0) {
+      for (std::size_t i = 0; i < batch; ++i) {
+        buf[i] = MySTL::make_unique<int>(1);
+      }
+      for (std::size_t done = 0; done < batch;) {
+        done += queue.try_push_bulk(buf + done, batch - done);
+      }
+    } else {
+      for (std::size_t done = 0; done < batch;) {
+        done += queue.try_pop_bulk(buf + done, batch - done);
+      }
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_Handoff<MySTL::mpmc_queue<MySTL::unique_ptr<int>>>)
+    ->Arg(1)
+    ->Arg(16)
+    ->Threads(2);
+BENCHMARK(BM_Handoff<MySTL::spsc_queue<MySTL::unique_ptr<int>>>)
+    ->Arg(1)
+    ->Arg(16)
+    ->Threads(2);
+
+BENCHMARK_MAIN();
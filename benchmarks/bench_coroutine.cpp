@@ -0,0 +1,98 @@
+#include "alloc_counter.hpp"
+#include "coroutine.hpp"
+#include <benchmark/benchmark.h>
+#include <memory>
+
+// task 的 co_await 链深度与延迟、每次 await 的分配次数：
+// 默认的线程本地帧缓存与每帧都走全局堆的分配器对比；以及 generator 的迭代开销
+
+// 每帧都从全局堆分配，相当于没有帧缓存
+struct HeapFrames {
+  auto allocate(std::size_t n, std::size_t) -> void * {
+    return ::operator new(n);
+  }
+
+  void deallocate(void *p, std::size_t n, std::size_t) noexcept {
+    ::operator delete(p, n);
+  }
+};
+
+static auto pooledChain(int depth) -> MySTL::task<int> {
+  if (depth == 0) {
+    co_return 0;
+  }
+  co_return co_await pooledChain(depth - 1) + 1;
+}
+
+static auto heapChain(std::allocator_arg_t, HeapFrames &alloc, int depth)
+    -> MySTL::task<int> {
+  if (depth == 0) {
+    co_return 0;
+  }
+  co_return co_await heapChain(std::allocator_arg, alloc, depth - 1) + 1;
+}
+
+// 最外层的 task 由 co_await 驱动，不经过 sync_wait 的信号量
+static auto drive(int depth, bool pooled) -> MySTL::task<int> {
+  HeapFrames alloc;
+  if (pooled) {
+    co_return co_await pooledChain(depth);
+  }
+  co_return co_await heapChain(std::allocator_arg, alloc, depth);
+}
+
+static void BM_TaskChain(benchmark::State &state, bool pooled) {
+  int const depth = static_cast<int>(state.range(0));
+  benchmark::DoNotOptimize(MySTL::sync_wait(drive(depth, pooled)));
+  AllocCounter allocs;
+  for (auto _ : state) {
+    auto t = drive(depth, pooled);
+    benchmark::DoNotOptimize(MySTL::sync_wait(std::move(t)));
+  }
+  allocs.report(state);
+  state.SetItemsProcessed(state.iterations() * (depth + 1));
+}
+BENCHMARK_CAPTURE(BM_TaskChain, pooled, true)->RangeMultiplier(4)->Range(1, 256);
+BENCHMARK_CAPTURE(BM_TaskChain, heap, false)->RangeMultiplier(4)->Range(1, 256);
+
+// 同样的递归用普通函数调用，作为每层开销的下限
+[[gnu::noinline]] static auto plainChain(int depth) -> int {
+  if (depth == 0) {
+    return 0;
+  }
+  int const r = plainChain(depth - 1) + 1;
+  benchmark::DoNotOptimize(r);
+  return r;
+}
+
+static void BM_PlainChain(benchmark::State &state) {
+  int const depth = static_cast<int>(state.range(0));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(plainChain(depth));
+  }
+  state.SetItemsProcessed(state.iterations() * (depth + 1));
+}
+BENCHMARK(BM_PlainChain)->RangeMultiplier(4)->Range(1, 256);
+
+static auto iota(int n) -> MySTL::generator<int> {
+  for (int i = 0; i < n; ++i) {
+    co_yield i;
+  }
+}
+
+static void BM_GeneratorSum(benchmark::State &state) {
+  int const n = static_cast<int>(state.range(0));
+  AllocCounter allocs;
+  for (auto _ : state) {
+    long sum = 0;
+    for (int v : iota(n)) {
+      sum += v;
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  allocs.report(state);
+  state.SetItemsProcessed(state.iterations() * n);
+}
+BENCHMARK(BM_GeneratorSum)->Arg(1)->Arg(1024);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,69 @@
+#include "deferred_reclaim.hpp"
+#include <algorithm>
+#include <benchmark/benchmark.h>
+#include <chrono>
+#include <string>
+#include <vector>
+
+// 释放最后一个 shared_ptr 时调用线程上的耗时：就地析构与推迟到后台线程、
+// 按批在本线程析构对比。只计时 reset 本身，对象的构造不计入
+// range(0)：对象持有的字符串个数，每个字符串一次堆释放
+
+struct Big {
+  std::vector<std::string> parts;
+
+  explicit Big(std::size_t n) {
+    parts.reserve(n);
+    for (std::size_t i = 0; i < n; ++i) {
+      parts.emplace_back(64, 'x');
+    }
+  }
+};
+
+// 除平均值外报告 p50/p99（纳秒），推迟析构改变的主要是分布的形状
+template <class _Make>
+static void releaseLoop(benchmark::State &state, _Make &&make) {
+  auto const n = static_cast<std::size_t>(state.range(0));
+  std::vector<double> samples;
+  for (auto _ : state) {
+    MySTL::shared_ptr<Big> p = make(n);
+    auto const start = std::chrono::steady_clock::now();
+    p.reset();
+    auto const stop = std::chrono::steady_clock::now();
+    double const t = std::chrono::duration<double>(stop - start).count();
+    state.SetIterationTime(t);
+    samples.push_back(t * 1e9);
+  }
+  std::sort(samples.begin(), samples.end());
+  state.counters["p50_ns"] = samples[samples.size() / 2];
+  state.counters["p99_ns"] = samples[samples.size() * 99 / 100];
+}
+
+static void BM_ReleaseInline(benchmark::State &state) {
+  releaseLoop(state, [](std::size_t n) { return MySTL::make_shared<Big>(n); });
+}
+BENCHMARK(BM_ReleaseInline)->Arg(16)->Arg(1024)->UseManualTime();
+
+static void BM_ReleaseBackground(benchmark::State &state) {
+  MySTL::deferred_reclaimer reclaimer(64, MySTL::deferred_mode::background);
+  releaseLoop(state, [&](std::size_t n) {
+    return MySTL::make_shared_deferred<Big>(reclaimer, n);
+  });
+  reclaimer.drain();
+  auto const s = reclaimer.stats();
+  state.counters["max_queued"] = static_cast<double>(s.max_queued);
+}
+BENCHMARK(BM_ReleaseBackground)->Arg(16)->Arg(1024)->UseManualTime();
+
+// caller 模式每 64 次释放中有一次承担整批析构，平均值与就地析构接近，
+// 但把析构集中到了可预期的位置
+static void BM_ReleaseCallerBatch(benchmark::State &state) {
+  MySTL::deferred_reclaimer reclaimer(64, MySTL::deferred_mode::caller);
+  releaseLoop(state, [&](std::size_t n) {
+    return MySTL::make_shared_deferred<Big>(reclaimer, n);
+  });
+  reclaimer.drain();
+}
+BENCHMARK(BM_ReleaseCallerBatch)->Arg(16)->Arg(1024)->UseManualTime();
+
+BENCHMARK_MAIN();
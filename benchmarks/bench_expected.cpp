@@ -0,0 +1,74 @@
+#include "expected.hpp"
+#include <benchmark/benchmark.h>
+#include <stdexcept>
+#include <string_view>
+
+// 解析失败的代价：抛异常与返回 expected 对比
+// 成功路径两者相近，失败率升高时异常的栈展开开销迅速占主导
+
+enum class parse_error { empty, not_a_digit };
+
+[[gnu::noinline]] static auto parseThrowing(std::string_view s) -> unsigned {
+  if (s.empty()) {
+    throw std::invalid_argument("empty");
+  }
+  unsigned v = 0;
+  for (char c : s) {
+    if (c < '0' || c > '9') {
+      throw std::invalid_argument("not a digit");
+    }
+    v = v * 10 + static_cast<unsigned>(c - '0');
+  }
+  return v;
+}
+
+[[gnu::noinline]] static auto parseExpected(std::string_view s)
+    -> MySTL::expected<unsigned, parse_error> {
+  if (s.empty()) {
+    return MySTL::unexpected(parse_error::empty);
+  }
+  unsigned v = 0;
+  for (char c : s) {
+    if (c < '0' || c > '9') {
+      return MySTL::unexpected(parse_error::not_a_digit);
+    }
+    v = v * 10 + static_cast<unsigned>(c - '0');
+  }
+  return v;
+}
+
+// range(0)：每 64 个输入中非法输入的个数
+static constexpr std::string_view kGood = "12345";
+static constexpr std::string_view kBad = "12x45";
+
+static void BM_ParseThrowing(benchmark::State &state) {
+  auto const bad = state.range(0);
+  for (auto _ : state) {
+    unsigned sum = 0;
+    for (int i = 0; i < 64; ++i) {
+      try {
+        sum += parseThrowing(i < bad ? kBad : kGood);
+      } catch (std::invalid_argument const &) {
+        ++sum;
+      }
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * 64);
+}
+BENCHMARK(BM_ParseThrowing)->Arg(0)->Arg(1)->Arg(16)->Arg(64);
+
+static void BM_ParseExpected(benchmark::State &state) {
+  auto const bad = state.range(0);
+  for (auto _ : state) {
+    unsigned sum = 0;
+    for (int i = 0; i < 64; ++i) {
+      sum += parseExpected(i < bad ? kBad : kGood).value_or(1);
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * 64);
+}
+BENCHMARK(BM_ParseExpected)->Arg(0)->Arg(1)->Arg(16)->Arg(64);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,111 @@
+#include "alloc_counter.hpp"
+#include "functional.hpp"
+#include <benchmark/benchmark.h>
+#include <functional>
+
+// 比较 MySTL::function 与 std::function、裸函数指针的调用和构造开销
+
+static int add_one(int x) { return x + 1; }
+
+static void BM_RawFunctionPointerCall(benchmark::State &state) {
+  int (*volatile fp)(int) = &add_one;
+  int (*f)(int) = fp;
+  int x = 0;
+  for (auto _ : state) {
+    x = f(x);
+    benchmark::DoNotOptimize(x);
+  }
+}
+BENCHMARK(BM_RawFunctionPointerCall);
+
+template <class _Func> static void BM_Call(benchmark::State &state) {
+  int k = 1;
+  _Func f = [k](int x) { return x + k; };
+  benchmark::DoNotOptimize(f);
+  int x = 0;
+  for (auto _ : state) {
+    x = f(x);
+    benchmark::DoNotOptimize(x);
+  }
+}
+BENCHMARK(BM_Call<std::function<int(int)>>);
+BENCHMARK(BM_Call<MySTL::function<int(int)>>);
+BENCHMARK(BM_Call<MySTL::move_only_function<int(int)>>);
+BENCHMARK(BM_Call<MySTL::inplace_function<int(int)>>);
+
+[[gnu::noinline]] static int
+call_through_ref(MySTL::function_ref<int(int)> f, int x) {
+  return f(x);
+}
+
+[[gnu::noinline]] static int
+call_through_function(MySTL::function<int(int)> const &f, int x) {
+  return f(x);
+}
+
+// 回调参数场景：被调方不内联，调用方每次都从lambda现场构造参数
+static void BM_CallbackParamFunctionRef(benchmark::State &state) {
+  int k = 1;
+  int x = 0;
+  AllocCounter allocs;
+  for (auto _ : state) {
+    x = call_through_ref([&k](int v) { return v + k; }, x);
+    benchmark::DoNotOptimize(x);
+  }
+  allocs.report(state);
+}
+BENCHMARK(BM_CallbackParamFunctionRef);
+
+static void BM_CallbackParamFunction(benchmark::State &state) {
+  int k = 1;
+  int x = 0;
+  AllocCounter allocs;
+  for (auto _ : state) {
+    x = call_through_function([&k](int v) { return v + k; }, x);
+    benchmark::DoNotOptimize(x);
+  }
+  allocs.report(state);
+}
+BENCHMARK(BM_CallbackParamFunction);
+
+template <class _Func> static void BM_ConstructSmall(benchmark::State &state) {
+  int a = 1, b = 2;
+  AllocCounter allocs;
+  for (auto _ : state) {
+    _Func f = [&a, &b](int x) { return x + a + b; };
+    benchmark::DoNotOptimize(f);
+  }
+  allocs.report(state);
+}
+BENCHMARK(BM_ConstructSmall<std::function<int(int)>>);
+BENCHMARK(BM_ConstructSmall<MySTL::function<int(int)>>);
+BENCHMARK(BM_ConstructSmall<MySTL::move_only_function<int(int)>>);
+
+template <class _Func> static void BM_CopySmall(benchmark::State &state) {
+  int a = 1, b = 2;
+  _Func f = [&a, &b](int x) { return x + a + b; };
+  AllocCounter allocs;
+  for (auto _ : state) {
+    _Func g = f;
+    benchmark::DoNotOptimize(g);
+  }
+  allocs.report(state);
+}
+BENCHMARK(BM_CopySmall<std::function<int(int)>>);
+BENCHMARK(BM_CopySmall<MySTL::function<int(int)>>);
+BENCHMARK(BM_CopySmall<MySTL::inplace_function<int(int)>>);
+
+// 捕获超过缓冲区大小时回退到堆分配
+template <class _Func> static void BM_ConstructLarge(benchmark::State &state) {
+  long a = 1, b = 2, c = 3, d = 4, e = 5;
+  AllocCounter allocs;
+  for (auto _ : state) {
+    _Func f = [a, b, c, d, e](int x) { return x + a + b + c + d + e; };
+    benchmark::DoNotOptimize(f);
+  }
+  allocs.report(state);
+}
+BENCHMARK(BM_ConstructLarge<std::function<int(int)>>);
+BENCHMARK(BM_ConstructLarge<MySTL::function<int(int)>>);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,89 @@
+#include "intrusive_ptr.hpp"
+#include "shared_ptr.hpp"
+#include <benchmark/benchmark.h>
+#include <memory>
+#include <thread>
+
+// 比较 intrusive_ptr 与 MySTL::shared_ptr、std::shared_ptr 作为图节点指针时的开销
+
+struct IntrusiveNode : MySTL::intrusive_ref_counter<IntrusiveNode> {
+  long value = 0;
+  MySTL::intrusive_ptr<IntrusiveNode> next;
+};
+
+struct LocalIntrusiveNode
+    : MySTL::intrusive_ref_counter<LocalIntrusiveNode,
+                                   MySTL::thread_unsafe_counter> {
+  long value = 0;
+  MySTL::intrusive_ptr<LocalIntrusiveNode> next;
+};
+
+struct MySTLNode {
+  long value = 0;
+  MySTL::shared_ptr<MySTLNode> next;
+};
+
+struct StdNode {
+  long value = 0;
+  std::shared_ptr<StdNode> next;
+};
+
+template <class _Node> static auto make_node() {
+  if constexpr (std::is_same_v<_Node, StdNode>) {
+    return std::make_shared<_Node>();
+  } else if constexpr (std::is_same_v<_Node, MySTLNode>) {
+    return MySTL::make_shared<_Node>();
+  } else {
+    return MySTL::make_intrusive<_Node>();
+  }
+}
+
+template <class _Node> static auto make_list(long n) {
+  auto head = make_node<_Node>();
+  auto cur = head;
+  for (long i = 1; i < n; ++i) {
+    cur->next = make_node<_Node>();
+    cur = cur->next;
+    cur->value = i;
+  }
+  return head;
+}
+
+// 以拥有引用的方式遍历链表，每一步拷贝一次指针
+template <class _Node> static void BM_Traverse(benchmark::State &state) {
+  auto head = make_list<_Node>(state.range(0));
+  for (auto _ : state) {
+    long sum = 0;
+    for (auto p = head; p; p = p->next) {
+      sum += p->value;
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+  // 逐个释放，避免长链表递归析构
+  while (head) {
+    head = std::move(head->next);
+  }
+}
+BENCHMARK(BM_Traverse<StdNode>)->Arg(1 << 10)->Arg(1 << 16);
+BENCHMARK(BM_Traverse<MySTLNode>)->Arg(1 << 10)->Arg(1 << 16);
+BENCHMARK(BM_Traverse<IntrusiveNode>)->Arg(1 << 10)->Arg(1 << 16);
+BENCHMARK(BM_Traverse<LocalIntrusiveNode>)->Arg(1 << 10)->Arg(1 << 16);
+
+static int const kMaxThreads =
+    static_cast<int>(std::max(2u, std::thread::hardware_concurrency()));
+
+// 每个线程拷贝自己的节点指针
+template <class _Node> static void BM_Copy(benchmark::State &state) {
+  auto node = make_node<_Node>();
+  for (auto _ : state) {
+    auto copy = node;
+    benchmark::DoNotOptimize(copy);
+  }
+}
+BENCHMARK(BM_Copy<StdNode>)->ThreadRange(1, kMaxThreads);
+BENCHMARK(BM_Copy<MySTLNode>)->ThreadRange(1, kMaxThreads);
+BENCHMARK(BM_Copy<IntrusiveNode>)->ThreadRange(1, kMaxThreads);
+BENCHMARK(BM_Copy<LocalIntrusiveNode>)->Threads(1);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,113 @@
+#include "atomic_shared_ptr.hpp"
+#include "lockfree.hpp"
+#include <atomic>
+#include <benchmark/benchmark.h>
+#include <thread>
+
+// 比较 epoch、hazard pointer 与 atomic<shared_ptr> 引用计数三种回收方式：
+// 读取一个不断被替换的共享对象，以及 Treiber 栈的压入弹出
+
+static int const kMaxThreads =
+    static_cast<int>(std::max(2u, std::thread::hardware_concurrency()));
+
+struct Snapshot {
+  int values[16] = {};
+};
+
+struct EpochSlot {
+  MySTL::epoch_domain domain;
+  std::atomic<Snapshot *> cur{new Snapshot};
+
+  ~EpochSlot() { delete cur.load(); }
+
+  template <class _Fn> void read(_Fn &&fn) {
+    MySTL::epoch_guard g(domain);
+    fn(*cur.load(std::memory_order_acquire));
+  }
+
+  void replace() { domain.retire(cur.exchange(new Snapshot)); }
+};
+
+struct HazardSlot {
+  MySTL::hazard_domain domain;
+  std::atomic<Snapshot *> cur{new Snapshot};
+
+  ~HazardSlot() { delete cur.load(); }
+
+  template <class _Fn> void read(_Fn &&fn) {
+    MySTL::hazard_pointer hp(domain);
+    fn(*hp.protect(cur));
+  }
+
+  void replace() { domain.retire(cur.exchange(new Snapshot)); }
+};
+
+struct SharedPtrSlot {
+  MySTL::atomic<MySTL::shared_ptr<Snapshot>> cur{
+      MySTL::make_shared<Snapshot>()};
+
+  template <class _Fn> void read(_Fn &&fn) { fn(*cur.load()); }
+
+  void replace() { cur.store(MySTL::make_shared<Snapshot>()); }
+};
+
+// 0号线程每1000次读取替换一次
+template <class _Slot> static void BM_ReadMostly(benchmark::State &state) {
+  static _Slot slot;
+  int i = 0;
+  for (auto _ : state) {
+    if (state.thread_index() == 0 && ++i % 1000 == 0) {
+      slot.replace();
+    }
+    slot.read([](Snapshot const &s) { benchmark::DoNotOptimize(s.values[0]); });
+  }
+}
+BENCHMARK(BM_ReadMostly<SharedPtrSlot>)->ThreadRange(1, kMaxThreads);
+BENCHMARK(BM_ReadMostly<EpochSlot>)->ThreadRange(1, kMaxThreads);
+BENCHMARK(BM_ReadMostly<HazardSlot>)->ThreadRange(1, kMaxThreads);
+
+// 以 atomic<shared_ptr> 作头指针的 Treiber 栈，节点由引用计数回收
+template <class _Tp> struct SharedPtrStack {
+  struct Node {
+    _Tp value;
+    MySTL::shared_ptr<Node> next;
+  };
+
+  MySTL::atomic<MySTL::shared_ptr<Node>> head;
+
+  void push(_Tp v) {
+    auto n = MySTL::make_shared<Node>(Node{v, head.load()});
+    while (!head.compare_exchange_weak(n->next, n)) {
+    }
+  }
+
+  auto try_pop() -> MySTL::optional<_Tp> {
+    auto h = head.load();
+    while (h && !head.compare_exchange_weak(h, h->next)) {
+    }
+    if (!h) {
+      return MySTL::nullopt;
+    }
+    return h->value;
+  }
+};
+
+template <class _Stack> static void BM_PushPop(benchmark::State &state) {
+  static _Stack stack;
+  int i = 0;
+  for (auto _ : state) {
+    stack.push(++i);
+    benchmark::DoNotOptimize(stack.try_pop());
+  }
+}
+BENCHMARK(BM_PushPop<SharedPtrStack<int>>)->ThreadRange(1, kMaxThreads);
+BENCHMARK(BM_PushPop<MySTL::treiber_stack<int, MySTL::epoch_domain>>)
+    ->ThreadRange(1, kMaxThreads);
+BENCHMARK(BM_PushPop<MySTL::treiber_stack<int, MySTL::hazard_domain>>)
+    ->ThreadRange(1, kMaxThreads);
+BENCHMARK(BM_PushPop<MySTL::ms_queue<int, MySTL::epoch_domain>>)
+    ->ThreadRange(1, kMaxThreads);
+BENCHMARK(BM_PushPop<MySTL::ms_queue<int, MySTL::hazard_domain>>)
+    ->ThreadRange(1, kMaxThreads);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,100 @@
+#include "alloc_counter.hpp"
+#include "optional.hpp"
+#include <algorithm>
+#include <benchmark/benchmark.h>
+#include <optional>
+#include <random>
+#include <vector>
+
+// 比较 MySTL::optional 与 std::optional 在 vector 中的拷贝与排序吞吐
+// 平凡可拷贝的 optional<int> 可以整体 memcpy，不必逐个调用拷贝构造函数
+
+template <class _Opt> static auto make_values(std::size_t n) -> std::vector<_Opt> {
+  std::mt19937 rng(42);
+  std::vector<_Opt> v;
+  v.reserve(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    if (rng() % 8 == 0) {
+      v.emplace_back();
+    } else {
+      v.emplace_back(static_cast<int>(rng() % 100000));
+    }
+  }
+  return v;
+}
+
+// 空值排在最前面
+template <class _Opt> static auto less(_Opt const &a, _Opt const &b) -> bool {
+  if (!a.has_value() || !b.has_value()) {
+    return !a.has_value() && b.has_value();
+  }
+  return *a < *b;
+}
+
+template <class _Opt> static void BM_VectorCopy(benchmark::State &state) {
+  auto const src = make_values<_Opt>(static_cast<std::size_t>(state.range(0)));
+  AllocCounter allocs;
+  for (auto _ : state) {
+    std::vector<_Opt> copy = src;
+    benchmark::DoNotOptimize(copy.data());
+    benchmark::ClobberMemory();
+  }
+  allocs.report(state);
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_VectorCopy<std::optional<int>>)->Arg(1 << 10)->Arg(1 << 16);
+BENCHMARK(BM_VectorCopy<MySTL::optional<int>>)->Arg(1 << 10)->Arg(1 << 16);
+
+template <class _Opt> static void BM_VectorSort(benchmark::State &state) {
+  auto const src = make_values<_Opt>(static_cast<std::size_t>(state.range(0)));
+  std::vector<_Opt> v;
+  for (auto _ : state) {
+    state.PauseTiming();
+    v = src;
+    state.ResumeTiming();
+    std::sort(v.begin(), v.end(), &less<_Opt>);
+    benchmark::DoNotOptimize(v.data());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_VectorSort<std::optional<int>>)->Arg(1 << 10)->Arg(1 << 16);
+BENCHMARK(BM_VectorSort<MySTL::optional<int>>)->Arg(1 << 10)->Arg(1 << 16);
+
+// 列式数组：带 bool 标记的 optional<long long> 占 16 字节，
+// 用保留值编码空状态的 optional<Id> 只占 8 字节
+struct Id {
+  long long v;
+  constexpr auto operator==(Id const &) const -> bool = default;
+};
+
+template <>
+struct MySTL::optional_niche<Id> : optional_niche_sentinel<Id, Id{-1}> {};
+
+static auto as_int(long long v) -> long long { return v; }
+static auto as_int(Id id) -> long long { return id.v; }
+
+template <class _Opt> static void BM_ScanColumn(benchmark::State &state) {
+  auto const n = static_cast<std::size_t>(state.range(0));
+  std::mt19937 rng(42);
+  std::vector<_Opt> column(n);
+  for (auto &slot : column) {
+    if (rng() % 8 != 0) {
+      slot.emplace(static_cast<long long>(rng() % 100000));
+    }
+  }
+  for (auto _ : state) {
+    long long sum = 0;
+    for (auto const &slot : column) {
+      if (slot.has_value()) {
+        sum += as_int(*slot);
+      }
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetBytesProcessed(state.iterations() * n * sizeof(_Opt));
+  state.counters["bytes_per_slot"] = sizeof(_Opt);
+}
+BENCHMARK(BM_ScanColumn<MySTL::optional<long long>>)->Arg(1 << 16)->Arg(1 << 22);
+BENCHMARK(BM_ScanColumn<MySTL::optional<Id>>)->Arg(1 << 16)->Arg(1 << 22);
+
+BENCHMARK_MAIN();
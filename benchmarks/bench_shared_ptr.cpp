@@ -0,0 +1,217 @@
+#include "alloc_counter.hpp"
+#include "local_shared_ptr.hpp"
+#include "shared_ptr.hpp"
+#include <benchmark/benchmark.h>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// 比较 MySTL::shared_ptr、local_shared_ptr 与 std::shared_ptr 的拷贝/析构吞吐量
+
+struct MySTLPtr {
+  template <class _Tp> using ptr = MySTL::shared_ptr<_Tp>;
+  template <class _Tp, class... _Args> static auto make(_Args &&...__args) {
+    return MySTL::make_shared<_Tp>(std::forward<_Args>(__args)...);
+  }
+};
+
+// 偏向计数：创建线程的拷贝不做原子读改写，类型仍是 MySTL::shared_ptr
+struct MySTLBiasedPtr {
+  template <class _Tp> using ptr = MySTL::shared_ptr<_Tp>;
+  template <class _Tp, class... _Args> static auto make(_Args &&...__args) {
+    return MySTL::make_shared_biased<_Tp>(std::forward<_Args>(__args)...);
+  }
+};
+
+// 分片计数：各线程的拷贝落在各自的分片上，类型仍是 MySTL::shared_ptr
+struct MySTLShardedPtr {
+  template <class _Tp> using ptr = MySTL::shared_ptr<_Tp>;
+  template <class _Tp, class... _Args> static auto make(_Args &&...__args) {
+    return MySTL::make_shared_sharded<_Tp>(std::forward<_Args>(__args)...);
+  }
+};
+
+struct MySTLLocalPtr {
+  template <class _Tp> using ptr = MySTL::local_shared_ptr<_Tp>;
+  template <class _Tp, class... _Args> static auto make(_Args &&...__args) {
+    return MySTL::make_local_shared<_Tp>(std::forward<_Args>(__args)...);
+  }
+};
+
+struct StdPtr {
+  template <class _Tp> using ptr = std::shared_ptr<_Tp>;
+  template <class _Tp, class... _Args> static auto make(_Args &&...__args) {
+    return std::make_shared<_Tp>(std::forward<_Args>(__args)...);
+  }
+};
+
+static int const kMaxThreads =
+    static_cast<int>(std::max(2u, std::thread::hardware_concurrency()));
+
+// 所有线程拷贝同一个对象，计数所在缓存行在核间来回传递
+// 偏向计数时 0 号线程是所有者，其余线程走共享计数，即混合负载
+// 分片计数时各线程只写自己的分片，items_per_second 应随线程数增长
+template <class _Ptr> static void BM_SharedCopyDestroy(benchmark::State &state) {
+  static typename _Ptr::template ptr<int> shared;
+  if (state.thread_index() == 0) {
+    shared = _Ptr::template make<int>(42);
+  }
+  for (auto _ : state) {
+    auto copy = shared;
+    benchmark::DoNotOptimize(copy);
+  }
+  state.SetItemsProcessed(state.iterations());
+  if (state.thread_index() == 0) {
+    shared = nullptr;
+  }
+}
+BENCHMARK(BM_SharedCopyDestroy<StdPtr>)->ThreadRange(1, kMaxThreads);
+BENCHMARK(BM_SharedCopyDestroy<MySTLPtr>)->ThreadRange(1, kMaxThreads);
+BENCHMARK(BM_SharedCopyDestroy<MySTLBiasedPtr>)->ThreadRange(1, kMaxThreads);
+BENCHMARK(BM_SharedCopyDestroy<MySTLShardedPtr>)->ThreadRange(1, kMaxThreads);
+
+// 每个线程拷贝自己的对象，没有竞争；偏向计数时全部是所有者的拷贝
+template <class _Ptr> static void BM_LocalCopyDestroy(benchmark::State &state) {
+  auto local = _Ptr::template make<int>(42);
+  for (auto _ : state) {
+    auto copy = local;
+    benchmark::DoNotOptimize(copy);
+  }
+}
+BENCHMARK(BM_LocalCopyDestroy<StdPtr>)->ThreadRange(1, kMaxThreads);
+BENCHMARK(BM_LocalCopyDestroy<MySTLPtr>)->ThreadRange(1, kMaxThreads);
+BENCHMARK(BM_LocalCopyDestroy<MySTLBiasedPtr>)->ThreadRange(1, kMaxThreads);
+BENCHMARK(BM_LocalCopyDestroy<MySTLLocalPtr>)->ThreadRange(1, kMaxThreads);
+
+// 只计拷贝（加计数）的开销，析构在暂停计时后成批进行
+// 普通控制块的拷贝只有一次读取和一次原子加，与偏向、分片计数的分支无关
+template <class _Ptr> static void BM_CopyOnly(benchmark::State &state) {
+  using ptr = typename _Ptr::template ptr<int>;
+  constexpr std::size_t kBatch = 1024;
+  auto local = _Ptr::template make<int>(42);
+  std::vector<ptr> copies;
+  copies.reserve(kBatch);
+  for (auto _ : state) {
+    for (std::size_t i = 0; i < kBatch; ++i) {
+      copies.push_back(local);
+    }
+    benchmark::DoNotOptimize(copies.data());
+    state.PauseTiming();
+    copies.clear();
+    state.ResumeTiming();
+  }
+  state.SetItemsProcessed(state.iterations() * kBatch);
+}
+BENCHMARK(BM_CopyOnly<StdPtr>);
+BENCHMARK(BM_CopyOnly<MySTLPtr>);
+BENCHMARK(BM_CopyOnly<MySTLBiasedPtr>);
+
+// 创建后立刻由唯一持有者释放
+template <class _Ptr> static void BM_MakeAndRelease(benchmark::State &state) {
+  AllocCounter allocs;
+  for (auto _ : state) {
+    auto p = _Ptr::template make<int>(42);
+    benchmark::DoNotOptimize(p);
+  }
+  allocs.report(state);
+}
+BENCHMARK(BM_MakeAndRelease<StdPtr>)->ThreadRange(1, kMaxThreads);
+BENCHMARK(BM_MakeAndRelease<MySTLPtr>)->ThreadRange(1, kMaxThreads);
+BENCHMARK(BM_MakeAndRelease<MySTLBiasedPtr>)->ThreadRange(1, kMaxThreads);
+BENCHMARK(BM_MakeAndRelease<MySTLLocalPtr>)->ThreadRange(1, kMaxThreads);
+
+// 接管已有指针：控制块单独分配，MySTL 从线程本地池中取
+template <class _Ptr> static void BM_AdoptRelease(benchmark::State &state) {
+  AllocCounter allocs;
+  for (auto _ : state) {
+    typename _Ptr::template ptr<int> p(new int(42));
+    benchmark::DoNotOptimize(p);
+  }
+  allocs.report(state);
+}
+BENCHMARK(BM_AdoptRelease<StdPtr>)->ThreadRange(1, kMaxThreads);
+BENCHMARK(BM_AdoptRelease<MySTLPtr>)->ThreadRange(1, kMaxThreads);
+
+// 生产者线程接管指针，整批交给消费者线程释放，控制块全部跨线程归还
+template <class _Ptr> static void BM_AdoptReleaseRemote(benchmark::State &state) {
+  using ptr = typename _Ptr::template ptr<int>;
+  constexpr std::size_t kBatch = 1024;
+  std::mutex mutex;
+  std::condition_variable cv;
+  std::vector<ptr> handoff;
+  bool done = false;
+  std::thread consumer([&] {
+    std::vector<ptr> local;
+    for (;;) {
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait(lock, [&] { return done || !handoff.empty(); });
+        if (handoff.empty()) {
+          return;
+        }
+        local.swap(handoff);
+      }
+      cv.notify_one();
+      local.clear();
+    }
+  });
+  std::vector<ptr> batch;
+  batch.reserve(kBatch);
+  for (auto _ : state) {
+    for (std::size_t i = 0; i < kBatch; ++i) {
+      batch.emplace_back(new int(42));
+    }
+    std::unique_lock<std::mutex> lock(mutex);
+    cv.wait(lock, [&] { return handoff.empty(); });
+    handoff.swap(batch);
+    lock.unlock();
+    cv.notify_one();
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    done = true;
+  }
+  cv.notify_one();
+  consumer.join();
+  state.SetItemsProcessed(state.iterations() * kBatch);
+}
+BENCHMARK(BM_AdoptReleaseRemote<StdPtr>)->UseRealTime();
+BENCHMARK(BM_AdoptReleaseRemote<MySTLPtr>)->UseRealTime();
+
+// 数组：单次分配（make_shared<T[]>）对比分别分配数组与控制块
+static void BM_MakeArray_Std(benchmark::State &state) {
+  auto const n = static_cast<std::size_t>(state.range(0));
+  AllocCounter allocs;
+  for (auto _ : state) {
+    auto p = std::make_shared<int[]>(n);
+    benchmark::DoNotOptimize(p);
+  }
+  allocs.report(state);
+}
+BENCHMARK(BM_MakeArray_Std)->Arg(16)->Arg(1024);
+
+static void BM_MakeArray_MySTL(benchmark::State &state) {
+  auto const n = static_cast<std::size_t>(state.range(0));
+  AllocCounter allocs;
+  for (auto _ : state) {
+    auto p = MySTL::make_shared<int[]>(n);
+    benchmark::DoNotOptimize(p);
+  }
+  allocs.report(state);
+}
+BENCHMARK(BM_MakeArray_MySTL)->Arg(16)->Arg(1024);
+
+static void BM_NewArray_MySTL(benchmark::State &state) {
+  auto const n = static_cast<std::size_t>(state.range(0));
+  AllocCounter allocs;
+  for (auto _ : state) {
+    MySTL::shared_ptr<int[]> p(new int[n]());
+    benchmark::DoNotOptimize(p);
+  }
+  allocs.report(state);
+}
+BENCHMARK(BM_NewArray_MySTL)->Arg(16)->Arg(1024);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,77 @@
+#include "alloc_counter.hpp"
+#include "thread_pool.hpp"
+#include <benchmark/benchmark.h>
+#include <thread>
+
+// 工作窃取线程池：分治任务随线程数的扩展性，以及单个任务的提交开销
+
+static int const kMaxThreads =
+    static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+
+static auto FibSeq(int n) -> long { return n < 2 ? n : FibSeq(n - 1) + FibSeq(n - 2); }
+
+// 低于阈值时顺序计算，每个任务有足够的工作量
+static auto Fib(MySTL::thread_pool &pool, int n) -> long {
+  if (n < 20) {
+    return FibSeq(n);
+  }
+  auto a = pool.submit([&pool, n] { return Fib(pool, n - 1); });
+  long const b = Fib(pool, n - 2);
+  return a.get() + b;
+}
+
+static void BM_FibSequential(benchmark::State &state) {
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(FibSeq(30));
+  }
+}
+BENCHMARK(BM_FibSequential)->Unit(benchmark::kMillisecond);
+
+// 参数为线程池大小
+static void BM_FibForkJoin(benchmark::State &state) {
+  MySTL::thread_pool pool(static_cast<std::size_t>(state.range(0)));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(pool.submit([&pool] { return Fib(pool, 30); }).get());
+  }
+}
+BENCHMARK(BM_FibForkJoin)
+    ->RangeMultiplier(2)
+    ->Range(1, kMaxThreads)
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+
+// 外部线程提交一个空任务并等待：包含唤醒休眠线程的开销
+static void BM_SubmitGet(benchmark::State &state) {
+  MySTL::thread_pool pool(1);
+  AllocCounter allocs;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(pool.submit([] { return 1; }).get());
+  }
+  allocs.report(state);
+}
+BENCHMARK(BM_SubmitGet);
+
+// 工作线程内部压入大量小任务：本地队列与节点池的吞吐
+static void BM_PostFromWorker(benchmark::State &state) {
+  MySTL::thread_pool pool(static_cast<std::size_t>(state.range(0)));
+  std::atomic<long> sum{0};
+  constexpr int kTasks = 10000;
+  for (auto _ : state) {
+    pool.submit([&] {
+      for (int i = 0; i < kTasks; ++i) {
+        pool.post([&sum, i] { sum.fetch_add(i, std::memory_order_relaxed); });
+      }
+    }).get();
+    while (sum.load() != static_cast<long>(kTasks) * (kTasks - 1) / 2) {
+      std::this_thread::yield();
+    }
+    sum = 0;
+  }
+  state.SetItemsProcessed(state.iterations() * kTasks);
+}
+BENCHMARK(BM_PostFromWorker)
+    ->RangeMultiplier(2)
+    ->Range(1, kMaxThreads)
+    ->UseRealTime();
+
+BENCHMARK_MAIN();
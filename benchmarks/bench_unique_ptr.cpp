@@ -0,0 +1,69 @@
+#include "alloc_counter.hpp"
+#include "unique_ptr.hpp"
+#include <algorithm>
+#include <benchmark/benchmark.h>
+#include <memory>
+#include <vector>
+
+// 比较 MySTL::unique_ptr 与 std::unique_ptr 的创建、移动及在容器中的开销
+
+struct MySTLUnique {
+  template <class _Tp> using ptr = MySTL::unique_ptr<_Tp>;
+  template <class _Tp, class... _Args> static auto make(_Args &&...__args) {
+    return MySTL::make_unique<_Tp>(std::forward<_Args>(__args)...);
+  }
+};
+
+struct StdUnique {
+  template <class _Tp> using ptr = std::unique_ptr<_Tp>;
+  template <class _Tp, class... _Args> static auto make(_Args &&...__args) {
+    return std::make_unique<_Tp>(std::forward<_Args>(__args)...);
+  }
+};
+
+template <class _Ptr> static void BM_MakeAndRelease(benchmark::State &state) {
+  AllocCounter allocs;
+  for (auto _ : state) {
+    auto p = _Ptr::template make<int>(42);
+    benchmark::DoNotOptimize(p);
+  }
+  allocs.report(state);
+}
+BENCHMARK(BM_MakeAndRelease<StdUnique>);
+BENCHMARK(BM_MakeAndRelease<MySTLUnique>);
+
+// 来回移动同一个指针，只有指针的拷贝与置空
+template <class _Ptr> static void BM_Move(benchmark::State &state) {
+  auto a = _Ptr::template make<int>(42);
+  typename _Ptr::template ptr<int> b;
+  for (auto _ : state) {
+    b = std::move(a);
+    benchmark::DoNotOptimize(b);
+    a = std::move(b);
+    benchmark::DoNotOptimize(a);
+  }
+}
+BENCHMARK(BM_Move<StdUnique>);
+BENCHMARK(BM_Move<MySTLUnique>);
+
+// vector 扩容时逐个移动元素，按指向的值排序
+template <class _Ptr> static void BM_VectorSort(benchmark::State &state) {
+  auto const n = static_cast<int>(state.range(0));
+  for (auto _ : state) {
+    state.PauseTiming();
+    std::vector<typename _Ptr::template ptr<int>> v;
+    for (int i = 0; i < n; ++i) {
+      v.push_back(_Ptr::template make<int>((i * 7919) % n));
+    }
+    state.ResumeTiming();
+    std::sort(v.begin(), v.end(), [](auto const &a, auto const &b) {
+      return *a < *b;
+    });
+    benchmark::DoNotOptimize(v.data());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_VectorSort<StdUnique>)->Arg(1 << 12);
+BENCHMARK(BM_VectorSort<MySTLUnique>)->Arg(1 << 12);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,53 @@
+#!/usr/bin/env python3
+"""比较两次 bench_json 的结果。
+
+用法: compare.py <旧结果目录或文件> <新结果目录或文件> [--threshold 0.05]
+
+按基准名称匹配，打印 real_time 的变化比例与 allocs_per_op 的变化，
+超过阈值的变慢项以非零退出码返回，便于在提交之间发现回归。
+"""
+
+import argparse
+import json
+import pathlib
+import sys
+
+
+def load(path):
+    path = pathlib.Path(path)
+    files = sorted(path.glob("*.json")) if path.is_dir() else [path]
+    results = {}
+    for f in files:
+        for b in json.loads(f.read_text())["benchmarks"]:
+            if b.get("run_type", "iteration") != "iteration":
+                continue
+            results[f"{f.stem}/{b['name']}"] = b
+    return results
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("old")
+    parser.add_argument("new")
+    parser.add_argument("--threshold", type=float, default=0.05)
+    args = parser.parse_args()
+
+    old, new = load(args.old), load(args.new)
+    regressions = 0
+    for name in sorted(old.keys() & new.keys()):
+        o, n = old[name], new[name]
+        delta = n["real_time"] / o["real_time"] - 1
+        line = f"{name:<70} {o['real_time']:>12.1f} {n['real_time']:>12.1f} {delta:+8.1%}"
+        if "allocs_per_op" in o or "allocs_per_op" in n:
+            line += f"  allocs {o.get('allocs_per_op', 0):.2f} -> {n.get('allocs_per_op', 0):.2f}"
+        if delta > args.threshold:
+            line += "  REGRESSION"
+            regressions += 1
+        print(line)
+    for name in sorted(new.keys() - old.keys()):
+        print(f"{name:<70} (new)")
+    return 1 if regressions else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -1,13 +1,14 @@
 #ifndef _FUNCTION_HPP
 #define _FUNCTION_HPP
 
-#include <cassert>
+#include "_function_base.hpp"
+#include "_optional_niche.hpp"
 #include <cstddef>
 #include <functional>
-#include <memory>
 #include <type_traits>
 #include <typeinfo>
 #include <utility>
+
 namespace MySTL {
 
 template <class _FnSig> struct function {
@@ -18,34 +19,12 @@ template <class _FnSig> struct function {
 
 template <class _Ret, class... _Args> struct function<_Ret(_Args...)> {
 private:
-  struct _FuncBase {
-    virtual auto _M_call(_Args... __args) -> _Ret = 0;
-    virtual auto _M_clone() const -> std::unique_ptr<_FuncBase> = 0;
-    virtual auto _M_type() const -> std::type_info const & = 0;
-    virtual ~_FuncBase() = default;
-  };
-
-  template <class _Fn> struct _FuncImpl : _FuncBase {
-    _Fn _M_f;
-
-    template <class... _CArgs>
-    explicit _FuncImpl(std::in_place_t, _CArgs &&...__args)
-        : _M_f(std::forward<_CArgs>(__args)...) {}
-
-    auto _M_call(_Args... __args) -> _Ret override {
-      return std::invoke(_M_f, std::forward<_Args>(__args)...);
-    }
-
-    auto _M_clone() const -> std::unique_ptr<_FuncBase> override {
-      return std::make_unique<_FuncImpl>(std::in_place, _M_f);
-    }
+  using _Storage =
+      _FuncStorage<MYSTL_FUNCTION_INLINE_SIZE, alignof(std::max_align_t)>;
 
-    auto _M_type() const -> std::type_info const & override {
-      return typeid(_Fn);
-    }
-  };
+  _FuncBase<_Storage, _Ret(_Args...)> _M_base;
 
-  std::unique_ptr<_FuncBase> _M_base;
+  template <class> friend struct optional_niche;
 
 public:
   function() = default;
@@ -57,48 +36,83 @@ public:
             && (!std::is_same_v<
                    std::decay_t<_Fn>,
                    function<_Ret(_Args...)>>) // 确保_Fn不是Function本身
-  function(_Fn &&__f) // 没有explicit，允许lambda表达式隐式转换为Function
-      : _M_base(std::make_unique<_FuncImpl<std::decay_t<_Fn>>>(
-            std::in_place, std::forward<_Fn>(__f))) {}
+  function(_Fn &&__f) { // 没有explicit，允许lambda表达式隐式转换为Function
+    _M_base.template _M_create<std::decay_t<_Fn>, true>(
+        std::forward<_Fn>(__f));
+  }
 
-  function(function &&) = default;
+  function(function &&__that) noexcept {
+    _M_base._M_move_from(__that._M_base);
+  }
 
-  auto operator=(function &&) -> function & = default;
+  auto operator=(function &&__that) noexcept -> function & {
+    if (this != &__that) {
+      _M_base._M_reset();
+      _M_base._M_move_from(__that._M_base);
+    }
+    return *this;
+  }
 
-  function(function const &__that)
-      : _M_base(__that._M_base ? __that._M_base->_M_clone() : nullptr) {}
+  function(function const &__that) { _M_base._M_copy_from(__that._M_base); }
 
   auto operator=(function const &__that) -> function & {
     if (this != &__that) {
-      _M_base = __that._M_base ? __that._M_base->_M_clone() : nullptr;
+      function(__that).swap(*this);
     }
     return *this;
   }
 
-  explicit operator bool() const noexcept { return _M_base != nullptr; }
+  ~function() noexcept { _M_base._M_reset(); }
+
+  explicit operator bool() const noexcept {
+    return _M_base._M_manager != nullptr;
+  }
 
-  bool operator==(std::nullptr_t) const noexcept { return _M_base == nullptr; }
+  bool operator==(std::nullptr_t) const noexcept {
+    return _M_base._M_manager == nullptr;
+  }
 
-  bool operator!=(std::nullptr_t) const noexcept { return _M_base != nullptr; }
+  bool operator!=(std::nullptr_t) const noexcept {
+    return _M_base._M_manager != nullptr;
+  }
 
+  // 空对象的调用指针会抛出std::bad_function_call，这里无需额外判断
   auto operator()(_Args... __args) const -> _Ret {
-    if (!_M_base) [[unlikely]] {
-      throw std::bad_function_call();
-    }
-    return _M_base->_M_call(std::forward<_Args>(__args)...);
+    return _M_base._M_invoker(_M_base._M_storage,
+                              std::forward<_Args>(__args)...);
+  }
+
+  // 不抛出bad_function_call的调用，空对象返回unexpected(call_errc::empty)
+  auto try_invoke(_Args... __args) const -> expected<_Ret, call_errc>
+    requires(!std::is_reference_v<_Ret>)
+  {
+    return _M_base._M_try_invoke(std::forward<_Args>(__args)...);
   }
 
   auto target_type() const noexcept -> std::type_info const & {
-    return _M_base ? _M_base->_M_type() : typeid(void);
+    return _M_base._M_target_type();
   }
   template <class _Fn> auto target() const noexcept -> _Fn * {
-    return _M_base && typeid(_Fn) == _M_base->_M_type()
-               ? std::addressof(
-                     static_cast<_FuncImpl<_Fn> *>(_M_base.get())->_M_f)
-               : nullptr;
+    return _M_base.template _M_target<_Fn>();
   }
 
-  void swap(function &__that) noexcept { _M_base.swap(__that._M_base); }
+  void swap(function &__that) noexcept { _M_base._M_swap(__that._M_base); }
+};
+
+// optional<function>的空标记是一个不可能的管理表地址，空function仍是合法的值
+template <class _Ret, class... _Args>
+struct optional_niche<function<_Ret(_Args...)>> {
+  using _Manager = std::remove_pointer_t<
+      decltype(std::declval<function<_Ret(_Args...)> &>()._M_base._M_manager)>;
+
+  static void set_empty(function<_Ret(_Args...)> *__p) noexcept {
+    std::construct_at(__p);
+    __p->_M_base._M_manager = _S_niche_pointer<_Manager>();
+  }
+
+  static auto is_empty(function<_Ret(_Args...)> const &__v) noexcept -> bool {
+    return __v._M_base._M_manager == _S_niche_pointer<_Manager>();
+  }
 };
 
 } // namespace MySTL
@@ -0,0 +1,238 @@
+#ifndef _FUNCTION_BASE_HPP
+#define _FUNCTION_BASE_HPP
+
+#include "alloc_hooks.hpp"
+#include "expected.hpp"
+#include <cstddef>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <typeinfo>
+#include <utility>
+
+// function/move_only_function小对象缓冲区大小，可在包含头文件前自行定义
+#ifndef MYSTL_FUNCTION_INLINE_SIZE
+#define MYSTL_FUNCTION_INLINE_SIZE (3 * sizeof(void *))
+#endif
+
+namespace MySTL {
+
+// 类型擦除的存储：小对象直接放在_M_buf里，大对象只保存堆指针
+template <std::size_t _Size, std::size_t _Align> union _FuncStorage {
+  static_assert(_Size >= sizeof(void *), "storage must hold a pointer");
+
+  void *_M_ptr = nullptr;
+  alignas(_Align) unsigned char _M_buf[_Size];
+};
+
+// 每种可调用对象一张的静态管理表，调用路径不经过这里
+// 为空的项表示对应操作可以直接按字节拷贝存储（或什么都不用做）
+template <class _Storage> struct _FuncManager {
+  void (*_M_clone)(_Storage &__dst, _Storage const &__src);
+  void (*_M_move)(_Storage &__dst, _Storage &__src) noexcept; // 移动并析构源
+  void (*_M_destroy)(_Storage &__s) noexcept;
+  auto (*_M_type)() noexcept -> std::type_info const &;
+};
+
+template <class _Fn, class _Storage, bool _HeapAllowed = true>
+struct _FuncHandler {
+  // 能放进缓冲区且移动不抛异常的可调用对象才走小对象优化
+  static constexpr bool _S_local =
+      sizeof(_Fn) <= sizeof(_Storage) &&
+      alignof(_Storage) % alignof(_Fn) == 0 &&
+      std::is_nothrow_move_constructible_v<_Fn>;
+
+  static_assert(_HeapAllowed || _S_local,
+                "callable does not fit in the inline storage or its move "
+                "constructor may throw");
+
+  static constexpr bool _S_trivial = _S_local &&
+                                     std::is_trivially_copyable_v<_Fn> &&
+                                     std::is_trivially_destructible_v<_Fn>;
+
+  static auto _S_get(_Storage const &__s) noexcept -> _Fn * {
+    if constexpr (_S_local) {
+      return std::launder(reinterpret_cast<_Fn *>(
+          const_cast<unsigned char *>(__s._M_buf)));
+    } else {
+      return static_cast<_Fn *>(__s._M_ptr);
+    }
+  }
+
+  template <class... _CArgs>
+  static void _S_create(_Storage &__s, _CArgs &&...__args) {
+    if constexpr (_S_local) {
+      ::new (static_cast<void *>(__s._M_buf))
+          _Fn(std::forward<_CArgs>(__args)...);
+    } else {
+      void *__mem =
+          _S_hookAllocate(alloc_site::function, sizeof(_Fn), alignof(_Fn));
+      try {
+        __s._M_ptr = ::new (__mem) _Fn(std::forward<_CArgs>(__args)...);
+      } catch (...) {
+        _S_hookDeallocate(alloc_site::function, __mem, sizeof(_Fn),
+                          alignof(_Fn));
+        throw;
+      }
+    }
+  }
+
+  static void _S_clone(_Storage &__dst, _Storage const &__src) {
+    _S_create(__dst, std::as_const(*_S_get(__src)));
+  }
+
+  static void _S_move(_Storage &__dst, _Storage &__src) noexcept {
+    _Fn *__f = _S_get(__src);
+    ::new (static_cast<void *>(__dst._M_buf)) _Fn(std::move(*__f));
+    __f->~_Fn();
+  }
+
+  static void _S_destroy(_Storage &__s) noexcept {
+    if constexpr (_S_local) {
+      _S_get(__s)->~_Fn();
+    } else {
+      _Fn *__f = _S_get(__s);
+      __f->~_Fn();
+      _S_hookDeallocate(alloc_site::function, __f, sizeof(_Fn), alignof(_Fn));
+    }
+  }
+
+  static auto _S_type() noexcept -> std::type_info const & {
+    return typeid(_Fn);
+  }
+
+  template <class _Ret, class... _Args>
+  static auto _S_invoke(_Storage const &__s, _Args &&...__args) -> _Ret {
+    if constexpr (std::is_void_v<_Ret>) {
+      std::invoke(*_S_get(__s), std::forward<_Args>(__args)...);
+    } else {
+      return std::invoke(*_S_get(__s), std::forward<_Args>(__args)...);
+    }
+  }
+
+  // 堆上的对象移动时只需拷贝指针，平凡类型的拷贝与移动都是memcpy
+  static constexpr auto _S_clone_fn() noexcept {
+    if constexpr (std::is_copy_constructible_v<_Fn> && !_S_trivial) {
+      return &_S_clone;
+    } else {
+      return static_cast<decltype(&_S_clone)>(nullptr);
+    }
+  }
+
+  static constexpr auto _S_move_fn() noexcept {
+    if constexpr (_S_local && !_S_trivial) {
+      return &_S_move;
+    } else {
+      return static_cast<decltype(&_S_move)>(nullptr);
+    }
+  }
+
+  static constexpr _FuncManager<_Storage> _S_manager = {
+      _S_clone_fn(),
+      _S_move_fn(),
+      _S_trivial ? nullptr : &_S_destroy,
+      &_S_type,
+  };
+};
+
+// try_invoke的错误码：调用了空的function
+enum class call_errc { empty };
+
+template <class _Storage, class _FnSig> struct _FuncBase;
+
+// function/move_only_function共用的类型擦除部分：
+// 调用指针直接放在对象里，一次调用只有一次间接跳转
+template <class _Storage, class _Ret, class... _Args>
+struct _FuncBase<_Storage, _Ret(_Args...)> {
+  using _Invoker = auto (*)(_Storage const &, _Args &&...) -> _Ret;
+
+  _Storage _M_storage;
+  _FuncManager<_Storage> const *_M_manager = nullptr;
+  _Invoker _M_invoker = &_S_empty_invoke;
+
+  [[noreturn]] static auto _S_empty_invoke(_Storage const &, _Args &&...)
+      -> _Ret {
+    throw std::bad_function_call();
+  }
+
+  // 空对象返回错误而不抛异常；被调用对象自己抛出的异常照常传播
+  auto _M_try_invoke(_Args &&...__args) const -> expected<_Ret, call_errc> {
+    if (!_M_manager) [[unlikely]] {
+      return unexpected(call_errc::empty);
+    }
+    if constexpr (std::is_void_v<_Ret>) {
+      _M_invoker(_M_storage, std::forward<_Args>(__args)...);
+      return {};
+    } else {
+      return _M_invoker(_M_storage, std::forward<_Args>(__args)...);
+    }
+  }
+
+  template <class _Fn, bool _HeapAllowed, class... _CArgs>
+  void _M_create(_CArgs &&...__args) {
+    using _Handler = _FuncHandler<_Fn, _Storage, _HeapAllowed>;
+    _Handler::_S_create(_M_storage, std::forward<_CArgs>(__args)...);
+    _M_manager = &_Handler::_S_manager;
+    _M_invoker = &_Handler::template _S_invoke<_Ret, _Args...>;
+  }
+
+  void _M_reset() noexcept {
+    if (_M_manager && _M_manager->_M_destroy) {
+      _M_manager->_M_destroy(_M_storage);
+    }
+    _M_manager = nullptr;
+    _M_invoker = &_S_empty_invoke;
+  }
+
+  // 要求*this为空
+  void _M_copy_from(_FuncBase const &__that) {
+    if (!__that._M_manager) {
+      return;
+    }
+    if (__that._M_manager->_M_clone) {
+      __that._M_manager->_M_clone(_M_storage, __that._M_storage);
+    } else {
+      _M_storage = __that._M_storage;
+    }
+    _M_manager = __that._M_manager;
+    _M_invoker = __that._M_invoker;
+  }
+
+  // 要求*this为空
+  void _M_move_from(_FuncBase &__that) noexcept {
+    if (!__that._M_manager) {
+      return;
+    }
+    if (__that._M_manager->_M_move) {
+      __that._M_manager->_M_move(_M_storage, __that._M_storage);
+    } else {
+      _M_storage = __that._M_storage;
+    }
+    _M_manager = std::exchange(__that._M_manager, nullptr);
+    _M_invoker = std::exchange(__that._M_invoker, &_S_empty_invoke);
+  }
+
+  void _M_swap(_FuncBase &__that) noexcept {
+    if (this == &__that) {
+      return;
+    }
+    _FuncBase __tmp;
+    __tmp._M_move_from(__that);
+    __that._M_move_from(*this);
+    _M_move_from(__tmp);
+  }
+
+  template <class _Fn> auto _M_target() const noexcept -> _Fn * {
+    return _M_manager && _M_manager->_M_type() == typeid(_Fn)
+               ? _FuncHandler<_Fn, _Storage>::_S_get(_M_storage)
+               : nullptr;
+  }
+
+  auto _M_target_type() const noexcept -> std::type_info const & {
+    return _M_manager ? _M_manager->_M_type() : typeid(void);
+  }
+};
+
+} // namespace MySTL
+
+#endif
@@ -0,0 +1,79 @@
+#ifndef _FUNCTION_REF_HPP
+#define _FUNCTION_REF_HPP
+
+#include <functional>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+namespace MySTL {
+
+template <class _FnSig> struct function_ref {
+  static_assert(!std::is_same_v<_FnSig, _FnSig>,
+                "not a valid function signature");
+};
+
+// 不拥有可调用对象的引用：只保存对象指针和调用跳板，从不分配内存
+// 被引用的对象必须比function_ref活得久，适合作为回调参数
+template <class _Ret, class... _Args> struct function_ref<_Ret(_Args...)> {
+private:
+  union _BoundEntity {
+    void *_M_obj;
+    void (*_M_fn)();
+  };
+
+  using _Thunk = auto (*)(_BoundEntity, _Args &&...) -> _Ret;
+
+  _BoundEntity _M_bound;
+  _Thunk _M_thunk;
+
+  template <class _Fn>
+  static auto _S_call_obj(_BoundEntity __b, _Args &&...__args) -> _Ret {
+    _Fn &__f = *static_cast<_Fn *>(__b._M_obj);
+    if constexpr (std::is_void_v<_Ret>) {
+      std::invoke(__f, std::forward<_Args>(__args)...);
+    } else {
+      return std::invoke(__f, std::forward<_Args>(__args)...);
+    }
+  }
+
+  template <class _Fn>
+  static auto _S_call_fn(_BoundEntity __b, _Args &&...__args) -> _Ret {
+    _Fn *__f = reinterpret_cast<_Fn *>(__b._M_fn);
+    if constexpr (std::is_void_v<_Ret>) {
+      std::invoke(__f, std::forward<_Args>(__args)...);
+    } else {
+      return std::invoke(__f, std::forward<_Args>(__args)...);
+    }
+  }
+
+public:
+  template <class _Fn>
+    requires(std::is_function_v<_Fn>) &&
+            (std::is_invocable_r_v<_Ret, _Fn *, _Args...>)
+  function_ref(_Fn *__f) noexcept : _M_thunk(&_S_call_fn<_Fn>) {
+    _M_bound._M_fn = reinterpret_cast<void (*)()>(__f);
+  }
+
+  template <class _Fn>
+    requires(!std::is_same_v<std::remove_cvref_t<_Fn>, function_ref>) &&
+            (!std::is_function_v<std::remove_reference_t<_Fn>>) &&
+            (std::is_invocable_r_v<_Ret, std::remove_reference_t<_Fn> &,
+                                   _Args...>)
+  function_ref(_Fn &&__f) noexcept
+      : _M_thunk(&_S_call_obj<std::remove_reference_t<_Fn>>) {
+    _M_bound._M_obj =
+        const_cast<void *>(static_cast<void const *>(std::addressof(__f)));
+  }
+
+  function_ref(function_ref const &) = default;
+  auto operator=(function_ref const &) -> function_ref & = default;
+
+  auto operator()(_Args... __args) const -> _Ret {
+    return _M_thunk(_M_bound, std::forward<_Args>(__args)...);
+  }
+};
+
+} // namespace MySTL
+
+#endif
@@ -0,0 +1,116 @@
+#ifndef _INPLACE_FUNCTION_HPP
+#define _INPLACE_FUNCTION_HPP
+
+#include "_function_base.hpp"
+#include <cstddef>
+#include <functional>
+#include <type_traits>
+#include <typeinfo>
+#include <utility>
+
+namespace MySTL {
+
+template <class _FnSig, std::size_t _Capacity = MYSTL_FUNCTION_INLINE_SIZE,
+          std::size_t _Alignment = alignof(std::max_align_t)>
+struct inplace_function {
+  static_assert(!std::is_same_v<_FnSig, _FnSig>,
+                "not a valid function signature");
+};
+
+// 固定容量、保证不分配内存的function：放不进缓冲区的可调用对象直接编译失败
+// 与function共用_FuncBase，平凡可拷贝的对象拷贝和移动都只是memcpy
+template <class _Ret, class... _Args, std::size_t _Capacity,
+          std::size_t _Alignment>
+struct inplace_function<_Ret(_Args...), _Capacity, _Alignment> {
+private:
+  using _Storage = _FuncStorage<_Capacity, _Alignment>;
+
+  // _Storage按_Alignment补齐后可能比_Capacity大，按声明的容量判断
+  template <class _Fn>
+  static constexpr bool _S_fits =
+      sizeof(_Fn) <= _Capacity && _FuncHandler<_Fn, _Storage>::_S_local;
+
+  _FuncBase<_Storage, _Ret(_Args...)> _M_base;
+
+public:
+  static constexpr std::size_t capacity = _Capacity;
+  static constexpr std::size_t alignment = _Alignment;
+
+  inplace_function() = default;
+  inplace_function(std::nullptr_t) noexcept : inplace_function() {}
+
+  template <class _Fn>
+    requires(std::invocable<_Fn, _Args...>) &&
+            (std::is_copy_constructible_v<std::decay_t<_Fn>>) &&
+            (!std::is_same_v<std::decay_t<_Fn>, inplace_function>) &&
+            (_S_fits<std::decay_t<_Fn>>)
+  inplace_function(_Fn &&__f) {
+    _M_base.template _M_create<std::decay_t<_Fn>, false>(
+        std::forward<_Fn>(__f));
+  }
+
+  inplace_function(inplace_function &&__that) noexcept {
+    _M_base._M_move_from(__that._M_base);
+  }
+
+  auto operator=(inplace_function &&__that) noexcept -> inplace_function & {
+    if (this != &__that) {
+      _M_base._M_reset();
+      _M_base._M_move_from(__that._M_base);
+    }
+    return *this;
+  }
+
+  inplace_function(inplace_function const &__that) {
+    _M_base._M_copy_from(__that._M_base);
+  }
+
+  auto operator=(inplace_function const &__that) -> inplace_function & {
+    if (this != &__that) {
+      inplace_function(__that).swap(*this);
+    }
+    return *this;
+  }
+
+  ~inplace_function() noexcept { _M_base._M_reset(); }
+
+  explicit operator bool() const noexcept {
+    return _M_base._M_manager != nullptr;
+  }
+
+  bool operator==(std::nullptr_t) const noexcept {
+    return _M_base._M_manager == nullptr;
+  }
+
+  bool operator!=(std::nullptr_t) const noexcept {
+    return _M_base._M_manager != nullptr;
+  }
+
+  // 空对象的调用指针会抛出std::bad_function_call
+  auto operator()(_Args... __args) const -> _Ret {
+    return _M_base._M_invoker(_M_base._M_storage,
+                              std::forward<_Args>(__args)...);
+  }
+
+  // 不抛出bad_function_call的调用，空对象返回unexpected(call_errc::empty)
+  auto try_invoke(_Args... __args) const -> expected<_Ret, call_errc>
+    requires(!std::is_reference_v<_Ret>)
+  {
+    return _M_base._M_try_invoke(std::forward<_Args>(__args)...);
+  }
+
+  auto target_type() const noexcept -> std::type_info const & {
+    return _M_base._M_target_type();
+  }
+  template <class _Fn> auto target() const noexcept -> _Fn * {
+    return _M_base.template _M_target<_Fn>();
+  }
+
+  void swap(inplace_function &__that) noexcept {
+    _M_base._M_swap(__that._M_base);
+  }
+};
+
+} // namespace MySTL
+
+#endif
@@ -1,7 +1,9 @@
 #ifndef MOVE_ONLY_FUNCTION_HPP
 #define MOVE_ONLY_FUNCTION_HPP
+#include "_function_base.hpp"
+#include <cassert>
+#include <cstddef>
 #include <functional>
-#include <memory>
 #include <type_traits>
 #include <utility>
 
@@ -14,24 +16,10 @@ template <class _Fnsig> struct move_only_function {
 template <class _Ret, class... _Args>
 struct move_only_function<_Ret(_Args...)> {
 private:
-  struct _FuncBase {
-    virtual auto _M_call(_Args... __args) -> _Ret = 0;
-    virtual ~_FuncBase() = default;
-  };
+  using _Storage =
+      _FuncStorage<MYSTL_FUNCTION_INLINE_SIZE, alignof(std::max_align_t)>;
 
-  template <class _Fn> struct _FuncImpl : _FuncBase {
-    _Fn _M_f;
-
-    template <class... _CArgs>
-    explicit _FuncImpl(std::in_place_t, _CArgs &&...__args)
-        : _M_f(std::forward<_CArgs>(__args)...) {}
-
-    auto _M_call(_Args... __args) -> _Ret override {
-      return std::invoke(_M_f, std::forward<_Args>(__args)...);
-    }
-  };
-
-  std::unique_ptr<_FuncBase> _M_base;
+  _FuncBase<_Storage, _Ret(_Args...)> _M_base;
 
 public:
   move_only_function() = default;
@@ -39,33 +27,60 @@ public:
 
   template <class _Fn>
     requires std::is_invocable_r_v<_Ret, _Fn &, _Args...>
-  move_only_function(_Fn __f)
-      : _M_base(
-            std::make_unique<_FuncImpl<_Fn>>(std::in_place, std::move(__f))){};
+  move_only_function(_Fn __f) {
+    _M_base.template _M_create<_Fn, true>(std::move(__f));
+  }
 
   template <class _Fn, class... _CArgs>
-  explicit move_only_function(std::in_place_type_t<_Fn>, _CArgs &&...__args)
-      : _M_base(std::make_unique<_FuncImpl<_Fn>>(
-            std::in_place, std::forward<_CArgs>(__args)...)) {}
+  explicit move_only_function(std::in_place_type_t<_Fn>, _CArgs &&...__args) {
+    _M_base.template _M_create<_Fn, true>(std::forward<_CArgs>(__args)...);
+  }
+
+  move_only_function(move_only_function &&__that) noexcept {
+    _M_base._M_move_from(__that._M_base);
+  }
+
+  auto operator=(move_only_function &&__that) noexcept
+      -> move_only_function & {
+    if (this != &__that) {
+      _M_base._M_reset();
+      _M_base._M_move_from(__that._M_base);
+    }
+    return *this;
+  }
 
-  move_only_function(move_only_function &&) = default;
-  auto operator=(move_only_function &&) -> move_only_function & = default;
   move_only_function(move_only_function const &) = delete;
   auto operator=(move_only_function const &) -> move_only_function & = delete;
 
-  explicit operator bool() const noexcept { return _M_base != nullptr; }
+  ~move_only_function() noexcept { _M_base._M_reset(); }
+
+  explicit operator bool() const noexcept {
+    return _M_base._M_manager != nullptr;
+  }
 
-  bool operator==(std::nullptr_t) const noexcept { return _M_base == nullptr; }
+  bool operator==(std::nullptr_t) const noexcept {
+    return _M_base._M_manager == nullptr;
+  }
 
-  bool operator!=(std::nullptr_t) const noexcept { return _M_base != nullptr; }
+  bool operator!=(std::nullptr_t) const noexcept {
+    return _M_base._M_manager != nullptr;
+  }
 
   auto operator()(_Args... __args) const -> _Ret {
-    assert(_M_base);
-    return _M_base->_M_call(std::forward<_Args>(__args)...);
+    assert(_M_base._M_manager);
+    return _M_base._M_invoker(_M_base._M_storage,
+                              std::forward<_Args>(__args)...);
+  }
+
+  // 不抛出bad_function_call的调用，空对象返回unexpected(call_errc::empty)
+  auto try_invoke(_Args... __args) const -> expected<_Ret, call_errc>
+    requires(!std::is_reference_v<_Ret>)
+  {
+    return _M_base._M_try_invoke(std::forward<_Args>(__args)...);
   }
 
   void swap(move_only_function &__that) noexcept {
-    _M_base.swap(__that._M_base);
+    _M_base._M_swap(__that._M_base);
   }
 };
 } // namespace MySTL
@@ -0,0 +1,68 @@
+#ifndef _OPTIONAL_NICHE_HPP
+#define _OPTIONAL_NICHE_HPP
+
+#include <bit>
+#include <concepts>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <type_traits>
+
+namespace MySTL {
+
+// optional<T>用来把“空”编码进T自身的钩子，默认不启用
+// 特化时提供两个静态函数，optional<T>就不再需要额外的bool标记：
+//   static void set_empty(T *__p) noexcept;          在未初始化的存储上构造空标记
+//   static bool is_empty(T const &__v) noexcept;     判断是否为空标记
+// 空标记必须是普通值永远不会取到的状态，optional不会对空标记调用析构函数
+template <class _Tp> struct optional_niche {};
+
+template <class _Tp>
+concept _HasOptionalNiche = requires(_Tp *__p, _Tp const &__v) {
+  optional_niche<_Tp>::set_empty(__p);
+  { optional_niche<_Tp>::is_empty(__v) } -> std::convertible_to<bool>;
+};
+
+// 用某个保留值作为空标记，如 ID 类型里的 -1
+// template <> struct optional_niche<UserId> : optional_niche_sentinel<UserId, UserId{-1}> {};
+template <class _Tp, _Tp _Sentinel> struct optional_niche_sentinel {
+  static constexpr void set_empty(_Tp *__p) noexcept {
+    std::construct_at(__p, _Sentinel);
+  }
+
+  static constexpr auto is_empty(_Tp const &__v) noexcept -> bool {
+    return __v == _Sentinel;
+  }
+};
+
+// 用一个特定负载的 NaN 作为空标记，按位比较，计算产生的 NaN 不会与之相同
+template <std::floating_point _Tp> struct optional_niche_nan {
+  using _Bits = std::conditional_t<sizeof(_Tp) == 8, std::uint64_t,
+                                   std::uint32_t>;
+  static_assert(sizeof(_Tp) == sizeof(_Bits) &&
+                    std::numeric_limits<_Tp>::is_iec559,
+                "NaN niche requires an IEEE 754 float or double");
+
+  static constexpr _Bits _S_quiet =
+      std::bit_cast<_Bits>(std::numeric_limits<_Tp>::quiet_NaN());
+  // 静默位以下的尾数位里放一个固定负载，硬件生成的NaN负载为0
+  static constexpr _Bits _S_pattern =
+      _S_quiet | (_Bits(0x6E696368) & ((_S_quiet & (~_S_quiet + 1)) - 1));
+
+  static constexpr void set_empty(_Tp *__p) noexcept {
+    std::construct_at(__p, std::bit_cast<_Tp>(_S_pattern));
+  }
+
+  static constexpr auto is_empty(_Tp const &__v) noexcept -> bool {
+    return std::bit_cast<_Bits>(__v) == _S_pattern;
+  }
+};
+
+// 智能指针等类型的空标记用的地址：最低页从不映射，不会有对象位于这里
+template <class _Tp> inline auto _S_niche_pointer() noexcept -> _Tp * {
+  return reinterpret_cast<_Tp *>(std::uintptr_t(1));
+}
+
+} // namespace MySTL
+
+#endif
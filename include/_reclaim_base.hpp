@@ -0,0 +1,191 @@
+#ifndef _RECLAIM_BASE_HPP
+#define _RECLAIM_BASE_HPP
+
+#include "default_deleter.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// epoch_domain与hazard_domain共用的部分：延迟释放的对象、每线程记录、
+// 线程到记录的映射
+
+namespace MySTL {
+
+// 等待回收的对象。空的删除器（如DefaultDeleter）不占空间，直接在回收时构造；
+// 有状态的删除器连同指针装进一个堆上的盒子
+struct _Retired {
+  void *_M_ptr; // 对象本身，hazard_domain按它与危险指针比较
+  void *_M_box;
+  void (*_M_reclaim)(void *, void *);
+  std::uint64_t _M_epoch; // 只有epoch_domain使用
+
+  void _M_run() const { _M_reclaim(_M_ptr, _M_box); }
+};
+
+template <class _Tp, class _Deleter> struct _RetiredBox {
+  [[no_unique_address]] _Deleter _M_deleter;
+};
+
+template <class _Tp, class _Deleter>
+auto _S_makeRetired(_Tp *__ptr, _Deleter __deleter) -> _Retired {
+  void *__p = const_cast<std::remove_cv_t<_Tp> *>(__ptr);
+  if constexpr (std::is_empty_v<_Deleter> &&
+                std::is_default_constructible_v<_Deleter>) {
+    return {__p, nullptr,
+            [](void *__q, void *) { _Deleter()(static_cast<_Tp *>(__q)); }, 0};
+  } else {
+    auto *__box = new _RetiredBox<_Tp, _Deleter>{std::move(__deleter)};
+    return {__p, __box,
+            [](void *__q, void *__b) {
+              auto *__box = static_cast<_RetiredBox<_Tp, _Deleter> *>(__b);
+              __box->_M_deleter(static_cast<_Tp *>(__q));
+              delete __box;
+            },
+            0};
+  }
+}
+
+// 每个线程在每个域里占用一条记录。记录挂在只增不减的无锁链表上，
+// 线程退出时交还，未回收的对象留在记录里由下一个占用者或域的析构继续处理
+struct _ReclaimRecord {
+  _ReclaimRecord *_M_next = nullptr;
+  std::atomic<bool> _M_in_use{true};
+  std::vector<_Retired> _M_retired;
+  // 待回收对象达到这个数时成批处理；处理后设为剩余数加一批，
+  // 释放不掉的对象不会让每次retire都重新扫描
+  std::size_t _M_collect_at = 0;
+};
+
+template <class _Record> struct _ReclaimRecords {
+  std::atomic<_Record *> _M_head{nullptr};
+  std::atomic<std::size_t> _M_count{0};
+
+  _ReclaimRecords() = default;
+
+  _ReclaimRecords(_ReclaimRecords const &) = delete;
+
+  auto operator=(_ReclaimRecords const &) -> _ReclaimRecords & = delete;
+
+  // 域析构时已经没有线程在使用，记录中剩下的对象全部释放
+  ~_ReclaimRecords() {
+    _Record *__r = _M_head.load(std::memory_order_acquire);
+    while (__r) {
+      auto *__next = static_cast<_Record *>(__r->_M_next);
+      for (_Retired const &__x : __r->_M_retired) {
+        __x._M_run();
+      }
+      delete __r;
+      __r = __next;
+    }
+  }
+
+  auto _M_acquire() -> _Record * {
+    for (_Record *__r = _M_head.load(std::memory_order_acquire); __r;
+         __r = static_cast<_Record *>(__r->_M_next)) {
+      bool __free = false;
+      if (!__r->_M_in_use.load(std::memory_order_relaxed) &&
+          __r->_M_in_use.compare_exchange_strong(__free, true,
+                                                 std::memory_order_acquire)) {
+        return __r;
+      }
+    }
+    auto *__r = new _Record;
+    _Record *__head = _M_head.load(std::memory_order_relaxed);
+    do {
+      __r->_M_next = __head;
+    } while (!_M_head.compare_exchange_weak(__head, __r,
+                                            std::memory_order_release,
+                                            std::memory_order_relaxed));
+    _M_count.fetch_add(1, std::memory_order_relaxed);
+    return __r;
+  }
+
+  static void _S_release(_ReclaimRecord *__r) noexcept {
+    __r->_M_in_use.store(false, std::memory_order_release);
+  }
+
+  template <class _Fn> void _M_for_each(_Fn &&__fn) const {
+    for (_Record *__r = _M_head.load(std::memory_order_acquire); __r;
+         __r = static_cast<_Record *>(__r->_M_next)) {
+      __fn(*__r);
+    }
+  }
+};
+
+// 存活的域按唯一编号登记。线程退出时在同一把锁下确认域仍然存活再交还记录，
+// 因此域可以先于使用过它的线程析构
+inline std::mutex _S_reclaim_registry_mutex;
+inline std::vector<std::uint64_t> _S_reclaim_live_domains;
+inline std::atomic<std::uint64_t> _S_reclaim_next_id{1};
+
+inline auto _S_reclaimRegister() -> std::uint64_t {
+  std::uint64_t const __id =
+      _S_reclaim_next_id.fetch_add(1, std::memory_order_relaxed);
+  std::lock_guard<std::mutex> __lock(_S_reclaim_registry_mutex);
+  _S_reclaim_live_domains.push_back(__id);
+  return __id;
+}
+
+inline void _S_reclaimUnregister(std::uint64_t __id) noexcept {
+  std::lock_guard<std::mutex> __lock(_S_reclaim_registry_mutex);
+  std::erase(_S_reclaim_live_domains, __id);
+}
+
+struct _ReclaimThreadCache {
+  struct _Entry {
+    std::uint64_t _M_id;
+    _ReclaimRecord *_M_record;
+  };
+
+  std::vector<_Entry> _M_entries;
+  _Entry _M_last{0, nullptr};
+
+  ~_ReclaimThreadCache() {
+    std::lock_guard<std::mutex> __lock(_S_reclaim_registry_mutex);
+    for (_Entry const &__e : _M_entries) {
+      if (std::ranges::find(_S_reclaim_live_domains, __e._M_id) !=
+          _S_reclaim_live_domains.end()) {
+        _ReclaimRecords<_ReclaimRecord>::_S_release(__e._M_record);
+      }
+    }
+  }
+};
+
+inline thread_local _ReclaimThreadCache _S_reclaim_thread_cache;
+
+// 查找本线程在编号为__id的域中的记录，最近一次使用的域走快速路径
+template <class _Record>
+auto _S_reclaimLocal(std::uint64_t __id, _ReclaimRecords<_Record> &__records)
+    -> _Record * {
+  _ReclaimThreadCache &__cache = _S_reclaim_thread_cache;
+  if (__cache._M_last._M_id == __id) [[likely]] {
+    return static_cast<_Record *>(__cache._M_last._M_record);
+  }
+  for (auto const &__e : __cache._M_entries) {
+    if (__e._M_id == __id) {
+      __cache._M_last = __e;
+      return static_cast<_Record *>(__e._M_record);
+    }
+  }
+  {
+    // 顺便清理已经析构的域留下的条目
+    std::lock_guard<std::mutex> __lock(_S_reclaim_registry_mutex);
+    std::erase_if(__cache._M_entries, [](auto const &__e) {
+      return std::ranges::find(_S_reclaim_live_domains, __e._M_id) ==
+             _S_reclaim_live_domains.end();
+    });
+  }
+  _Record *__r = __records._M_acquire();
+  __cache._M_entries.push_back({__id, __r});
+  __cache._M_last = __cache._M_entries.back();
+  return __r;
+}
+
+} // namespace MySTL
+
+#endif
@@ -0,0 +1,366 @@
+#ifndef _SP_POOL_HPP
+#define _SP_POOL_HPP
+
+#include "alloc_hooks.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <new>
+#include <utility>
+
+// 非单次分配的控制块（shared_ptr接管裸指针、atomic<shared_ptr>的_Holder）
+// 从按大小分类的线程本地池中分配。定义MYSTL_NO_SP_POOL可以关闭；
+// 定义MYSTL_ALLOC_HOOKS时也不使用池，以便逐块统计和改道
+#if !defined(MYSTL_NO_SP_POOL) && !defined(MYSTL_ALLOC_HOOKS)
+#define _MYSTL_SP_POOL 1
+#endif
+
+namespace MySTL {
+
+#ifdef _MYSTL_SP_POOL
+
+struct _SpPoolNode {
+  _SpPoolNode *_M_next;
+};
+
+struct _SpPoolHeap;
+
+// slab按自身大小对齐，块地址向下取整即得到头部，从而找到所属的线程堆
+// 空闲块按slab分开记录，slab的块全部归还后可以整个释放
+// 除_M_remote与_M_next_pending外只由所属线程（或接手孤儿堆的线程）访问
+struct _SpPoolSlab {
+  _SpPoolHeap *_M_heap;
+  std::size_t _M_class;
+  _SpPoolNode *_M_free = nullptr;
+  char *_M_bump = nullptr;
+  char *_M_end = nullptr;
+  // 已分配、尚未回到_M_free的块数，远程归还的块在取回之前仍计在内
+  std::size_t _M_used = 0;
+  // 有空闲块的非当前slab组成的双向链表，可以从中间摘除
+  _SpPoolSlab *_M_prev = nullptr;
+  _SpPoolSlab *_M_next = nullptr;
+  // 其他线程归还用的无锁链表（多生产者单消费者，消费者一次取走整条，
+  // 不存在ABA）；由空变为非空的归还者把slab挂到堆的待取回链表上
+  alignas(64) std::atomic<_SpPoolNode *> _M_remote{nullptr};
+  _SpPoolSlab *_M_next_pending = nullptr;
+
+  _SpPoolSlab(_SpPoolHeap *__heap, std::size_t __class) noexcept
+      : _M_heap(__heap), _M_class(__class) {}
+};
+
+// 每个线程一个堆，每个大小类从当前slab的空闲链表或未分配的尾部取块，
+// 用完后换到其他有空闲块的slab，都没有时才申请新的slab
+// 块全部归还的slab（当前slab除外）每个大小类只留一个备用，其余还给系统，
+// 一次性的突发分配不会一直占着内存
+// 线程退出后堆不释放，而是放入孤儿链表等待新线程接手，其他线程仍可以往里归还
+struct _SpPoolHeap {
+  static constexpr std::size_t _S_granule = 16;
+  static constexpr std::size_t _S_classes = 8; // 16, 32, ..., 128字节
+  static constexpr std::size_t _S_slab_size = 64 * 1024;
+  static constexpr std::size_t _S_header =
+      (sizeof(_SpPoolSlab) + _S_granule - 1) / _S_granule * _S_granule;
+
+  struct _Class {
+    _SpPoolSlab *_M_current = nullptr;
+    _SpPoolSlab *_M_avail = nullptr;
+    _SpPoolSlab *_M_spare = nullptr;
+    // 与本线程使用的字段分开缓存行，远程归还不干扰本线程的快速路径
+    alignas(64) std::atomic<_SpPoolSlab *> _M_pending{nullptr};
+  };
+
+  _Class _M_classes[_S_classes];
+  _SpPoolHeap *_M_next_orphan = nullptr;
+  // 在孤儿链表上时为true，只在_S_sp_pool_orphan_mutex下修改
+  std::atomic<bool> _M_orphaned{false};
+
+  static constexpr auto _S_fits(std::size_t __size,
+                                std::size_t __align) noexcept -> bool {
+    return __size <= _S_classes * _S_granule && __align <= _S_granule;
+  }
+
+  static constexpr auto _S_class_of(std::size_t __size) noexcept
+      -> std::size_t {
+    return (__size + _S_granule - 1) / _S_granule - 1;
+  }
+
+  static auto _S_slab_of(void *__p) noexcept -> _SpPoolSlab * {
+    return reinterpret_cast<_SpPoolSlab *>(
+        reinterpret_cast<std::uintptr_t>(__p) & ~(_S_slab_size - 1));
+  }
+
+  auto _M_allocate(std::size_t __c) -> void * {
+    if (_SpPoolSlab *__s = _M_classes[__c]._M_current) [[likely]] {
+      if (_SpPoolNode *__n = __s->_M_free) {
+        __s->_M_free = __n->_M_next;
+        ++__s->_M_used;
+        return __n;
+      }
+      if (__s->_M_bump != __s->_M_end) {
+        void *__p = __s->_M_bump;
+        __s->_M_bump += (__c + 1) * _S_granule;
+        ++__s->_M_used;
+        return __p;
+      }
+    }
+    _M_switch(__c);
+    return _M_allocate(__c);
+  }
+
+  // 当前slab用完：先取回其他线程归还的块，再换到有空闲块的slab、备用slab，
+  // 最后才申请新的slab。用完的slab不在任何链表上，有块归还时再挂回_M_avail
+  void _M_switch(std::size_t __c) {
+    _Class &__k = _M_classes[__c];
+    _M_collect_remote(__c);
+    _SpPoolSlab *__cur = __k._M_current;
+    if (__cur && (__cur->_M_free || __cur->_M_bump != __cur->_M_end)) {
+      return;
+    }
+    if (_SpPoolSlab *__s = __k._M_avail) {
+      _S_unlink(__k, __s);
+      __k._M_current = __s;
+    } else if (_SpPoolSlab *__s = std::exchange(__k._M_spare, nullptr)) {
+      __k._M_current = __s;
+    } else {
+      __k._M_current = _M_new_slab(__c);
+    }
+  }
+
+  auto _M_new_slab(std::size_t __c) -> _SpPoolSlab * {
+    void *__mem =
+        ::operator new(_S_slab_size, std::align_val_t(_S_slab_size));
+    auto *__s = ::new (__mem) _SpPoolSlab(this, __c);
+    std::size_t const __block = (__c + 1) * _S_granule;
+    __s->_M_bump = static_cast<char *>(__mem) + _S_header;
+    __s->_M_end =
+        __s->_M_bump + (_S_slab_size - _S_header) / __block * __block;
+    return __s;
+  }
+
+  static void _S_delete_slab(_SpPoolSlab *__s) noexcept {
+    __s->~_SpPoolSlab();
+    ::operator delete(static_cast<void *>(__s), _S_slab_size,
+                      std::align_val_t(_S_slab_size));
+  }
+
+  static void _S_link(_Class &__k, _SpPoolSlab *__s) noexcept {
+    __s->_M_prev = nullptr;
+    __s->_M_next = __k._M_avail;
+    if (__k._M_avail) {
+      __k._M_avail->_M_prev = __s;
+    }
+    __k._M_avail = __s;
+  }
+
+  static void _S_unlink(_Class &__k, _SpPoolSlab *__s) noexcept {
+    if (__s->_M_prev) {
+      __s->_M_prev->_M_next = __s->_M_next;
+    } else {
+      __k._M_avail = __s->_M_next;
+    }
+    if (__s->_M_next) {
+      __s->_M_next->_M_prev = __s->_M_prev;
+    }
+  }
+
+  // __n个块（首尾为__first、__last）回到slab的空闲链表。非当前slab的块全部
+  // 归还时留作备用或释放，否则由空变为有空闲块时挂到_M_avail上
+  void _M_give_back(_SpPoolSlab *__s, _SpPoolNode *__first,
+                    _SpPoolNode *__last, std::size_t __n) noexcept {
+    _Class &__k = _M_classes[__s->_M_class];
+    bool const __was_full = __s->_M_free == nullptr;
+    __last->_M_next = __s->_M_free;
+    __s->_M_free = __first;
+    __s->_M_used -= __n;
+    if (__s == __k._M_current) {
+      return;
+    }
+    if (__s->_M_used == 0) {
+      if (!__was_full) {
+        _S_unlink(__k, __s);
+      }
+      if (!__k._M_spare) {
+        __k._M_spare = __s;
+      } else {
+        _S_delete_slab(__s);
+      }
+    } else if (__was_full) {
+      _S_link(__k, __s);
+    }
+  }
+
+  void _M_free_local(_SpPoolSlab *__s, void *__p) noexcept {
+    auto *__n = static_cast<_SpPoolNode *>(__p);
+    _M_give_back(__s, __n, __n, 1);
+  }
+
+  // 只有让_M_remote由空变为非空的归还者挂slab，取回前它一定已经挂好，
+  // slab在取回之前仍有块未归还，不会被释放。挂了slab时返回true
+  auto _M_free_remote(_SpPoolSlab *__s, void *__p) noexcept -> bool {
+    // 成功后__n可能立刻被取回重用，之后只看局部变量
+    // acquire与取回时的交换配对：挂slab时改写_M_next_pending，要在所属线程
+    // 上次读取它之后
+    auto *__n = static_cast<_SpPoolNode *>(__p);
+    _SpPoolNode *__head = __s->_M_remote.load(std::memory_order_relaxed);
+    do {
+      __n->_M_next = __head;
+    } while (!__s->_M_remote.compare_exchange_weak(
+        __head, __n, std::memory_order_acq_rel, std::memory_order_relaxed));
+    if (__head) {
+      return false;
+    }
+    auto &__pending = _M_classes[__s->_M_class]._M_pending;
+    _SpPoolSlab *__top = __pending.load(std::memory_order_relaxed);
+    do {
+      __s->_M_next_pending = __top;
+    } while (!__pending.compare_exchange_weak(
+        __top, __s, std::memory_order_release, std::memory_order_relaxed));
+    return true;
+  }
+
+  // 取回其他线程归还的块。先读出下一个再清空_M_remote：清空之后别的线程
+  // 可能立刻把这个slab重新挂上，改写_M_next_pending
+  void _M_collect_remote(std::size_t __c) noexcept {
+    auto &__pending = _M_classes[__c]._M_pending;
+    if (__pending.load(std::memory_order_relaxed) == nullptr) {
+      return;
+    }
+    _SpPoolSlab *__s = __pending.exchange(nullptr, std::memory_order_acquire);
+    while (__s) {
+      _SpPoolSlab *__next = __s->_M_next_pending;
+      _SpPoolNode *__first =
+          __s->_M_remote.exchange(nullptr, std::memory_order_acq_rel);
+      _SpPoolNode *__last = __first;
+      std::size_t __n = 1;
+      while (__last->_M_next) {
+        __last = __last->_M_next;
+        ++__n;
+      }
+      _M_give_back(__s, __first, __last, __n);
+      __s = __next;
+    }
+  }
+
+  // 没有线程使用的孤儿堆：取回归还的块，并释放没有未归还块的slab，
+  // 包括备用与当前slab
+  void _M_trim_class(std::size_t __c) noexcept {
+    _Class &__k = _M_classes[__c];
+    _M_collect_remote(__c);
+    if (_SpPoolSlab *__s = std::exchange(__k._M_spare, nullptr)) {
+      _S_delete_slab(__s);
+    }
+    if (__k._M_current && __k._M_current->_M_used == 0) {
+      _S_delete_slab(std::exchange(__k._M_current, nullptr));
+    }
+  }
+};
+
+inline thread_local _SpPoolHeap *_S_sp_pool_heap = nullptr;
+inline thread_local bool _S_sp_pool_exiting = false;
+
+inline std::mutex _S_sp_pool_orphan_mutex;
+inline _SpPoolHeap *_S_sp_pool_orphans = nullptr;
+
+inline auto _S_spPoolAdopt() -> _SpPoolHeap * {
+  {
+    std::lock_guard<std::mutex> __lock(_S_sp_pool_orphan_mutex);
+    if (_SpPoolHeap *__h = _S_sp_pool_orphans) {
+      _S_sp_pool_orphans = __h->_M_next_orphan;
+      __h->_M_orphaned.store(false, std::memory_order_relaxed);
+      return __h;
+    }
+  }
+  return new _SpPoolHeap;
+}
+
+// 放入孤儿链表前先收缩。栅栏与_S_spPoolCollectOrphan中的配对：归还者要么
+// 看到_M_orphaned自己去取回，要么它挂上的slab在这里被取回
+inline void _S_spPoolOrphan(_SpPoolHeap *__h) noexcept {
+  std::lock_guard<std::mutex> __lock(_S_sp_pool_orphan_mutex);
+  __h->_M_orphaned.store(true, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  for (std::size_t __c = 0; __c < _SpPoolHeap::_S_classes; ++__c) {
+    __h->_M_trim_class(__c);
+  }
+  __h->_M_next_orphan = _S_sp_pool_orphans;
+  _S_sp_pool_orphans = __h;
+}
+
+// 归还到孤儿堆的块没有所属线程取回，由挂上slab的归还者在锁下代为取回，
+// 块全部归还的slab随即释放，孤儿堆不会一直占着退出前分配的内存
+inline void _S_spPoolCollectOrphan(_SpPoolHeap *__h, std::size_t __c) noexcept {
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (!__h->_M_orphaned.load(std::memory_order_relaxed)) {
+    return;
+  }
+  std::lock_guard<std::mutex> __lock(_S_sp_pool_orphan_mutex);
+  if (__h->_M_orphaned.load(std::memory_order_relaxed)) {
+    __h->_M_trim_class(__c);
+  }
+}
+
+// 只在线程第一次分配时构造，线程退出时把堆交给孤儿链表
+struct _SpPoolThreadExit {
+  ~_SpPoolThreadExit() {
+    _S_sp_pool_exiting = true;
+    if (_SpPoolHeap *__h = std::exchange(_S_sp_pool_heap, nullptr)) {
+      _S_spPoolOrphan(__h);
+    }
+  }
+};
+
+inline thread_local _SpPoolThreadExit _S_sp_pool_exit;
+
+[[gnu::noinline]] inline auto _S_spPoolAllocateSlow(std::size_t __c)
+    -> void * {
+  _SpPoolHeap *__h = _S_spPoolAdopt();
+  if (_S_sp_pool_exiting) {
+    // 线程析构阶段不再登记新的堆，借用一次后立即归还
+    void *__p = __h->_M_allocate(__c);
+    _S_spPoolOrphan(__h);
+    return __p;
+  }
+  (void)&_S_sp_pool_exit;
+  _S_sp_pool_heap = __h;
+  return __h->_M_allocate(__c);
+}
+
+#endif
+
+// 按控制块大小选择线程池或全局堆，两端的__size与__align必须一致
+inline auto _S_spAllocateBlock(alloc_site __site, std::size_t __size,
+                               std::size_t __align) -> void * {
+#ifdef _MYSTL_SP_POOL
+  if (_SpPoolHeap::_S_fits(__size, __align)) {
+    std::size_t const __c = _SpPoolHeap::_S_class_of(__size);
+    if (_SpPoolHeap *__h = _S_sp_pool_heap) [[likely]] {
+      return __h->_M_allocate(__c);
+    }
+    return _S_spPoolAllocateSlow(__c);
+  }
+#endif
+  return _S_hookAllocate(__site, __size, __align);
+}
+
+// 释放可能发生在任意线程，不属于本线程的块归还到所属堆的远程链表
+inline void _S_spDeallocateBlock(alloc_site __site, void *__p,
+                                 std::size_t __size,
+                                 std::size_t __align) noexcept {
+#ifdef _MYSTL_SP_POOL
+  if (_SpPoolHeap::_S_fits(__size, __align)) {
+    _SpPoolSlab *__slab = _SpPoolHeap::_S_slab_of(__p);
+    _SpPoolHeap *__h = __slab->_M_heap;
+    if (__h == _S_sp_pool_heap) {
+      __h->_M_free_local(__slab, __p);
+    } else if (__h->_M_free_remote(__slab, __p)) [[unlikely]] {
+      _S_spPoolCollectOrphan(__h, __slab->_M_class);
+    }
+    return;
+  }
+#endif
+  _S_hookDeallocate(__site, __p, __size, __align);
+}
+
+} // namespace MySTL
+
+#endif
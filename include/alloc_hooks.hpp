@@ -0,0 +1,156 @@
+#ifndef ALLOC_HOOKS_HPP
+#define ALLOC_HOOKS_HPP
+
+#include <bit>
+#include <cstddef>
+#include <new>
+
+// 定义MYSTL_ALLOC_HOOKS后，MySTL内部的每个分配点都会按站点统计分配次数、
+// 字节数、存活块数与大小分布，并可以通过set_alloc_resource整体改道到用户提供的
+// memory_resource；未定义时所有钩子都直接内联为全局operator new/delete，没有额外开销
+#ifdef MYSTL_ALLOC_HOOKS
+#include <atomic>
+#include <memory_resource>
+#endif
+
+namespace MySTL {
+
+enum class alloc_site : unsigned {
+  shared_ptr_counter, // shared_ptr/local_shared_ptr接管裸指针时单独分配的控制块
+  make_shared,        // make_shared的控制块与对象
+  make_shared_array,  // make_shared<T[]>的控制块与元素
+  atomic_shared_ptr,  // atomic<shared_ptr>每次写入分配的控制块
+  function,           // function/move_only_function放不进缓冲区的可调用对象
+  make_unique,        // 只统计分配，由DefaultDeleter释放，不计释放与存活
+  arena,              // monotonic_arena从堆上链式分配的块
+  thread_pool,        // thread_pool的任务节点与submit的结果状态
+  coroutine_frame,    // task/generator的协程帧（未指定分配器时）
+};
+
+inline constexpr std::size_t alloc_site_count = 9;
+
+// 第i个桶统计大小在(2^(i-1), 2^i]之间的分配，最后一个桶包含所有更大的分配
+inline constexpr std::size_t alloc_histogram_buckets = 16;
+
+#ifdef MYSTL_ALLOC_HOOKS
+
+struct alloc_site_stats {
+  std::size_t allocs = 0;
+  std::size_t deallocs = 0;
+  std::size_t bytes = 0;      // 累计分配的字节数
+  std::size_t live = 0;       // 尚未释放的块数
+  std::size_t live_bytes = 0; // 尚未释放的字节数
+  std::size_t histogram[alloc_histogram_buckets] = {};
+};
+
+struct _AllocSiteCounters {
+  std::atomic<std::size_t> _M_allocs{0};
+  std::atomic<std::size_t> _M_deallocs{0};
+  std::atomic<std::size_t> _M_bytes{0};
+  std::atomic<std::size_t> _M_freed_bytes{0};
+  std::atomic<std::size_t> _M_histogram[alloc_histogram_buckets]{};
+};
+
+inline _AllocSiteCounters _S_alloc_counters[alloc_site_count];
+
+inline std::atomic<std::pmr::memory_resource *> _S_alloc_resource{nullptr};
+
+inline auto _S_histogramBucket(std::size_t __size) noexcept -> std::size_t {
+  std::size_t const __b = __size <= 1 ? 0 : std::bit_width(__size - 1);
+  return __b < alloc_histogram_buckets ? __b : alloc_histogram_buckets - 1;
+}
+
+inline auto alloc_stats(alloc_site __site) noexcept -> alloc_site_stats {
+  auto const &__c = _S_alloc_counters[static_cast<unsigned>(__site)];
+  alloc_site_stats __s;
+  __s.allocs = __c._M_allocs.load(std::memory_order_relaxed);
+  __s.deallocs = __c._M_deallocs.load(std::memory_order_relaxed);
+  __s.bytes = __c._M_bytes.load(std::memory_order_relaxed);
+  std::size_t const __freed = __c._M_freed_bytes.load(std::memory_order_relaxed);
+  if (__site != alloc_site::make_unique) {
+    __s.live = __s.allocs - __s.deallocs;
+    __s.live_bytes = __s.bytes - __freed;
+  }
+  for (std::size_t __i = 0; __i < alloc_histogram_buckets; ++__i) {
+    __s.histogram[__i] = __c._M_histogram[__i].load(std::memory_order_relaxed);
+  }
+  return __s;
+}
+
+inline void reset_alloc_stats() noexcept {
+  for (auto &__c : _S_alloc_counters) {
+    __c._M_allocs.store(0, std::memory_order_relaxed);
+    __c._M_deallocs.store(0, std::memory_order_relaxed);
+    __c._M_bytes.store(0, std::memory_order_relaxed);
+    __c._M_freed_bytes.store(0, std::memory_order_relaxed);
+    for (auto &__h : __c._M_histogram) {
+      __h.store(0, std::memory_order_relaxed);
+    }
+  }
+}
+
+// 返回之前安装的memory_resource，nullptr表示使用全局operator new
+// 释放时使用当时安装的resource，因此必须在第一次分配前安装，并保持到所有块释放
+inline auto set_alloc_resource(std::pmr::memory_resource *__r) noexcept
+    -> std::pmr::memory_resource * {
+  return _S_alloc_resource.exchange(__r, std::memory_order_acq_rel);
+}
+
+inline void _S_hookRecord(alloc_site __site, std::size_t __size) noexcept {
+  auto &__c = _S_alloc_counters[static_cast<unsigned>(__site)];
+  __c._M_allocs.fetch_add(1, std::memory_order_relaxed);
+  __c._M_bytes.fetch_add(__size, std::memory_order_relaxed);
+  __c._M_histogram[_S_histogramBucket(__size)].fetch_add(
+      1, std::memory_order_relaxed);
+}
+
+inline auto _S_hookAllocate(alloc_site __site, std::size_t __size,
+                            std::size_t __align) -> void * {
+  void *__p;
+  if (auto *__r = _S_alloc_resource.load(std::memory_order_acquire)) {
+    __p = __r->allocate(__size, __align);
+  } else {
+    __p = ::operator new(__size, std::align_val_t(__align));
+  }
+  _S_hookRecord(__site, __size);
+  return __p;
+}
+
+inline void _S_hookDeallocate(alloc_site __site, void *__p, std::size_t __size,
+                              std::size_t __align) noexcept {
+  auto &__c = _S_alloc_counters[static_cast<unsigned>(__site)];
+  __c._M_deallocs.fetch_add(1, std::memory_order_relaxed);
+  __c._M_freed_bytes.fetch_add(__size, std::memory_order_relaxed);
+  if (auto *__r = _S_alloc_resource.load(std::memory_order_acquire)) {
+    __r->deallocate(__p, __size, __align);
+  } else {
+    ::operator delete(__p, __size, std::align_val_t(__align));
+  }
+}
+
+#else
+
+inline void _S_hookRecord(alloc_site, std::size_t) noexcept {}
+
+inline auto _S_hookAllocate(alloc_site, std::size_t __size,
+                            std::size_t __align) -> void * {
+  if (__align > __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+    return ::operator new(__size, std::align_val_t(__align));
+  }
+  return ::operator new(__size);
+}
+
+inline void _S_hookDeallocate(alloc_site, void *__p, std::size_t __size,
+                              std::size_t __align) noexcept {
+  if (__align > __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+    ::operator delete(__p, __size, std::align_val_t(__align));
+  } else {
+    ::operator delete(__p, __size);
+  }
+}
+
+#endif
+
+} // namespace MySTL
+
+#endif
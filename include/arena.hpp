@@ -0,0 +1,198 @@
+#ifndef ARENA_HPP
+#define ARENA_HPP
+
+#include "alloc_hooks.hpp"
+#include "unique_ptr.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace MySTL {
+
+// 单调分配区：只向前移动游标，不单独释放，release()或析构时按块整体归还，
+// 耗时只与块数有关。可以先使用调用者提供的初始缓冲区（如栈上数组），
+// 用完后再从堆上链式分配新块，块大小按倍数增长
+struct _ArenaBlock {
+  _ArenaBlock *_M_next;
+  std::size_t _M_size;
+};
+
+struct monotonic_arena {
+private:
+  char *_M_cur;
+  char *_M_end;
+  _ArenaBlock *_M_blocks = nullptr;
+  char *_M_initial;
+  std::size_t _M_initial_size;
+  std::size_t _M_first_block;
+  std::size_t _M_next_block;
+
+  static constexpr std::size_t _S_header =
+      (sizeof(_ArenaBlock) + alignof(std::max_align_t) - 1) /
+      alignof(std::max_align_t) * alignof(std::max_align_t);
+
+  [[gnu::noinline]] auto _M_allocate_slow(std::size_t __size,
+                                          std::size_t __align) -> void * {
+    // 超过对齐保证的部分在块内补齐，最坏情况需要额外的align字节
+    std::size_t const __need = _S_header + __size + __align;
+    std::size_t __bytes = _M_next_block;
+    if (__bytes < __need) {
+      __bytes = __need;
+    } else if (_M_next_block < _S_max_block) {
+      _M_next_block *= 2;
+    }
+    void *__mem = _S_hookAllocate(alloc_site::arena, __bytes,
+                                  alignof(std::max_align_t));
+    _M_blocks = ::new (__mem) _ArenaBlock{_M_blocks, __bytes};
+    _M_cur = static_cast<char *>(__mem) + _S_header;
+    _M_end = static_cast<char *>(__mem) + __bytes;
+    return allocate(__size, __align);
+  }
+
+public:
+  static constexpr std::size_t _S_default_block = 4096;
+  static constexpr std::size_t _S_max_block = 1024 * 1024;
+
+  explicit monotonic_arena(
+      std::size_t __block_size = _S_default_block) noexcept
+      : monotonic_arena(nullptr, 0, __block_size) {}
+
+  // 先用完[__buffer, __buffer + __size)，缓冲区的生存期必须长于分配区
+  monotonic_arena(void *__buffer, std::size_t __size,
+                  std::size_t __block_size = _S_default_block) noexcept
+      : _M_cur(static_cast<char *>(__buffer)),
+        _M_end(static_cast<char *>(__buffer) + __size),
+        _M_initial(static_cast<char *>(__buffer)), _M_initial_size(__size),
+        _M_first_block(__block_size), _M_next_block(__block_size) {}
+
+  monotonic_arena(monotonic_arena const &) = delete;
+
+  auto operator=(monotonic_arena const &) -> monotonic_arena & = delete;
+
+  ~monotonic_arena() noexcept { release(); }
+
+  // 总是返回非空指针，包括__size为0时；没有初始缓冲区的分配区游标为空，
+  // 这时即使不需要空间也要先分配一块
+  auto allocate(std::size_t __size,
+                std::size_t __align = alignof(std::max_align_t)) -> void * {
+    auto const __cur = reinterpret_cast<std::uintptr_t>(_M_cur);
+    auto const __p = (__cur + __align - 1) & ~(__align - 1);
+    if (__p - __cur + __size <= static_cast<std::size_t>(_M_end - _M_cur) &&
+        __cur != 0) [[likely]] {
+      _M_cur += __p - __cur + __size;
+      return reinterpret_cast<void *>(__p);
+    }
+    return _M_allocate_slow(__size, __align);
+  }
+
+  // 归还所有堆上的块并回到初始缓冲区，之前分配的内存全部失效，
+  // 其中的对象不会被析构
+  void release() noexcept {
+    _ArenaBlock *__b = std::exchange(_M_blocks, nullptr);
+    while (__b) {
+      _ArenaBlock *__next = __b->_M_next;
+      _S_hookDeallocate(alloc_site::arena, __b, __b->_M_size,
+                        alignof(std::max_align_t));
+      __b = __next;
+    }
+    _M_cur = _M_initial;
+    _M_end = _M_initial + _M_initial_size;
+    _M_next_block = _M_first_block;
+  }
+
+  // 当前持有的堆块数，不包括初始缓冲区
+  auto block_count() const noexcept -> std::size_t {
+    std::size_t __n = 0;
+    for (_ArenaBlock *__b = _M_blocks; __b; __b = __b->_M_next) {
+      ++__n;
+    }
+    return __n;
+  }
+};
+
+template <std::size_t _Size> struct _ArenaBuffer {
+  alignas(std::max_align_t) char _M_buffer[_Size];
+};
+
+// 自带_Size字节初始缓冲区的分配区，放在栈上时小规模的对象图完全不访问堆
+template <std::size_t _Size>
+struct inline_arena : private _ArenaBuffer<_Size>, monotonic_arena {
+  explicit inline_arena(
+      std::size_t __block_size = _S_default_block) noexcept
+      : monotonic_arena(this->_M_buffer, _Size, __block_size) {}
+};
+
+// 分配区中的对象由unique_ptr负责析构，内存随分配区一起归还
+// 删除器是空类型，arena_unique_ptr仍只有一个指针宽；平凡析构的类型什么都不做
+template <class _Tp> struct ArenaDeleter {
+  ArenaDeleter() = default;
+
+  template <class _Up>
+    requires(std::is_convertible_v<_Up *, _Tp *>)
+  ArenaDeleter(ArenaDeleter<_Up> const &) noexcept {}
+
+  void operator()(_Tp *__p) const noexcept {
+    if constexpr (!std::is_trivially_destructible_v<_Tp>) {
+      __p->~_Tp();
+    }
+  }
+};
+
+// 非平凡析构的数组在元素前保存长度，长度紧挨着第一个元素，
+// 前面按元素的对齐补齐
+template <class _Tp> struct ArenaDeleter<_Tp[]> {
+  static constexpr std::size_t _S_cookie =
+      alignof(_Tp) > sizeof(std::size_t) ? alignof(_Tp) : sizeof(std::size_t);
+
+  void operator()(_Tp *__p) const noexcept {
+    if constexpr (!std::is_trivially_destructible_v<_Tp>) {
+      std::size_t __len = *reinterpret_cast<std::size_t *>(
+          reinterpret_cast<char *>(__p) - sizeof(std::size_t));
+      while (__len) {
+        std::destroy_at(__p + --__len);
+      }
+    }
+  }
+};
+
+template <class _Tp>
+using arena_unique_ptr = unique_ptr<_Tp, ArenaDeleter<_Tp>>;
+
+static_assert(sizeof(arena_unique_ptr<int>) == sizeof(int *));
+
+template <class _Tp, class... _Args>
+  requires(!std::is_unbounded_array_v<_Tp>)
+auto make_arena_unique(monotonic_arena &__arena, _Args &&...__args)
+    -> arena_unique_ptr<_Tp> {
+  void *__mem = __arena.allocate(sizeof(_Tp), alignof(_Tp));
+  // 构造抛出异常时内存留在分配区里，随分配区一起归还
+  return arena_unique_ptr<_Tp>(::new (__mem)
+                                   _Tp(std::forward<_Args>(__args)...));
+}
+
+template <class _Tp>
+  requires(std::is_unbounded_array_v<_Tp>)
+auto make_arena_unique(monotonic_arena &__arena, std::size_t __len)
+    -> arena_unique_ptr<_Tp> {
+  using _Up = std::remove_extent_t<_Tp>;
+  constexpr std::size_t __cookie =
+      std::is_trivially_destructible_v<_Up> ? 0 : ArenaDeleter<_Tp>::_S_cookie;
+  constexpr std::size_t __align =
+      __cookie && alignof(std::size_t) > alignof(_Up) ? alignof(std::size_t)
+                                                      : alignof(_Up);
+  char *__mem = static_cast<char *>(
+      __arena.allocate(__cookie + __len * sizeof(_Up), __align));
+  auto *__p = reinterpret_cast<_Up *>(__mem + __cookie);
+  std::uninitialized_value_construct_n(__p, __len);
+  if constexpr (__cookie != 0) {
+    ::new (__mem + __cookie - sizeof(std::size_t)) std::size_t(__len);
+  }
+  return arena_unique_ptr<_Tp>(__p);
+}
+
+} // namespace MySTL
+
+#endif
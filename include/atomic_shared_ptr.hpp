@@ -0,0 +1,241 @@
+#ifndef ATOMIC_SHARED_PTR_HPP
+#define ATOMIC_SHARED_PTR_HPP
+#include "shared_ptr.hpp"
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <utility>
+
+namespace MySTL {
+
+// 目前只提供 atomic<shared_ptr<T>> 特化
+template <class _Tp> struct atomic;
+
+// 无锁读取的 atomic<shared_ptr<T>>，适合读多写少的配置快照发布
+//
+// 64位字的高48位保存控制块指针，低16位是读者已消耗的“预留引用”个数。
+// 写入时先一次性给控制块加上_S_credits个强引用，读者只需对这个字做一次
+// fetch_add就得到一个引用，不会触碰对象的引用计数，也从不阻塞写者。
+// 消耗过半时由读者批量补充。被替换的旧值归还剩余的预留引用即可。
+//
+// shared_ptr的元素指针可能与控制块管理的对象不同（别名构造），所以每次写入
+// 把值放进一个小的_Holder控制块里，load()返回的是指向_Holder的别名指针，
+// 其use_count()包含预留引用，只能作为参考。
+template <class _Tp> struct atomic<shared_ptr<_Tp>> {
+private:
+  static_assert(sizeof(void *) == 8 &&
+                    std::atomic<std::uint64_t>::is_always_lock_free,
+                "requires 64-bit lock-free atomics");
+
+  struct _Holder final : _SpCounter {
+    shared_ptr<_Tp> _M_value;
+
+    explicit _Holder(shared_ptr<_Tp> &&__value) noexcept
+        : _M_value(std::move(__value)) {}
+
+    void _M_dispose() noexcept override { _M_value.reset(); }
+
+    static auto operator new(std::size_t __size) -> void * {
+      return _S_spAllocateBlock(alloc_site::atomic_shared_ptr, __size,
+                                alignof(_Holder));
+    }
+
+    static void operator delete(void *__mem, std::size_t __size) noexcept {
+      _S_spDeallocateBlock(alloc_site::atomic_shared_ptr, __mem, __size,
+                           alignof(_Holder));
+    }
+  };
+
+  static constexpr unsigned _S_count_bits = 16;
+  static constexpr std::uint64_t _S_count_mask =
+      (std::uint64_t(1) << _S_count_bits) - 1;
+  // 读者消耗的预留引用不会超过_S_credits - 1，原子变量始终至少持有一个引用
+  static constexpr std::uint32_t _S_credits = std::uint32_t(1)
+                                              << _S_count_bits;
+  static constexpr std::uint64_t _S_refill = _S_count_mask / 2;
+
+  // load()是const，但读者也要在这个字上消耗和补充预留引用
+  mutable std::atomic<std::uint64_t> _M_word;
+
+  // 用户态指针只用到低48位；五级页表（LA57）或带标签的指针超出时会被截断，
+  // _Holder的对齐只空出3位，放不下计数，所以只能检查
+  static auto _S_pack(_Holder *__h) noexcept -> std::uint64_t {
+    auto const __bits = reinterpret_cast<std::uintptr_t>(__h);
+    assert((__bits >> (64 - _S_count_bits)) == 0 &&
+           "atomic<shared_ptr> requires user pointers within 48 bits");
+    return static_cast<std::uint64_t>(__bits) << _S_count_bits;
+  }
+
+  static auto _S_holder(std::uint64_t __w) noexcept -> _Holder * {
+    return reinterpret_cast<_Holder *>(
+        static_cast<std::uintptr_t>(__w >> _S_count_bits));
+  }
+
+  static auto _S_used(std::uint64_t __w) noexcept -> std::uint32_t {
+    return static_cast<std::uint32_t>(__w & _S_count_mask);
+  }
+
+  // 消耗调用者持有的一个_Holder引用，返回指向其中对象的别名指针
+  static auto _S_alias(_Holder *__h) noexcept -> shared_ptr<_Tp> {
+    return shared_ptr<_Tp>(__h->_M_value.get(),
+                           static_cast<_SpCounter *>(__h));
+  }
+
+  // 新建_Holder并为原子变量预留_S_credits个强引用
+  static auto _S_make_holder(shared_ptr<_Tp> &&__value) -> _Holder * {
+    if (!__value) {
+      return nullptr;
+    }
+    _Holder *__h = new _Holder(std::move(__value));
+    __h->_M_incref_n(_S_credits - 1);
+    return __h;
+  }
+
+  // 归还被替换的值剩余的预留引用
+  static void _S_release(std::uint64_t __w) noexcept {
+    if (_Holder *__h = _S_holder(__w)) {
+      __h->_M_decref_n(_S_credits - _S_used(__w));
+    }
+  }
+
+  // 把原子变量持有的一个预留引用转为shared_ptr，其余归还
+  static auto _S_take(std::uint64_t __w) noexcept -> shared_ptr<_Tp> {
+    _Holder *__h = _S_holder(__w);
+    if (!__h) {
+      return nullptr;
+    }
+    if (std::uint32_t __rest = _S_credits - _S_used(__w) - 1) {
+      __h->_M_decref_n(__rest);
+    }
+    return _S_alias(__h);
+  }
+
+  // 读者已消耗过半时补充预留引用，调用者持有__w中_Holder的一个引用
+  void _M_refill(std::uint64_t __w) const noexcept {
+    _Holder *__h = _S_holder(__w);
+    std::uint32_t const __n = _S_used(__w);
+    __h->_M_incref_n(__n);
+    while (!_M_word.compare_exchange_weak(__w, __w - __n,
+                                          std::memory_order_relaxed,
+                                          std::memory_order_relaxed)) {
+      // 值已被替换或别的读者已经补充过
+      if (_S_holder(__w) != __h || _S_used(__w) < __n) {
+        __h->_M_decref_n(__n);
+        return;
+      }
+    }
+  }
+
+public:
+  using value_type = shared_ptr<_Tp>;
+
+  static constexpr bool is_always_lock_free = true;
+
+  atomic() noexcept : _M_word(0) {}
+
+  atomic(std::nullptr_t) noexcept : atomic() {}
+
+  atomic(shared_ptr<_Tp> __desired)
+      : _M_word(_S_pack(_S_make_holder(std::move(__desired)))) {}
+
+  atomic(atomic const &) = delete;
+  void operator=(atomic const &) = delete;
+
+  ~atomic() noexcept { _S_release(_M_word.load(std::memory_order_acquire)); }
+
+  auto is_lock_free() const noexcept -> bool { return true; }
+
+  auto load(std::memory_order = std::memory_order_seq_cst) const noexcept
+      -> shared_ptr<_Tp> {
+    if (!_S_holder(_M_word.load(std::memory_order_acquire))) {
+      return nullptr;
+    }
+    std::uint64_t __w = _M_word.fetch_add(1, std::memory_order_acquire);
+    _Holder *__h = _S_holder(__w);
+    if (!__h) [[unlikely]] {
+      // 期间被写入了空值：空值的计数没有意义，尽量撤销即可
+      ++__w;
+      while (!_S_holder(__w) && _S_used(__w) != 0 &&
+             !_M_word.compare_exchange_weak(__w, __w - 1,
+                                            std::memory_order_relaxed)) {
+      }
+      return nullptr;
+    }
+    if (_S_used(__w) + 1 >= _S_refill) [[unlikely]] {
+      _M_refill(__w + 1);
+    }
+    return _S_alias(__h);
+  }
+
+  operator shared_ptr<_Tp>() const noexcept { return load(); }
+
+  void store(shared_ptr<_Tp> __desired,
+             std::memory_order = std::memory_order_seq_cst) {
+    _Holder *__h = _S_make_holder(std::move(__desired));
+    _S_release(_M_word.exchange(_S_pack(__h), std::memory_order_acq_rel));
+  }
+
+  void operator=(shared_ptr<_Tp> __desired) { store(std::move(__desired)); }
+
+  void operator=(std::nullptr_t) { store(nullptr); }
+
+  auto exchange(shared_ptr<_Tp> __desired,
+                std::memory_order = std::memory_order_seq_cst)
+      -> shared_ptr<_Tp> {
+    _Holder *__h = _S_make_holder(std::move(__desired));
+    return _S_take(_M_word.exchange(_S_pack(__h), std::memory_order_acq_rel));
+  }
+
+  // 当前值与__expected是同一个控制块且指向同一对象时替换，
+  // 失败时__expected被更新为当前值
+  // __expected可以是写入时传入的shared_ptr（比较其中的控制块），
+  // 也可以是load()返回的指向_Holder的别名
+  auto compare_exchange_strong(shared_ptr<_Tp> &__expected,
+                               shared_ptr<_Tp> __desired,
+                               std::memory_order = std::memory_order_seq_cst,
+                               std::memory_order = std::memory_order_seq_cst)
+      -> bool {
+    _Holder *__h = nullptr;
+    std::uint64_t __w = _M_word.load(std::memory_order_acquire);
+    while (true) {
+      _Holder *__cur = _S_holder(__w);
+      bool const __match =
+          __cur ? (__cur->_M_value._M_owner == __expected._M_owner ||
+                   static_cast<_SpCounter *>(__cur) == __expected._M_owner) &&
+                      __cur->_M_value.get() == __expected.get()
+                : !__expected;
+      if (!__match) {
+        if (__h) {
+          __h->_M_decref_n(_S_credits);
+        }
+        __expected = load();
+        return false;
+      }
+      if (!__h && __desired) {
+        __h = _S_make_holder(std::move(__desired));
+      }
+      if (_M_word.compare_exchange_weak(__w, _S_pack(__h),
+                                        std::memory_order_acq_rel,
+                                        std::memory_order_acquire)) {
+        _S_release(__w);
+        return true;
+      }
+    }
+  }
+
+  auto compare_exchange_weak(shared_ptr<_Tp> &__expected,
+                             shared_ptr<_Tp> __desired,
+                             std::memory_order __success =
+                                 std::memory_order_seq_cst,
+                             std::memory_order __failure =
+                                 std::memory_order_seq_cst) -> bool {
+    return compare_exchange_strong(__expected, std::move(__desired), __success,
+                                   __failure);
+  }
+};
+
+template <class _Tp> using atomic_shared_ptr = atomic<shared_ptr<_Tp>>;
+
+} // namespace MySTL
+
+#endif
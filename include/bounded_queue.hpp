@@ -0,0 +1,567 @@
+#ifndef BOUNDED_QUEUE_HPP
+#define BOUNDED_QUEUE_HPP
+
+#include "optional.hpp"
+#include "unique_ptr.hpp"
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// 没有人休眠时发布方不应承担store-load屏障。Linux上用membarrier做非对称屏障：
+// 发布方只用release写入，休眠方登记后让本进程所有运行中的线程各执行一次完整屏障。
+// 定义MYSTL_NO_MEMBARRIER或在TSan下（它不识别membarrier）退回两边都用seq_cst
+#if defined(__linux__) && !defined(MYSTL_NO_MEMBARRIER) &&                     \
+    !defined(__SANITIZE_THREAD__)
+#define _MYSTL_QUEUE_MEMBARRIER 1
+#endif
+
+#ifdef _MYSTL_QUEUE_MEMBARRIER
+#include <linux/membarrier.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace MySTL {
+
+// 有界的无锁队列，元素放在预先分配的环形缓冲区里，不要求元素可以默认构造，
+// 只要求移动构造不抛异常（unique_ptr、move_only_function都满足）
+// try_*在满或空时立即返回；push/pop在满或空时先自旋再休眠等待
+// 批量接口一次占用多个连续位置，只在下标上做一次原子操作
+
+inline constexpr std::size_t _S_cache_line = 64;
+
+// 记录在atomic::wait上休眠的线程数，没有休眠者时发布方省掉notify
+// 等待方先登记再检查条件，发布方先写入再检查登记，两者之间都有（或等效于）
+// seq_cst屏障，至少有一方能看到另一方的操作，不会漏掉唤醒
+// 每个队列的生产者和消费者各用一个，发布方只读取对方那一侧的计数
+struct alignas(_S_cache_line) _QueueSleepers {
+  std::atomic<unsigned> _M_count{0};
+
+#ifdef _MYSTL_QUEUE_MEMBARRIER
+  // 1表示已注册membarrier，-1表示内核不支持
+  alignas(_S_cache_line) static inline std::atomic<int> _S_membarrier{0};
+
+  // 构造队列时注册，此后发布方一开始就走非对称路径
+  _QueueSleepers() noexcept {
+    if (_S_membarrier.load(std::memory_order_relaxed) == 0) {
+      int const __state =
+          ::syscall(SYS_membarrier, MEMBARRIER_CMD_REGISTER_PRIVATE_EXPEDITED,
+                    0, 0) == 0
+              ? 1
+              : -1;
+      _S_membarrier.store(__state, std::memory_order_relaxed);
+    }
+  }
+
+  static auto _S_asymmetric() noexcept -> bool {
+    return _S_membarrier.load(std::memory_order_relaxed) > 0;
+  }
+
+  // 登记之后、最后一次检查之前调用。其他线程读到的状态可能还是0，
+  // 这时它们用seq_cst写入，与这里的seq_cst操作配对，同样不会漏掉唤醒
+  static void _S_heavy_barrier() noexcept {
+    if (_S_asymmetric()) {
+      ::syscall(SYS_membarrier, MEMBARRIER_CMD_PRIVATE_EXPEDITED, 0, 0);
+    }
+  }
+#else
+  static auto _S_asymmetric() noexcept -> bool { return false; }
+
+  static void _S_heavy_barrier() noexcept {}
+#endif
+
+  // 先自旋，再登记并休眠，直到__word的值满足__pred
+  template <class _Word, class _Pred>
+  void _M_wait(std::atomic<_Word> const &__word, _Pred __pred) noexcept {
+    for (int __i = 0; __i < 128; ++__i) {
+      if (__pred(__word.load(std::memory_order_acquire))) {
+        return;
+      }
+    }
+    _M_count.fetch_add(1, std::memory_order_seq_cst);
+    _S_heavy_barrier();
+    while (true) {
+      _Word const __cur = __word.load(std::memory_order_seq_cst);
+      if (__pred(__cur)) {
+        break;
+      }
+      __word.wait(__cur, std::memory_order_acquire);
+    }
+    _M_count.fetch_sub(1, std::memory_order_relaxed);
+  }
+
+  // 写入__word后唤醒休眠者。非对称模式下写入与读取计数之间只需编译器屏障，
+  // 处理器层面的屏障由休眠方的membarrier补上
+  template <class _Word>
+  void _M_publish(std::atomic<_Word> &__word, _Word __value) noexcept {
+    if (_S_asymmetric()) [[likely]] {
+      __word.store(__value, std::memory_order_release);
+      std::atomic_signal_fence(std::memory_order_seq_cst);
+    } else {
+      __word.store(__value, std::memory_order_seq_cst);
+    }
+    if (_M_count.load(std::memory_order_seq_cst) != 0) [[unlikely]] {
+      __word.notify_all();
+    }
+  }
+};
+
+// 多生产者多消费者队列（Vyukov）：每个位置带一个序号，序号等于下标时可写入，
+// 等于下标加一时可读出，读出后加上容量进入下一轮。生产者与消费者分别只竞争
+// 各自的下标，位置与下标都按缓存行对齐，避免相邻位置的伪共享
+template <class _Tp> struct mpmc_queue {
+  static_assert(std::is_nothrow_move_constructible_v<_Tp> &&
+                    std::is_nothrow_destructible_v<_Tp>,
+                "mpmc_queue elements must be nothrow movable");
+
+private:
+  struct alignas(_S_cache_line) _Slot {
+    std::atomic<std::size_t> _M_seq;
+    alignas(_Tp) unsigned char _M_storage[sizeof(_Tp)];
+
+    auto _M_get() noexcept -> _Tp * {
+      return std::launder(reinterpret_cast<_Tp *>(_M_storage));
+    }
+  };
+
+  std::size_t _M_mask;
+  unique_ptr<_Slot[]> _M_slots;
+  alignas(_S_cache_line) std::atomic<std::size_t> _M_enqueue_pos{0};
+  alignas(_S_cache_line) std::atomic<std::size_t> _M_dequeue_pos{0};
+  // 等待空位的生产者由_M_read唤醒，等待元素的消费者由_M_write唤醒
+  _QueueSleepers _M_push_sleepers;
+  _QueueSleepers _M_pop_sleepers;
+
+  auto _M_slot(std::size_t __pos) const noexcept -> _Slot & {
+    return _M_slots[__pos & _M_mask];
+  }
+
+  auto _M_capacity() const noexcept -> std::size_t { return _M_mask + 1; }
+
+  // 占用一个可写入的位置，队列满时返回false
+  auto _M_claim_push(std::size_t &__pos) noexcept -> bool {
+    __pos = _M_enqueue_pos.load(std::memory_order_relaxed);
+    while (true) {
+      std::size_t const __seq =
+          _M_slot(__pos)._M_seq.load(std::memory_order_acquire);
+      auto const __diff = static_cast<std::intptr_t>(__seq - __pos);
+      if (__diff == 0) {
+        if (_M_enqueue_pos.compare_exchange_weak(__pos, __pos + 1,
+                                                 std::memory_order_relaxed)) {
+          return true;
+        }
+      } else if (__diff < 0) {
+        return false;
+      } else {
+        __pos = _M_enqueue_pos.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  auto _M_claim_pop(std::size_t &__pos) noexcept -> bool {
+    __pos = _M_dequeue_pos.load(std::memory_order_relaxed);
+    while (true) {
+      std::size_t const __seq =
+          _M_slot(__pos)._M_seq.load(std::memory_order_acquire);
+      auto const __diff = static_cast<std::intptr_t>(__seq - (__pos + 1));
+      if (__diff == 0) {
+        if (_M_dequeue_pos.compare_exchange_weak(__pos, __pos + 1,
+                                                 std::memory_order_relaxed)) {
+          return true;
+        }
+      } else if (__diff < 0) {
+        return false;
+      } else {
+        __pos = _M_dequeue_pos.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  static void _S_wait_seq(_QueueSleepers &__sleepers, _Slot &__s,
+                         std::size_t __want) noexcept {
+    __sleepers._M_wait(__s._M_seq, [__want](std::size_t __seq) {
+      return __seq == __want;
+    });
+  }
+
+  template <class... _Args>
+  void _M_write(std::size_t __pos, _Args &&...__args) noexcept {
+    _Slot &__s = _M_slot(__pos);
+    ::new (static_cast<void *>(__s._M_storage))
+        _Tp(std::forward<_Args>(__args)...);
+    _M_pop_sleepers._M_publish(__s._M_seq, __pos + 1);
+  }
+
+  auto _M_read(std::size_t __pos) noexcept -> _Tp {
+    _Slot &__s = _M_slot(__pos);
+    _Tp *__p = __s._M_get();
+    _Tp __v(std::move(*__p));
+    __p->~_Tp();
+    _M_push_sleepers._M_publish(__s._M_seq, __pos + _M_capacity());
+    return __v;
+  }
+
+  // 构造可能抛异常时先在外面构造好再移动进去，占用的位置总能完成写入
+  template <class... _Args>
+  static constexpr bool _S_nothrow_emplace =
+      std::is_nothrow_constructible_v<_Tp, _Args...>;
+
+public:
+  // 容量向上取整到2的幂
+  explicit mpmc_queue(std::size_t __capacity)
+      : _M_mask(std::bit_ceil(__capacity < 2 ? std::size_t(2) : __capacity) -
+                1),
+        _M_slots(make_unique<_Slot[]>(_M_mask + 1)) {
+    for (std::size_t __i = 0; __i <= _M_mask; ++__i) {
+      _M_slots[__i]._M_seq.store(__i, std::memory_order_relaxed);
+    }
+  }
+
+  mpmc_queue(mpmc_queue const &) = delete;
+
+  auto operator=(mpmc_queue const &) -> mpmc_queue & = delete;
+
+  // 析构时不能有其他线程仍在访问
+  ~mpmc_queue() {
+    std::size_t const __end = _M_enqueue_pos.load(std::memory_order_relaxed);
+    for (std::size_t __pos = _M_dequeue_pos.load(std::memory_order_relaxed);
+         __pos != __end; ++__pos) {
+      std::destroy_at(_M_slot(__pos)._M_get());
+    }
+  }
+
+  auto capacity() const noexcept -> std::size_t { return _M_capacity(); }
+
+  template <class... _Args> auto try_emplace(_Args &&...__args) -> bool {
+    if constexpr (_S_nothrow_emplace<_Args...>) {
+      std::size_t __pos;
+      if (!_M_claim_push(__pos)) {
+        return false;
+      }
+      _M_write(__pos, std::forward<_Args>(__args)...);
+      return true;
+    } else {
+      return try_push(_Tp(std::forward<_Args>(__args)...));
+    }
+  }
+
+  // 失败时__value保持不变
+  auto try_push(_Tp &&__value) noexcept -> bool {
+    std::size_t __pos;
+    if (!_M_claim_push(__pos)) {
+      return false;
+    }
+    _M_write(__pos, std::move(__value));
+    return true;
+  }
+
+  auto try_push(_Tp const &__value) -> bool { return try_emplace(__value); }
+
+  auto try_pop() noexcept -> optional<_Tp> {
+    std::size_t __pos;
+    if (!_M_claim_pop(__pos)) {
+      return nullopt;
+    }
+    return _M_read(__pos);
+  }
+
+  // 阻塞版本先领取一个序号，再等待对应的位置轮到自己
+  template <class... _Args> void emplace(_Args &&...__args) {
+    if constexpr (_S_nothrow_emplace<_Args...>) {
+      std::size_t const __pos =
+          _M_enqueue_pos.fetch_add(1, std::memory_order_relaxed);
+      _S_wait_seq(_M_push_sleepers, _M_slot(__pos), __pos);
+      _M_write(__pos, std::forward<_Args>(__args)...);
+    } else {
+      push(_Tp(std::forward<_Args>(__args)...));
+    }
+  }
+
+  void push(_Tp &&__value) noexcept {
+    std::size_t const __pos =
+        _M_enqueue_pos.fetch_add(1, std::memory_order_relaxed);
+    _S_wait_seq(_M_push_sleepers, _M_slot(__pos), __pos);
+    _M_write(__pos, std::move(__value));
+  }
+
+  void push(_Tp const &__value) { emplace(__value); }
+
+  auto pop() noexcept -> _Tp {
+    std::size_t const __pos =
+        _M_dequeue_pos.fetch_add(1, std::memory_order_relaxed);
+    _S_wait_seq(_M_pop_sleepers, _M_slot(__pos), __pos + 1);
+    return _M_read(__pos);
+  }
+
+  // 从__first开始移动至多__n个元素入队，返回实际入队的个数
+  // 逐个确认位置已经空出，只占用开头连续可写的部分，一次CAS占用，写入时不等待
+  // 阻塞的push在满时会把下标推过容量，这时按满处理，不等它们完成
+  template <class _It>
+  auto try_push_bulk(_It __first, std::size_t __n) noexcept -> std::size_t {
+    std::size_t __pos = _M_enqueue_pos.load(std::memory_order_relaxed);
+    std::size_t __k;
+    while (true) {
+      std::size_t const __used =
+          __pos - _M_dequeue_pos.load(std::memory_order_acquire);
+      // 消费者的下标超前时那些位置已有阻塞的pop在等，仍可写入
+      std::size_t __free;
+      if (static_cast<std::intptr_t>(__used) < 0) {
+        __free = _M_capacity();
+      } else if (__used > _M_capacity()) {
+        __free = 0;
+      } else {
+        __free = _M_capacity() - __used;
+      }
+      std::size_t const __max = std::min(__n, __free);
+      for (__k = 0; __k < __max; ++__k) {
+        if (_M_slot(__pos + __k)._M_seq.load(std::memory_order_acquire) !=
+            __pos + __k) {
+          break;
+        }
+      }
+      if (__k == 0) {
+        // 读到的下标已经过时才重试，否则确实已满
+        std::size_t const __cur =
+            _M_enqueue_pos.load(std::memory_order_relaxed);
+        if (__cur == __pos) {
+          return 0;
+        }
+        __pos = __cur;
+        continue;
+      }
+      if (_M_enqueue_pos.compare_exchange_weak(__pos, __pos + __k,
+                                               std::memory_order_relaxed)) {
+        break;
+      }
+    }
+    for (std::size_t __i = 0; __i < __k; ++__i, ++__first) {
+      _M_write(__pos + __i, std::move(*__first));
+    }
+    return __k;
+  }
+
+  // 至多取出__n个元素依次移动赋值给*__out++，返回实际取出的个数
+  // 生产者可能已经领取了位置但还没写完，只取开头连续写好的部分，读取时不等待
+  // 阻塞的pop在空时会把下标推过生产者的下标，这时按空处理
+  template <class _OutIt>
+  auto try_pop_bulk(_OutIt __out, std::size_t __n) -> std::size_t {
+    std::size_t __pos = _M_dequeue_pos.load(std::memory_order_relaxed);
+    std::size_t __k;
+    while (true) {
+      std::size_t const __ready =
+          _M_enqueue_pos.load(std::memory_order_acquire) - __pos;
+      std::size_t const __max =
+          static_cast<std::intptr_t>(__ready) < 0 ? 0 : std::min(__n, __ready);
+      for (__k = 0; __k < __max; ++__k) {
+        if (_M_slot(__pos + __k)._M_seq.load(std::memory_order_acquire) !=
+            __pos + __k + 1) {
+          break;
+        }
+      }
+      if (__k == 0) {
+        // 读到的下标已经过时才重试，否则确实为空
+        std::size_t const __cur =
+            _M_dequeue_pos.load(std::memory_order_relaxed);
+        if (__cur == __pos) {
+          return 0;
+        }
+        __pos = __cur;
+        continue;
+      }
+      if (_M_dequeue_pos.compare_exchange_weak(__pos, __pos + __k,
+                                               std::memory_order_relaxed)) {
+        break;
+      }
+    }
+    for (std::size_t __i = 0; __i < __k; ++__i, ++__out) {
+      *__out = _M_read(__pos + __i);
+    }
+    return __k;
+  }
+};
+
+// 单生产者单消费者队列：两端各自只写自己的下标，并缓存对方下标，
+// 只有缓存的值显示满或空时才重新读取对方的缓存行
+template <class _Tp> struct spsc_queue {
+  static_assert(std::is_nothrow_move_constructible_v<_Tp> &&
+                    std::is_nothrow_destructible_v<_Tp>,
+                "spsc_queue elements must be nothrow movable");
+
+private:
+  struct _Slot {
+    alignas(_Tp) unsigned char _M_storage[sizeof(_Tp)];
+
+    auto _M_get() noexcept -> _Tp * {
+      return std::launder(reinterpret_cast<_Tp *>(_M_storage));
+    }
+  };
+
+  std::size_t _M_mask;
+  unique_ptr<_Slot[]> _M_slots;
+  // 生产者的缓存行
+  alignas(_S_cache_line) std::atomic<std::size_t> _M_tail{0};
+  std::size_t _M_head_cache = 0;
+  // 消费者的缓存行
+  alignas(_S_cache_line) std::atomic<std::size_t> _M_head{0};
+  std::size_t _M_tail_cache = 0;
+  // 生产者满时在_M_push_sleepers上休眠，消费者空时在_M_pop_sleepers上休眠
+  _QueueSleepers _M_push_sleepers;
+  _QueueSleepers _M_pop_sleepers;
+
+  auto _M_capacity() const noexcept -> std::size_t { return _M_mask + 1; }
+
+  auto _M_get(std::size_t __i) const noexcept -> _Tp * {
+    return _M_slots[__i & _M_mask]._M_get();
+  }
+
+  // 返回生产者当前可写入的位置数
+  auto _M_free(std::size_t __tail, std::size_t __want) noexcept
+      -> std::size_t {
+    std::size_t __free = _M_capacity() - (__tail - _M_head_cache);
+    if (__free < __want) {
+      _M_head_cache = _M_head.load(std::memory_order_acquire);
+      __free = _M_capacity() - (__tail - _M_head_cache);
+    }
+    return __free;
+  }
+
+  auto _M_ready(std::size_t __head, std::size_t __want) noexcept
+      -> std::size_t {
+    std::size_t __ready = _M_tail_cache - __head;
+    if (__ready < __want) {
+      _M_tail_cache = _M_tail.load(std::memory_order_acquire);
+      __ready = _M_tail_cache - __head;
+    }
+    return __ready;
+  }
+
+  void _M_publish_tail(std::size_t __tail) noexcept {
+    _M_pop_sleepers._M_publish(_M_tail, __tail);
+  }
+
+  void _M_publish_head(std::size_t __head) noexcept {
+    _M_push_sleepers._M_publish(_M_head, __head);
+  }
+
+public:
+  explicit spsc_queue(std::size_t __capacity)
+      : _M_mask(std::bit_ceil(__capacity < 2 ? std::size_t(2) : __capacity) -
+                1),
+        _M_slots(make_unique_for_overwrite<_Slot[]>(_M_mask + 1)) {}
+
+  spsc_queue(spsc_queue const &) = delete;
+
+  auto operator=(spsc_queue const &) -> spsc_queue & = delete;
+
+  ~spsc_queue() {
+    std::size_t const __end = _M_tail.load(std::memory_order_relaxed);
+    for (std::size_t __i = _M_head.load(std::memory_order_relaxed);
+         __i != __end; ++__i) {
+      std::destroy_at(_M_get(__i));
+    }
+  }
+
+  auto capacity() const noexcept -> std::size_t { return _M_capacity(); }
+
+  // 以下只能由生产者线程调用
+
+  template <class... _Args> auto try_emplace(_Args &&...__args) -> bool {
+    std::size_t const __t = _M_tail.load(std::memory_order_relaxed);
+    if (_M_free(__t, 1) == 0) {
+      return false;
+    }
+    ::new (static_cast<void *>(_M_get(__t)))
+        _Tp(std::forward<_Args>(__args)...);
+    _M_publish_tail(__t + 1);
+    return true;
+  }
+
+  auto try_push(_Tp &&__value) noexcept -> bool {
+    return try_emplace(std::move(__value));
+  }
+
+  auto try_push(_Tp const &__value) -> bool { return try_emplace(__value); }
+
+  template <class... _Args> void emplace(_Args &&...__args) {
+    std::size_t const __t = _M_tail.load(std::memory_order_relaxed);
+    while (_M_free(__t, 1) == 0) {
+      // 等消费者把head推进到至少__t - capacity + 1
+      std::size_t const __seen = _M_head_cache;
+      _M_push_sleepers._M_wait(
+          _M_head, [__seen](std::size_t __h) { return __h != __seen; });
+    }
+    ::new (static_cast<void *>(_M_get(__t)))
+        _Tp(std::forward<_Args>(__args)...);
+    _M_publish_tail(__t + 1);
+  }
+
+  void push(_Tp &&__value) noexcept { emplace(std::move(__value)); }
+
+  void push(_Tp const &__value) { emplace(__value); }
+
+  template <class _It>
+  auto try_push_bulk(_It __first, std::size_t __n) noexcept -> std::size_t {
+    std::size_t const __t = _M_tail.load(std::memory_order_relaxed);
+    std::size_t const __k = std::min(__n, _M_free(__t, __n));
+    for (std::size_t __i = 0; __i < __k; ++__i, ++__first) {
+      ::new (static_cast<void *>(_M_get(__t + __i))) _Tp(std::move(*__first));
+    }
+    if (__k) {
+      _M_publish_tail(__t + __k);
+    }
+    return __k;
+  }
+
+  // 以下只能由消费者线程调用
+
+  auto try_pop() noexcept -> optional<_Tp> {
+    std::size_t const __h = _M_head.load(std::memory_order_relaxed);
+    if (_M_ready(__h, 1) == 0) {
+      return nullopt;
+    }
+    _Tp *__p = _M_get(__h);
+    optional<_Tp> __v(std::move(*__p));
+    __p->~_Tp();
+    _M_publish_head(__h + 1);
+    return __v;
+  }
+
+  auto pop() noexcept -> _Tp {
+    std::size_t const __h = _M_head.load(std::memory_order_relaxed);
+    while (_M_ready(__h, 1) == 0) {
+      std::size_t const __seen = _M_tail_cache;
+      _M_pop_sleepers._M_wait(
+          _M_tail, [__seen](std::size_t __t) { return __t != __seen; });
+    }
+    _Tp *__p = _M_get(__h);
+    _Tp __v(std::move(*__p));
+    __p->~_Tp();
+    _M_publish_head(__h + 1);
+    return __v;
+  }
+
+  template <class _OutIt>
+  auto try_pop_bulk(_OutIt __out, std::size_t __n) -> std::size_t {
+    std::size_t const __h = _M_head.load(std::memory_order_relaxed);
+    std::size_t const __k = std::min(__n, _M_ready(__h, __n));
+    for (std::size_t __i = 0; __i < __k; ++__i, ++__out) {
+      _Tp *__p = _M_get(__h + __i);
+      *__out = std::move(*__p);
+      __p->~_Tp();
+    }
+    if (__k) {
+      _M_publish_head(__h + __k);
+    }
+    return __k;
+  }
+};
+
+} // namespace MySTL
+
+#endif
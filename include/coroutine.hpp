@@ -0,0 +1,627 @@
+#ifndef COROUTINE_HPP
+#define COROUTINE_HPP
+
+#include "alloc_hooks.hpp"
+#include "functional.hpp"
+#include "optional.hpp"
+#include <atomic>
+#include <concepts>
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// task<T>：惰性启动的协程，被co_await时才开始执行，结束时对称转移回等待者，
+// 任意深度的co_await链不会增长调用栈（GCC在-O2以上才把对称转移编译为尾调用）
+// generator<T>：同步的惰性序列，可直接用于范围for与std::ranges
+// 两者的协程帧默认从线程本地的帧缓存分配，同样大小的帧反复创建时不经过全局堆；
+// 定义MYSTL_NO_FRAME_POOL可以关闭，定义MYSTL_ALLOC_HOOKS时也不使用缓存，
+// 以便逐帧统计和改道
+
+#if !defined(MYSTL_NO_FRAME_POOL) && !defined(MYSTL_ALLOC_HOOKS)
+#define _MYSTL_FRAME_POOL 1
+#endif
+
+namespace MySTL {
+
+inline constexpr std::size_t _S_frame_align = __STDCPP_DEFAULT_NEW_ALIGNMENT__;
+
+#ifdef _MYSTL_FRAME_POOL
+
+struct _FrameNode {
+  _FrameNode *_M_next;
+};
+
+// 按64字节分档的空闲链表，每档最多缓存_S_keep_bytes字节，
+// 足够容纳数百层的co_await链；超过_S_max_size的帧不缓存
+// 帧可以在其他线程释放，释放的线程把它放进自己的链表，不需要同步
+// 本身可平凡析构，线程退出后仍可安全访问，由_FramePoolExit归还缓存的帧
+struct _FramePool {
+  static constexpr std::size_t _S_granule = 64;
+  static constexpr std::size_t _S_classes = 16;
+  static constexpr std::size_t _S_max_size = _S_granule * _S_classes;
+  static constexpr std::size_t _S_keep_bytes = 64 * 1024;
+
+  _FrameNode *_M_free[_S_classes];
+  std::size_t _M_count[_S_classes];
+  bool _M_exiting;
+
+  static constexpr auto _S_class_of(std::size_t __size) noexcept
+      -> std::size_t {
+    return (__size - 1) / _S_granule;
+  }
+
+  static constexpr auto _S_size_of(std::size_t __c) noexcept -> std::size_t {
+    return (__c + 1) * _S_granule;
+  }
+};
+
+inline thread_local _FramePool _S_frame_pool{};
+
+struct _FramePoolExit {
+  ~_FramePoolExit() {
+    _FramePool &__pool = _S_frame_pool;
+    __pool._M_exiting = true;
+    for (std::size_t __c = 0; __c < _FramePool::_S_classes; ++__c) {
+      while (_FrameNode *__n = __pool._M_free[__c]) {
+        __pool._M_free[__c] = __n->_M_next;
+        _S_hookDeallocate(alloc_site::coroutine_frame, __n,
+                          _FramePool::_S_size_of(__c), _S_frame_align);
+      }
+      __pool._M_count[__c] = 0;
+    }
+  }
+};
+
+inline thread_local _FramePoolExit _S_frame_pool_exit;
+
+#endif
+
+inline auto _S_frameAllocate(std::size_t __size) -> void * {
+#ifdef _MYSTL_FRAME_POOL
+  if (__size <= _FramePool::_S_max_size) {
+    std::size_t const __c = _FramePool::_S_class_of(__size);
+    _FramePool &__pool = _S_frame_pool;
+    if (_FrameNode *__n = __pool._M_free[__c]) [[likely]] {
+      __pool._M_free[__c] = __n->_M_next;
+      --__pool._M_count[__c];
+      return __n;
+    }
+    // 第一次往缓存里放帧之前登记线程退出时的清理
+    (void)&_S_frame_pool_exit;
+    return _S_hookAllocate(alloc_site::coroutine_frame,
+                           _FramePool::_S_size_of(__c), _S_frame_align);
+  }
+#endif
+  return _S_hookAllocate(alloc_site::coroutine_frame, __size, _S_frame_align);
+}
+
+inline void _S_frameDeallocate(void *__p, std::size_t __size) noexcept {
+#ifdef _MYSTL_FRAME_POOL
+  if (__size <= _FramePool::_S_max_size) {
+    std::size_t const __c = _FramePool::_S_class_of(__size);
+    _FramePool &__pool = _S_frame_pool;
+    if (__pool._M_count[__c] <
+            _FramePool::_S_keep_bytes / _FramePool::_S_size_of(__c) &&
+        !__pool._M_exiting) [[likely]] {
+      // 只释放不分配的线程（如只运行resume_on之后的部分）也要在线程退出时
+      // 归还缓存的帧，往空链表里放帧时登记
+      if (__pool._M_count[__c] == 0) {
+        (void)&_S_frame_pool_exit;
+      }
+      auto *__n = static_cast<_FrameNode *>(__p);
+      __n->_M_next = __pool._M_free[__c];
+      __pool._M_free[__c] = __n;
+      ++__pool._M_count[__c];
+      return;
+    }
+    __size = _FramePool::_S_size_of(__c);
+  }
+#endif
+  _S_hookDeallocate(alloc_site::coroutine_frame, __p, __size, _S_frame_align);
+}
+
+// 协程参数以std::allocator_arg, __alloc开头时帧改由__alloc分配
+// __alloc需要提供allocate(size, align)，有deallocate(p, size, align)时
+// 释放帧会调用它；没有时（如monotonic_arena）帧随分配器一起释放
+// 可拷贝的分配器与std::generator一样拷贝一份放在帧之后，参数可以按值传递；
+// 不可拷贝的分配器（分配区等资源本身）只记录地址，协程必须按引用接收，
+// 所以也不能可移动，否则按值的参数在协程首次挂起后就已析构
+template <class _Alloc>
+concept _FrameAllocator =
+    requires(_Alloc &__a, std::size_t __n) {
+      { __a.allocate(__n, __n) } -> std::convertible_to<void *>;
+    } && (std::is_copy_constructible_v<_Alloc> ||
+          !std::is_move_constructible_v<_Alloc>) &&
+    alignof(_Alloc) <= _S_frame_align;
+
+// 帧之后附带的释放方式，默认缓存与自定义分配器共用同一个operator delete
+// _M_free收到的是协程帧本身的大小，由它算出整块分配的大小
+struct _FrameTrailer {
+  void (*_M_free)(void *__alloc, void *__frame, std::size_t __size) noexcept;
+  void *_M_alloc;
+};
+
+// task与generator的promise共用的帧分配
+struct _FramePromiseBase {
+private:
+  static constexpr auto _S_trailer_at(std::size_t __size) noexcept
+      -> std::size_t {
+    return (__size + alignof(_FrameTrailer) - 1) &
+           ~(alignof(_FrameTrailer) - 1);
+  }
+
+  static constexpr auto _S_total(std::size_t __size) noexcept -> std::size_t {
+    return _S_trailer_at(__size) + sizeof(_FrameTrailer);
+  }
+
+  static auto _S_trailer(void *__frame, std::size_t __size) noexcept
+      -> _FrameTrailer * {
+    return reinterpret_cast<_FrameTrailer *>(static_cast<char *>(__frame) +
+                                             _S_trailer_at(__size));
+  }
+
+  // 分配器的拷贝紧接在_FrameTrailer之后
+  template <class _Alloc>
+  static constexpr auto _S_alloc_at(std::size_t __size) noexcept
+      -> std::size_t {
+    return (_S_total(__size) + alignof(_Alloc) - 1) & ~(alignof(_Alloc) - 1);
+  }
+
+  template <class _Alloc>
+  static constexpr auto _S_total_with(std::size_t __size) noexcept
+      -> std::size_t {
+    if constexpr (std::is_copy_constructible_v<_Alloc>) {
+      return _S_alloc_at<_Alloc>(__size) + sizeof(_Alloc);
+    } else {
+      return _S_total(__size);
+    }
+  }
+
+  template <class _Alloc>
+  static void _S_deallocateWith(_Alloc &__alloc, void *__frame,
+                                std::size_t __size) noexcept {
+    if constexpr (requires {
+                    __alloc.deallocate(__frame, __size, _S_frame_align);
+                  }) {
+      __alloc.deallocate(__frame, _S_total_with<_Alloc>(__size),
+                         _S_frame_align);
+    }
+  }
+
+  template <class _Alloc>
+  static auto _S_allocateWith(std::size_t __size, _Alloc &__alloc) -> void * {
+    std::size_t const __total = _S_total_with<_Alloc>(__size);
+    void *__p = __alloc.allocate(__total, _S_frame_align);
+    _Alloc *__kept = std::addressof(__alloc);
+    if constexpr (std::is_copy_constructible_v<_Alloc>) {
+      void *__at = static_cast<char *>(__p) + _S_alloc_at<_Alloc>(__size);
+      try {
+        __kept = ::new (__at) _Alloc(__alloc);
+      } catch (...) {
+        _S_deallocateWith(__alloc, __p, __size);
+        throw;
+      }
+    }
+    ::new (static_cast<void *>(_S_trailer(__p, __size))) _FrameTrailer{
+        [](void *__a, void *__frame, std::size_t __n) noexcept {
+          auto &__kept = *static_cast<_Alloc *>(__a);
+          if constexpr (std::is_copy_constructible_v<_Alloc>) {
+            // 帧内的拷贝随帧一起释放，先移出来
+            _Alloc __local(std::move(__kept));
+            __kept.~_Alloc();
+            _S_deallocateWith(__local, __frame, __n);
+          } else {
+            _S_deallocateWith(__kept, __frame, __n);
+          }
+        },
+        __kept};
+    return __p;
+  }
+
+public:
+  static auto operator new(std::size_t __size) -> void * {
+    void *__p = _S_frameAllocate(_S_total(__size));
+    ::new (static_cast<void *>(_S_trailer(__p, __size))) _FrameTrailer{
+        [](void *, void *__frame, std::size_t __n) noexcept {
+          _S_frameDeallocate(__frame, _S_total(__n));
+        },
+        nullptr};
+    return __p;
+  }
+
+  template <_FrameAllocator _Alloc, class... _Args>
+  static auto operator new(std::size_t __size, std::allocator_arg_t,
+                           _Alloc &__alloc, _Args &...) -> void * {
+    return _S_allocateWith(__size, __alloc);
+  }
+
+  // 成员函数协程的第一个参数是对象本身
+  template <class _Self, _FrameAllocator _Alloc, class... _Args>
+  static auto operator new(std::size_t __size, _Self &, std::allocator_arg_t,
+                           _Alloc &__alloc, _Args &...) -> void * {
+    return _S_allocateWith(__size, __alloc);
+  }
+
+  static void operator delete(void *__p, std::size_t __size) noexcept {
+    _FrameTrailer const *__t = _S_trailer(__p, __size);
+    __t->_M_free(__t->_M_alloc, __p, __size);
+  }
+};
+
+// 执行器：接受move_only_function<void()>并在某个线程上运行，thread_pool满足
+template <class _Executor>
+concept executor = requires(_Executor &__e, move_only_function<void()> __f) {
+  __e.post(std::move(__f));
+};
+
+// co_await resume_on(__e)把当前协程的剩余部分交给__e继续执行
+template <executor _Executor> struct _ResumeOn {
+  _Executor &_M_executor;
+
+  auto await_ready() const noexcept -> bool { return false; }
+
+  void await_suspend(std::coroutine_handle<> __h) {
+    _M_executor.post([__h] { __h.resume(); });
+  }
+
+  void await_resume() const noexcept {}
+};
+
+template <executor _Executor>
+auto resume_on(_Executor &__e) noexcept -> _ResumeOn<_Executor> {
+  return {__e};
+}
+
+template <class _Tp = void> struct task;
+
+// 结束时对称转移到等待者；没有等待者时挂起，帧由task析构
+struct _TaskFinalAwaiter {
+  auto await_ready() const noexcept -> bool { return false; }
+
+  template <class _Promise>
+  auto await_suspend(std::coroutine_handle<_Promise> __h) noexcept
+      -> std::coroutine_handle<> {
+    if (std::coroutine_handle<> __c = __h.promise()._M_continuation) {
+      return __c;
+    }
+    return std::noop_coroutine();
+  }
+
+  void await_resume() const noexcept {}
+};
+
+// 结果与异常分开存放，引用结果按指针保存
+template <class _Tp> struct _TaskPromise : _FramePromiseBase {
+  using _Stored = std::conditional_t<std::is_reference_v<_Tp>,
+                                     std::remove_reference_t<_Tp> *, _Tp>;
+
+  std::coroutine_handle<> _M_continuation;
+  optional<_Stored> _M_value;
+  std::exception_ptr _M_error;
+
+  auto get_return_object() noexcept -> task<_Tp>;
+
+  auto initial_suspend() const noexcept -> std::suspend_always { return {}; }
+
+  auto final_suspend() const noexcept -> _TaskFinalAwaiter { return {}; }
+
+  void unhandled_exception() noexcept { _M_error = std::current_exception(); }
+
+  template <class _Up = _Tp>
+    requires std::is_convertible_v<_Up &&, _Tp>
+  void return_value(_Up &&__value) {
+    if constexpr (std::is_reference_v<_Tp>) {
+      _Tp __ref = std::forward<_Up>(__value);
+      _M_value.emplace(std::addressof(__ref));
+    } else {
+      _M_value.emplace(std::forward<_Up>(__value));
+    }
+  }
+
+  // 结束后取出结果，协程中抛出的异常在这里重新抛出
+  auto _M_take() -> _Tp {
+    if (_M_error) {
+      std::rethrow_exception(_M_error);
+    }
+    if constexpr (std::is_reference_v<_Tp>) {
+      return static_cast<_Tp>(**_M_value);
+    } else {
+      return std::move(*_M_value);
+    }
+  }
+};
+
+template <> struct _TaskPromise<void> : _FramePromiseBase {
+  std::coroutine_handle<> _M_continuation;
+  std::exception_ptr _M_error;
+
+  auto get_return_object() noexcept -> task<void>;
+
+  auto initial_suspend() const noexcept -> std::suspend_always { return {}; }
+
+  auto final_suspend() const noexcept -> _TaskFinalAwaiter { return {}; }
+
+  void unhandled_exception() noexcept { _M_error = std::current_exception(); }
+
+  void return_void() const noexcept {}
+
+  void _M_take() const {
+    if (_M_error) {
+      std::rethrow_exception(_M_error);
+    }
+  }
+};
+
+// 等待task结束但不取结果
+template <class _Tp> struct _TaskAwaiterBase {
+  std::coroutine_handle<_TaskPromise<_Tp>> _M_handle;
+
+  auto await_ready() const noexcept -> bool { return _M_handle.done(); }
+
+  auto await_suspend(std::coroutine_handle<> __awaiting) noexcept
+      -> std::coroutine_handle<> {
+    _M_handle.promise()._M_continuation = __awaiting;
+    return _M_handle;
+  }
+
+  void await_resume() const noexcept {}
+};
+
+template <class _Tp> struct [[nodiscard]] task {
+  using promise_type = _TaskPromise<_Tp>;
+
+private:
+  std::coroutine_handle<promise_type> _M_handle;
+
+  template <class _Up> friend struct _TaskPromise;
+  template <class _Up> friend auto sync_wait(task<_Up> __t) -> _Up;
+
+  explicit task(std::coroutine_handle<promise_type> __h) noexcept
+      : _M_handle(__h) {}
+
+  struct _Awaiter : _TaskAwaiterBase<_Tp> {
+    auto await_resume() -> _Tp { return this->_M_handle.promise()._M_take(); }
+  };
+
+public:
+  task() noexcept = default;
+
+  task(task &&__that) noexcept
+      : _M_handle(std::exchange(__that._M_handle, nullptr)) {}
+
+  auto operator=(task __that) noexcept -> task & {
+    std::swap(_M_handle, __that._M_handle);
+    return *this;
+  }
+
+  ~task() {
+    if (_M_handle) {
+      _M_handle.destroy();
+    }
+  }
+
+  auto valid() const noexcept -> bool { return static_cast<bool>(_M_handle); }
+
+  auto done() const noexcept -> bool { return _M_handle.done(); }
+
+  // 启动（或继续等待）task，结束后得到它的结果；结果只能取一次
+  auto operator co_await() && noexcept -> _Awaiter { return {{_M_handle}}; }
+};
+
+template <class _Tp>
+inline auto _TaskPromise<_Tp>::get_return_object() noexcept -> task<_Tp> {
+  return task<_Tp>(
+      std::coroutine_handle<_TaskPromise<_Tp>>::from_promise(*this));
+}
+
+inline auto _TaskPromise<void>::get_return_object() noexcept -> task<void> {
+  return task<void>(
+      std::coroutine_handle<_TaskPromise<void>>::from_promise(*this));
+}
+
+// sync_wait用来等待task结束的协程，结束时置位标志唤醒调用线程
+// 不用std::binary_semaphore：libstdc++的release无论有没有等待者都会进内核
+struct _SyncWaitDriver {
+  struct promise_type : _FramePromiseBase {
+    std::atomic<bool> *_M_done;
+
+    template <class _Awaiter>
+    promise_type(_Awaiter &, std::atomic<bool> &__done) noexcept
+        : _M_done(&__done) {}
+
+    auto get_return_object() noexcept -> _SyncWaitDriver {
+      return {std::coroutine_handle<promise_type>::from_promise(*this)};
+    }
+
+    auto initial_suspend() const noexcept -> std::suspend_never { return {}; }
+
+    auto final_suspend() const noexcept {
+      struct _Final {
+        auto await_ready() const noexcept -> bool { return false; }
+
+        // 置位之后调用线程就可能销毁本帧与标志，notify只用到标志的地址
+        void await_suspend(
+            std::coroutine_handle<promise_type> __h) const noexcept {
+          std::atomic<bool> *__done = __h.promise()._M_done;
+          __done->store(true, std::memory_order_release);
+          __done->notify_one();
+        }
+
+        void await_resume() const noexcept {}
+      };
+      return _Final{};
+    }
+
+    // task的异常留在task里，这里不会抛出
+    void unhandled_exception() const noexcept { std::terminate(); }
+
+    void return_void() const noexcept {}
+  };
+
+  std::coroutine_handle<promise_type> _M_handle;
+};
+
+template <class _Tp>
+auto _S_syncWaitStart(_TaskAwaiterBase<_Tp> __awaiter, std::atomic<bool> &)
+    -> _SyncWaitDriver {
+  co_await __awaiter;
+}
+
+// 在当前线程启动task并阻塞到它结束（可能在其他线程结束），返回它的结果
+template <class _Tp> auto sync_wait(task<_Tp> __t) -> _Tp {
+  std::atomic<bool> __done{false};
+  _SyncWaitDriver __driver =
+      _S_syncWaitStart(_TaskAwaiterBase<_Tp>{__t._M_handle}, __done);
+  __done.wait(false, std::memory_order_acquire);
+  __driver._M_handle.destroy();
+  return __t._M_handle.promise()._M_take();
+}
+
+template <class _Tp> struct generator;
+
+// 与std::generator相同：非引用的_Tp按右值引用产出，迭代时可以移走
+template <class _Tp> struct _GeneratorPromise : _FramePromiseBase {
+  using _Reference =
+      std::conditional_t<std::is_reference_v<_Tp>, _Tp, _Tp &&>;
+  using _Yielded =
+      std::conditional_t<std::is_reference_v<_Reference>, _Reference,
+                         _Reference const &>;
+
+  std::add_pointer_t<_Yielded> _M_current = nullptr;
+  std::exception_ptr _M_error;
+
+  auto get_return_object() noexcept -> generator<_Tp>;
+
+  auto initial_suspend() const noexcept -> std::suspend_always { return {}; }
+
+  auto final_suspend() const noexcept -> std::suspend_always { return {}; }
+
+  // 产出的对象在协程恢复之前一直存活，只保存它的地址
+  auto yield_value(_Yielded __value) noexcept -> std::suspend_always {
+    _M_current = std::addressof(__value);
+    return {};
+  }
+
+  // 以右值产出时，左值先复制一份放在帧里
+  auto yield_value(std::remove_reference_t<_Yielded> const &__value)
+    requires std::is_rvalue_reference_v<_Yielded> &&
+             std::constructible_from<std::remove_cvref_t<_Yielded>,
+                                     std::remove_reference_t<_Yielded> const &>
+  {
+    struct _CopyAwaiter {
+      std::remove_cvref_t<_Yielded> _M_copy;
+      _GeneratorPromise *_M_promise;
+
+      auto await_ready() const noexcept -> bool { return false; }
+
+      void await_suspend(std::coroutine_handle<>) noexcept {
+        _M_promise->_M_current = std::addressof(_M_copy);
+      }
+
+      void await_resume() const noexcept {}
+    };
+    return _CopyAwaiter{__value, this};
+  }
+
+  void return_void() const noexcept {}
+
+  void unhandled_exception() noexcept { _M_error = std::current_exception(); }
+
+  // 生成器中不能co_await
+  template <class _Up> auto await_transform(_Up &&) = delete;
+
+  void _M_rethrow() const {
+    if (_M_error) {
+      std::rethrow_exception(_M_error);
+    }
+  }
+};
+
+template <class _Tp> struct [[nodiscard]] generator {
+  using promise_type = _GeneratorPromise<_Tp>;
+
+private:
+  using _Reference = typename promise_type::_Reference;
+
+  std::coroutine_handle<promise_type> _M_handle;
+
+  friend promise_type;
+
+  explicit generator(std::coroutine_handle<promise_type> __h) noexcept
+      : _M_handle(__h) {}
+
+public:
+  struct iterator {
+    using value_type = std::remove_cvref_t<_Tp>;
+    using difference_type = std::ptrdiff_t;
+
+  private:
+    std::coroutine_handle<promise_type> _M_handle;
+
+    friend generator;
+
+    explicit iterator(std::coroutine_handle<promise_type> __h) noexcept
+        : _M_handle(__h) {}
+
+  public:
+    iterator() noexcept = default;
+
+    auto operator*() const noexcept -> _Reference {
+      return static_cast<_Reference>(*_M_handle.promise()._M_current);
+    }
+
+    // 恢复生成器直到下一次产出或结束，生成器抛出的异常在这里传出
+    auto operator++() -> iterator & {
+      _M_handle.resume();
+      _M_handle.promise()._M_rethrow();
+      return *this;
+    }
+
+    void operator++(int) { ++*this; }
+
+    friend auto operator==(iterator const &__it,
+                           std::default_sentinel_t) noexcept -> bool {
+      return __it._M_handle.done();
+    }
+  };
+
+  generator(generator &&__that) noexcept
+      : _M_handle(std::exchange(__that._M_handle, nullptr)) {}
+
+  auto operator=(generator __that) noexcept -> generator & {
+    std::swap(_M_handle, __that._M_handle);
+    return *this;
+  }
+
+  // 提前析构时销毁帧，帧中的局部对象正常析构
+  ~generator() {
+    if (_M_handle) {
+      _M_handle.destroy();
+    }
+  }
+
+  // 只能调用一次，第一次调用时才开始执行生成器
+  auto begin() -> iterator {
+    _M_handle.resume();
+    _M_handle.promise()._M_rethrow();
+    return iterator(_M_handle);
+  }
+
+  auto end() const noexcept -> std::default_sentinel_t { return {}; }
+};
+
+template <class _Tp>
+inline auto _GeneratorPromise<_Tp>::get_return_object() noexcept
+    -> generator<_Tp> {
+  return generator<_Tp>(
+      std::coroutine_handle<_GeneratorPromise<_Tp>>::from_promise(*this));
+}
+
+} // namespace MySTL
+
+#endif
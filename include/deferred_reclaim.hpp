@@ -0,0 +1,250 @@
+#ifndef DEFERRED_RECLAIM_HPP
+#define DEFERRED_RECLAIM_HPP
+
+#include "_reclaim_base.hpp"
+#include "shared_ptr.hpp"
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace MySTL {
+
+// background：攒满一批后交给回收器自己的后台线程析构
+// caller：攒满一批或调用flush时在本线程一次析构，把零散的析构集中到调用者
+// 选定的时机（例如一个请求处理完之后）
+enum class deferred_mode { background, caller };
+
+struct deferred_reclaim_stats {
+  std::size_t queued;       // 已交给后台线程、尚未析构完的对象数
+  std::size_t max_queued;   // queued的峰值
+  std::uint64_t handed_off; // 累计交出的对象数
+  std::uint64_t reclaimed;  // 累计析构完成的对象数
+};
+
+// 把对象的析构从热路径上挪走：deferred_deleter把要析构的对象放进本线程的
+// 批次（一次push_back），批次满batch个后整体交出，每批只加一次锁
+// 每个线程的批次沿用epoch_domain的每线程记录；线程退出前未交出的对象留在
+// 记录里，由下一个占用该记录的线程或回收器的析构处理，需要及时析构时先flush
+struct deferred_reclaimer {
+private:
+  _ReclaimRecords<_ReclaimRecord> _M_records;
+  std::size_t _M_batch;
+  deferred_mode _M_mode;
+  std::uint64_t _M_id;
+
+  std::mutex _M_mutex;
+  std::condition_variable _M_work_cv;
+  std::condition_variable _M_idle_cv;
+  std::vector<_Retired> _M_queue;
+  std::size_t _M_queued = 0; // 包括后台线程正在析构的一批
+  std::size_t _M_max_queued = 0;
+  std::uint64_t _M_handed_off = 0;
+  std::uint64_t _M_reclaimed = 0;
+  bool _M_stop = false;
+  std::thread _M_worker;
+
+  template <class, class> friend struct deferred_deleter;
+
+  auto _M_local() -> _ReclaimRecord * {
+    return _S_reclaimLocal(_M_id, _M_records);
+  }
+
+  void _M_defer(_Retired const &__x) noexcept {
+    _ReclaimRecord *__r;
+    try {
+      __r = _M_local();
+      __r->_M_retired.push_back(__x);
+    } catch (...) {
+      // 记录或批次无法分配时退回到当场析构
+      __x._M_run();
+      return;
+    }
+    if (__r->_M_retired.size() >= _M_batch) {
+      _M_flush(__r);
+    }
+  }
+
+  // 析构中可能再次推迟对象，它们进入同一个记录，循环到记录为空
+  void _M_run_local(_ReclaimRecord *__r) noexcept {
+    std::vector<_Retired> __batch;
+    std::uint64_t __n = 0;
+    while (!__r->_M_retired.empty()) {
+      __batch.swap(__r->_M_retired);
+      for (_Retired const &__x : __batch) {
+        __x._M_run();
+      }
+      __n += __batch.size();
+      __batch.clear();
+    }
+    // 保留批次的容量，下一批不必重新分配
+    __r->_M_retired.swap(__batch);
+    std::lock_guard<std::mutex> __lock(_M_mutex);
+    _M_reclaimed += __n;
+  }
+
+  // 整批交给后台线程；队列扩容失败时留在批次里，下次再交
+  void _M_flush(_ReclaimRecord *__r) noexcept {
+    if (__r->_M_retired.empty()) {
+      return;
+    }
+    if (_M_mode == deferred_mode::caller) {
+      _M_run_local(__r);
+      return;
+    }
+    std::size_t const __n = __r->_M_retired.size();
+    {
+      std::lock_guard<std::mutex> __lock(_M_mutex);
+      if (_M_queue.empty()) {
+        _M_queue.swap(__r->_M_retired);
+      } else {
+        try {
+          _M_queue.insert(_M_queue.end(), __r->_M_retired.begin(),
+                          __r->_M_retired.end());
+        } catch (...) {
+          return;
+        }
+        __r->_M_retired.clear();
+      }
+      _M_queued += __n;
+      _M_handed_off += __n;
+      _M_max_queued = std::max(_M_max_queued, _M_queued);
+    }
+    _M_work_cv.notify_one();
+  }
+
+  void _M_work() {
+    std::vector<_Retired> __batch;
+    std::unique_lock<std::mutex> __lock(_M_mutex);
+    while (true) {
+      _M_work_cv.wait(__lock,
+                      [this] { return _M_stop || !_M_queue.empty(); });
+      if (_M_queue.empty()) {
+        return;
+      }
+      __batch.swap(_M_queue);
+      __lock.unlock();
+      for (_Retired const &__x : __batch) {
+        __x._M_run();
+      }
+      // 析构中再次推迟的对象先交出，再报告这一批完成，drain不会提前返回
+      _M_flush(_M_local());
+      __lock.lock();
+      _M_queued -= __batch.size();
+      _M_reclaimed += __batch.size();
+      __batch.clear();
+      if (_M_queued == 0) {
+        _M_idle_cv.notify_all();
+      }
+    }
+  }
+
+public:
+  static constexpr std::size_t _S_default_batch = 64;
+
+  explicit deferred_reclaimer(
+      std::size_t __batch = _S_default_batch,
+      deferred_mode __mode = deferred_mode::background)
+      : _M_batch(__batch ? __batch : 1), _M_mode(__mode),
+        _M_id(_S_reclaimRegister()) {
+    if (_M_mode == deferred_mode::background) {
+      _M_worker = std::thread(&deferred_reclaimer::_M_work, this);
+    }
+  }
+
+  deferred_reclaimer(deferred_reclaimer const &) = delete;
+
+  auto operator=(deferred_reclaimer const &) -> deferred_reclaimer & = delete;
+
+  // 析构时不能再有线程向它推迟对象。后台线程处理完已交出的对象后退出，
+  // 各线程记录中剩下的对象随_M_records析构。不经过本线程的记录：静态的回收器
+  // 析构时，主线程的线程本地缓存可能已经销毁
+  ~deferred_reclaimer() {
+    if (_M_worker.joinable()) {
+      {
+        std::lock_guard<std::mutex> __lock(_M_mutex);
+        _M_stop = true;
+      }
+      _M_work_cv.notify_one();
+      _M_worker.join();
+    }
+    _S_reclaimUnregister(_M_id);
+  }
+
+  // 不等批次攒满，立即交出本线程推迟的对象；caller模式下当场析构
+  void flush() { _M_flush(_M_local()); }
+
+  // flush之后等待已交出的对象全部析构完，用于关闭前清空
+  // 只覆盖本线程和已经交出的批次，其他线程需要各自flush
+  void drain() {
+    flush();
+    std::unique_lock<std::mutex> __lock(_M_mutex);
+    _M_idle_cv.wait(__lock, [this] { return _M_queued == 0; });
+  }
+
+  // 本线程批次中尚未交出的对象数
+  auto pending() -> std::size_t { return _M_local()->_M_retired.size(); }
+
+  auto stats() -> deferred_reclaim_stats {
+    std::lock_guard<std::mutex> __lock(_M_mutex);
+    return {_M_queued, _M_max_queued, _M_handed_off, _M_reclaimed};
+  }
+
+  auto batch() const noexcept -> std::size_t { return _M_batch; }
+
+  auto mode() const noexcept -> deferred_mode { return _M_mode; }
+};
+
+inline auto default_deferred_reclaimer() -> deferred_reclaimer & {
+  static deferred_reclaimer __reclaimer;
+  return __reclaimer;
+}
+
+// 推迟析构的删除器：单独使用时（例如unique_ptr）把指针和内层删除器交给回收器；
+// 作为shared_ptr的删除器时交出整个控制块，两种控制块布局都适用
+template <class _Tp, class _Deleter = DefaultDeleter<_Tp>>
+struct deferred_deleter {
+  [[no_unique_address]] _Deleter _M_deleter;
+  deferred_reclaimer *_M_reclaimer;
+
+  explicit deferred_deleter(
+      deferred_reclaimer &__reclaimer = default_deferred_reclaimer(),
+      _Deleter __deleter = _Deleter())
+      : _M_deleter(std::move(__deleter)), _M_reclaimer(&__reclaimer) {}
+
+  void operator()(_Tp *__ptr) const {
+    _M_reclaimer->_M_defer(_S_makeRetired(__ptr, _M_deleter));
+  }
+
+  // 强引用归零时调用，__counter多持有的弱引用在析构完成后归还
+  template <class _Counter>
+  void _M_dispose_counter(_Counter *__counter) const noexcept {
+    _M_reclaimer->_M_defer(
+        {__counter, nullptr, &deferred_deleter::_S_reclaim<_Counter>, 0});
+  }
+
+  template <class _Counter> static void _S_reclaim(void *__c, void *) {
+    auto *__counter = static_cast<_Counter *>(__c);
+    __counter->_M_deleter._M_deleter(__counter->_M_ptr);
+    __counter->_M_weak_decref();
+  }
+};
+
+// 与make_shared相同的单次分配布局，最后一个强引用释放时对象交给__reclaimer析构
+template <class _Tp, class... _Args>
+  requires(!std::is_unbounded_array_v<_Tp>)
+auto make_shared_deferred(deferred_reclaimer &__reclaimer, _Args &&...__args)
+    -> shared_ptr<_Tp> {
+  auto [__object, __counter] = _S_newSharedFusedWith<_Tp>(
+      deferred_deleter<_Tp, _SpDestroyAt<_Tp>>(__reclaimer),
+      std::forward<_Args>(__args)...);
+  _S_setupEnableSharedFromThis(__object, __counter);
+  return _S_makeSharedFused(__object, __counter);
+}
+
+} // namespace MySTL
+
+#endif
@@ -0,0 +1,165 @@
+#ifndef EPOCH_HPP
+#define EPOCH_HPP
+
+#include "_reclaim_base.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace MySTL {
+
+// 基于纪元的内存回收：读端进入epoch_guard时公布当前全局纪元，只是一次本线程
+// 缓存行上的存储加一个屏障，不修改任何共享计数
+// 对象从数据结构中摘下后retire，标记为当时的全局纪元e；所有临界区中的线程都
+// 观察到纪元e后全局纪元才能前进，前进到e + 2时已经没有线程可能持有该对象
+// 积累batch个待回收对象后尝试推进纪元并成批释放。长时间停在临界区中的线程会
+// 阻止纪元前进，此时待回收对象没有上界，需要上界时使用hazard_domain
+struct _EpochRecord : _ReclaimRecord {
+  // 0表示不在临界区，否则为(纪元 << 1) | 1
+  alignas(64) std::atomic<std::uint64_t> _M_state{0};
+  unsigned _M_nesting = 0;
+};
+
+struct epoch_domain {
+private:
+  alignas(64) std::atomic<std::uint64_t> _M_epoch{0};
+  _ReclaimRecords<_EpochRecord> _M_records;
+  std::size_t _M_batch;
+  std::uint64_t _M_id;
+
+  friend struct epoch_guard;
+
+  auto _M_local() -> _EpochRecord * {
+    return _S_reclaimLocal(_M_id, _M_records);
+  }
+
+  void _M_enter(_EpochRecord *__r) noexcept {
+    if (__r->_M_nesting++ == 0) {
+      std::uint64_t const __e = _M_epoch.load(std::memory_order_relaxed);
+      __r->_M_state.store((__e << 1) | 1, std::memory_order_relaxed);
+      // 公布纪元必须先于临界区内的读取，与_M_try_advance中的屏障配对
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+    }
+  }
+
+  void _M_leave(_EpochRecord *__r) noexcept {
+    if (--__r->_M_nesting == 0) {
+      __r->_M_state.store(0, std::memory_order_release);
+    }
+  }
+
+  // 所有临界区中的线程都已观察到当前纪元时前进一步，返回前进后的全局纪元
+  auto _M_try_advance() noexcept -> std::uint64_t {
+    std::uint64_t __e = _M_epoch.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    bool __blocked = false;
+    // acquire与_M_leave的release配对：离开临界区前的读取先于之后的释放
+    _M_records._M_for_each([&](_EpochRecord const &__r) {
+      std::uint64_t const __s = __r._M_state.load(std::memory_order_acquire);
+      if ((__s & 1) && (__s >> 1) != __e) {
+        __blocked = true;
+      }
+    });
+    if (__blocked) {
+      return __e;
+    }
+    if (_M_epoch.compare_exchange_strong(__e, __e + 1,
+                                         std::memory_order_release,
+                                         std::memory_order_relaxed)) {
+      return __e + 1;
+    }
+    return __e;
+  }
+
+  // 释放本线程记录中标记纪元不晚于__epoch - 2的对象。标记按retire的顺序
+  // 单调不减，可以释放的总是开头的一段；先取出再调用删除器，删除器中可以再次retire
+  static void _S_collect(_EpochRecord *__r, std::uint64_t __epoch) {
+    auto &__list = __r->_M_retired;
+    auto __end = std::find_if(__list.begin(), __list.end(),
+                              [__epoch](_Retired const &__x) {
+                                return __x._M_epoch + 2 > __epoch;
+                              });
+    if (__end == __list.begin()) {
+      return;
+    }
+    std::vector<_Retired> __ready(__list.begin(), __end);
+    __list.erase(__list.begin(), __end);
+    for (_Retired const &__x : __ready) {
+      __x._M_run();
+    }
+  }
+
+public:
+  static constexpr std::size_t _S_default_batch = 64;
+
+  explicit epoch_domain(std::size_t __batch = _S_default_batch)
+      : _M_batch(__batch ? __batch : 1), _M_id(_S_reclaimRegister()) {}
+
+  epoch_domain(epoch_domain const &) = delete;
+
+  auto operator=(epoch_domain const &) -> epoch_domain & = delete;
+
+  // 析构时不能再有线程处于该域的临界区中，剩余对象全部释放
+  ~epoch_domain() { _S_reclaimUnregister(_M_id); }
+
+  // 对象必须已经从数据结构中摘下，之后新进入临界区的线程无法再访问到它
+  template <class _Tp, class _Deleter = DefaultDeleter<_Tp>>
+  void retire(_Tp *__ptr, _Deleter __deleter = _Deleter()) {
+    _EpochRecord *__r = _M_local();
+    _Retired __x = _S_makeRetired(__ptr, std::move(__deleter));
+    // 摘下对象先于读取纪元，与_M_enter、_M_try_advance中的屏障配对：否则标记
+    // 可能比仍能读到该对象的读端公布的纪元早一个，在它离开前就被释放
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    __x._M_epoch = _M_epoch.load(std::memory_order_relaxed);
+    __r->_M_retired.push_back(__x);
+    if (__r->_M_retired.size() >= __r->_M_collect_at) {
+      _S_collect(__r, _M_try_advance());
+      __r->_M_collect_at = __r->_M_retired.size() + _M_batch;
+    }
+  }
+
+  // 尝试推进两次纪元并释放本线程可以释放的对象，没有其他线程停在临界区中时
+  // 本线程retire的对象全部释放
+  void reclaim() {
+    _EpochRecord *__r = _M_local();
+    _M_try_advance();
+    _S_collect(__r, _M_try_advance());
+  }
+
+  auto epoch() const noexcept -> std::uint64_t {
+    return _M_epoch.load(std::memory_order_relaxed);
+  }
+
+  // 本线程尚未释放的对象数
+  auto pending() -> std::size_t { return _M_local()->_M_retired.size(); }
+};
+
+inline auto default_epoch_domain() -> epoch_domain & {
+  static epoch_domain __domain;
+  return __domain;
+}
+
+// 读端临界区，可以嵌套；临界区内读到的对象在离开前不会被释放
+struct epoch_guard {
+private:
+  epoch_domain *_M_domain;
+  _EpochRecord *_M_record;
+
+public:
+  explicit epoch_guard(epoch_domain &__domain = default_epoch_domain())
+      : _M_domain(&__domain), _M_record(__domain._M_local()) {
+    _M_domain->_M_enter(_M_record);
+  }
+
+  epoch_guard(epoch_guard const &) = delete;
+
+  auto operator=(epoch_guard const &) -> epoch_guard & = delete;
+
+  ~epoch_guard() { _M_domain->_M_leave(_M_record); }
+};
+
+} // namespace MySTL
+
+#endif
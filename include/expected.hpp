@@ -0,0 +1,1040 @@
+#ifndef EXPECTED_HPP
+#define EXPECTED_HPP
+
+#include "optional.hpp"
+#include <exception>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+namespace MySTL {
+
+// 保存一个错误值，用来构造处于错误状态的expected
+template <class _Err> struct unexpected {
+  static_assert(std::is_object_v<_Err> && !std::is_array_v<_Err> &&
+                    !std::is_const_v<_Err> && !std::is_volatile_v<_Err>,
+                "unexpected requires a non-cv object type");
+
+private:
+  _Err _M_error;
+
+public:
+  template <class _Up = _Err>
+    requires(!std::is_same_v<std::remove_cvref_t<_Up>, unexpected> &&
+             !std::is_same_v<std::remove_cvref_t<_Up>, in_place_t> &&
+             std::is_constructible_v<_Err, _Up>)
+  constexpr explicit unexpected(_Up &&__e) noexcept(
+      std::is_nothrow_constructible_v<_Err, _Up>)
+      : _M_error(std::forward<_Up>(__e)) {}
+
+  template <class... _Args>
+    requires std::is_constructible_v<_Err, _Args...>
+  constexpr explicit unexpected(in_place_t, _Args &&...__args)
+      : _M_error(std::forward<_Args>(__args)...) {}
+
+  constexpr auto error() const & noexcept -> _Err const & { return _M_error; }
+
+  constexpr auto error() & noexcept -> _Err & { return _M_error; }
+
+  constexpr auto error() const && noexcept -> _Err const && {
+    return std::move(_M_error);
+  }
+
+  constexpr auto error() && noexcept -> _Err && { return std::move(_M_error); }
+
+  template <class _Err2>
+  friend constexpr auto operator==(unexpected const &__x,
+                                   unexpected<_Err2> const &__y) -> bool {
+    return __x.error() == __y.error();
+  }
+};
+
+template <class _Err> unexpected(_Err) -> unexpected<_Err>;
+
+struct unexpect_t {
+  explicit unexpect_t() = default;
+};
+
+inline constexpr unexpect_t unexpect{};
+
+template <class _Err> struct bad_expected_access;
+
+template <> struct bad_expected_access<void> : std::exception {
+  auto what() const noexcept -> char const * override {
+    return "bad expected access";
+  }
+};
+
+template <class _Err> struct bad_expected_access : bad_expected_access<void> {
+private:
+  _Err _M_error;
+
+public:
+  explicit bad_expected_access(_Err __e) : _M_error(std::move(__e)) {}
+
+  auto error() const & noexcept -> _Err const & { return _M_error; }
+
+  auto error() & noexcept -> _Err & { return _M_error; }
+
+  auto error() && noexcept -> _Err && { return std::move(_M_error); }
+};
+
+template <class _Tp, class _Err> struct expected;
+
+template <class _Tp> struct _IsExpected : std::false_type {};
+
+template <class _Tp, class _Err>
+struct _IsExpected<expected<_Tp, _Err>> : std::true_type {};
+
+// 在__old的位置换成__new，构造可能抛异常时先保住旧值，保证不会两者都不存在
+template <class _New, class _Old, class... _Args>
+constexpr void _S_reinitExpected(_New &__new, _Old &__old, _Args &&...__args) {
+  if constexpr (std::is_nothrow_constructible_v<_New, _Args...>) {
+    std::destroy_at(std::addressof(__old));
+    std::construct_at(std::addressof(__new), std::forward<_Args>(__args)...);
+  } else if constexpr (std::is_nothrow_move_constructible_v<_New>) {
+    _New __tmp(std::forward<_Args>(__args)...);
+    std::destroy_at(std::addressof(__old));
+    std::construct_at(std::addressof(__new), std::move(__tmp));
+  } else {
+    _Old __tmp(std::move(__old));
+    std::destroy_at(std::addressof(__old));
+    try {
+      std::construct_at(std::addressof(__new), std::forward<_Args>(__args)...);
+    } catch (...) {
+      std::construct_at(std::addressof(__old), std::move(__tmp));
+      throw;
+    }
+  }
+}
+
+// 值或错误二者之一，与optional一样放在union里，没有额外的堆分配
+// 特殊成员函数按_Tp与_Err的平凡性分别约束：两者都可平凡拷贝时expected也可平凡拷贝，
+// 可以通过寄存器返回；失败路径只是返回一个值，不需要异常表与栈展开
+template <class _Tp, class _Err> struct expected {
+  static_assert(!std::is_reference_v<_Tp> && !std::is_function_v<_Tp> &&
+                    !std::is_same_v<std::remove_cv_t<_Tp>, in_place_t> &&
+                    !std::is_same_v<std::remove_cv_t<_Tp>, unexpect_t>,
+                "invalid expected value type");
+
+  using value_type = _Tp;
+  using error_type = _Err;
+  using unexpected_type = unexpected<_Err>;
+
+  template <class _Up> using rebind = expected<_Up, _Err>;
+
+private:
+  bool _M_has_value;
+  union {
+    _Tp _M_value;
+    _Err _M_error;
+  };
+
+  template <class, class> friend struct expected;
+
+  template <class _Self> using _ValueRef = decltype((std::declval<_Self>()._M_value));
+
+  template <class _Self> using _ErrorRef = decltype((std::declval<_Self>()._M_error));
+
+  static constexpr bool _S_trivial_copy =
+      std::is_trivially_copy_constructible_v<_Tp> &&
+      std::is_trivially_copy_constructible_v<_Err>;
+
+  static constexpr bool _S_trivial_move =
+      std::is_trivially_move_constructible_v<_Tp> &&
+      std::is_trivially_move_constructible_v<_Err>;
+
+  static constexpr bool _S_trivial_destroy =
+      std::is_trivially_destructible_v<_Tp> &&
+      std::is_trivially_destructible_v<_Err>;
+
+  static constexpr bool _S_trivial_copy_assign =
+      _S_trivial_copy && _S_trivial_destroy &&
+      std::is_trivially_copy_assignable_v<_Tp> &&
+      std::is_trivially_copy_assignable_v<_Err>;
+
+  static constexpr bool _S_trivial_move_assign =
+      _S_trivial_move && _S_trivial_destroy &&
+      std::is_trivially_move_assignable_v<_Tp> &&
+      std::is_trivially_move_assignable_v<_Err>;
+
+  // 状态切换时必须有一方的移动构造不抛异常，才能在失败时恢复原状
+  static constexpr bool _S_can_reinit =
+      std::is_nothrow_move_constructible_v<_Tp> ||
+      std::is_nothrow_move_constructible_v<_Err>;
+
+  template <class _That> constexpr void _M_construct_from(_That &&__that) {
+    if (__that._M_has_value) {
+      std::construct_at(std::addressof(_M_value),
+                        std::forward<_That>(__that)._M_value);
+    } else {
+      std::construct_at(std::addressof(_M_error),
+                        std::forward<_That>(__that)._M_error);
+    }
+  }
+
+  template <class _That> constexpr void _M_assign_from(_That &&__that) {
+    if (_M_has_value && __that._M_has_value) {
+      _M_value = std::forward<_That>(__that)._M_value;
+    } else if (_M_has_value) {
+      _S_reinitExpected(_M_error, _M_value,
+                        std::forward<_That>(__that)._M_error);
+    } else if (__that._M_has_value) {
+      _S_reinitExpected(_M_value, _M_error,
+                        std::forward<_That>(__that)._M_value);
+    } else {
+      _M_error = std::forward<_That>(__that)._M_error;
+    }
+    _M_has_value = __that._M_has_value;
+  }
+
+  template <class _Self, class _Fn>
+  static constexpr auto _S_and_then(_Self &&__self, _Fn &&__f) {
+    using _Res =
+        std::remove_cvref_t<std::invoke_result_t<_Fn, _ValueRef<_Self>>>;
+    static_assert(_IsExpected<_Res>::value &&
+                      std::is_same_v<typename _Res::error_type, _Err>,
+                  "and_then must return an expected with the same error_type");
+    if (__self._M_has_value) {
+      return std::invoke(std::forward<_Fn>(__f),
+                         std::forward<_Self>(__self)._M_value);
+    }
+    return _Res(unexpect, std::forward<_Self>(__self)._M_error);
+  }
+
+  template <class _Self, class _Fn>
+  static constexpr auto _S_transform(_Self &&__self, _Fn &&__f) {
+    using _Up = std::remove_cv_t<std::invoke_result_t<_Fn, _ValueRef<_Self>>>;
+    using _Res = expected<_Up, _Err>;
+    if (!__self._M_has_value) {
+      return _Res(unexpect, std::forward<_Self>(__self)._M_error);
+    }
+    if constexpr (std::is_void_v<_Up>) {
+      std::invoke(std::forward<_Fn>(__f), std::forward<_Self>(__self)._M_value);
+      return _Res();
+    } else {
+      return _Res(in_place, std::invoke(std::forward<_Fn>(__f),
+                                        std::forward<_Self>(__self)._M_value));
+    }
+  }
+
+  template <class _Self, class _Fn>
+  static constexpr auto _S_or_else(_Self &&__self, _Fn &&__f) {
+    using _Res =
+        std::remove_cvref_t<std::invoke_result_t<_Fn, _ErrorRef<_Self>>>;
+    static_assert(_IsExpected<_Res>::value &&
+                      std::is_same_v<typename _Res::value_type, _Tp>,
+                  "or_else must return an expected with the same value_type");
+    if (__self._M_has_value) {
+      return _Res(in_place, std::forward<_Self>(__self)._M_value);
+    }
+    return std::invoke(std::forward<_Fn>(__f),
+                       std::forward<_Self>(__self)._M_error);
+  }
+
+  template <class _Self, class _Fn>
+  static constexpr auto _S_transform_error(_Self &&__self, _Fn &&__f) {
+    using _Err2 =
+        std::remove_cv_t<std::invoke_result_t<_Fn, _ErrorRef<_Self>>>;
+    using _Res = expected<_Tp, _Err2>;
+    if (__self._M_has_value) {
+      return _Res(in_place, std::forward<_Self>(__self)._M_value);
+    }
+    return _Res(unexpect, std::invoke(std::forward<_Fn>(__f),
+                                      std::forward<_Self>(__self)._M_error));
+  }
+
+public:
+  constexpr expected() noexcept(std::is_nothrow_default_constructible_v<_Tp>)
+    requires std::is_default_constructible_v<_Tp>
+      : _M_has_value(true), _M_value() {}
+
+  constexpr expected(expected const &)
+    requires _S_trivial_copy
+  = default;
+
+  constexpr expected(expected const &__that) noexcept(
+      std::is_nothrow_copy_constructible_v<_Tp> &&
+      std::is_nothrow_copy_constructible_v<_Err>)
+    requires(std::is_copy_constructible_v<_Tp> &&
+             std::is_copy_constructible_v<_Err> && !_S_trivial_copy)
+      : _M_has_value(__that._M_has_value) {
+    _M_construct_from(__that);
+  }
+
+  constexpr expected(expected &&)
+    requires _S_trivial_move
+  = default;
+
+  constexpr expected(expected &&__that) noexcept(
+      std::is_nothrow_move_constructible_v<_Tp> &&
+      std::is_nothrow_move_constructible_v<_Err>)
+    requires(std::is_move_constructible_v<_Tp> &&
+             std::is_move_constructible_v<_Err> && !_S_trivial_move)
+      : _M_has_value(__that._M_has_value) {
+    _M_construct_from(std::move(__that));
+  }
+
+  template <class _Up = _Tp>
+    requires(!std::is_same_v<std::remove_cvref_t<_Up>, in_place_t> &&
+             !std::is_same_v<std::remove_cvref_t<_Up>, unexpect_t> &&
+             !std::is_same_v<std::remove_cvref_t<_Up>, expected> &&
+             !_IsExpected<std::remove_cvref_t<_Up>>::value &&
+             std::is_constructible_v<_Tp, _Up>)
+  constexpr explicit(!std::is_convertible_v<_Up, _Tp>)
+      expected(_Up &&__v) noexcept(std::is_nothrow_constructible_v<_Tp, _Up>)
+      : _M_has_value(true), _M_value(std::forward<_Up>(__v)) {}
+
+  template <class _Err2>
+    requires std::is_constructible_v<_Err, _Err2 const &>
+  constexpr explicit(!std::is_convertible_v<_Err2 const &, _Err>)
+      expected(unexpected<_Err2> const &__u)
+      : _M_has_value(false), _M_error(__u.error()) {}
+
+  template <class _Err2>
+    requires std::is_constructible_v<_Err, _Err2>
+  constexpr explicit(!std::is_convertible_v<_Err2, _Err>)
+      expected(unexpected<_Err2> &&__u)
+      : _M_has_value(false), _M_error(std::move(__u).error()) {}
+
+  template <class... _Args>
+    requires std::is_constructible_v<_Tp, _Args...>
+  constexpr explicit expected(in_place_t, _Args &&...__args)
+      : _M_has_value(true), _M_value(std::forward<_Args>(__args)...) {}
+
+  template <class _Up, class... _Args>
+    requires std::is_constructible_v<_Tp, std::initializer_list<_Up> &,
+                                     _Args...>
+  constexpr explicit expected(in_place_t, std::initializer_list<_Up> __il,
+                              _Args &&...__args)
+      : _M_has_value(true), _M_value(__il, std::forward<_Args>(__args)...) {}
+
+  template <class... _Args>
+    requires std::is_constructible_v<_Err, _Args...>
+  constexpr explicit expected(unexpect_t, _Args &&...__args)
+      : _M_has_value(false), _M_error(std::forward<_Args>(__args)...) {}
+
+  constexpr ~expected()
+    requires _S_trivial_destroy
+  = default;
+
+  constexpr ~expected() {
+    if (_M_has_value) {
+      std::destroy_at(std::addressof(_M_value));
+    } else {
+      std::destroy_at(std::addressof(_M_error));
+    }
+  }
+
+  constexpr auto operator=(expected const &) -> expected &
+    requires _S_trivial_copy_assign
+  = default;
+
+  constexpr auto operator=(expected const &__that) -> expected &
+    requires(std::is_copy_constructible_v<_Tp> &&
+             std::is_copy_assignable_v<_Tp> &&
+             std::is_copy_constructible_v<_Err> &&
+             std::is_copy_assignable_v<_Err> && _S_can_reinit &&
+             !_S_trivial_copy_assign)
+  {
+    _M_assign_from(__that);
+    return *this;
+  }
+
+  constexpr auto operator=(expected &&) -> expected &
+    requires _S_trivial_move_assign
+  = default;
+
+  constexpr auto operator=(expected &&__that) noexcept(
+      std::is_nothrow_move_constructible_v<_Tp> &&
+      std::is_nothrow_move_assignable_v<_Tp> &&
+      std::is_nothrow_move_constructible_v<_Err> &&
+      std::is_nothrow_move_assignable_v<_Err>) -> expected &
+    requires(std::is_move_constructible_v<_Tp> &&
+             std::is_move_assignable_v<_Tp> &&
+             std::is_move_constructible_v<_Err> &&
+             std::is_move_assignable_v<_Err> && _S_can_reinit &&
+             !_S_trivial_move_assign)
+  {
+    _M_assign_from(std::move(__that));
+    return *this;
+  }
+
+  template <class _Up = _Tp>
+    requires(!std::is_same_v<std::remove_cvref_t<_Up>, expected> &&
+             !_IsExpected<std::remove_cvref_t<_Up>>::value &&
+             std::is_constructible_v<_Tp, _Up> &&
+             std::is_assignable_v<_Tp &, _Up> && _S_can_reinit)
+  constexpr auto operator=(_Up &&__v) -> expected & {
+    if (_M_has_value) {
+      _M_value = std::forward<_Up>(__v);
+    } else {
+      _S_reinitExpected(_M_value, _M_error, std::forward<_Up>(__v));
+      _M_has_value = true;
+    }
+    return *this;
+  }
+
+  template <class _Err2>
+    requires(std::is_constructible_v<_Err, _Err2 const &> &&
+             std::is_assignable_v<_Err &, _Err2 const &> && _S_can_reinit)
+  constexpr auto operator=(unexpected<_Err2> const &__u) -> expected & {
+    if (_M_has_value) {
+      _S_reinitExpected(_M_error, _M_value, __u.error());
+      _M_has_value = false;
+    } else {
+      _M_error = __u.error();
+    }
+    return *this;
+  }
+
+  template <class _Err2>
+    requires(std::is_constructible_v<_Err, _Err2> &&
+             std::is_assignable_v<_Err &, _Err2> && _S_can_reinit)
+  constexpr auto operator=(unexpected<_Err2> &&__u) -> expected & {
+    if (_M_has_value) {
+      _S_reinitExpected(_M_error, _M_value, std::move(__u).error());
+      _M_has_value = false;
+    } else {
+      _M_error = std::move(__u).error();
+    }
+    return *this;
+  }
+
+  template <class... _Args>
+    requires std::is_nothrow_constructible_v<_Tp, _Args...>
+  constexpr auto emplace(_Args &&...__args) noexcept -> _Tp & {
+    if (_M_has_value) {
+      std::destroy_at(std::addressof(_M_value));
+    } else {
+      std::destroy_at(std::addressof(_M_error));
+      _M_has_value = true;
+    }
+    return *std::construct_at(std::addressof(_M_value),
+                              std::forward<_Args>(__args)...);
+  }
+
+  constexpr void swap(expected &__that) noexcept(
+      std::is_nothrow_move_constructible_v<_Tp> &&
+      std::is_nothrow_swappable_v<_Tp> &&
+      std::is_nothrow_move_constructible_v<_Err> &&
+      std::is_nothrow_swappable_v<_Err>)
+    requires(std::is_swappable_v<_Tp> && std::is_swappable_v<_Err> &&
+             std::is_move_constructible_v<_Tp> &&
+             std::is_move_constructible_v<_Err> && _S_can_reinit)
+  {
+    using std::swap;
+    if (_M_has_value && __that._M_has_value) {
+      swap(_M_value, __that._M_value);
+    } else if (!_M_has_value && !__that._M_has_value) {
+      swap(_M_error, __that._M_error);
+    } else if (!_M_has_value) {
+      __that.swap(*this);
+    } else {
+      // *this持有值，__that持有错误；先把移动不抛异常的一方挪到临时对象里，
+      // 另一方移动失败时把它放回原处
+      if constexpr (std::is_nothrow_move_constructible_v<_Err>) {
+        _Err __tmp(std::move(__that._M_error));
+        std::destroy_at(std::addressof(__that._M_error));
+        if constexpr (std::is_nothrow_move_constructible_v<_Tp>) {
+          std::construct_at(std::addressof(__that._M_value),
+                            std::move(_M_value));
+        } else {
+          try {
+            std::construct_at(std::addressof(__that._M_value),
+                              std::move(_M_value));
+          } catch (...) {
+            std::construct_at(std::addressof(__that._M_error),
+                              std::move(__tmp));
+            throw;
+          }
+        }
+        std::destroy_at(std::addressof(_M_value));
+        std::construct_at(std::addressof(_M_error), std::move(__tmp));
+      } else {
+        _Tp __tmp(std::move(_M_value));
+        std::destroy_at(std::addressof(_M_value));
+        try {
+          std::construct_at(std::addressof(_M_error),
+                            std::move(__that._M_error));
+        } catch (...) {
+          std::construct_at(std::addressof(_M_value), std::move(__tmp));
+          throw;
+        }
+        std::destroy_at(std::addressof(__that._M_error));
+        std::construct_at(std::addressof(__that._M_value), std::move(__tmp));
+      }
+      _M_has_value = false;
+      __that._M_has_value = true;
+    }
+  }
+
+  friend constexpr void swap(expected &__x, expected &__y) noexcept(
+      noexcept(__x.swap(__y)))
+    requires requires { __x.swap(__y); }
+  {
+    __x.swap(__y);
+  }
+
+  constexpr auto has_value() const noexcept -> bool { return _M_has_value; }
+
+  constexpr explicit operator bool() const noexcept { return _M_has_value; }
+
+  // 以下不检查状态，调用者需要先确认has_value()
+  constexpr auto operator->() const noexcept -> _Tp const * {
+    return std::addressof(_M_value);
+  }
+
+  constexpr auto operator->() noexcept -> _Tp * {
+    return std::addressof(_M_value);
+  }
+
+  constexpr auto operator*() const & noexcept -> _Tp const & {
+    return _M_value;
+  }
+
+  constexpr auto operator*() & noexcept -> _Tp & { return _M_value; }
+
+  constexpr auto operator*() const && noexcept -> _Tp const && {
+    return std::move(_M_value);
+  }
+
+  constexpr auto operator*() && noexcept -> _Tp && {
+    return std::move(_M_value);
+  }
+
+  constexpr auto error() const & noexcept -> _Err const & { return _M_error; }
+
+  constexpr auto error() & noexcept -> _Err & { return _M_error; }
+
+  constexpr auto error() const && noexcept -> _Err const && {
+    return std::move(_M_error);
+  }
+
+  constexpr auto error() && noexcept -> _Err && { return std::move(_M_error); }
+
+  // 处于错误状态时抛出bad_expected_access，热路径上应改用operator*或value_or
+  constexpr auto value() const & -> _Tp const & {
+    if (!_M_has_value) {
+      throw bad_expected_access<_Err>(std::as_const(_M_error));
+    }
+    return _M_value;
+  }
+
+  constexpr auto value() & -> _Tp & {
+    if (!_M_has_value) {
+      throw bad_expected_access<_Err>(std::as_const(_M_error));
+    }
+    return _M_value;
+  }
+
+  constexpr auto value() const && -> _Tp const && {
+    if (!_M_has_value) {
+      throw bad_expected_access<_Err>(std::move(_M_error));
+    }
+    return std::move(_M_value);
+  }
+
+  constexpr auto value() && -> _Tp && {
+    if (!_M_has_value) {
+      throw bad_expected_access<_Err>(std::move(_M_error));
+    }
+    return std::move(_M_value);
+  }
+
+  template <class _Up>
+  constexpr auto value_or(_Up &&__default) const & -> _Tp {
+    if (_M_has_value) {
+      return _M_value;
+    }
+    return static_cast<_Tp>(std::forward<_Up>(__default));
+  }
+
+  template <class _Up> constexpr auto value_or(_Up &&__default) && -> _Tp {
+    if (_M_has_value) {
+      return std::move(_M_value);
+    }
+    return static_cast<_Tp>(std::forward<_Up>(__default));
+  }
+
+  template <class _Up = _Err>
+  constexpr auto error_or(_Up &&__default) const & -> _Err {
+    if (_M_has_value) {
+      return std::forward<_Up>(__default);
+    }
+    return _M_error;
+  }
+
+  template <class _Up = _Err>
+  constexpr auto error_or(_Up &&__default) && -> _Err {
+    if (_M_has_value) {
+      return std::forward<_Up>(__default);
+    }
+    return std::move(_M_error);
+  }
+
+  // 有值时以值调用__f，__f返回错误类型相同的expected；否则原样传递错误
+  template <class _Fn> constexpr auto and_then(_Fn &&__f) & {
+    return _S_and_then(*this, std::forward<_Fn>(__f));
+  }
+
+  template <class _Fn> constexpr auto and_then(_Fn &&__f) const & {
+    return _S_and_then(*this, std::forward<_Fn>(__f));
+  }
+
+  template <class _Fn> constexpr auto and_then(_Fn &&__f) && {
+    return _S_and_then(std::move(*this), std::forward<_Fn>(__f));
+  }
+
+  template <class _Fn> constexpr auto and_then(_Fn &&__f) const && {
+    return _S_and_then(std::move(*this), std::forward<_Fn>(__f));
+  }
+
+  // 有值时把__f的结果作为新的值
+  template <class _Fn> constexpr auto transform(_Fn &&__f) & {
+    return _S_transform(*this, std::forward<_Fn>(__f));
+  }
+
+  template <class _Fn> constexpr auto transform(_Fn &&__f) const & {
+    return _S_transform(*this, std::forward<_Fn>(__f));
+  }
+
+  template <class _Fn> constexpr auto transform(_Fn &&__f) && {
+    return _S_transform(std::move(*this), std::forward<_Fn>(__f));
+  }
+
+  template <class _Fn> constexpr auto transform(_Fn &&__f) const && {
+    return _S_transform(std::move(*this), std::forward<_Fn>(__f));
+  }
+
+  // 出错时以错误调用__f，__f返回值类型相同的expected；否则原样传递值
+  template <class _Fn> constexpr auto or_else(_Fn &&__f) & {
+    return _S_or_else(*this, std::forward<_Fn>(__f));
+  }
+
+  template <class _Fn> constexpr auto or_else(_Fn &&__f) const & {
+    return _S_or_else(*this, std::forward<_Fn>(__f));
+  }
+
+  template <class _Fn> constexpr auto or_else(_Fn &&__f) && {
+    return _S_or_else(std::move(*this), std::forward<_Fn>(__f));
+  }
+
+  template <class _Fn> constexpr auto or_else(_Fn &&__f) const && {
+    return _S_or_else(std::move(*this), std::forward<_Fn>(__f));
+  }
+
+  // 出错时把__f的结果作为新的错误
+  template <class _Fn> constexpr auto transform_error(_Fn &&__f) & {
+    return _S_transform_error(*this, std::forward<_Fn>(__f));
+  }
+
+  template <class _Fn> constexpr auto transform_error(_Fn &&__f) const & {
+    return _S_transform_error(*this, std::forward<_Fn>(__f));
+  }
+
+  template <class _Fn> constexpr auto transform_error(_Fn &&__f) && {
+    return _S_transform_error(std::move(*this), std::forward<_Fn>(__f));
+  }
+
+  template <class _Fn> constexpr auto transform_error(_Fn &&__f) const && {
+    return _S_transform_error(std::move(*this), std::forward<_Fn>(__f));
+  }
+
+  template <class _Tp2, class _Err2>
+    requires(!std::is_void_v<_Tp2>)
+  friend constexpr auto operator==(expected const &__x,
+                                   expected<_Tp2, _Err2> const &__y) -> bool {
+    if (__x.has_value() != __y.has_value()) {
+      return false;
+    }
+    if (__x.has_value()) {
+      return *__x == *__y;
+    }
+    return __x.error() == __y.error();
+  }
+
+  template <class _Tp2>
+    requires(!_IsExpected<_Tp2>::value)
+  friend constexpr auto operator==(expected const &__x, _Tp2 const &__v)
+      -> bool {
+    return __x.has_value() && static_cast<bool>(*__x == __v);
+  }
+
+  template <class _Err2>
+  friend constexpr auto operator==(expected const &__x,
+                                   unexpected<_Err2> const &__e) -> bool {
+    return !__x.has_value() && static_cast<bool>(__x.error() == __e.error());
+  }
+};
+
+// 没有值只表示成功与否，union中只有错误
+template <class _Err> struct expected<void, _Err> {
+  using value_type = void;
+  using error_type = _Err;
+  using unexpected_type = unexpected<_Err>;
+
+  template <class _Up> using rebind = expected<_Up, _Err>;
+
+private:
+  bool _M_has_value;
+  union {
+    char _M_empty;
+    _Err _M_error;
+  };
+
+  template <class, class> friend struct expected;
+
+  template <class _Self> using _ErrorRef = decltype((std::declval<_Self>()._M_error));
+
+  template <class _Self, class _Fn>
+  static constexpr auto _S_and_then(_Self &&__self, _Fn &&__f) {
+    using _Res = std::remove_cvref_t<std::invoke_result_t<_Fn>>;
+    static_assert(_IsExpected<_Res>::value &&
+                      std::is_same_v<typename _Res::error_type, _Err>,
+                  "and_then must return an expected with the same error_type");
+    if (__self._M_has_value) {
+      return std::invoke(std::forward<_Fn>(__f));
+    }
+    return _Res(unexpect, std::forward<_Self>(__self)._M_error);
+  }
+
+  template <class _Self, class _Fn>
+  static constexpr auto _S_transform(_Self &&__self, _Fn &&__f) {
+    using _Up = std::remove_cv_t<std::invoke_result_t<_Fn>>;
+    using _Res = expected<_Up, _Err>;
+    if (!__self._M_has_value) {
+      return _Res(unexpect, std::forward<_Self>(__self)._M_error);
+    }
+    if constexpr (std::is_void_v<_Up>) {
+      std::invoke(std::forward<_Fn>(__f));
+      return _Res();
+    } else {
+      return _Res(in_place, std::invoke(std::forward<_Fn>(__f)));
+    }
+  }
+
+  template <class _Self, class _Fn>
+  static constexpr auto _S_or_else(_Self &&__self, _Fn &&__f) {
+    using _Res =
+        std::remove_cvref_t<std::invoke_result_t<_Fn, _ErrorRef<_Self>>>;
+    static_assert(_IsExpected<_Res>::value &&
+                      std::is_void_v<typename _Res::value_type>,
+                  "or_else must return an expected with the same value_type");
+    if (__self._M_has_value) {
+      return _Res();
+    }
+    return std::invoke(std::forward<_Fn>(__f),
+                       std::forward<_Self>(__self)._M_error);
+  }
+
+  template <class _Self, class _Fn>
+  static constexpr auto _S_transform_error(_Self &&__self, _Fn &&__f) {
+    using _Err2 =
+        std::remove_cv_t<std::invoke_result_t<_Fn, _ErrorRef<_Self>>>;
+    using _Res = expected<void, _Err2>;
+    if (__self._M_has_value) {
+      return _Res();
+    }
+    return _Res(unexpect, std::invoke(std::forward<_Fn>(__f),
+                                      std::forward<_Self>(__self)._M_error));
+  }
+
+public:
+  constexpr expected() noexcept : _M_has_value(true), _M_empty() {}
+
+  constexpr expected(expected const &)
+    requires std::is_trivially_copy_constructible_v<_Err>
+  = default;
+
+  constexpr expected(expected const &__that) noexcept(
+      std::is_nothrow_copy_constructible_v<_Err>)
+    requires(std::is_copy_constructible_v<_Err> &&
+             !std::is_trivially_copy_constructible_v<_Err>)
+      : _M_has_value(__that._M_has_value), _M_empty() {
+    if (!_M_has_value) {
+      std::construct_at(std::addressof(_M_error), __that._M_error);
+    }
+  }
+
+  constexpr expected(expected &&)
+    requires std::is_trivially_move_constructible_v<_Err>
+  = default;
+
+  constexpr expected(expected &&__that) noexcept(
+      std::is_nothrow_move_constructible_v<_Err>)
+    requires(std::is_move_constructible_v<_Err> &&
+             !std::is_trivially_move_constructible_v<_Err>)
+      : _M_has_value(__that._M_has_value), _M_empty() {
+    if (!_M_has_value) {
+      std::construct_at(std::addressof(_M_error), std::move(__that._M_error));
+    }
+  }
+
+  template <class _Err2>
+    requires std::is_constructible_v<_Err, _Err2 const &>
+  constexpr explicit(!std::is_convertible_v<_Err2 const &, _Err>)
+      expected(unexpected<_Err2> const &__u)
+      : _M_has_value(false), _M_error(__u.error()) {}
+
+  template <class _Err2>
+    requires std::is_constructible_v<_Err, _Err2>
+  constexpr explicit(!std::is_convertible_v<_Err2, _Err>)
+      expected(unexpected<_Err2> &&__u)
+      : _M_has_value(false), _M_error(std::move(__u).error()) {}
+
+  constexpr explicit expected(in_place_t) noexcept : expected() {}
+
+  template <class... _Args>
+    requires std::is_constructible_v<_Err, _Args...>
+  constexpr explicit expected(unexpect_t, _Args &&...__args)
+      : _M_has_value(false), _M_error(std::forward<_Args>(__args)...) {}
+
+  constexpr ~expected()
+    requires std::is_trivially_destructible_v<_Err>
+  = default;
+
+  constexpr ~expected() {
+    if (!_M_has_value) {
+      std::destroy_at(std::addressof(_M_error));
+    }
+  }
+
+  constexpr auto operator=(expected const &) -> expected &
+    requires(std::is_trivially_copy_constructible_v<_Err> &&
+             std::is_trivially_copy_assignable_v<_Err> &&
+             std::is_trivially_destructible_v<_Err>)
+  = default;
+
+  constexpr auto operator=(expected const &__that) -> expected &
+    requires(std::is_copy_constructible_v<_Err> &&
+             std::is_copy_assignable_v<_Err> &&
+             !(std::is_trivially_copy_constructible_v<_Err> &&
+               std::is_trivially_copy_assignable_v<_Err> &&
+               std::is_trivially_destructible_v<_Err>))
+  {
+    if (__that._M_has_value) {
+      emplace();
+    } else {
+      *this = unexpected<_Err>(__that._M_error);
+    }
+    return *this;
+  }
+
+  constexpr auto operator=(expected &&) -> expected &
+    requires(std::is_trivially_move_constructible_v<_Err> &&
+             std::is_trivially_move_assignable_v<_Err> &&
+             std::is_trivially_destructible_v<_Err>)
+  = default;
+
+  constexpr auto operator=(expected &&__that) noexcept(
+      std::is_nothrow_move_constructible_v<_Err> &&
+      std::is_nothrow_move_assignable_v<_Err>) -> expected &
+    requires(std::is_move_constructible_v<_Err> &&
+             std::is_move_assignable_v<_Err> &&
+             !(std::is_trivially_move_constructible_v<_Err> &&
+               std::is_trivially_move_assignable_v<_Err> &&
+               std::is_trivially_destructible_v<_Err>))
+  {
+    if (__that._M_has_value) {
+      emplace();
+    } else if (_M_has_value) {
+      std::construct_at(std::addressof(_M_error), std::move(__that._M_error));
+      _M_has_value = false;
+    } else {
+      _M_error = std::move(__that._M_error);
+    }
+    return *this;
+  }
+
+  template <class _Err2>
+    requires(std::is_constructible_v<_Err, _Err2 const &> &&
+             std::is_assignable_v<_Err &, _Err2 const &>)
+  constexpr auto operator=(unexpected<_Err2> const &__u) -> expected & {
+    if (_M_has_value) {
+      std::construct_at(std::addressof(_M_error), __u.error());
+      _M_has_value = false;
+    } else {
+      _M_error = __u.error();
+    }
+    return *this;
+  }
+
+  template <class _Err2>
+    requires(std::is_constructible_v<_Err, _Err2> &&
+             std::is_assignable_v<_Err &, _Err2>)
+  constexpr auto operator=(unexpected<_Err2> &&__u) -> expected & {
+    if (_M_has_value) {
+      std::construct_at(std::addressof(_M_error), std::move(__u).error());
+      _M_has_value = false;
+    } else {
+      _M_error = std::move(__u).error();
+    }
+    return *this;
+  }
+
+  constexpr void emplace() noexcept {
+    if (!_M_has_value) {
+      std::destroy_at(std::addressof(_M_error));
+      _M_has_value = true;
+    }
+  }
+
+  constexpr void swap(expected &__that) noexcept(
+      std::is_nothrow_move_constructible_v<_Err> &&
+      std::is_nothrow_swappable_v<_Err>)
+    requires(std::is_swappable_v<_Err> && std::is_move_constructible_v<_Err>)
+  {
+    using std::swap;
+    if (_M_has_value && __that._M_has_value) {
+      return;
+    }
+    if (!_M_has_value && !__that._M_has_value) {
+      swap(_M_error, __that._M_error);
+    } else if (_M_has_value) {
+      std::construct_at(std::addressof(_M_error), std::move(__that._M_error));
+      std::destroy_at(std::addressof(__that._M_error));
+      _M_has_value = false;
+      __that._M_has_value = true;
+    } else {
+      __that.swap(*this);
+    }
+  }
+
+  friend constexpr void swap(expected &__x, expected &__y) noexcept(
+      noexcept(__x.swap(__y)))
+    requires requires { __x.swap(__y); }
+  {
+    __x.swap(__y);
+  }
+
+  constexpr auto has_value() const noexcept -> bool { return _M_has_value; }
+
+  constexpr explicit operator bool() const noexcept { return _M_has_value; }
+
+  constexpr void operator*() const noexcept {}
+
+  constexpr void value() const & {
+    if (!_M_has_value) {
+      throw bad_expected_access<_Err>(_M_error);
+    }
+  }
+
+  constexpr void value() && {
+    if (!_M_has_value) {
+      throw bad_expected_access<_Err>(std::move(_M_error));
+    }
+  }
+
+  constexpr auto error() const & noexcept -> _Err const & { return _M_error; }
+
+  constexpr auto error() & noexcept -> _Err & { return _M_error; }
+
+  constexpr auto error() const && noexcept -> _Err const && {
+    return std::move(_M_error);
+  }
+
+  constexpr auto error() && noexcept -> _Err && { return std::move(_M_error); }
+
+  template <class _Up = _Err>
+  constexpr auto error_or(_Up &&__default) const & -> _Err {
+    if (_M_has_value) {
+      return std::forward<_Up>(__default);
+    }
+    return _M_error;
+  }
+
+  template <class _Up = _Err>
+  constexpr auto error_or(_Up &&__default) && -> _Err {
+    if (_M_has_value) {
+      return std::forward<_Up>(__default);
+    }
+    return std::move(_M_error);
+  }
+
+  template <class _Fn> constexpr auto and_then(_Fn &&__f) & {
+    return _S_and_then(*this, std::forward<_Fn>(__f));
+  }
+
+  template <class _Fn> constexpr auto and_then(_Fn &&__f) const & {
+    return _S_and_then(*this, std::forward<_Fn>(__f));
+  }
+
+  template <class _Fn> constexpr auto and_then(_Fn &&__f) && {
+    return _S_and_then(std::move(*this), std::forward<_Fn>(__f));
+  }
+
+  template <class _Fn> constexpr auto and_then(_Fn &&__f) const && {
+    return _S_and_then(std::move(*this), std::forward<_Fn>(__f));
+  }
+
+  template <class _Fn> constexpr auto transform(_Fn &&__f) & {
+    return _S_transform(*this, std::forward<_Fn>(__f));
+  }
+
+  template <class _Fn> constexpr auto transform(_Fn &&__f) const & {
+    return _S_transform(*this, std::forward<_Fn>(__f));
+  }
+
+  template <class _Fn> constexpr auto transform(_Fn &&__f) && {
+    return _S_transform(std::move(*this), std::forward<_Fn>(__f));
+  }
+
+  template <class _Fn> constexpr auto transform(_Fn &&__f) const && {
+    return _S_transform(std::move(*this), std::forward<_Fn>(__f));
+  }
+
+  template <class _Fn> constexpr auto or_else(_Fn &&__f) & {
+    return _S_or_else(*this, std::forward<_Fn>(__f));
+  }
+
+  template <class _Fn> constexpr auto or_else(_Fn &&__f) const & {
+    return _S_or_else(*this, std::forward<_Fn>(__f));
+  }
+
+  template <class _Fn> constexpr auto or_else(_Fn &&__f) && {
+    return _S_or_else(std::move(*this), std::forward<_Fn>(__f));
+  }
+
+  template <class _Fn> constexpr auto or_else(_Fn &&__f) const && {
+    return _S_or_else(std::move(*this), std::forward<_Fn>(__f));
+  }
+
+  template <class _Fn> constexpr auto transform_error(_Fn &&__f) & {
+    return _S_transform_error(*this, std::forward<_Fn>(__f));
+  }
+
+  template <class _Fn> constexpr auto transform_error(_Fn &&__f) const & {
+    return _S_transform_error(*this, std::forward<_Fn>(__f));
+  }
+
+  template <class _Fn> constexpr auto transform_error(_Fn &&__f) && {
+    return _S_transform_error(std::move(*this), std::forward<_Fn>(__f));
+  }
+
+  template <class _Fn> constexpr auto transform_error(_Fn &&__f) const && {
+    return _S_transform_error(std::move(*this), std::forward<_Fn>(__f));
+  }
+
+  template <class _Tp2, class _Err2>
+    requires std::is_void_v<_Tp2>
+  friend constexpr auto operator==(expected const &__x,
+                                   expected<_Tp2, _Err2> const &__y) -> bool {
+    if (__x.has_value() != __y.has_value()) {
+      return false;
+    }
+    return __x.has_value() || static_cast<bool>(__x.error() == __y.error());
+  }
+
+  template <class _Err2>
+  friend constexpr auto operator==(expected const &__x,
+                                   unexpected<_Err2> const &__e) -> bool {
+    return !__x.has_value() && static_cast<bool>(__x.error() == __e.error());
+  }
+};
+
+} // namespace MySTL
+
+#endif
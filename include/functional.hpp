@@ -2,5 +2,7 @@
 #ifndef FUNCTIONAL_HPP
 #define FUNCTIONAL_HPP
 #include "_function.hpp"
+#include "_function_ref.hpp"
+#include "_inplace_function.hpp"
 #include "_move_only_function.hpp"
 #endif
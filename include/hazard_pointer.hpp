@@ -0,0 +1,175 @@
+#ifndef HAZARD_POINTER_HPP
+#define HAZARD_POINTER_HPP
+
+#include "_reclaim_base.hpp"
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <stdexcept>
+#include <vector>
+
+namespace MySTL {
+
+// 危险指针：读端把要访问的对象地址写进本线程的槽位，再确认对象仍然可达；
+// 回收端释放前扫描所有槽位，跳过仍被保护的对象
+// 每个线程的待回收对象不超过max(batch, 2 * 槽位总数)再加一批，
+// 停住的读者最多拖住它保护的那几个对象
+struct _HazardRecord : _ReclaimRecord {
+  static constexpr unsigned _S_slots = 8;
+
+  alignas(64) std::atomic<void const *> _M_slots[_S_slots] = {};
+  unsigned _M_used = 0; // 本线程已占用的槽位，只由所属线程访问
+};
+
+struct hazard_domain {
+private:
+  _ReclaimRecords<_HazardRecord> _M_records;
+  std::size_t _M_batch;
+  std::uint64_t _M_id;
+
+  friend struct hazard_pointer;
+
+  auto _M_local() -> _HazardRecord * {
+    return _S_reclaimLocal(_M_id, _M_records);
+  }
+
+  // 收集所有槽位中的地址，释放本线程记录中不在其中的对象
+  void _M_scan(_HazardRecord *__r) {
+    // 摘下对象与读取槽位之间的屏障，与protect中的屏障配对
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    std::vector<void const *> __hazards;
+    __hazards.reserve(_M_records._M_count.load(std::memory_order_relaxed) *
+                      _HazardRecord::_S_slots);
+    _M_records._M_for_each([&](_HazardRecord const &__h) {
+      for (auto const &__slot : __h._M_slots) {
+        // acquire与reset_protection的release配对：保护期间的读取先于释放
+        if (void const *__p = __slot.load(std::memory_order_acquire)) {
+          __hazards.push_back(__p);
+        }
+      }
+    });
+    std::sort(__hazards.begin(), __hazards.end());
+    auto &__list = __r->_M_retired;
+    std::vector<_Retired> __ready;
+    __ready.reserve(__list.size());
+    std::size_t __kept = 0;
+    for (std::size_t __i = 0; __i < __list.size(); ++__i) {
+      if (std::binary_search(__hazards.begin(), __hazards.end(),
+                             __list[__i]._M_ptr)) {
+        __list[__kept++] = __list[__i];
+      } else {
+        __ready.push_back(__list[__i]);
+      }
+    }
+    __list.resize(__kept);
+    for (_Retired const &__x : __ready) {
+      __x._M_run();
+    }
+  }
+
+  auto _M_threshold() const noexcept -> std::size_t {
+    std::size_t const __h =
+        _M_records._M_count.load(std::memory_order_relaxed) *
+        _HazardRecord::_S_slots;
+    return std::max(_M_batch, 2 * __h);
+  }
+
+public:
+  static constexpr std::size_t _S_default_batch = 64;
+
+  explicit hazard_domain(std::size_t __batch = _S_default_batch)
+      : _M_batch(__batch ? __batch : 1), _M_id(_S_reclaimRegister()) {}
+
+  hazard_domain(hazard_domain const &) = delete;
+
+  auto operator=(hazard_domain const &) -> hazard_domain & = delete;
+
+  // 析构时不能再有线程持有该域的hazard_pointer，剩余对象全部释放
+  ~hazard_domain() { _S_reclaimUnregister(_M_id); }
+
+  // 对象必须已经从数据结构中摘下，之后的protect无法再读到它
+  template <class _Tp, class _Deleter = DefaultDeleter<_Tp>>
+  void retire(_Tp *__ptr, _Deleter __deleter = _Deleter()) {
+    _HazardRecord *__r = _M_local();
+    __r->_M_retired.push_back(_S_makeRetired(__ptr, std::move(__deleter)));
+    if (__r->_M_retired.size() >= __r->_M_collect_at) {
+      _M_scan(__r);
+      __r->_M_collect_at = __r->_M_retired.size() + _M_threshold();
+    }
+  }
+
+  // 立即扫描一次，释放本线程retire且不再受保护的对象
+  void reclaim() { _M_scan(_M_local()); }
+
+  // 本线程尚未释放的对象数
+  auto pending() -> std::size_t { return _M_local()->_M_retired.size(); }
+};
+
+inline auto default_hazard_domain() -> hazard_domain & {
+  static hazard_domain __domain;
+  return __domain;
+}
+
+// 占用本线程的一个槽位，每个线程同时最多持有_HazardRecord::_S_slots个
+struct hazard_pointer {
+private:
+  _HazardRecord *_M_record;
+  std::atomic<void const *> *_M_slot;
+  unsigned _M_index;
+
+public:
+  explicit hazard_pointer(hazard_domain &__domain = default_hazard_domain())
+      : _M_record(__domain._M_local()) {
+    if (_M_record->_M_used == (1u << _HazardRecord::_S_slots) - 1) {
+      throw std::length_error("too many hazard_pointers in one thread");
+    }
+    _M_index = static_cast<unsigned>(std::countr_one(_M_record->_M_used));
+    _M_record->_M_used |= 1u << _M_index;
+    _M_slot = &_M_record->_M_slots[_M_index];
+  }
+
+  hazard_pointer(hazard_pointer const &) = delete;
+
+  auto operator=(hazard_pointer const &) -> hazard_pointer & = delete;
+
+  ~hazard_pointer() {
+    reset_protection();
+    _M_record->_M_used &= ~(1u << _M_index);
+  }
+
+  // 保护__src当前指向的对象并返回它，返回后直到下一次保护或reset_protection
+  // 之前对象都不会被释放
+  template <class _Tp>
+  auto protect(std::atomic<_Tp *> const &__src) noexcept -> _Tp * {
+    _Tp *__p = __src.load(std::memory_order_relaxed);
+    while (!try_protect(__p, __src)) {
+    }
+    return __p;
+  }
+
+  // 保护__ptr，如果__src已经不再指向它则把最新值写回__ptr并返回false
+  template <class _Tp>
+  auto try_protect(_Tp *&__ptr, std::atomic<_Tp *> const &__src) noexcept
+      -> bool {
+    _Tp *const __expected = __ptr;
+    // release使之前对旧对象的读取先于回收端看到新的槽位值
+    _M_slot->store(__expected, std::memory_order_release);
+    // 写入槽位必须先于重新读取__src，与_M_scan中的屏障配对
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    __ptr = __src.load(std::memory_order_acquire);
+    if (__ptr == __expected) {
+      return true;
+    }
+    _M_slot->store(nullptr, std::memory_order_release);
+    return false;
+  }
+
+  void reset_protection() noexcept {
+    _M_slot->store(nullptr, std::memory_order_release);
+  }
+};
+
+} // namespace MySTL
+
+#endif
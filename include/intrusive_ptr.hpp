@@ -0,0 +1,233 @@
+#ifndef INTRUSIVE_PTR_HPP
+#define INTRUSIVE_PTR_HPP
+
+#include "default_deleter.hpp"
+#include "unique_ptr.hpp"
+#include <atomic>
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+namespace MySTL {
+
+// 计数直接放在对象里的智能指针：只有一个指针宽，访问计数不需要额外的间接跳转
+// 计数通过ADL查找的intrusive_ptr_add_ref/intrusive_ptr_release增减，
+// 可以自行实现，也可以继承intrusive_ref_counter
+
+// 多线程共享时使用，递减与shared_ptr相同：release递减，最后一个引用再acquire
+struct thread_safe_counter {
+  using type = std::atomic<unsigned>;
+
+  static auto load(type const &__c) noexcept -> unsigned {
+    return __c.load(std::memory_order_relaxed);
+  }
+
+  static void increment(type &__c) noexcept {
+    __c.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  // 返回递减后是否归零
+  static auto decrement(type &__c) noexcept -> bool {
+    // 唯一持有者时其他线程无法再增加计数，可以跳过原子读改写
+    if (__c.load(std::memory_order_acquire) == 1) {
+      return true;
+    }
+    if (__c.fetch_sub(1, std::memory_order_release) == 1) {
+#if defined(__SANITIZE_THREAD__)
+      (void)__c.load(std::memory_order_acquire);
+#else
+      std::atomic_thread_fence(std::memory_order_acquire);
+#endif
+      return true;
+    }
+    return false;
+  }
+};
+
+// 只在一个线程内使用，计数是普通整数运算
+struct thread_unsafe_counter {
+  using type = unsigned;
+
+  static auto load(type const &__c) noexcept -> unsigned { return __c; }
+
+  static void increment(type &__c) noexcept { ++__c; }
+
+  static auto decrement(type &__c) noexcept -> bool { return --__c == 0; }
+};
+
+// 新对象的计数为0，第一个intrusive_ptr接管时变为1
+// 拷贝对象不拷贝计数
+template <class _Derived, class _Policy = thread_safe_counter>
+struct intrusive_ref_counter {
+private:
+  mutable typename _Policy::type _M_refs;
+
+public:
+  intrusive_ref_counter() noexcept : _M_refs(0) {}
+
+  intrusive_ref_counter(intrusive_ref_counter const &) noexcept
+      : _M_refs(0) {}
+
+  auto operator=(intrusive_ref_counter const &) noexcept
+      -> intrusive_ref_counter & {
+    return *this;
+  }
+
+  auto use_count() const noexcept -> unsigned { return _Policy::load(_M_refs); }
+
+  friend void intrusive_ptr_add_ref(intrusive_ref_counter const *__p) noexcept {
+    _Policy::increment(__p->_M_refs);
+  }
+
+  friend void intrusive_ptr_release(intrusive_ref_counter const *__p) noexcept {
+    if (_Policy::decrement(__p->_M_refs)) {
+      delete static_cast<_Derived const *>(__p);
+    }
+  }
+
+protected:
+  ~intrusive_ref_counter() = default;
+};
+
+template <class _Tp> struct intrusive_ptr {
+private:
+  _Tp *_M_ptr;
+
+  template <class> friend struct intrusive_ptr;
+
+public:
+  using element_type = _Tp;
+  using element_pointer = _Tp *;
+
+  intrusive_ptr(std::nullptr_t = nullptr) noexcept : _M_ptr(nullptr) {}
+
+  // __add_ref为false时接管一个已经计入的引用，如detach()的返回值
+  intrusive_ptr(_Tp *__ptr, bool __add_ref = true) noexcept : _M_ptr(__ptr) {
+    if (_M_ptr && __add_ref) {
+      intrusive_ptr_add_ref(_M_ptr);
+    }
+  }
+
+  // 从unique_ptr接管对象，最后一个引用释放时用delete析构，因此只接受默认删除器
+  template <class _Yp>
+    requires(std::is_convertible_v<_Yp *, _Tp *>)
+  explicit intrusive_ptr(unique_ptr<_Yp, DefaultDeleter<_Yp>> &&__ptr) noexcept
+      : intrusive_ptr(__ptr.release()) {}
+
+  intrusive_ptr(intrusive_ptr const &__that) noexcept
+      : intrusive_ptr(__that._M_ptr) {}
+
+  template <class _Yp>
+    requires(std::is_convertible_v<_Yp *, _Tp *>)
+  intrusive_ptr(intrusive_ptr<_Yp> const &__that) noexcept
+      : intrusive_ptr(static_cast<_Tp *>(__that._M_ptr)) {}
+
+  intrusive_ptr(intrusive_ptr &&__that) noexcept
+      : _M_ptr(std::exchange(__that._M_ptr, nullptr)) {}
+
+  template <class _Yp>
+    requires(std::is_convertible_v<_Yp *, _Tp *>)
+  intrusive_ptr(intrusive_ptr<_Yp> &&__that) noexcept
+      : _M_ptr(std::exchange(__that._M_ptr, nullptr)) {}
+
+  auto operator=(intrusive_ptr const &__that) noexcept -> intrusive_ptr & {
+    intrusive_ptr(__that).swap(*this);
+    return *this;
+  }
+
+  auto operator=(intrusive_ptr &&__that) noexcept -> intrusive_ptr & {
+    intrusive_ptr(std::move(__that)).swap(*this);
+    return *this;
+  }
+
+  template <class _Yp>
+    requires(std::is_convertible_v<_Yp *, _Tp *>)
+  auto operator=(intrusive_ptr<_Yp> const &__that) noexcept
+      -> intrusive_ptr & {
+    intrusive_ptr(__that).swap(*this);
+    return *this;
+  }
+
+  template <class _Yp>
+    requires(std::is_convertible_v<_Yp *, _Tp *>)
+  auto operator=(intrusive_ptr<_Yp> &&__that) noexcept -> intrusive_ptr & {
+    intrusive_ptr(std::move(__that)).swap(*this);
+    return *this;
+  }
+
+  auto operator=(_Tp *__ptr) noexcept -> intrusive_ptr & {
+    intrusive_ptr(__ptr).swap(*this);
+    return *this;
+  }
+
+  ~intrusive_ptr() noexcept {
+    if (_M_ptr) {
+      intrusive_ptr_release(_M_ptr);
+    }
+  }
+
+  void reset() noexcept { intrusive_ptr().swap(*this); }
+
+  void reset(_Tp *__ptr, bool __add_ref = true) noexcept {
+    intrusive_ptr(__ptr, __add_ref).swap(*this);
+  }
+
+  // 放弃所有权但不减少计数，返回的指针需要由调用者以__add_ref=false重新接管
+  auto detach() noexcept -> _Tp * { return std::exchange(_M_ptr, nullptr); }
+
+  void swap(intrusive_ptr &__that) noexcept {
+    std::swap(_M_ptr, __that._M_ptr);
+  }
+
+  auto get() const noexcept -> _Tp * { return _M_ptr; }
+
+  auto operator->() const noexcept -> _Tp * { return _M_ptr; }
+
+  auto operator*() const noexcept -> _Tp & { return *_M_ptr; }
+
+  explicit operator bool() const noexcept { return _M_ptr != nullptr; }
+
+  template <class _Yp>
+  auto operator==(intrusive_ptr<_Yp> const &__that) const noexcept -> bool {
+    return _M_ptr == __that._M_ptr;
+  }
+
+  template <class _Yp>
+  auto operator!=(intrusive_ptr<_Yp> const &__that) const noexcept -> bool {
+    return _M_ptr != __that._M_ptr;
+  }
+
+  template <class _Yp>
+  auto operator<(intrusive_ptr<_Yp> const &__that) const noexcept -> bool {
+    return _M_ptr < __that._M_ptr;
+  }
+
+  auto operator==(std::nullptr_t) const noexcept -> bool {
+    return _M_ptr == nullptr;
+  }
+
+  auto operator!=(std::nullptr_t) const noexcept -> bool {
+    return _M_ptr != nullptr;
+  }
+};
+
+template <class _Tp, class... _Args>
+auto make_intrusive(_Args &&...__args) -> intrusive_ptr<_Tp> {
+  return intrusive_ptr<_Tp>(new _Tp(std::forward<_Args>(__args)...));
+}
+
+template <class _Tp, class _Up>
+auto static_pointer_cast(intrusive_ptr<_Up> const &__ptr) noexcept
+    -> intrusive_ptr<_Tp> {
+  return intrusive_ptr<_Tp>(static_cast<_Tp *>(__ptr.get()));
+}
+
+template <class _Tp, class _Up>
+auto dynamic_pointer_cast(intrusive_ptr<_Up> const &__ptr) noexcept
+    -> intrusive_ptr<_Tp> {
+  return intrusive_ptr<_Tp>(dynamic_cast<_Tp *>(__ptr.get()));
+}
+
+} // namespace MySTL
+
+#endif
@@ -0,0 +1,211 @@
+#ifndef LOCAL_SHARED_PTR_HPP
+#define LOCAL_SHARED_PTR_HPP
+#include "default_deleter.hpp"
+#include "shared_ptr.hpp"
+#include "unique_ptr.hpp"
+#include <cstddef>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+namespace MySTL {
+
+// 只在创建它的线程里使用的shared_ptr：计数是普通整数运算，没有lock前缀指令
+// 控制块与shared_ptr完全相同，独占时可以零开销地转换为shared_ptr交给其他线程
+// 不支持weak_ptr，也不会设置enable_shared_from_this（转换为shared_ptr时才设置）
+template <class _Tp> struct local_shared_ptr {
+private:
+  _Tp *_M_ptr;
+  _SpCounter *_M_owner;
+
+  template <class> friend struct local_shared_ptr;
+
+  explicit local_shared_ptr(_Tp *__ptr, _SpCounter *__owner) noexcept
+      : _M_ptr(__ptr), _M_owner(__owner) {}
+
+public:
+  using element_type = _Tp;
+  using element_pointer = _Tp *;
+
+  local_shared_ptr(std::nullptr_t = nullptr) noexcept
+      : _M_ptr(nullptr), _M_owner(nullptr) {}
+
+  template <class _Yp>
+    requires(std::is_convertible_v<_Yp *, _Tp *>)
+  explicit local_shared_ptr(_Yp *__ptr)
+      : _M_ptr(__ptr),
+        _M_owner(new _SpCounterImpl<_Yp, DefaultDeleter<_Yp>>(__ptr)) {}
+
+  // 单线程计数没有弱引用，不支持接管控制块的删除器
+  template <class _Yp, class _Deleter>
+    requires(std::is_convertible_v<_Yp *, _Tp *> &&
+             !_SpCounterDisposer<_Deleter, _SpCounterImpl<_Yp, _Deleter>>)
+  explicit local_shared_ptr(_Yp *__ptr, _Deleter __deleter)
+      : _M_ptr(__ptr), _M_owner(new _SpCounterImpl<_Yp, _Deleter>(
+                           __ptr, std::move(__deleter))) {}
+
+  template <class _Yp, class _Deleter>
+    requires(std::is_convertible_v<_Yp *, _Tp *>)
+  explicit local_shared_ptr(unique_ptr<_Yp, _Deleter> &&__ptr)
+      : local_shared_ptr(__ptr.release(), __ptr.get_deleter()) {}
+
+  template <class _Yp>
+  inline friend local_shared_ptr<_Yp>
+  _S_makeLocalSharedFused(_Yp *__ptr, _SpCounter *__owner) noexcept;
+
+  local_shared_ptr(local_shared_ptr const &__that) noexcept
+      : _M_ptr(__that._M_ptr), _M_owner(__that._M_owner) {
+    if (_M_owner) {
+      _M_owner->_M_local_incref();
+    }
+  }
+
+  template <class _Yp>
+    requires(std::is_convertible_v<_Yp *, _Tp *>)
+  local_shared_ptr(local_shared_ptr<_Yp> const &__that) noexcept
+      : _M_ptr(__that._M_ptr), _M_owner(__that._M_owner) {
+    if (_M_owner) {
+      _M_owner->_M_local_incref();
+    }
+  }
+
+  local_shared_ptr(local_shared_ptr &&__that) noexcept
+      : _M_ptr(__that._M_ptr), _M_owner(__that._M_owner) {
+    __that._M_ptr = nullptr;
+    __that._M_owner = nullptr;
+  }
+
+  template <class _Yp>
+    requires(std::is_convertible_v<_Yp *, _Tp *>)
+  local_shared_ptr(local_shared_ptr<_Yp> &&__that) noexcept
+      : _M_ptr(__that._M_ptr), _M_owner(__that._M_owner) {
+    __that._M_ptr = nullptr;
+    __that._M_owner = nullptr;
+  }
+
+  auto operator=(local_shared_ptr const &__that) noexcept
+      -> local_shared_ptr & {
+    local_shared_ptr(__that).swap(*this);
+    return *this;
+  }
+
+  auto operator=(local_shared_ptr &&__that) noexcept -> local_shared_ptr & {
+    local_shared_ptr(std::move(__that)).swap(*this);
+    return *this;
+  }
+
+  template <class _Yp>
+    requires(std::is_convertible_v<_Yp *, _Tp *>)
+  auto operator=(local_shared_ptr<_Yp> const &__that) noexcept
+      -> local_shared_ptr & {
+    local_shared_ptr(__that).swap(*this);
+    return *this;
+  }
+
+  template <class _Yp>
+    requires(std::is_convertible_v<_Yp *, _Tp *>)
+  auto operator=(local_shared_ptr<_Yp> &&__that) noexcept
+      -> local_shared_ptr & {
+    local_shared_ptr(std::move(__that)).swap(*this);
+    return *this;
+  }
+
+  ~local_shared_ptr() noexcept {
+    if (_M_owner) {
+      _M_owner->_M_local_decref();
+    }
+  }
+
+  void reset() noexcept { local_shared_ptr().swap(*this); }
+
+  template <class _Yp> void reset(_Yp *__ptr) {
+    local_shared_ptr(__ptr).swap(*this);
+  }
+
+  template <class _Yp, class _Deleter>
+  void reset(_Yp *__ptr, _Deleter __deleter) {
+    local_shared_ptr(__ptr, std::move(__deleter)).swap(*this);
+  }
+
+  // 转换为原子计数的shared_ptr，用于少见的跨线程传递
+  // 只有独占时才安全，否则本线程剩下的持有者会与其他线程产生数据竞争
+  explicit operator shared_ptr<_Tp>() && {
+    if (!_M_owner) {
+      return nullptr;
+    }
+    if (!unique()) {
+      throw std::logic_error("local_shared_ptr is not unique");
+    }
+    _Tp *__ptr = std::exchange(_M_ptr, nullptr);
+    _SpCounter *__owner = std::exchange(_M_owner, nullptr);
+    _S_setupEnableSharedFromThis(__ptr, __owner);
+    return _S_makeSharedFused(__ptr, __owner);
+  }
+
+  auto use_count() const noexcept -> long {
+    return _M_owner ? static_cast<long>(_M_owner->_M_counts &
+                                        _SpCounter::_S_strong_mask)
+                    : 0;
+  }
+
+  auto unique() const noexcept -> bool { return use_count() == 1; }
+
+  template <class _Yp>
+  auto operator==(local_shared_ptr<_Yp> const &__that) const noexcept
+      -> bool {
+    return _M_ptr == __that._M_ptr;
+  }
+
+  template <class _Yp>
+  auto operator!=(local_shared_ptr<_Yp> const &__that) const noexcept
+      -> bool {
+    return _M_ptr != __that._M_ptr;
+  }
+
+  template <class _Yp>
+  auto owner_before(local_shared_ptr<_Yp> const &__that) const noexcept
+      -> bool {
+    return _M_owner < __that._M_owner;
+  }
+
+  void swap(local_shared_ptr &__that) noexcept {
+    std::swap(_M_ptr, __that._M_ptr);
+    std::swap(_M_owner, __that._M_owner);
+  }
+
+  auto get() const noexcept -> _Tp * { return _M_ptr; }
+
+  auto operator->() const noexcept -> _Tp * { return _M_ptr; }
+
+  auto operator*() const noexcept -> std::add_lvalue_reference_t<_Tp> {
+    return *_M_ptr;
+  }
+
+  explicit operator bool() const noexcept { return _M_ptr != nullptr; }
+};
+
+template <class _Tp>
+inline auto _S_makeLocalSharedFused(_Tp *__ptr, _SpCounter *__owner) noexcept
+    -> local_shared_ptr<_Tp> {
+  return local_shared_ptr<_Tp>(__ptr, __owner);
+}
+
+// 与make_shared相同的单次分配布局
+template <class _Tp, class... _Args>
+  requires(!std::is_unbounded_array_v<_Tp>)
+auto make_local_shared(_Args &&...__args) -> local_shared_ptr<_Tp> {
+  auto [__object, __counter] =
+      _S_newSharedFused<_Tp>(std::forward<_Args>(__args)...);
+  return _S_makeLocalSharedFused(__object, __counter);
+}
+
+template <class _Tp>
+  requires(!std::is_unbounded_array_v<_Tp>)
+auto make_local_shared_for_overwrite() -> local_shared_ptr<_Tp> {
+  auto [__object, __counter] = _S_newSharedFused<_Tp, true>();
+  return _S_makeLocalSharedFused(__object, __counter);
+}
+
+} // namespace MySTL
+
+#endif
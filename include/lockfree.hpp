@@ -0,0 +1,208 @@
+#ifndef LOCKFREE_HPP
+#define LOCKFREE_HPP
+
+#include "epoch.hpp"
+#include "hazard_pointer.hpp"
+#include "optional.hpp"
+#include <atomic>
+#include <type_traits>
+#include <utility>
+
+namespace MySTL {
+
+// 两种回收方式对读端的统一接口：epoch只需进入临界区，读取不做额外工作；
+// hazard在每次读取共享指针时占用一个槽位
+template <class _Domain> struct _ReclaimGuard;
+
+template <> struct _ReclaimGuard<epoch_domain> {
+  epoch_guard _M_guard;
+
+  explicit _ReclaimGuard(epoch_domain &__domain) : _M_guard(__domain) {}
+
+  template <unsigned _Slot, class _Tp>
+  auto protect(std::atomic<_Tp *> const &__src) noexcept -> _Tp * {
+    return __src.load(std::memory_order_acquire);
+  }
+};
+
+template <> struct _ReclaimGuard<hazard_domain> {
+  hazard_pointer _M_first;
+  hazard_pointer _M_second;
+
+  explicit _ReclaimGuard(hazard_domain &__domain)
+      : _M_first(__domain), _M_second(__domain) {}
+
+  template <unsigned _Slot, class _Tp>
+  auto protect(std::atomic<_Tp *> const &__src) noexcept -> _Tp * {
+    if constexpr (_Slot == 0) {
+      return _M_first.protect(__src);
+    } else {
+      return _M_second.protect(__src);
+    }
+  }
+};
+
+template <class _Domain> auto _S_defaultDomain() -> _Domain & {
+  if constexpr (std::is_same_v<_Domain, epoch_domain>) {
+    return default_epoch_domain();
+  } else {
+    return default_hazard_domain();
+  }
+}
+
+// Treiber栈：头指针上的CAS压入与弹出，弹出的节点交给回收域延迟释放，
+// 节点在有读者时不会被释放也就不会被重用，因此不存在ABA
+template <class _Tp, class _Domain = epoch_domain> struct treiber_stack {
+private:
+  struct _Node {
+    _Tp _M_value;
+    _Node *_M_next;
+  };
+
+  alignas(64) std::atomic<_Node *> _M_head{nullptr};
+  _Domain *_M_domain;
+
+public:
+  explicit treiber_stack(_Domain &__domain = _S_defaultDomain<_Domain>())
+      : _M_domain(&__domain) {}
+
+  treiber_stack(treiber_stack const &) = delete;
+
+  auto operator=(treiber_stack const &) -> treiber_stack & = delete;
+
+  // 析构时不能有其他线程仍在访问
+  ~treiber_stack() {
+    _Node *__n = _M_head.load(std::memory_order_relaxed);
+    while (__n) {
+      delete std::exchange(__n, __n->_M_next);
+    }
+  }
+
+  template <class... _Args> void emplace(_Args &&...__args) {
+    auto *__n = new _Node{_Tp(std::forward<_Args>(__args)...),
+                          _M_head.load(std::memory_order_relaxed)};
+    while (!_M_head.compare_exchange_weak(__n->_M_next, __n,
+                                          std::memory_order_release,
+                                          std::memory_order_relaxed)) {
+    }
+  }
+
+  void push(_Tp __value) { emplace(std::move(__value)); }
+
+  auto try_pop() -> optional<_Tp> {
+    _ReclaimGuard<_Domain> __guard(*_M_domain);
+    while (true) {
+      _Node *__h = __guard.template protect<0>(_M_head);
+      if (!__h) {
+        return nullopt;
+      }
+      // 弹出成功后节点只属于本线程，可以移走其中的值
+      if (_M_head.compare_exchange_weak(__h, __h->_M_next,
+                                        std::memory_order_acquire,
+                                        std::memory_order_relaxed)) {
+        optional<_Tp> __ret(std::move(__h->_M_value));
+        _M_domain->retire(__h);
+        return __ret;
+      }
+    }
+  }
+
+  auto empty() const noexcept -> bool {
+    return _M_head.load(std::memory_order_relaxed) == nullptr;
+  }
+};
+
+// Michael-Scott队列：头部始终是一个哑节点，出队时把下一个节点变为新的哑节点，
+// 取走其中的值并回收旧的哑节点；入队时尾指针可能落后一步，由任何线程帮忙推进
+template <class _Tp, class _Domain = epoch_domain> struct ms_queue {
+private:
+  struct _Node {
+    std::atomic<_Node *> _M_next{nullptr};
+    optional<_Tp> _M_value;
+  };
+
+  alignas(64) std::atomic<_Node *> _M_head;
+  alignas(64) std::atomic<_Node *> _M_tail;
+  _Domain *_M_domain;
+
+public:
+  explicit ms_queue(_Domain &__domain = _S_defaultDomain<_Domain>())
+      : _M_domain(&__domain) {
+    auto *__dummy = new _Node;
+    _M_head.store(__dummy, std::memory_order_relaxed);
+    _M_tail.store(__dummy, std::memory_order_relaxed);
+  }
+
+  ms_queue(ms_queue const &) = delete;
+
+  auto operator=(ms_queue const &) -> ms_queue & = delete;
+
+  // 析构时不能有其他线程仍在访问
+  ~ms_queue() {
+    _Node *__n = _M_head.load(std::memory_order_relaxed);
+    while (__n) {
+      delete std::exchange(__n, __n->_M_next.load(std::memory_order_relaxed));
+    }
+  }
+
+  template <class... _Args> void emplace(_Args &&...__args) {
+    auto *__n = new _Node;
+    __n->_M_value.emplace(std::forward<_Args>(__args)...);
+    _ReclaimGuard<_Domain> __guard(*_M_domain);
+    while (true) {
+      _Node *__t = __guard.template protect<0>(_M_tail);
+      _Node *__next = __t->_M_next.load(std::memory_order_acquire);
+      if (__t != _M_tail.load(std::memory_order_acquire)) {
+        continue;
+      }
+      if (__next) {
+        _M_tail.compare_exchange_weak(__t, __next, std::memory_order_release,
+                                      std::memory_order_relaxed);
+        continue;
+      }
+      if (__t->_M_next.compare_exchange_weak(__next, __n,
+                                             std::memory_order_release,
+                                             std::memory_order_relaxed)) {
+        _M_tail.compare_exchange_strong(__t, __n, std::memory_order_release,
+                                        std::memory_order_relaxed);
+        return;
+      }
+    }
+  }
+
+  void push(_Tp __value) { emplace(std::move(__value)); }
+
+  auto try_pop() -> optional<_Tp> {
+    _ReclaimGuard<_Domain> __guard(*_M_domain);
+    while (true) {
+      _Node *__h = __guard.template protect<0>(_M_head);
+      _Node *__next = __guard.template protect<1>(__h->_M_next);
+      // 确认__h仍是头部，此时__next尚未成为哑节点被回收
+      if (__h != _M_head.load(std::memory_order_acquire)) {
+        continue;
+      }
+      if (!__next) {
+        return nullopt;
+      }
+      _Node *__t = _M_tail.load(std::memory_order_acquire);
+      if (__h == __t) {
+        // 尾指针落后，先帮入队的线程推进
+        _M_tail.compare_exchange_weak(__t, __next, std::memory_order_release,
+                                      std::memory_order_relaxed);
+        continue;
+      }
+      if (_M_head.compare_exchange_weak(__h, __next,
+                                        std::memory_order_acq_rel,
+                                        std::memory_order_relaxed)) {
+        // __next成为新的哑节点，其中的值只有本线程会取走
+        optional<_Tp> __ret(std::move(*__next->_M_value));
+        _M_domain->retire(__h);
+        return __ret;
+      }
+    }
+  }
+};
+
+} // namespace MySTL
+
+#endif
@@ -1,9 +1,12 @@
 #ifndef OPTIONAL_HPP
 #define OPTIONAL_HPP
 
+#include "_optional_niche.hpp"
 #include <exception>
 #include <initializer_list>
+#include <memory>
 #include <type_traits>
+#include <utility>
 namespace MySTL {
 
 struct bad_optional_access : std::exception {
@@ -25,264 +28,356 @@ struct in_place_t {
 
 constexpr in_place_t in_place;
 
+// 特殊成员函数按T的平凡性分别约束：T可平凡拷贝时optional<T>也可平凡拷贝，
+// 可以被memcpy、通过寄存器返回，并能在常量表达式中使用
+// T特化了optional_niche时，空状态编码在m_value里，不再占用bool标记
 template<class T> struct optional {
 private:
-  bool m_has_value;
+  static constexpr bool s_niche = _HasOptionalNiche<T>;
+
+  struct no_flag {};
+
+  [[no_unique_address]] std::conditional_t<s_niche, no_flag, bool>
+      m_has_value{};
   union {
+    char m_empty;
     T m_value;
   };
 
+  constexpr void mark_engaged() noexcept {
+    if constexpr (!s_niche) {
+      m_has_value = true;
+    }
+  }
+
+  // 要求当前不持有值
+  constexpr void make_empty() noexcept {
+    if constexpr (s_niche) {
+      optional_niche<T>::set_empty(std::addressof(m_value));
+    } else {
+      m_has_value = false;
+    }
+  }
+
+  // 要求当前不持有值，空标记不需要析构，直接复用存储
+  // 空状态编码在m_value里时，构造抛出异常后存储可能只写了一半，重新写入空标记
+  template<class... Ts> constexpr void construct_value(Ts &&...value_args) {
+    if constexpr (s_niche) {
+      try {
+        std::construct_at(std::addressof(m_value),
+                          std::forward<Ts>(value_args)...);
+      } catch (...) {
+        make_empty();
+        throw;
+      }
+    } else {
+      std::construct_at(std::addressof(m_value),
+                        std::forward<Ts>(value_args)...);
+      mark_engaged();
+    }
+  }
+
 public:
-  optional(T &&value) noexcept: m_has_value(true), m_value(std::move(value)) {}
+  constexpr optional(T &&value) noexcept(
+      std::is_nothrow_move_constructible_v<T>)
+      : m_value(std::move(value)) {
+    mark_engaged();
+  }
 
-  optional(const T &value) noexcept
-      : m_has_value(true), m_value(std::move(value)) {}
+  constexpr optional(const T &value) noexcept(
+      std::is_nothrow_copy_constructible_v<T>)
+      : m_value(value) {
+    mark_engaged();
+  }
 
-  optional() noexcept: m_has_value(false) {}
+  constexpr optional() noexcept: m_empty() {
+    make_empty();
+  }
 
-  optional(nullopt_t) noexcept: m_has_value(false) {}
+  constexpr optional(nullopt_t) noexcept: m_empty() {
+    make_empty();
+  }
 
   template<class... Ts>
-  explicit optional(in_place_t, Ts &&...value_args)
-      : m_has_value(true), m_value(std::forward<Ts>(value_args)...) {}
+  constexpr explicit optional(in_place_t, Ts &&...value_args)
+      : m_value(std::forward<Ts>(value_args)...) {
+    mark_engaged();
+  }
 
   template<class U, class... Ts>
-  explicit optional(in_place_t, std::initializer_list<U> ilist,
-                    Ts &&...value_args)
-      : m_has_value(true), m_value(ilist, std::forward<Ts>(value_args)...) {}
-
-  optional(optional const &that) : m_has_value(that.m_has_value) {
-    if (m_has_value) {
-      new(&m_value) T(that.m_value);
+  constexpr explicit optional(in_place_t, std::initializer_list<U> ilist,
+                              Ts &&...value_args)
+      : m_value(ilist, std::forward<Ts>(value_args)...) {
+    mark_engaged();
+  }
+
+  constexpr optional(optional const &that)
+  requires(std::is_trivially_copy_constructible_v<T>)
+  = default;
+
+  constexpr optional(optional const &that) noexcept(
+      std::is_nothrow_copy_constructible_v<T>)
+  requires(std::is_copy_constructible_v<T> &&
+           !std::is_trivially_copy_constructible_v<T>)
+      : m_empty() {
+    if (that.has_value()) {
+      construct_value(that.m_value);
+    } else {
+      make_empty();
     }
   }
 
-  optional(optional &&that) noexcept: m_has_value(that.m_has_value) {
-    if (m_has_value) {
-      new(&m_value) T(std::move(that.m_value));
+  constexpr optional(optional &&that)
+  requires(std::is_trivially_move_constructible_v<T>)
+  = default;
+
+  constexpr optional(optional &&that) noexcept(
+      std::is_nothrow_move_constructible_v<T>)
+  requires(std::is_move_constructible_v<T> &&
+           !std::is_trivially_move_constructible_v<T>)
+      : m_empty() {
+    if (that.has_value()) {
+      construct_value(std::move(that.m_value));
+    } else {
+      make_empty();
     }
   }
 
-  optional &operator=(nullopt_t) noexcept {
-    if (m_has_value) {
-      m_value.~T();
-      m_has_value = false;
+  constexpr ~optional()
+  requires(std::is_trivially_destructible_v<T>)
+  = default;
+
+  constexpr ~optional() noexcept {
+    if (has_value()) {
+      std::destroy_at(std::addressof(m_value));
     }
+  }
+
+  constexpr optional &operator=(nullopt_t) noexcept {
+    reset();
     return *this;
   }
 
-  optional &operator=(T &&value) noexcept {
-    if (m_has_value) {
-      m_value.~T();
-      m_has_value = false;
-    }
-    new(&m_value) T(std::move(value));
-    m_has_value = true;
+  constexpr optional &operator=(T &&value) noexcept(
+      std::is_nothrow_move_constructible_v<T>) {
+    reset();
+    construct_value(std::move(value));
     return *this;
   }
 
-  optional &operator=(T const &value) noexcept {
-    if (m_has_value) {
-      m_value.~T();
-      m_has_value = false;
-    }
-    new(&m_value) T(value);
-    m_has_value = true;
+  constexpr optional &operator=(T const &value) noexcept(
+      std::is_nothrow_copy_constructible_v<T>) {
+    reset();
+    construct_value(value);
     return *this;
   }
 
-  optional &operator=(optional const &that) {
+  constexpr optional &operator=(optional const &that)
+  requires(std::is_trivially_copy_constructible_v<T> &&
+           std::is_trivially_copy_assignable_v<T> &&
+           std::is_trivially_destructible_v<T>)
+  = default;
+
+  constexpr optional &operator=(optional const &that)
+  requires(std::is_copy_constructible_v<T> &&
+           !(std::is_trivially_copy_constructible_v<T> &&
+             std::is_trivially_copy_assignable_v<T> &&
+             std::is_trivially_destructible_v<T>))
+  {
     if (this == &that) {
       return *this;
     }
 
-    if (m_has_value) {
-      m_value.~T();
-      m_has_value = false;
+    reset();
+    if (that.has_value()) {
+      construct_value(that.m_value);
     }
-
-    if (that.m_has_value) {
-      new(&m_value) T(that.m_value);
-    }
-    m_has_value = that.m_has_value;
     return *this;
   }
 
-  optional &operator=(optional &&that) {
+  constexpr optional &operator=(optional &&that)
+  requires(std::is_trivially_move_constructible_v<T> &&
+           std::is_trivially_move_assignable_v<T> &&
+           std::is_trivially_destructible_v<T>)
+  = default;
+
+  // 与平凡版本一致，移动后源对象仍持有（被移动过的）值
+  constexpr optional &operator=(optional &&that) noexcept(
+      std::is_nothrow_move_constructible_v<T>)
+  requires(std::is_move_constructible_v<T> &&
+           !(std::is_trivially_move_constructible_v<T> &&
+             std::is_trivially_move_assignable_v<T> &&
+             std::is_trivially_destructible_v<T>))
+  {
     if (this == &that) {
       return *this;
     }
 
-    if (m_has_value) {
-      m_value.~T();
-      m_has_value = false;
-    }
-
-    if (that.m_has_value) {
-      new(&m_value) T(that.m_value);
-      that.m_value.~T();
+    reset();
+    if (that.has_value()) {
+      construct_value(std::move(that.m_value));
     }
-    m_has_value = that.m_has_value;
-    that.m_has_value = false;
     return *this;
   }
 
-  template<class... Ts> void emplace(Ts &&...value_args) {
-    if (m_has_value) {
-      m_value.~T();
-      m_has_value = false;
-    }
-
-    new(&m_value) T(std::forward<Ts>(value_args)...);
-    m_has_value = true;
+  template<class... Ts> constexpr void emplace(Ts &&...value_args) {
+    reset();
+    construct_value(std::forward<Ts>(value_args)...);
   }
 
   template<class U, class... Ts>
-  void emplace(std::initializer_list<U> ilist, Ts &&...value_args) {
-    if (m_has_value) {
-      m_value.~T();
-      m_has_value = false;
-    }
-    new(&m_value) T(ilist, std::forward<Ts>(value_args)...);
-    m_has_value = true;
+  constexpr void emplace(std::initializer_list<U> ilist, Ts &&...value_args) {
+    reset();
+    construct_value(ilist, std::forward<Ts>(value_args)...);
   }
 
-  void reset() noexcept {
-    if (m_has_value) {
-      m_value.~T();
-      m_has_value = false;
+  constexpr void reset() noexcept {
+    if (has_value()) {
+      std::destroy_at(std::addressof(m_value));
+      make_empty();
     }
   }
 
-  ~optional() noexcept {
-    if (m_has_value) {
-      m_value.~T();
+  constexpr auto has_value() const noexcept -> bool {
+    if constexpr (s_niche) {
+      return !optional_niche<T>::is_empty(m_value);
+    } else {
+      return m_has_value;
     }
   }
 
-  auto has_value() const noexcept -> bool { return m_has_value; }
+  constexpr explicit operator bool() const noexcept { return has_value(); }
 
-  explicit operator bool() const noexcept { return m_has_value; }
-
-  auto operator==(nullopt_t) const noexcept -> bool { return !m_has_value; }
+  constexpr auto operator==(nullopt_t) const noexcept -> bool {
+    return !has_value();
+  }
 
-  friend auto operator==(nullopt_t, optional const &self) noexcept -> bool {
-    return !self.m_has_value;
+  friend constexpr auto operator==(nullopt_t, optional const &self) noexcept -> bool {
+    return !self.has_value();
   }
 
-  auto operator!=(nullopt_t) const noexcept { return m_has_value; }
+  constexpr auto operator!=(nullopt_t) const noexcept { return has_value(); }
 
-  friend auto operator!=(nullopt_t, optional const &self) noexcept -> bool {
-    return self.m_has_value;
+  friend constexpr auto operator!=(nullopt_t, optional const &self) noexcept -> bool {
+    return self.has_value();
   }
 
-  auto value() const & -> T const & {
-    if (!m_has_value) {
+  constexpr auto value() const & -> T const & {
+    if (!has_value()) {
       throw bad_optional_access();
     }
     return m_value;
   }
 
-  auto value() & -> T & {
-    if (!m_has_value) {
+  constexpr auto value() & -> T & {
+    if (!has_value()) {
       throw bad_optional_access();
     }
     return m_value;
   }
 
-  auto value() const && -> T const && {
-    if (!m_has_value) {
+  constexpr auto value() const && -> T const && {
+    if (!has_value()) {
       throw bad_optional_access();
     }
     return std::move(m_value);
   }
 
-  auto value() && -> T && {
-    if (!m_has_value) {
+  constexpr auto value() && -> T && {
+    if (!has_value()) {
       throw bad_optional_access();
     }
     return std::move(m_value);
   }
 
-  auto operator*() const & noexcept -> T const & { return m_value; }
+  constexpr auto operator*() const & noexcept -> T const & { return m_value; }
 
-  auto operator*() & noexcept -> T & { return m_value; }
+  constexpr auto operator*() & noexcept -> T & { return m_value; }
 
-  auto operator*() const && noexcept -> T const && {
+  constexpr auto operator*() const && noexcept -> T const && {
     return std::move(m_value);
   }
 
-  auto operator*() && noexcept -> T && { return std::move(m_value); }
+  constexpr auto operator*() && noexcept -> T && { return std::move(m_value); }
+
+  constexpr auto operator->() const noexcept -> T const * { return &m_value; }
 
-  auto operator->() const noexcept -> T const * { return &m_value; }
+  constexpr auto operator->() noexcept -> T * { return &m_value; }
 
-  auto operator->() noexcept -> T * { return &m_value; }
+  // 不抛异常的访问：为空时返回空指针，热路径上代替value()
+  constexpr auto try_value() const noexcept -> T const * {
+    return has_value() ? std::addressof(m_value) : nullptr;
+  }
+
+  constexpr auto try_value() noexcept -> T * {
+    return has_value() ? std::addressof(m_value) : nullptr;
+  }
 
-  auto value_or(T default_value) const & -> T {
-    if (!m_has_value) {
+  constexpr auto value_or(T default_value) const & -> T {
+    if (!has_value()) {
       return default_value;
     }
     return m_value;
   }
 
-  auto value_or(T default_value) && noexcept -> T {
-    if (!m_has_value) {
+  constexpr auto value_or(T default_value) && noexcept -> T {
+    if (!has_value()) {
       return default_value;
     }
     return std::move(m_value);
   }
 
-  auto operator==(optional<T> const &that) const noexcept -> bool {
-    if (m_has_value != that.m_has_value) {
+  constexpr auto operator==(optional<T> const &that) const noexcept -> bool {
+    if (has_value() != that.has_value()) {
       return false;
     }
-    if (m_has_value) {
+    if (has_value()) {
       return m_value == that.m_value;
     }
     return true;
   }
 
-  auto operator!=(optional<T> const &that) const noexcept -> bool {
-    if (m_has_value != that.m_has_value) {
+  constexpr auto operator!=(optional<T> const &that) const noexcept -> bool {
+    if (has_value() != that.has_value()) {
       return false;
     }
-    if (m_has_value) {
+    if (has_value()) {
       return m_value != that.m_value;
     }
     return false;
   }
 
-  auto operator<(optional const &that) const noexcept -> bool {
-    if (!m_has_value || !that.m_has_value) {
+  constexpr auto operator<(optional const &that) const noexcept -> bool {
+    if (!has_value() || !that.has_value()) {
       return false;
     }
     return m_value < that.m_value;
   }
 
-  auto operator>(optional const &that) const noexcept -> bool {
-    if (!m_has_value || !that.m_has_value) {
+  constexpr auto operator>(optional const &that) const noexcept -> bool {
+    if (!has_value() || !that.has_value()) {
       return false;
     }
     return m_value > that.m_value;
   }
 
-  auto operator>=(optional const &that) const noexcept -> bool {
-    if (!m_has_value || !that.m_has_value) {
+  constexpr auto operator>=(optional const &that) const noexcept -> bool {
+    if (!has_value() || !that.has_value()) {
       return false;
     }
     return m_value >= that.m_value;
   }
 
-  auto operator<=(optional const &that) const noexcept -> bool {
-    if (!m_has_value || !that.m_has_value) {
+  constexpr auto operator<=(optional const &that) const noexcept -> bool {
+    if (!has_value() || !that.has_value()) {
       return false;
     }
     return m_value <= that.m_value;
   }
 
   template<class F>
-  auto and_then(F &&f) const & -> std::remove_cvref_t<decltype(f(m_value))> {
-    if (m_has_value) {
+  constexpr auto and_then(F &&f) const & -> std::remove_cvref_t<decltype(f(m_value))> {
+    if (has_value()) {
       return std::forward<F>(f)(m_value);
     } else {
       return std::remove_cvref_t<decltype(f(m_value))>{};
@@ -290,8 +385,8 @@ public:
   }
 
   template<class F>
-  auto and_then(F &&f) & -> std::remove_cvref_t<decltype(f(m_value))> {
-    if (m_has_value) {
+  constexpr auto and_then(F &&f) & -> std::remove_cvref_t<decltype(f(m_value))> {
+    if (has_value()) {
       return std::forward<F>(f)(m_value);
     } else {
       return std::remove_cvref_t<decltype(f(m_value))>{};
@@ -299,8 +394,8 @@ public:
   }
 
   template<class F>
-  auto and_then(F &&f) const && -> std::remove_cvref_t<decltype(f(m_value))> {
-    if (m_has_value) {
+  constexpr auto and_then(F &&f) const && -> std::remove_cvref_t<decltype(f(m_value))> {
+    if (has_value()) {
       return std::forward<F>(f)(std::move(m_value));
     } else {
       return std::remove_cvref_t<decltype(f(std::move(m_value)))>{};
@@ -308,8 +403,8 @@ public:
   }
 
   template<class F>
-  auto and_then(F &&f) && -> std::remove_cvref_t<decltype(f(m_value))> {
-    if (m_has_value) {
+  constexpr auto and_then(F &&f) && -> std::remove_cvref_t<decltype(f(m_value))> {
+    if (has_value()) {
       return std::forward<F>(f)(std::move(m_value));
     } else {
       return std::remove_cvref_t<decltype(f(std::move(m_value)))>{};
@@ -317,9 +412,9 @@ public:
   }
 
   template<class F>
-  auto transform(
+  constexpr auto transform(
       F &&f) const & -> optional<std::remove_cvref_t<decltype(f(m_value))>> {
-    if (m_has_value) {
+    if (has_value()) {
       return std::forward<F>(f)(m_value);
     } else {
       return nullopt;
@@ -327,9 +422,9 @@ public:
   }
 
   template<class F>
-  auto
+  constexpr auto
   transform(F &&f) & -> optional<std::remove_cvref_t<decltype(f(m_value))>> {
-    if (m_has_value) {
+    if (has_value()) {
       return std::forward<F>(f)(m_value);
     } else {
       return nullopt;
@@ -337,9 +432,9 @@ public:
   }
 
   template<class F>
-  auto transform(F &&f) const
+  constexpr auto transform(F &&f) const
   && -> optional<std::remove_cvref_t<decltype(f(std::move(m_value)))>> {
-    if (m_has_value) {
+    if (has_value()) {
       return std::forward<F>(f)(std::move(m_value));
     } else {
       return nullopt;
@@ -347,9 +442,9 @@ public:
   }
 
   template<class F>
-  auto transform(F &&f)
+  constexpr auto transform(F &&f)
   && -> optional<std::remove_cvref_t<decltype(f(std::move(m_value)))>> {
-    if (m_has_value) {
+    if (has_value()) {
       return std::forward<F>(f)(std::move(m_value));
     } else {
       return nullopt;
@@ -358,8 +453,8 @@ public:
 
   template<class F>
   requires(std::is_move_constructible_v<T>)
-  auto or_else(F &&f) && -> optional {
-    if (m_has_value) {
+  constexpr auto or_else(F &&f) && -> optional {
+    if (has_value()) {
       return std::move(*this);
     } else {
       return std::forward<F>(f)();
@@ -368,22 +463,23 @@ public:
 
   template<class F>
   requires(std::is_move_constructible_v<T>)
-  auto or_else(F &&f) const & -> optional {
-    if (m_has_value) {
+  constexpr auto or_else(F &&f) const & -> optional {
+    if (has_value()) {
       return std::move(*this);
     } else {
       return std::forward<F>(f)();
     }
   }
 
-  void swap(optional &that) noexcept {
-    if (m_has_value && that.m_has_value) {
+  constexpr void swap(optional &that) noexcept {
+    if (has_value() && that.has_value()) {
       using std::swap;
       swap(m_value, that.m_value);
-    } else if (!m_has_value && !that.m_has_value) {
+    } else if (!has_value() && !that.has_value()) {
       //
-    } else if (m_has_value) {
+    } else if (has_value()) {
       that.emplace(std::move(m_value));
+      reset();
     } else {
       emplace(std::move(that.m_value));
       that.reset();
@@ -391,7 +487,109 @@ public:
   }
 };
 
-template<class T> auto make_optional(T value) {
+// 引用版本只保存一个指针，空指针表示空；赋值时重新绑定而不是给被引用对象赋值
+template<class T> struct optional<T &> {
+private:
+  T *m_ptr;
+
+public:
+  constexpr optional() noexcept: m_ptr(nullptr) {}
+
+  constexpr optional(nullopt_t) noexcept: m_ptr(nullptr) {}
+
+  template<class U>
+  requires(std::is_convertible_v<U *, T *>)
+  constexpr optional(U &value) noexcept: m_ptr(std::addressof(value)) {}
+
+  // 不允许绑定到临时对象
+  template<class U>
+  requires(!std::is_lvalue_reference_v<U> &&
+           std::is_convertible_v<U *, T *>)
+  optional(U &&value) = delete;
+
+  constexpr optional(optional const &that) = default;
+
+  constexpr optional &operator=(optional const &that) = default;
+
+  constexpr optional &operator=(nullopt_t) noexcept {
+    m_ptr = nullptr;
+    return *this;
+  }
+
+  template<class U>
+  requires(std::is_convertible_v<U *, T *>)
+  constexpr auto emplace(U &value) noexcept -> T & {
+    m_ptr = std::addressof(value);
+    return *m_ptr;
+  }
+
+  constexpr void reset() noexcept { m_ptr = nullptr; }
+
+  constexpr auto has_value() const noexcept -> bool { return m_ptr != nullptr; }
+
+  constexpr explicit operator bool() const noexcept { return m_ptr != nullptr; }
+
+  constexpr auto operator==(nullopt_t) const noexcept -> bool {
+    return m_ptr == nullptr;
+  }
+
+  constexpr auto operator!=(nullopt_t) const noexcept -> bool {
+    return m_ptr != nullptr;
+  }
+
+  constexpr auto value() const -> T & {
+    if (!m_ptr) {
+      throw bad_optional_access();
+    }
+    return *m_ptr;
+  }
+
+  constexpr auto operator*() const noexcept -> T & { return *m_ptr; }
+
+  constexpr auto operator->() const noexcept -> T * { return m_ptr; }
+
+  constexpr auto try_value() const noexcept -> T * { return m_ptr; }
+
+  template<class U>
+  constexpr auto value_or(U &&default_value) const -> std::remove_cv_t<T> {
+    if (!m_ptr) {
+      return std::forward<U>(default_value);
+    }
+    return *m_ptr;
+  }
+
+  template<class F>
+  constexpr auto and_then(F &&f) const
+      -> std::remove_cvref_t<std::invoke_result_t<F, T &>> {
+    if (m_ptr) {
+      return std::forward<F>(f)(*m_ptr);
+    } else {
+      return std::remove_cvref_t<std::invoke_result_t<F, T &>>{};
+    }
+  }
+
+  template<class F>
+  constexpr auto transform(F &&f) const
+      -> optional<std::remove_cvref_t<std::invoke_result_t<F, T &>>> {
+    if (m_ptr) {
+      return std::forward<F>(f)(*m_ptr);
+    } else {
+      return nullopt;
+    }
+  }
+
+  template<class F> constexpr auto or_else(F &&f) const -> optional {
+    if (m_ptr) {
+      return *this;
+    } else {
+      return std::forward<F>(f)();
+    }
+  }
+
+  constexpr void swap(optional &that) noexcept { std::swap(m_ptr, that.m_ptr); }
+};
+
+template<class T> constexpr auto make_optional(T value) {
   return optional<T>(std::move(value));
 }
 
@@ -1,9 +1,12 @@
 #ifndef SHARED_PTR_HPP
 #define SHARED_PTR_HPP
+#include "_sp_pool.hpp"
+#include "alloc_hooks.hpp"
 #include "default_deleter.hpp"
 #include "unique_ptr.hpp"
 #include <algorithm>
 #include <atomic>
+#include <cstdint>
 #include <memory>
 #include <new>
 #include <type_traits>
@@ -11,31 +14,528 @@
 
 namespace MySTL {
 
-struct _SpCounter {
+template <class _Tp> struct shared_ptr;
+template <class _Tp> struct weak_ptr;
+template <class _Tp> struct atomic;
+
+struct _SpCounterBiased;
+struct _SpBiasRecord;
 
-  std::atomic<long> _M_refcnt;
+// 本线程作为偏向计数所有者的记录，没有创建过偏向控制块的线程为空
+inline thread_local _SpBiasRecord *_S_sp_bias_thread = nullptr;
+
+struct _SpCounter {
 
-  _SpCounter() noexcept : _M_refcnt(1){};
+  // 低32位为强引用计数，高32位为弱引用计数（全部强引用合计再占1）
+  // 两者放在同一个64位字里，一次读取就能确认“只剩自己一个强引用且没有弱引用”
+  // shared_ptr通过atomic_ref原子地访问，local_shared_ptr直接用普通整数运算
+  alignas(std::atomic_ref<std::uint64_t>::required_alignment)
+      std::uint64_t _M_counts;
+
+  static constexpr std::uint64_t _S_strong_one = 1;
+  static constexpr std::uint64_t _S_weak_one = std::uint64_t(1) << 32;
+  static constexpr std::uint64_t _S_strong_mask = _S_weak_one - 1;
+
+  // 偏向计数的控制块（make_shared_biased）在合并前置位_S_biased：低32位是
+  // 其他线程的共享计数加上_S_shared_zero，可以为负而不向弱引用借位；所有者线程
+  // 的引用记在_SpCounterBiased::_M_biased里，不做原子读改写
+  // _S_queued表示共享计数已减为负并已排入所有者的合并队列；合并时两者一起清除，
+  // 控制块变回普通计数
+  static constexpr std::uint64_t _S_biased = std::uint64_t(1) << 63;
+  static constexpr std::uint64_t _S_queued = std::uint64_t(1) << 62;
+  static constexpr std::uint64_t _S_shared_zero = std::uint64_t(1) << 31;
+
+  // 分片计数的控制块（make_shared_sharded）在关闭前置位_S_sharded：强引用的
+  // 增减记在_SpCounterSharded的分片里，低32位保持在_S_shared_zero加1，不会
+  // 归零，也就不做归零检查；关闭时清除标志并把分片汇总到低32位
+  static constexpr std::uint64_t _S_sharded = std::uint64_t(1) << 61;
+
+  // 偏向计数与分片计数的控制块在构造时置位，之后不再改变，发布前写入，普通
+  // 读取即可。拷贝只检查它而不先读计数字：读取刚被原子加写过的同一个字要等
+  // 那次读改写完成，每次拷贝多付几纳秒
+  bool _M_flagged = false;
+
+  _SpCounter() noexcept : _M_counts(_S_strong_one + _S_weak_one){};
 
   _SpCounter(_SpCounter &&) = delete;
 
+  auto _M_atomic_counts() const noexcept -> std::atomic_ref<std::uint64_t> {
+    return std::atomic_ref<std::uint64_t>(
+        const_cast<std::uint64_t &>(_M_counts));
+  }
+
+  // 最后一个引用释放后的acquire栅栏
+  // TSan不识别独立的栅栏，改用对同一计数的acquire读取，两者语义相同
+  void _M_acquire_fence() const noexcept {
+#if defined(__SANITIZE_THREAD__)
+    (void)_M_atomic_counts().load(std::memory_order_acquire);
+#else
+    std::atomic_thread_fence(std::memory_order_acquire);
+#endif
+  }
+
+  // 拷贝时加1。普通控制块只有一次原子加，不读计数、不经过虚调用
   void _M_incref() noexcept {
-    _M_refcnt.fetch_add(1, std::memory_order_relaxed);
+    if (_M_flagged) [[unlikely]] {
+      if (_M_flagged_incref()) {
+        return;
+      }
+    }
+    _M_atomic_counts().fetch_add(_S_strong_one, std::memory_order_relaxed);
+  }
+
+  // 强引用不为0时才加1，供weak_ptr::lock使用，不会让已析构的对象复活
+  // 偏向计数合并前低32位不会为0，对象总在合并之后才析构
+  auto _M_incref_nonzero() noexcept -> bool {
+    auto __counts = _M_atomic_counts();
+    std::uint64_t __cnt = __counts.load(std::memory_order_relaxed);
+    do {
+      if ((__cnt & _S_strong_mask) == 0) {
+        return false;
+      }
+    } while (!__counts.compare_exchange_weak(__cnt, __cnt + _S_strong_one,
+                                             std::memory_order_acq_rel,
+                                             std::memory_order_relaxed));
+    return true;
   }
 
+  // 递减用release，最后一个引用再用acquire栅栏，保证其他持有者对对象的写入
+  // 在析构前可见
   void _M_decref() noexcept {
-    if (_M_refcnt.fetch_sub(1, std::memory_order_relaxed) == 1) {
-      delete this;
+    auto __counts = _M_atomic_counts();
+    std::uint64_t const __cnt = __counts.load(std::memory_order_acquire);
+    // 唯一持有者且没有weak_ptr时，其他线程无法再增加计数，可以跳过原子读改写
+    if (__cnt == _S_strong_one + _S_weak_one) {
+      _M_dispose();
+      _M_destroy();
+      return;
+    }
+    // 置位标志的控制块先交给各自的实现，返回false时按普通计数递减
+    if (__cnt & (_S_biased | _S_sharded)) [[unlikely]] {
+      if (_M_flagged_decref(__cnt)) {
+        return;
+      }
+    }
+    if ((__counts.fetch_sub(_S_strong_one, std::memory_order_release) &
+         _S_strong_mask) == 1) {
+      _M_acquire_fence();
+      _M_dispose();
+      _M_weak_decref();
+    }
+  }
+
+  // 批量增减强引用，供atomic<shared_ptr>预留引用使用，调用者需已持有引用
+  // 只用于atomic<shared_ptr>自己的_Holder，不会遇到偏向计数
+  void _M_incref_n(std::uint32_t __n) noexcept {
+    _M_atomic_counts().fetch_add(__n * _S_strong_one,
+                                 std::memory_order_relaxed);
+  }
+
+  void _M_decref_n(std::uint32_t __n) noexcept {
+    if ((_M_atomic_counts().fetch_sub(__n * _S_strong_one,
+                                      std::memory_order_release) &
+         _S_strong_mask) == __n) {
+      _M_acquire_fence();
+      _M_dispose();
+      _M_weak_decref();
+    }
+  }
+
+  void _M_weak_incref() noexcept {
+    _M_atomic_counts().fetch_add(_S_weak_one, std::memory_order_relaxed);
+  }
+
+  void _M_weak_decref() noexcept {
+    auto __counts = _M_atomic_counts();
+    // 强引用已归零且只剩这一个弱引用
+    if (__counts.load(std::memory_order_acquire) == _S_weak_one) {
+      _M_destroy();
+      return;
+    }
+    if ((__counts.fetch_sub(_S_weak_one, std::memory_order_release) >> 32) ==
+        1) {
+      _M_acquire_fence();
+      _M_destroy();
     }
   }
 
+  // 单线程版本，仅供local_shared_ptr使用：控制块不会被其他线程看到，
+  // 也不存在weak_ptr
+  void _M_local_incref() noexcept { _M_counts += _S_strong_one; }
+
+  void _M_local_decref() noexcept {
+    if (_M_counts == _S_strong_one + _S_weak_one) {
+      _M_dispose();
+      _M_destroy();
+      return;
+    }
+    _M_counts -= _S_strong_one;
+  }
+
   long _M_cntref() const noexcept {
-    return _M_refcnt.load(std::memory_order_relaxed);
+    std::uint64_t const __cnt =
+        _M_atomic_counts().load(std::memory_order_relaxed);
+    if (__cnt & (_S_biased | _S_sharded)) {
+      return _M_flagged_cntref(__cnt);
+    }
+    return static_cast<long>(__cnt & _S_strong_mask);
+  }
+
+  // 置位_M_flagged的控制块的拷贝，以及计数字带有_S_biased或_S_sharded时的
+  // 释放与use_count，由对应的控制块重写；拷贝与释放返回false时按普通计数处理
+  virtual auto _M_flagged_incref() noexcept -> bool {
+    return false;
+  }
+
+  virtual auto _M_flagged_decref(std::uint64_t) noexcept -> bool {
+    return false;
+  }
+
+  virtual auto _M_flagged_cntref(std::uint64_t __cnt) const noexcept -> long {
+    return static_cast<long>(__cnt & _S_strong_mask);
   }
 
+  // close_sharded，只有分片计数的控制块重写
+  virtual void _M_close_sharded() noexcept {}
+
+  // 强引用归零时析构被管理的对象
+  virtual void _M_dispose() noexcept = 0;
+
+  // 弱引用也归零时释放控制块本身
+  virtual void _M_destroy() noexcept { delete this; }
+
   virtual ~_SpCounter() = default;
 };
 
+// 偏向计数所有者线程的记录。其他线程把共享计数减为负时，控制块挂到_M_queue上
+// 等所有者合并；所有者退出时关闭队列，之后由减为负的线程自己合并
+// 每个偏向控制块引用记录，记录本身也按偏向的方式计数：所有者创建与释放的
+// 控制块只改_M_owned；其他线程释放时从_M_remote减一。_M_remote在线程存活期间
+// 带有_S_alive，不会归零；线程退出时并入_M_owned并去掉_S_alive，归零即删除
+struct _SpBiasRecord {
+  static constexpr std::int64_t _S_alive = std::int64_t(1) << 62;
+
+  std::atomic<_SpCounterBiased *> _M_queue{nullptr};
+  std::int64_t _M_owned = 0;
+  std::atomic<std::int64_t> _M_remote{_S_alive};
+
+  void _M_release_remote() noexcept {
+    if (_M_remote.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      delete this;
+    }
+  }
+
+  void _M_release_thread() noexcept {
+    std::int64_t const __delta = _M_owned - _S_alive;
+    if (_M_remote.fetch_add(__delta, std::memory_order_acq_rel) == -__delta) {
+      delete this;
+    }
+  }
+};
+
+inline thread_local bool _S_sp_bias_exiting = false;
+
+inline void _S_spBiasEnqueue(_SpCounterBiased *__b) noexcept;
+
+// 偏向计数：创建线程（所有者）的拷贝与析构只读写_M_biased，其他线程修改共享计数
+// 所有者的偏向计数归零，或者其他线程把共享计数减为负，控制块合并为普通计数
+// 对象只在合并后、两部分之和为零时析构
+struct _SpCounterBiased : _SpCounter {
+  _SpBiasRecord *_M_owner;
+  _SpCounterBiased *_M_next_queued = nullptr;
+  // 只有所有者写入，用relaxed的读和写代替读改写；其他线程只在use_count中
+  // 以及所有者退出后的合并中读取
+  std::atomic<std::uint32_t> _M_biased{1};
+
+  // 由make_shared_biased在本线程的记录建立之后构造
+  _SpCounterBiased() noexcept : _M_owner(_S_sp_bias_thread) {
+    _M_counts = _S_biased | _S_shared_zero | _S_weak_one;
+    _M_flagged = true;
+    ++_M_owner->_M_owned;
+  }
+
+  ~_SpCounterBiased() override {
+    if (_M_owner == _S_sp_bias_thread) {
+      --_M_owner->_M_owned;
+    } else {
+      _M_owner->_M_release_remote();
+    }
+  }
+
+  // 把偏向计数并入共享计数并清除标志。调用者是所有者，或者所有者已经退出、
+  // 偏向计数不会再变；acquire保证其他线程释放前的写入在析构前可见
+  void _M_merge() noexcept {
+    auto __counts = _M_atomic_counts();
+    std::uint64_t const __biased = _M_biased.load(std::memory_order_relaxed);
+    std::uint64_t __cnt = __counts.load(std::memory_order_relaxed);
+    std::uint64_t __strong;
+    do {
+      __strong = (__cnt & _S_strong_mask) - _S_shared_zero + __biased;
+    } while (!__counts.compare_exchange_weak(
+        __cnt, (__cnt & ~(_S_biased | _S_queued | _S_strong_mask)) | __strong,
+        std::memory_order_acq_rel, std::memory_order_relaxed));
+    if (__strong == 0) {
+      _M_dispose();
+      _M_weak_decref();
+    }
+  }
+
+  // 非所有者释放引用。共享计数第一次减为负时置_S_queued并多持有一个弱引用，
+  // 把控制块交给所有者合并，弱引用保证合并前控制块不会被释放
+  void _M_shared_decref() noexcept {
+    auto __counts = _M_atomic_counts();
+    std::uint64_t __cnt = __counts.load(std::memory_order_relaxed);
+    std::uint64_t __next;
+    bool __enqueue;
+    do {
+      if (!(__cnt & _S_biased)) {
+        // 已经合并，按普通计数释放
+        if ((__counts.fetch_sub(_S_strong_one, std::memory_order_release) &
+             _S_strong_mask) == 1) {
+          _M_acquire_fence();
+          _M_dispose();
+          _M_weak_decref();
+        }
+        return;
+      }
+      __next = __cnt - _S_strong_one;
+      __enqueue = !(__cnt & _S_queued) &&
+                  (__next & _S_strong_mask) < _S_shared_zero;
+      if (__enqueue) {
+        __next = (__next + _S_weak_one) | _S_queued;
+      }
+    } while (!__counts.compare_exchange_weak(__cnt, __next,
+                                             std::memory_order_release,
+                                             std::memory_order_relaxed));
+    if (__enqueue) {
+      _S_spBiasEnqueue(this);
+    }
+  }
+
+  // 所有者在合并前只改偏向计数；其他线程与合并后按普通计数
+  auto _M_flagged_incref() noexcept -> bool override {
+    if (_M_owner != _S_sp_bias_thread ||
+        !(_M_atomic_counts().load(std::memory_order_relaxed) & _S_biased)) {
+      return false;
+    }
+    _M_biased.store(_M_biased.load(std::memory_order_relaxed) + 1,
+                    std::memory_order_relaxed);
+    return true;
+  }
+
+  auto _M_flagged_decref(std::uint64_t) noexcept -> bool override;
+
+  auto _M_flagged_cntref(std::uint64_t __cnt) const noexcept -> long override {
+    return static_cast<long>(static_cast<std::int64_t>(__cnt & _S_strong_mask) -
+                             static_cast<std::int64_t>(_S_shared_zero) +
+                             _M_biased.load(std::memory_order_relaxed));
+  }
+};
+
+// 合并队列中的控制块，并归还入队时多持有的弱引用
+inline void _S_spBiasMergeList(_SpCounterBiased *__b) noexcept {
+  while (__b) {
+    _SpCounterBiased *__next = __b->_M_next_queued;
+    if (__b->_M_atomic_counts().load(std::memory_order_relaxed) &
+        _SpCounter::_S_biased) {
+      __b->_M_merge();
+    }
+    __b->_M_weak_decref();
+    __b = __next;
+  }
+}
+
+// 队列已关闭（所有者已退出）时就地合并；acquire读到关闭标记即看到所有者
+// 退出前对偏向计数的全部写入
+inline void _S_spBiasEnqueue(_SpCounterBiased *__b) noexcept {
+  auto &__queue = __b->_M_owner->_M_queue;
+  _SpCounterBiased *__head = __queue.load(std::memory_order_acquire);
+  do {
+    if (__head == _S_niche_pointer<_SpCounterBiased>()) {
+      __b->_M_merge();
+      __b->_M_weak_decref();
+      return;
+    }
+    __b->_M_next_queued = __head;
+  } while (!__queue.compare_exchange_weak(__head, __b,
+                                          std::memory_order_release,
+                                          std::memory_order_acquire));
+}
+
+// 所有者合并其他线程交来的控制块
+inline void _S_spBiasMergeQueued() noexcept {
+  if (_SpBiasRecord *__r = _S_sp_bias_thread) {
+    if (__r->_M_queue.load(std::memory_order_relaxed) != nullptr) {
+      _S_spBiasMergeList(
+          __r->_M_queue.exchange(nullptr, std::memory_order_acquire));
+    }
+  }
+}
+
+// 线程退出时关闭队列并合并其中的控制块。之后本线程不再被当作所有者，
+// 稍后析构的线程局部对象释放偏向引用时走非所有者的路径
+struct _SpBiasThreadExit {
+  ~_SpBiasThreadExit() {
+    _S_sp_bias_exiting = true;
+    if (_SpBiasRecord *__r = std::exchange(_S_sp_bias_thread, nullptr)) {
+      _S_spBiasMergeList(__r->_M_queue.exchange(
+          _S_niche_pointer<_SpCounterBiased>(), std::memory_order_acq_rel));
+      __r->_M_release_thread();
+    }
+  }
+};
+
+inline thread_local _SpBiasThreadExit _S_sp_bias_exit;
+
+// 本线程的记录，第一次创建偏向控制块时建立；线程退出阶段返回空指针
+inline auto _S_spBiasLocal() -> _SpBiasRecord * {
+  if (_SpBiasRecord *__r = _S_sp_bias_thread) [[likely]] {
+    return __r;
+  }
+  if (_S_sp_bias_exiting) {
+    return nullptr;
+  }
+  (void)&_S_sp_bias_exit;
+  return _S_sp_bias_thread = new _SpBiasRecord;
+}
+
+inline auto _SpCounterBiased::_M_flagged_decref(std::uint64_t) noexcept
+    -> bool {
+  if (_M_owner != _S_sp_bias_thread) {
+    _M_shared_decref();
+    return true;
+  }
+  std::uint32_t const __n = _M_biased.load(std::memory_order_relaxed) - 1;
+  _M_biased.store(__n, std::memory_order_relaxed);
+  if (__n == 0) {
+    // 没有其他线程的引用和弱引用时，没有人能再修改计数，与_M_decref的
+    // 快速路径相同；否则合并。之后this可能已经释放
+    if (_M_atomic_counts().load(std::memory_order_acquire) ==
+        (_S_biased | _S_shared_zero | _S_weak_one)) {
+      _M_dispose();
+      _M_destroy();
+    } else {
+      _M_merge();
+    }
+  }
+  // 顺便合并其他线程交来的控制块，只是读一次本线程记录
+  _S_spBiasMergeQueued();
+  return true;
+}
+
+// 分片计数的分片数与每个线程使用的分片，线程按首次使用的顺序轮流分配；
+// 超过分片数的线程共用分片，仍然正确，只是同一分片上又有了争用
+inline constexpr std::size_t _S_sp_shard_count = 16;
+inline std::atomic<std::size_t> _S_sp_shard_next{0};
+inline thread_local std::size_t _S_sp_shard_index = _S_sp_shard_count;
+
+inline auto _S_spShardIndex() noexcept -> std::size_t {
+  std::size_t __i = _S_sp_shard_index;
+  if (__i == _S_sp_shard_count) [[unlikely]] {
+    __i = _S_sp_shard_index =
+        _S_sp_shard_next.fetch_add(1, std::memory_order_relaxed) %
+        _S_sp_shard_count;
+  }
+  return __i;
+}
+
+// 分片计数：被所有线程频繁拷贝的对象（路由表、日志器）的强引用增减分散到
+// 各占一条缓存行的分片上，多个核同时拷贝时不争用同一条缓存行
+// 分片的值是该分片上增减的净值。工厂返回的引用记在低32位上（_S_shared_zero
+// 之上的1），所以强引用总数是1加各分片之和；分片期间不做归零检查，关闭时把
+// 每个分片换成_S_closed并汇总到低32位，之后按普通计数；关闭后才落到分片上的
+// 增减看到_S_closed，改为修改低32位
+// 某个分片被减为负时自动关闭：这个线程释放的引用比它取得的多，通常是发布者的
+// 引用已经释放。总数要归零，各分片之和必须为-1，一定有分片先变为负，因此最后
+// 一个引用释放时总会关闭并在汇总时析构对象，不需要调用close_sharded
+// 引用跨线程转交后在别的线程释放也会提前关闭，之后只是按普通计数，仍然正确
+struct _SpCounterSharded : _SpCounter {
+  static constexpr std::int64_t _S_closed = std::int64_t(1) << 62;
+
+  struct alignas(64) _Shard {
+    std::atomic<std::int64_t> _M_delta{0};
+  };
+
+  // 第一个分片与计数字不在同一缓存行
+  _Shard _M_shards[_S_sp_shard_count];
+
+  _SpCounterSharded() noexcept {
+    _M_counts = _S_sharded | (_S_shared_zero + _S_strong_one) | _S_weak_one;
+    _M_flagged = true;
+  }
+
+  // 递减用release，关闭时的acquire交换看到其他持有者释放前的写入
+  // 分片已关闭时返回false，由调用者改为修改低32位；把分片减为负时关闭，
+  // 之后this可能已经释放
+  auto _M_add(std::int64_t __delta) noexcept -> bool {
+    std::int64_t const __old = _M_shards[_S_spShardIndex()]._M_delta.fetch_add(
+        __delta, __delta > 0 ? std::memory_order_relaxed
+                             : std::memory_order_release);
+    if (__old >= _S_closed / 2) {
+      return false;
+    }
+    if (__old + __delta < 0) [[unlikely]] {
+      _M_close_sharded();
+    }
+    return true;
+  }
+
+  // 只有清除_S_sharded的一次调用汇总分片。汇总前从分片转到低32位的递减不会
+  // 让它归零：低32位仍带着_S_shared_zero，汇总时一并去掉
+  void _M_close_sharded() noexcept override {
+    auto __counts = _M_atomic_counts();
+    if (!(__counts.load(std::memory_order_relaxed) & _S_sharded) ||
+        !(__counts.fetch_and(~_S_sharded, std::memory_order_relaxed) &
+          _S_sharded)) {
+      return;
+    }
+    std::int64_t __sum = 0;
+    for (_Shard &__s : _M_shards) {
+      __sum += __s._M_delta.exchange(_S_closed, std::memory_order_acquire);
+    }
+    std::uint64_t const __delta =
+        static_cast<std::uint64_t>(__sum) - _S_shared_zero;
+    if (((__counts.fetch_add(__delta, std::memory_order_acq_rel) + __delta) &
+         _S_strong_mask) == 0) {
+      _M_dispose();
+      _M_weak_decref();
+    }
+  }
+
+  // 加在分片上；分片已关闭时返回false，改为修改低32位
+  auto _M_flagged_incref() noexcept -> bool override {
+    return _M_add(1);
+  }
+
+  // 分片已经关闭时返回false，改为修改低32位
+  auto _M_flagged_decref(std::uint64_t) noexcept -> bool override {
+    return _M_add(-1);
+  }
+
+  // 关闭过程中可能少算或多算正在转移的引用，与普通计数的use_count一样只是
+  // 近似值
+  auto _M_flagged_cntref(std::uint64_t __cnt) const noexcept -> long override {
+    std::int64_t __n = static_cast<std::int64_t>(__cnt & _S_strong_mask) -
+                       static_cast<std::int64_t>(_S_shared_zero);
+    for (_Shard const &__s : _M_shards) {
+      std::int64_t const __d = __s._M_delta.load(std::memory_order_relaxed);
+      if (__d < _S_closed / 2) {
+        __n += __d;
+      }
+    }
+    return static_cast<long>(__n);
+  }
+};
+
+// 删除器提供_M_dispose_counter时，强引用归零后由它接管对象的析构，例如交给
+// deferred_reclaimer在别的线程上完成（见deferred_reclaim.hpp）
+// 这类控制块构造时多持有一个弱引用：不走唯一持有者的快速路径，删除器交出对象后
+// 控制块（以及单次分配布局中的对象内存）仍然有效，析构完成后再归还这个弱引用
+template <class _Deleter, class _Counter>
+concept _SpCounterDisposer = requires(_Deleter &__d, _Counter *__c) {
+  __d._M_dispose_counter(__c);
+};
+
 template <class _Tp, class _Deleter> struct _SpCounterImpl final : _SpCounter {
 
   _Tp *_M_ptr;
@@ -45,30 +545,160 @@ template <class _Tp, class _Deleter> struct _SpCounterImpl final : _SpCounter {
   explicit _SpCounterImpl(_Tp *__ptr) noexcept : _M_ptr(__ptr) {}
 
   explicit _SpCounterImpl(_Tp *__ptr, _Deleter __deleter) noexcept
-      : _M_ptr(__ptr), _M_deleter(std::move(__deleter)) {}
+      : _M_ptr(__ptr), _M_deleter(std::move(__deleter)) {
+    if constexpr (_SpCounterDisposer<_Deleter, _SpCounterImpl>) {
+      _M_counts += _S_weak_one;
+    }
+  }
+
+  void _M_dispose() noexcept override {
+    if constexpr (_SpCounterDisposer<_Deleter, _SpCounterImpl>) {
+      _M_deleter._M_dispose_counter(this);
+    } else {
+      _M_deleter(_M_ptr);
+    }
+  }
+
+  static auto operator new(std::size_t __size) -> void * {
+    return _S_spAllocateBlock(alloc_site::shared_ptr_counter, __size,
+                              alignof(_SpCounterImpl));
+  }
 
-  ~_SpCounterImpl() noexcept override { _M_deleter(_M_ptr); }
+  static void operator delete(void *__mem, std::size_t __size) noexcept {
+    _S_spDeallocateBlock(alloc_site::shared_ptr_counter, __mem, __size,
+                         alignof(_SpCounterImpl));
+  }
 };
 
-template <class _Tp, class _Deleter>
-struct _SpCounterImplFused final : _SpCounter {
+// 控制块和对象在同一块内存里：强引用归零只析构对象，弱引用归零才释放内存
+// _Base选择计数方式，如_SpCounterBiased
+template <class _Tp, class _Deleter, class _Base = _SpCounter>
+struct _SpCounterImplFused final : _Base {
   _Tp *_M_ptr;
   void *_M_mem;
   [[no_unique_address]] _Deleter _M_deleter;
 
   explicit _SpCounterImplFused(_Tp *__ptr, void *__mem,
                                _Deleter __deleter) noexcept
-      : _M_ptr(__ptr), _M_mem(__mem), _M_deleter(std::move(__deleter)) {}
+      : _M_ptr(__ptr), _M_mem(__mem), _M_deleter(std::move(__deleter)) {
+    if constexpr (_SpCounterDisposer<_Deleter, _SpCounterImplFused>) {
+      this->_M_counts += _Base::_S_weak_one;
+    }
+  }
+
+  void _M_dispose() noexcept override {
+    if constexpr (_SpCounterDisposer<_Deleter, _SpCounterImplFused>) {
+      _M_deleter._M_dispose_counter(this);
+    } else {
+      _M_deleter(_M_ptr);
+    }
+  }
 
-  ~_SpCounterImplFused() noexcept { _M_deleter(_M_ptr); }
+  // 对象位于控制块之后_S_offset处，整块内存大小为_S_size
+  static constexpr std::size_t _S_offset =
+      (sizeof(_SpCounterImplFused) + alignof(_Tp) - 1) / alignof(_Tp) *
+      alignof(_Tp);
+  static constexpr std::size_t _S_align =
+      std::max(alignof(_Tp), alignof(_SpCounterImplFused));
+  static constexpr std::size_t _S_size = _S_offset + sizeof(_Tp);
 
   void operator delete(void *__mem) noexcept {
-#if __cpp_aligned_new
-    ::operator delete(__mem, std::align_val_t(std::max(
-                                 alignof(_Tp), alignof(_SpCounterImplFused))));
-#else
-    ::operator delete(__mem);
-#endif
+    _S_hookDeallocate(alloc_site::make_shared, __mem, _S_size, _S_align);
+  }
+};
+
+// 控制块本身也由分配器分配和释放，不经过全局堆
+template <class _Tp, class _Deleter, class _Alloc>
+struct _SpCounterImplAlloc final : _SpCounter {
+  using _BlockAlloc = typename std::allocator_traits<
+      _Alloc>::template rebind_alloc<_SpCounterImplAlloc>;
+
+  _Tp *_M_ptr;
+  [[no_unique_address]] _Deleter _M_deleter;
+  [[no_unique_address]] _BlockAlloc _M_alloc;
+
+  explicit _SpCounterImplAlloc(_Tp *__ptr, _Deleter __deleter,
+                               _BlockAlloc const &__alloc) noexcept
+      : _M_ptr(__ptr), _M_deleter(std::move(__deleter)), _M_alloc(__alloc) {}
+
+  // 分配失败时用删除器释放__ptr
+  static auto _S_create(_Tp *__ptr, _Deleter __deleter, _Alloc const &__alloc)
+      -> _SpCounterImplAlloc * {
+    _BlockAlloc __a(__alloc);
+    _SpCounterImplAlloc *__mem;
+    try {
+      __mem = std::allocator_traits<_BlockAlloc>::allocate(__a, 1);
+    } catch (...) {
+      __deleter(__ptr);
+      throw;
+    }
+    return ::new (static_cast<void *>(__mem))
+        _SpCounterImplAlloc(__ptr, std::move(__deleter), __a);
+  }
+
+  void _M_dispose() noexcept override { _M_deleter(_M_ptr); }
+
+  void _M_destroy() noexcept override {
+    _BlockAlloc __a(std::move(_M_alloc));
+    this->~_SpCounterImplAlloc();
+    std::allocator_traits<_BlockAlloc>::deallocate(__a, this, 1);
+  }
+};
+
+// allocate_shared使用的单次分配布局：对象直接作为控制块的成员
+template <class _Tp, class _Alloc>
+struct _SpCounterImplFusedAlloc final : _SpCounter {
+  using _BlockAlloc = typename std::allocator_traits<
+      _Alloc>::template rebind_alloc<_SpCounterImplFusedAlloc>;
+  using _ObjAlloc =
+      typename std::allocator_traits<_Alloc>::template rebind_alloc<_Tp>;
+
+  [[no_unique_address]] _BlockAlloc _M_alloc;
+  union {
+    _Tp _M_obj;
+  };
+
+  explicit _SpCounterImplFusedAlloc(_BlockAlloc const &__alloc) noexcept
+      : _M_alloc(__alloc) {}
+
+  ~_SpCounterImplFusedAlloc() noexcept override {}
+
+  auto _M_object() noexcept -> _Tp * { return std::addressof(_M_obj); }
+
+  // 对象构造失败时释放整块内存并重新抛出
+  template <bool _ForOverwrite, class... _Args>
+  static auto _S_create(_Alloc const &__alloc, _Args &&...__args)
+      -> _SpCounterImplFusedAlloc * {
+    _BlockAlloc __a(__alloc);
+    _SpCounterImplFusedAlloc *__mem =
+        std::allocator_traits<_BlockAlloc>::allocate(__a, 1);
+    auto *__counter = ::new (static_cast<void *>(__mem))
+        _SpCounterImplFusedAlloc(__a);
+    try {
+      if constexpr (_ForOverwrite) {
+        ::new (static_cast<void *>(__counter->_M_object())) _Tp;
+      } else {
+        _ObjAlloc __oa(__a);
+        std::allocator_traits<_ObjAlloc>::construct(
+            __oa, __counter->_M_object(), std::forward<_Args>(__args)...);
+      }
+    } catch (...) {
+      __counter->~_SpCounterImplFusedAlloc();
+      std::allocator_traits<_BlockAlloc>::deallocate(__a, __mem, 1);
+      throw;
+    }
+    return __counter;
+  }
+
+  void _M_dispose() noexcept override {
+    _ObjAlloc __oa(_M_alloc);
+    std::allocator_traits<_ObjAlloc>::destroy(__oa, _M_object());
+  }
+
+  void _M_destroy() noexcept override {
+    _BlockAlloc __a(std::move(_M_alloc));
+    this->~_SpCounterImplFusedAlloc();
+    std::allocator_traits<_BlockAlloc>::deallocate(__a, this, 1);
   }
 };
 
@@ -78,6 +708,9 @@ private:
   _SpCounter *_M_owner;
 
   template <class> friend struct shared_ptr;
+  template <class> friend struct weak_ptr;
+  template <class> friend struct atomic;
+  template <class> friend struct optional_niche;
 
   explicit shared_ptr(_Tp *__ptr, _SpCounter *__owner) noexcept
       : _M_ptr(__ptr), _M_owner(__owner) {}
@@ -87,7 +720,7 @@ public:
   using element_pointer = _Tp *;
 
   shared_ptr(std::nullptr_t = nullptr) noexcept
-      : _M_owner(nullptr), _M_ptr(nullptr) {}
+      : _M_ptr(nullptr), _M_owner(nullptr) {}
 
   template <class _Yp>
     requires(std::is_convertible_v<_Yp *, _Tp *>)
@@ -105,6 +738,16 @@ public:
     _S_setupEnableSharedFromThis(_M_ptr, _M_owner);
   }
 
+  // 控制块由__alloc分配
+  template <class _Yp, class _Deleter, class _Alloc>
+    requires(std::is_convertible_v<_Yp *, _Tp *>)
+  explicit shared_ptr(_Yp *__ptr, _Deleter __deleter, _Alloc __alloc)
+      : _M_ptr(__ptr),
+        _M_owner(_SpCounterImplAlloc<_Yp, _Deleter, _Alloc>::_S_create(
+            __ptr, std::move(__deleter), __alloc)) {
+    _S_setupEnableSharedFromThis(_M_ptr, _M_owner);
+  }
+
   template <class _Yp, class _Deleter>
     requires(std::is_convertible_v<_Yp *, _Tp *>)
   explicit shared_ptr(unique_ptr<_Yp, _Deleter> &&__ptr)
@@ -114,6 +757,19 @@ public:
   inline friend shared_ptr<_Yp>
   _S_makeSharedFused(_Yp *__ptr, _SpCounter *__owner) noexcept;
 
+  template <class _Yp>
+  inline friend void close_sharded(shared_ptr<_Yp> const &__ptr) noexcept;
+
+  // 对象已经析构时抛出std::bad_weak_ptr
+  template <class _Yp>
+    requires(std::is_convertible_v<_Yp *, _Tp *>)
+  explicit shared_ptr(weak_ptr<_Yp> const &__that)
+      : _M_ptr(__that._M_ptr), _M_owner(__that._M_owner) {
+    if (!_M_owner || !_M_owner->_M_incref_nonzero()) {
+      throw std::bad_weak_ptr();
+    }
+  }
+
   shared_ptr(shared_ptr const &__that) noexcept
       : _M_ptr(__that._M_ptr), _M_owner(__that._M_owner) {
     if (_M_owner) {
@@ -159,100 +815,43 @@ public:
     __that._M_owner = nullptr;
   }
 
+  // 先取得新值再释放旧值：__that可能由旧值管理的对象持有，如 p = p->next
   auto operator=(shared_ptr const &__that) noexcept -> shared_ptr & {
-    if (this == &__that) {
-      return *this;
-    }
-    if (this->_M_owner) {
-      _M_owner->_M_decref();
-    }
-    _M_ptr = __that._M_ptr;
-    _M_owner = __that._M_owner;
-
-    if (this->_M_owner) {
-      _M_owner->_M_incref();
-    }
+    shared_ptr(__that).swap(*this);
     return *this;
   }
 
   auto operator=(shared_ptr &&__that) noexcept -> shared_ptr & {
-    if (this == &__that) {
-      return *this;
-    }
-    if (this->_M_owner) {
-      _M_owner->_M_decref();
-    }
-
-    _M_ptr = __that._M_ptr;
-    _M_owner = __that._M_owner;
-    __that._M_ptr = nullptr;
-    __that._M_owner = nullptr;
+    shared_ptr(std::move(__that)).swap(*this);
     return *this;
   }
 
   template <class _Yp>
     requires(std::is_convertible_v<_Yp *, _Tp *>)
   auto operator=(shared_ptr<_Yp> const &__that) noexcept -> shared_ptr & {
-    if (this == &__that) {
-      return *this;
-    }
-    if (this->_M_owner) {
-      _M_owner->_M_decref();
-    }
-    _M_ptr = __that._M_ptr;
-    _M_owner = __that._M_owner;
-
-    if (this->_M_owner) {
-      _M_owner->_M_incref();
-    }
+    shared_ptr(__that).swap(*this);
     return *this;
   }
 
   template <class _Yp>
     requires(std::is_convertible_v<_Yp *, _Tp *>)
   auto operator=(shared_ptr<_Yp> &&__that) noexcept -> shared_ptr & {
-    if (this == &__that) {
-      return *this;
-    }
-    if (this->_M_owner) {
-      _M_owner->_M_decref();
-    }
-    _M_ptr = __that._M_ptr;
-    _M_owner = __that._M_owner;
-    __that._M_ptr = nullptr;
-    __that._M_owner = nullptr;
+    shared_ptr(std::move(__that)).swap(*this);
     return *this;
   }
 
-  void reset() noexcept {
-    if (_M_owner) {
-      _M_owner->_M_decref();
-    }
-    _M_owner = nullptr;
-    _M_ptr = nullptr;
-  }
+  void reset() noexcept { shared_ptr().swap(*this); }
 
-  template <class _Yp> void reset(_Yp *__ptr) {
-    if (_M_owner) {
-      _M_owner->_M_decref();
-    }
-    _M_ptr = nullptr;
-    _M_owner = nullptr;
-    _M_ptr = __ptr;
-    _M_owner = new _SpCounterImpl<_Yp, DefaultDeleter<_Yp>>(__ptr);
-    _S_setupEnableSharedFromThis(_M_ptr, _M_owner);
-  }
+  template <class _Yp> void reset(_Yp *__ptr) { shared_ptr(__ptr).swap(*this); }
 
   template <class _Yp, class _Deleter>
   void reset(_Yp *__ptr, _Deleter __deleter) {
-    if (_M_owner) {
-      _M_owner->_M_decref();
-    }
-    _M_ptr = nullptr;
-    _M_owner = nullptr;
-    _M_ptr = __ptr;
-    _M_owner = new _SpCounterImpl<_Yp, _Deleter>(__ptr, std::move(__deleter));
-    _S_setupEnableSharedFromThis(_M_ptr, _M_owner);
+    shared_ptr(__ptr, std::move(__deleter)).swap(*this);
+  }
+
+  template <class _Yp, class _Deleter, class _Alloc>
+  void reset(_Yp *__ptr, _Deleter __deleter, _Alloc __alloc) {
+    shared_ptr(__ptr, std::move(__deleter), std::move(__alloc)).swap(*this);
   }
 
   ~shared_ptr() noexcept {
@@ -332,37 +931,199 @@ inline auto _S_makeSharedFused(_Tp *__ptr, _SpCounter *__owner) noexcept
 }
 
 template <class _Tp> struct shared_ptr<_Tp[]> : shared_ptr<_Tp> {
+private:
+  explicit shared_ptr(_Tp *__ptr, _SpCounter *__owner) noexcept
+      : shared_ptr<_Tp>(__ptr, __owner) {}
+
+  template <class _Up>
+  inline friend shared_ptr<_Up[]>
+  _S_makeSharedArrayFused(_Up *__ptr, _SpCounter *__owner) noexcept;
+
+public:
   using shared_ptr<_Tp>::shared_ptr;
+  using shared_ptr<_Tp>::reset;
+
+  shared_ptr(std::nullptr_t = nullptr) noexcept : shared_ptr<_Tp>() {}
 
-  auto operator[](std::size_t __i) -> std::add_lvalue_reference<_Tp> {
+  // 默认删除器使用delete[]
+  template <class _Yp>
+    requires(std::is_convertible_v<_Yp (*)[], _Tp (*)[]>)
+  explicit shared_ptr(_Yp *__ptr)
+      : shared_ptr<_Tp>(__ptr, DefaultDeleter<_Yp[]>()) {}
+
+  template <class _Yp>
+    requires(std::is_convertible_v<_Yp (*)[], _Tp (*)[]>)
+  void reset(_Yp *__ptr) {
+    shared_ptr(__ptr).swap(*this);
+  }
+
+  auto operator[](std::size_t __i) const noexcept -> _Tp & {
     return this->get()[__i];
   }
 };
 
-template <class _Tp> struct enable_shared_from_this {
+// optional<shared_ptr>的空标记是一个不可能的控制块地址，空指针仍是合法的值
+template <class _Tp> struct optional_niche<shared_ptr<_Tp>> {
+  static void set_empty(shared_ptr<_Tp> *__p) noexcept {
+    std::construct_at(__p);
+    __p->_M_owner = _S_niche_pointer<_SpCounter>();
+  }
+
+  static auto is_empty(shared_ptr<_Tp> const &__v) noexcept -> bool {
+    return __v._M_owner == _S_niche_pointer<_SpCounter>();
+  }
+};
+
+template <class _Tp>
+inline auto _S_makeSharedArrayFused(_Tp *__ptr, _SpCounter *__owner) noexcept
+    -> shared_ptr<_Tp[]> {
+  return shared_ptr<_Tp[]>(__ptr, __owner);
+}
+
+template <class _Tp> struct weak_ptr {
 private:
+  _Tp *_M_ptr;
   _SpCounter *_M_owner;
 
+  template <class> friend struct weak_ptr;
+  template <class> friend struct shared_ptr;
+  template <class> friend struct enable_shared_from_this;
+
+  // 新增一个弱引用
+  explicit weak_ptr(_Tp *__ptr, _SpCounter *__owner) noexcept
+      : _M_ptr(__ptr), _M_owner(__owner) {
+    if (_M_owner) {
+      _M_owner->_M_weak_incref();
+    }
+  }
+
+public:
+  using element_type = _Tp;
+
+  weak_ptr() noexcept : _M_ptr(nullptr), _M_owner(nullptr) {}
+
+  template <class _Yp>
+    requires(std::is_convertible_v<_Yp *, _Tp *>)
+  weak_ptr(shared_ptr<_Yp> const &__that) noexcept
+      : weak_ptr(__that._M_ptr, __that._M_owner) {}
+
+  weak_ptr(weak_ptr const &__that) noexcept
+      : weak_ptr(__that._M_ptr, __that._M_owner) {}
+
+  template <class _Yp>
+    requires(std::is_convertible_v<_Yp *, _Tp *>)
+  weak_ptr(weak_ptr<_Yp> const &__that) noexcept
+      : weak_ptr(__that._M_ptr, __that._M_owner) {}
+
+  weak_ptr(weak_ptr &&__that) noexcept
+      : _M_ptr(__that._M_ptr), _M_owner(__that._M_owner) {
+    __that._M_ptr = nullptr;
+    __that._M_owner = nullptr;
+  }
+
+  template <class _Yp>
+    requires(std::is_convertible_v<_Yp *, _Tp *>)
+  weak_ptr(weak_ptr<_Yp> &&__that) noexcept
+      : _M_ptr(__that._M_ptr), _M_owner(__that._M_owner) {
+    __that._M_ptr = nullptr;
+    __that._M_owner = nullptr;
+  }
+
+  auto operator=(weak_ptr const &__that) noexcept -> weak_ptr & {
+    weak_ptr(__that).swap(*this);
+    return *this;
+  }
+
+  auto operator=(weak_ptr &&__that) noexcept -> weak_ptr & {
+    weak_ptr(std::move(__that)).swap(*this);
+    return *this;
+  }
+
+  template <class _Yp>
+    requires(std::is_convertible_v<_Yp *, _Tp *>)
+  auto operator=(shared_ptr<_Yp> const &__that) noexcept -> weak_ptr & {
+    weak_ptr(__that).swap(*this);
+    return *this;
+  }
+
+  ~weak_ptr() noexcept {
+    if (_M_owner) {
+      _M_owner->_M_weak_decref();
+    }
+  }
+
+  void reset() noexcept { weak_ptr().swap(*this); }
+
+  void swap(weak_ptr &__that) noexcept {
+    std::swap(_M_ptr, __that._M_ptr);
+    std::swap(_M_owner, __that._M_owner);
+  }
+
+  auto use_count() const noexcept -> long {
+    return _M_owner ? _M_owner->_M_cntref() : 0;
+  }
+
+  auto expired() const noexcept -> bool { return use_count() == 0; }
+
+  // 通过CAS循环获取强引用，强引用已归零时返回空指针
+  auto lock() const noexcept -> shared_ptr<_Tp> {
+    if (_M_owner && _M_owner->_M_incref_nonzero()) {
+      return shared_ptr<_Tp>(_M_ptr, _M_owner);
+    }
+    return nullptr;
+  }
+
+  template <class _Yp>
+  auto owner_before(weak_ptr<_Yp> const &__that) const noexcept -> bool {
+    return _M_owner < __that._M_owner;
+  }
+
+  template <class _Yp>
+  auto owner_before(shared_ptr<_Yp> const &__that) const noexcept -> bool {
+    return _M_owner < __that._M_owner;
+  }
+};
+
+template <class _Tp> struct enable_shared_from_this {
+private:
+  // 只持有弱引用，不会让对象自己延长自己的生命周期
+  mutable weak_ptr<_Tp> _M_weak_this;
+
 protected:
-  enable_shared_from_this() noexcept : _M_owner(nullptr){};
+  enable_shared_from_this() noexcept = default;
+
+  // 拷贝时不复制所属关系
+  enable_shared_from_this(enable_shared_from_this const &) noexcept {}
+
+  auto operator=(enable_shared_from_this const &) noexcept
+      -> enable_shared_from_this & {
+    return *this;
+  }
 
   auto shared_from_this() -> shared_ptr<_Tp> {
     static_assert(std::is_base_of_v<enable_shared_from_this, _Tp>,
                   "must be derived class");
-    if (!_M_owner) {
-      throw std::bad_weak_ptr();
-    }
-    _M_owner->_M_incref();
-    return _S_makeSharedFused(static_cast<_Tp *>(this), _M_owner);
+    return shared_ptr<_Tp>(_M_weak_this);
   }
+
   auto shared_from_this() const -> shared_ptr<_Tp const> {
     static_assert(std::is_base_of_v<enable_shared_from_this, _Tp>,
                   "must be derived class");
-    if (!_M_owner) {
-      throw std::bad_weak_ptr();
+    return shared_ptr<_Tp const>(_M_weak_this);
+  }
+
+  auto weak_from_this() noexcept -> weak_ptr<_Tp> { return _M_weak_this; }
+
+  auto weak_from_this() const noexcept -> weak_ptr<_Tp const> {
+    return _M_weak_this;
+  }
+
+private:
+  // 已经被别的shared_ptr管理时不覆盖
+  void _M_weak_assign(_Tp *__ptr, _SpCounter *__owner) const noexcept {
+    if (_M_weak_this.expired()) {
+      _M_weak_this = weak_ptr<_Tp>(__ptr, __owner);
     }
-    _M_owner->_M_incref();
-    return _S_makeSharedFused(static_cast<_Tp const *>(this), _M_owner);
   }
 
   template <class _Up>
@@ -375,7 +1136,7 @@ template <class _Up>
 inline void
 _S_setupEnableSharedFromThisOwner(enable_shared_from_this<_Up> *__ptr,
                                   _SpCounter *__owner) {
-  __ptr->_M_owner = __owner;
+  __ptr->_M_weak_assign(static_cast<_Up *>(__ptr), __owner);
 }
 
 template <class _Tp>
@@ -389,93 +1150,239 @@ template <class _Tp>
   requires(!std::is_base_of_v<enable_shared_from_this<_Tp>, _Tp>)
 void _S_setupEnableSharedFromThis(_Tp *, _SpCounter *) {}
 
-template <class _Tp, class... _Args>
-  requires(!std::is_unbounded_array_v<_Tp>)
-auto make_shared(_Args &&...__args) -> shared_ptr<_Tp> {
-  auto const __deleter = [](_Tp *__ptr) noexcept { __ptr->~_Tp(); };
-  using _Counter = _SpCounterImplFused<_Tp, decltype(__deleter)>;
-  constexpr std::size_t __offset = std::max(alignof(_Tp), sizeof(_Counter));
-  constexpr std::size_t __align = std::max(alignof(_Tp), alignof(_Counter));
-  constexpr std::size_t __size = __offset + sizeof(_Tp);
-#if __cpp_aligned_new
-  void *__mem = ::operator new(__size, std::align_val_t(__align));
+// 单次分配布局的删除器只析构对象，内存随控制块释放
+template <class _Tp> struct _SpDestroyAt {
+  void operator()(_Tp *__ptr) const noexcept { __ptr->~_Tp(); }
+};
+
+// 控制块与对象一次分配，_ForOverwrite时对象默认初始化
+// 返回的控制块持有一个强引用
+template <class _Tp, bool _ForOverwrite = false, class _Base = _SpCounter,
+          class _Deleter = _SpDestroyAt<_Tp>, class... _Args>
+auto _S_newSharedFusedWith(_Deleter __deleter, _Args &&...__args)
+    -> std::pair<_Tp *, _SpCounter *> {
+  using _Counter = _SpCounterImplFused<_Tp, _Deleter, _Base>;
+  void *__mem = _S_hookAllocate(alloc_site::make_shared, _Counter::_S_size,
+                                _Counter::_S_align);
   _Counter *__counter = reinterpret_cast<_Counter *>(__mem);
-#else
-  void *__mem = ::operator new(__size + __align);
-  _Counter *__counter =
-      reinterpret_cast<_SpC *>(reinterpret_cast<std::size_t>(__mem) & __align);
-#endif
-  _Tp *__object =
-      reinterpret_cast<_Tp *>(reinterpret_cast<char *>(__counter) + __offset);
+  _Tp *__object = reinterpret_cast<_Tp *>(reinterpret_cast<char *>(__counter) +
+                                          _Counter::_S_offset);
   try {
-    new (__object) _Tp(std::forward<_Args>(__args)...);
+    if constexpr (_ForOverwrite) {
+      new (__object) _Tp;
+    } else {
+      new (__object) _Tp(std::forward<_Args>(__args)...);
+    }
   } catch (...) {
-#if __cpp_aligned_new
-    ::operator delete(__mem, std::align_val_t(__align));
-#else
-    ::operator delete(__mem);
-#endif
+    _S_hookDeallocate(alloc_site::make_shared, __mem, _Counter::_S_size,
+                      _Counter::_S_align);
     throw;
   }
-  new (__counter) _Counter(__object, __mem, __deleter);
+  new (__counter) _Counter(__object, __mem, std::move(__deleter));
+  return {__object, __counter};
+}
+
+template <class _Tp, bool _ForOverwrite = false, class... _Args>
+auto _S_newSharedFused(_Args &&...__args) -> std::pair<_Tp *, _SpCounter *> {
+  return _S_newSharedFusedWith<_Tp, _ForOverwrite>(
+      _SpDestroyAt<_Tp>(), std::forward<_Args>(__args)...);
+}
+
+template <class _Tp, class... _Args>
+  requires(!std::is_unbounded_array_v<_Tp>)
+auto make_shared(_Args &&...__args) -> shared_ptr<_Tp> {
+  auto [__object, __counter] =
+      _S_newSharedFused<_Tp>(std::forward<_Args>(__args)...);
   _S_setupEnableSharedFromThis(__object, __counter);
   return _S_makeSharedFused(__object, __counter);
 }
+
 template <class _Tp>
   requires(!std::is_unbounded_array_v<_Tp>)
-auto make_shared_for_over_write() -> shared_ptr<_Tp> {
-  auto const __deleter = [](_Tp *__ptr) noexcept { __ptr->~_Tp(); };
-  using _Counter = _SpCounterImplFused<_Tp, decltype(__deleter)>;
-  constexpr std::size_t __offset = std::max(alignof(_Tp), sizeof(_Counter));
-  constexpr std::size_t __align = std::max(alignof(_Tp), alignof(_Counter));
-  constexpr std::size_t __size = __offset + sizeof(_Tp);
-#if __cpp_aligned_new
-  void *__mem = ::operator new(__size, std::align_val_t(__align));
-  _Counter *__counter = reinterpret_cast<_Counter *>(__mem);
-#else
-  void *__mem = ::operator new(__size + __align);
-  _SpC *__counter =
-      reinterpret_cast<_SpC *>(reinterpret_cast<std::size_t>(__mem) & __align);
-#endif
-  _Tp *__object =
-      reinterpret_cast<_Tp *>(reinterpret_cast<char *>(__counter) + __offset);
-  try {
-    new (__object) _Tp;
-  } catch (...) {
-#if __cpp_aligned_new
-    ::operator delete(__mem, std::align_val_t(__align));
-#else
-    ::operator delete(__mem);
-#endif
-    throw;
+auto make_shared_for_overwrite() -> shared_ptr<_Tp> {
+  auto [__object, __counter] = _S_newSharedFused<_Tp, true>();
+  _S_setupEnableSharedFromThis(__object, __counter);
+  return _S_makeSharedFused(__object, __counter);
+}
+
+// 偏向计数的单次分配：调用线程成为所有者，它的拷贝与析构不做原子读改写，
+// 其他线程的拷贝照常使用原子计数，返回类型与make_shared相同
+// 其他线程释放了所有者创建的引用时，控制块排入所有者的合并队列，由所有者在
+// 下次释放偏向引用、make_shared_biased、merge_biased_shared或线程退出时处理，
+// 在此之前对象不会析构；线程退出阶段退回到普通的make_shared
+template <class _Tp, class... _Args>
+  requires(!std::is_unbounded_array_v<_Tp>)
+auto make_shared_biased(_Args &&...__args) -> shared_ptr<_Tp> {
+  if (!_S_spBiasLocal()) {
+    return make_shared<_Tp>(std::forward<_Args>(__args)...);
   }
-  new (__counter) _Counter(__object, __mem, __deleter);
+  _S_spBiasMergeQueued();
+  auto [__object, __counter] = _S_newSharedFusedWith<_Tp, false, _SpCounterBiased>(
+      _SpDestroyAt<_Tp>(), std::forward<_Args>(__args)...);
   _S_setupEnableSharedFromThis(__object, __counter);
   return _S_makeSharedFused(__object, __counter);
 }
 
+// 合并其他线程交给本线程的偏向控制块，长时间不再创建偏向对象的所有者线程
+// 可以定期调用
+inline void merge_biased_shared() noexcept { _S_spBiasMergeQueued(); }
+
+// 分片计数的单次分配：控制块带_S_sp_shard_count个各占一条缓存行的分片（约
+// 1KiB），各线程的拷贝与析构只修改自己的分片，返回类型与make_shared相同，
+// 持有者不需要区分。某个线程释放的引用多于取得的引用时（通常是发布者释放了
+// 自己的引用）自动转为普通计数，最后一个引用释放时照常析构
 template <class _Tp, class... _Args>
+  requires(!std::is_unbounded_array_v<_Tp>)
+auto make_shared_sharded(_Args &&...__args) -> shared_ptr<_Tp> {
+  auto [__object, __counter] =
+      _S_newSharedFusedWith<_Tp, false, _SpCounterSharded>(
+          _SpDestroyAt<_Tp>(), std::forward<_Args>(__args)...);
+  _S_setupEnableSharedFromThis(__object, __counter);
+  return _S_makeSharedFused(__object, __counter);
+}
+
+// 提前关闭__ptr的分片计数，汇总后转为普通计数，例如发布者知道之后不会再有
+// 大量拷贝时。不调用也会在引用释放时自动关闭。可以重复调用，可以与其他线程的
+// 拷贝和释放并发；对其他方式创建的shared_ptr什么也不做
+template <class _Tp>
+inline void close_sharded(shared_ptr<_Tp> const &__ptr) noexcept {
+  if (__ptr._M_owner) {
+    __ptr._M_owner->_M_close_sharded();
+  }
+}
+
+// 控制块和对象都由__alloc分配，释放时也归还给__alloc
+template <class _Tp, class _Alloc, class... _Args>
+  requires(!std::is_unbounded_array_v<_Tp>)
+auto allocate_shared(_Alloc const &__alloc, _Args &&...__args)
+    -> shared_ptr<_Tp> {
+  auto *__counter =
+      _SpCounterImplFusedAlloc<_Tp, _Alloc>::template _S_create<false>(
+          __alloc, std::forward<_Args>(__args)...);
+  _Tp *__object = __counter->_M_object();
+  _S_setupEnableSharedFromThis(__object, __counter);
+  return _S_makeSharedFused(__object, static_cast<_SpCounter *>(__counter));
+}
+
+template <class _Tp, class _Alloc>
+  requires(!std::is_unbounded_array_v<_Tp>)
+auto allocate_shared_for_overwrite(_Alloc const &__alloc) -> shared_ptr<_Tp> {
+  auto *__counter =
+      _SpCounterImplFusedAlloc<_Tp, _Alloc>::template _S_create<true>(__alloc);
+  _Tp *__object = __counter->_M_object();
+  _S_setupEnableSharedFromThis(__object, __counter);
+  return _S_makeSharedFused(__object, static_cast<_SpCounter *>(__counter));
+}
+
+// 数组版本的单次分配布局：控制块（含长度）之后紧跟__len个元素
+template <class _Tp> struct _SpCounterImplFusedArray final : _SpCounter {
+  std::size_t _M_len;
+
+  // 与_SpCounterImplFused一样按整个控制块的大小和对齐计算，
+  // 控制块增加成员或提高对齐时元素不会与之重叠
+  static constexpr std::size_t _S_offset =
+      (sizeof(_SpCounterImplFusedArray) + alignof(_Tp) - 1) / alignof(_Tp) *
+      alignof(_Tp);
+  static constexpr std::size_t _S_align =
+      std::max(alignof(_Tp), alignof(_SpCounterImplFusedArray));
+
+  explicit _SpCounterImplFusedArray(std::size_t __len) noexcept
+      : _M_len(__len) {}
+
+  auto _M_elements() noexcept -> _Tp * {
+    return reinterpret_cast<_Tp *>(reinterpret_cast<char *>(this) +
+                                   _S_offset);
+  }
+
+  static void _S_destroy_n(_Tp *__first, std::size_t __n) noexcept {
+    if constexpr (!std::is_trivially_destructible_v<_Tp>) {
+      while (__n > 0) {
+        __first[--__n].~_Tp();
+      }
+    }
+  }
+
+  static auto _S_allocate(std::size_t __len) -> void * {
+    if (__len > (std::size_t(-1) - _S_offset) / sizeof(_Tp)) {
+      throw std::bad_array_new_length();
+    }
+    return _S_hookAllocate(alloc_site::make_shared_array,
+                           _S_offset + __len * sizeof(_Tp), _S_align);
+  }
+
+  static void _S_deallocate(void *__mem, std::size_t __len) noexcept {
+    _S_hookDeallocate(alloc_site::make_shared_array, __mem,
+                      _S_offset + __len * sizeof(_Tp), _S_align);
+  }
+
+  // 逐个构造元素，中途抛出异常时逆序析构已构造的元素并释放内存
+  template <bool _ForOverwrite>
+  static auto _S_create(std::size_t __len) -> _SpCounterImplFusedArray * {
+    void *__mem = _S_allocate(__len);
+    auto *__counter = ::new (__mem) _SpCounterImplFusedArray(__len);
+    _Tp *__first = __counter->_M_elements();
+    std::size_t __i = 0;
+    try {
+      for (; __i < __len; ++__i) {
+        if constexpr (_ForOverwrite) {
+          ::new (static_cast<void *>(__first + __i)) _Tp;
+        } else {
+          ::new (static_cast<void *>(__first + __i)) _Tp();
+        }
+      }
+    } catch (...) {
+      _S_destroy_n(__first, __i);
+      __counter->~_SpCounterImplFusedArray();
+      _S_deallocate(__mem, __len);
+      throw;
+    }
+    return __counter;
+  }
+
+  void _M_dispose() noexcept override { _S_destroy_n(_M_elements(), _M_len); }
+
+  void _M_destroy() noexcept override {
+    std::size_t const __len = _M_len;
+    this->~_SpCounterImplFusedArray();
+    _S_deallocate(this, __len);
+  }
+};
+
+// 元素值初始化
+template <class _Tp>
   requires(std::is_unbounded_array_v<_Tp>)
 auto make_shared(std::size_t __len) -> shared_ptr<_Tp> {
-  std::remove_extent_t<_Tp> *__p = new std::remove_extent_t<_Tp>[__len];
-  try {
-    return SharedPtr<_Tp>(__p);
-  } catch (...) {
-    delete[] __p;
-    throw;
-  }
+  using _Elem = std::remove_extent_t<_Tp>;
+  auto *__counter =
+      _SpCounterImplFusedArray<_Elem>::template _S_create<false>(__len);
+  return _S_makeSharedArrayFused(__counter->_M_elements(),
+                                 static_cast<_SpCounter *>(__counter));
 }
 
+// 元素默认初始化，平凡类型不做初始化
 template <class _Tp>
   requires(std::is_unbounded_array_v<_Tp>)
-auto makeSharedForOverwrite(std::size_t __len) -> shared_ptr<_Tp> {
-  std::remove_extent_t<_Tp> *__p = new std::remove_extent_t<_Tp>[__len];
-  try {
-    return SharedPtr<_Tp>(__p);
-  } catch (...) {
-    delete[] __p;
-    throw;
-  }
+auto make_shared_for_overwrite(std::size_t __len) -> shared_ptr<_Tp> {
+  using _Elem = std::remove_extent_t<_Tp>;
+  auto *__counter =
+      _SpCounterImplFusedArray<_Elem>::template _S_create<true>(__len);
+  return _S_makeSharedArrayFused(__counter->_M_elements(),
+                                 static_cast<_SpCounter *>(__counter));
+}
+
+// 旧的拼写，保留给已有代码过渡
+template <class _Tp>
+  requires(!std::is_unbounded_array_v<_Tp>)
+[[deprecated("use make_shared_for_overwrite")]] auto
+make_shared_for_over_write() -> shared_ptr<_Tp> {
+  return make_shared_for_overwrite<_Tp>();
+}
+
+template <class _Tp>
+  requires(std::is_unbounded_array_v<_Tp>)
+[[deprecated("use make_shared_for_overwrite")]] auto
+make_shared_for_over_write(std::size_t __len) -> shared_ptr<_Tp> {
+  return make_shared_for_overwrite<_Tp>(__len);
 }
 
 template <class _Tp, class _Up>
@@ -0,0 +1,455 @@
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+#include "_move_only_function.hpp"
+#include "_sp_pool.hpp"
+#include "intrusive_ptr.hpp"
+#include "optional.hpp"
+#include "unique_ptr.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+namespace MySTL {
+
+// 工作窃取线程池：每个工作线程一个Chase-Lev双端队列，工作线程提交的任务压入
+// 自己队列的底部并从底部取出（后进先出，缓存友好），空闲的线程从其他队列顶部
+// 窃取；外部线程提交的任务进入全局注入队列。找不到任务的线程自旋片刻后休眠
+
+// 任务节点：任务本身是move_only_function<void()>，放不进其缓冲区的可调用对象
+// 才会额外分配；节点从控制块使用的线程本地池中分配，可以在任意线程释放
+struct _TaskNode {
+  move_only_function<void()> _M_task;
+  _TaskNode *_M_next = nullptr; // 只在注入队列中使用
+
+  template <class _Fn, class... _Args>
+  explicit _TaskNode(std::in_place_type_t<_Fn> __tag, _Args &&...__args)
+      : _M_task(__tag, std::forward<_Args>(__args)...) {}
+
+  static auto operator new(std::size_t __size) -> void * {
+    return _S_spAllocateBlock(alloc_site::thread_pool, __size,
+                              alignof(_TaskNode));
+  }
+
+  static void operator delete(void *__mem, std::size_t __size) noexcept {
+    _S_spDeallocateBlock(alloc_site::thread_pool, __mem, __size,
+                         alignof(_TaskNode));
+  }
+};
+
+// Chase-Lev双端队列（按Lê等人针对弱内存模型的版本）：所属线程在底部压入与
+// 弹出，其他线程在顶部用CAS窃取，只有最后一个元素上会有竞争
+// 扩容时旧数组不能立即释放（窃取者可能正在读），留到队列析构
+struct _WorkDeque {
+  struct _Array {
+    std::int64_t _M_mask;
+    unique_ptr<std::atomic<_TaskNode *>[]> _M_slots;
+    unique_ptr<_Array> _M_prev;
+
+    explicit _Array(std::int64_t __capacity)
+        : _M_mask(__capacity - 1),
+          _M_slots(make_unique<std::atomic<_TaskNode *>[]>(
+              static_cast<std::size_t>(__capacity))) {}
+
+    auto _M_get(std::int64_t __i) const noexcept -> _TaskNode * {
+      return _M_slots[__i & _M_mask].load(std::memory_order_relaxed);
+    }
+
+    void _M_put(std::int64_t __i, _TaskNode *__n) noexcept {
+      _M_slots[__i & _M_mask].store(__n, std::memory_order_relaxed);
+    }
+  };
+
+  alignas(64) std::atomic<std::int64_t> _M_top{0};
+  alignas(64) std::atomic<std::int64_t> _M_bottom{0};
+  std::atomic<_Array *> _M_array;
+  unique_ptr<_Array> _M_owned;
+
+  static constexpr std::int64_t _S_initial_capacity = 256;
+
+  _WorkDeque()
+      : _M_array(new _Array(_S_initial_capacity)),
+        _M_owned(_M_array.load(std::memory_order_relaxed)) {}
+
+  void _M_push(_TaskNode *__n) {
+    std::int64_t const __b = _M_bottom.load(std::memory_order_relaxed);
+    std::int64_t const __t = _M_top.load(std::memory_order_acquire);
+    _Array *__a = _M_array.load(std::memory_order_relaxed);
+    if (__b - __t > __a->_M_mask) {
+      __a = _M_grow(__a, __b, __t);
+    }
+    __a->_M_put(__b, __n);
+    // release使节点内容先于新的底部对窃取者可见
+    _M_bottom.store(__b + 1, std::memory_order_release);
+  }
+
+  auto _M_take() noexcept -> _TaskNode * {
+    std::int64_t const __b = _M_bottom.load(std::memory_order_relaxed) - 1;
+    _Array *__a = _M_array.load(std::memory_order_relaxed);
+    _M_bottom.store(__b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    std::int64_t __t = _M_top.load(std::memory_order_relaxed);
+    if (__t > __b) {
+      _M_bottom.store(__b + 1, std::memory_order_relaxed);
+      return nullptr;
+    }
+    _TaskNode *__n = __a->_M_get(__b);
+    if (__t == __b) {
+      // 最后一个元素，与窃取者在顶部竞争
+      if (!_M_top.compare_exchange_strong(__t, __t + 1,
+                                          std::memory_order_seq_cst,
+                                          std::memory_order_relaxed)) {
+        __n = nullptr;
+      }
+      _M_bottom.store(__b + 1, std::memory_order_relaxed);
+    }
+    return __n;
+  }
+
+  // 其他线程调用，输掉竞争时重试，队列为空才返回nullptr
+  auto _M_steal() noexcept -> _TaskNode * {
+    while (true) {
+      std::int64_t __t = _M_top.load(std::memory_order_acquire);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      std::int64_t const __b = _M_bottom.load(std::memory_order_acquire);
+      if (__t >= __b) {
+        return nullptr;
+      }
+      _TaskNode *__n =
+          _M_array.load(std::memory_order_acquire)->_M_get(__t);
+      if (_M_top.compare_exchange_strong(__t, __t + 1,
+                                         std::memory_order_seq_cst,
+                                         std::memory_order_relaxed)) {
+        return __n;
+      }
+    }
+  }
+
+  auto _M_grow(_Array *__old, std::int64_t __b, std::int64_t __t)
+      -> _Array * {
+    auto *__a = new _Array((__old->_M_mask + 1) * 2);
+    for (std::int64_t __i = __t; __i < __b; ++__i) {
+      __a->_M_put(__i, __old->_M_get(__i));
+    }
+    __a->_M_prev = std::move(_M_owned);
+    _M_owned.reset(__a);
+    _M_array.store(__a, std::memory_order_release);
+    return __a;
+  }
+};
+
+// 外部线程提交的任务，所有工作线程都可以取
+struct _InjectQueue {
+  std::mutex _M_mutex;
+  _TaskNode *_M_head = nullptr;
+  _TaskNode *_M_tail = nullptr;
+  std::atomic<std::size_t> _M_size{0};
+
+  void _M_push(_TaskNode *__n) {
+    std::lock_guard<std::mutex> __lock(_M_mutex);
+    if (_M_tail) {
+      _M_tail->_M_next = __n;
+    } else {
+      _M_head = __n;
+    }
+    _M_tail = __n;
+    _M_size.fetch_add(1, std::memory_order_release);
+  }
+
+  auto _M_pop() -> _TaskNode * {
+    // 大部分时间注入队列为空，先无锁地看一眼
+    if (_M_size.load(std::memory_order_acquire) == 0) {
+      return nullptr;
+    }
+    std::lock_guard<std::mutex> __lock(_M_mutex);
+    _TaskNode *__n = _M_head;
+    if (__n) {
+      _M_head = __n->_M_next;
+      if (!_M_head) {
+        _M_tail = nullptr;
+      }
+      _M_size.fetch_sub(1, std::memory_order_relaxed);
+    }
+    return __n;
+  }
+};
+
+struct _TaskVoid {};
+
+// submit返回的结果与任务共享的状态，由intrusive_ptr计数，和任务节点一样
+// 从线程本地池中分配
+template <class _Res>
+struct _TaskResult final : intrusive_ref_counter<_TaskResult<_Res>> {
+  using _Value = std::conditional_t<std::is_void_v<_Res>, _TaskVoid, _Res>;
+
+  std::atomic<bool> _M_ready{false};
+  optional<_Value> _M_value;
+  std::exception_ptr _M_error;
+
+  template <class _Fn> void _M_run(_Fn &__fn) noexcept {
+    try {
+      if constexpr (std::is_void_v<_Res>) {
+        std::invoke(__fn);
+        _M_value.emplace();
+      } else {
+        _M_value.emplace(std::invoke(__fn));
+      }
+    } catch (...) {
+      _M_error = std::current_exception();
+    }
+    _M_ready.store(true, std::memory_order_release);
+    _M_ready.notify_all();
+  }
+
+  static auto operator new(std::size_t __size) -> void * {
+    return _S_spAllocateBlock(alloc_site::thread_pool, __size,
+                              alignof(_TaskResult));
+  }
+
+  static void operator delete(void *__mem, std::size_t __size) noexcept {
+    _S_spDeallocateBlock(alloc_site::thread_pool, __mem, __size,
+                         alignof(_TaskResult));
+  }
+};
+
+struct thread_pool;
+
+template <class _Res> struct task_handle;
+
+struct _PoolWorker {
+  _WorkDeque _M_deque;
+  std::thread _M_thread;
+  std::uint64_t _M_rng = 0;
+};
+
+// 当前线程所属的线程池与工作线程，外部线程为空
+struct _PoolThread {
+  thread_pool *_M_pool = nullptr;
+  _PoolWorker *_M_worker = nullptr;
+};
+
+inline thread_local _PoolThread _S_pool_thread;
+
+struct thread_pool {
+private:
+  unique_ptr<_PoolWorker[]> _M_workers;
+  std::size_t _M_size;
+  _InjectQueue _M_inject;
+  // 休眠与唤醒：休眠前记下信号值，提交任务时有休眠线程就递增信号并唤醒一个
+  alignas(64) std::atomic<std::uint32_t> _M_signal{0};
+  alignas(64) std::atomic<std::size_t> _M_idle{0};
+  std::atomic<bool> _M_stop{false};
+
+  template <class _Res> friend struct task_handle;
+
+  static constexpr int _S_spin_rounds = 64;
+
+  static void _S_run(_TaskNode *__n) noexcept {
+    __n->_M_task();
+    delete __n;
+  }
+
+  auto _M_local() const noexcept -> _PoolWorker * {
+    return _S_pool_thread._M_pool == this ? _S_pool_thread._M_worker
+                                          : nullptr;
+  }
+
+  void _M_schedule(_TaskNode *__n) {
+    if (_PoolWorker *__w = _M_local()) {
+      __w->_M_deque._M_push(__n);
+    } else {
+      _M_inject._M_push(__n);
+    }
+    // 任务入队必须先于读取休眠数，与_M_worker_main中的屏障配对，
+    // 否则可能错过刚准备休眠的线程
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (_M_idle.load(std::memory_order_relaxed) != 0) {
+      _M_signal.fetch_add(1, std::memory_order_release);
+      _M_signal.notify_one();
+    }
+  }
+
+  auto _M_find(_PoolWorker *__self) -> _TaskNode * {
+    if (__self) {
+      if (_TaskNode *__n = __self->_M_deque._M_take()) {
+        return __n;
+      }
+    }
+    if (_TaskNode *__n = _M_inject._M_pop()) {
+      return __n;
+    }
+    // 从随机位置开始依次尝试窃取，避免所有线程挤在同一个队列上
+    std::size_t __start = 0;
+    if (__self) {
+      __self->_M_rng ^= __self->_M_rng << 13;
+      __self->_M_rng ^= __self->_M_rng >> 7;
+      __self->_M_rng ^= __self->_M_rng << 17;
+      __start = static_cast<std::size_t>(__self->_M_rng % _M_size);
+    }
+    for (std::size_t __i = 0; __i < _M_size; ++__i) {
+      _PoolWorker &__victim = _M_workers[(__start + __i) % _M_size];
+      if (&__victim == __self) {
+        continue;
+      }
+      if (_TaskNode *__n = __victim._M_deque._M_steal()) {
+        return __n;
+      }
+    }
+    return nullptr;
+  }
+
+  void _M_worker_main(_PoolWorker *__self) {
+    _S_pool_thread = {this, __self};
+    int __spins = 0;
+    while (true) {
+      if (_TaskNode *__n = _M_find(__self)) {
+        _S_run(__n);
+        __spins = 0;
+        continue;
+      }
+      if (++__spins < _S_spin_rounds) {
+        std::this_thread::yield();
+        continue;
+      }
+      __spins = 0;
+      std::uint32_t const __seq = _M_signal.load(std::memory_order_acquire);
+      _M_idle.fetch_add(1, std::memory_order_relaxed);
+      // 先登记休眠再最后检查一次，与_M_schedule中的屏障配对
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      if (_TaskNode *__n = _M_find(__self)) {
+        _M_idle.fetch_sub(1, std::memory_order_relaxed);
+        _S_run(__n);
+        continue;
+      }
+      // 析构时所有队列都已取空才退出
+      if (_M_stop.load(std::memory_order_acquire)) {
+        _M_idle.fetch_sub(1, std::memory_order_relaxed);
+        break;
+      }
+      _M_signal.wait(__seq, std::memory_order_acquire);
+      _M_idle.fetch_sub(1, std::memory_order_relaxed);
+    }
+    _S_pool_thread = {};
+  }
+
+  // 在工作线程中等待结果时不能阻塞，否则分治任务会占满所有线程而死锁，
+  // 改为一边等一边执行其他任务
+  template <class _Pred> void _M_help_until(_Pred __done) {
+    _PoolWorker *__self = _M_local();
+    while (!__done()) {
+      if (_TaskNode *__n = _M_find(__self)) {
+        _S_run(__n);
+      } else {
+        std::this_thread::yield();
+      }
+    }
+  }
+
+public:
+  explicit thread_pool(
+      std::size_t __threads = std::thread::hardware_concurrency())
+      : _M_workers(make_unique<_PoolWorker[]>(__threads ? __threads : 1)),
+        _M_size(__threads ? __threads : 1) {
+    for (std::size_t __i = 0; __i < _M_size; ++__i) {
+      _M_workers[__i]._M_rng = 0x9e3779b97f4a7c15ull * (__i + 1);
+    }
+    for (std::size_t __i = 0; __i < _M_size; ++__i) {
+      _PoolWorker *__w = &_M_workers[__i];
+      __w->_M_thread = std::thread([this, __w] { _M_worker_main(__w); });
+    }
+  }
+
+  thread_pool(thread_pool const &) = delete;
+
+  auto operator=(thread_pool const &) -> thread_pool & = delete;
+
+  // 等待已提交的任务（包括它们继续提交的任务）全部完成
+  ~thread_pool() {
+    _M_stop.store(true, std::memory_order_seq_cst);
+    _M_signal.fetch_add(1, std::memory_order_release);
+    _M_signal.notify_all();
+    for (std::size_t __i = 0; __i < _M_size; ++__i) {
+      _M_workers[__i]._M_thread.join();
+    }
+  }
+
+  auto size() const noexcept -> std::size_t { return _M_size; }
+
+  // 不关心结果的任务，异常从任务中逃出时调用std::terminate
+  template <class _Fn>
+    requires(std::is_invocable_v<std::decay_t<_Fn> &>)
+  void post(_Fn &&__fn) {
+    _M_schedule(new _TaskNode(std::in_place_type<std::decay_t<_Fn>>,
+                              std::forward<_Fn>(__fn)));
+  }
+
+  // 返回的task_handle可以等待并取出结果，任务中的异常在get()时重新抛出
+  // 返回引用的可调用对象保存引用对象的副本
+  template <class _Fn,
+            class _Res = std::remove_cvref_t<
+                std::invoke_result_t<std::decay_t<_Fn> &>>>
+  auto submit(_Fn &&__fn) -> task_handle<_Res> {
+    intrusive_ptr<_TaskResult<_Res>> __state(new _TaskResult<_Res>);
+    auto __task = [__s = __state, __f = std::decay_t<_Fn>(
+                                      std::forward<_Fn>(__fn))]() mutable {
+      __s->_M_run(__f);
+    };
+    _M_schedule(new _TaskNode(std::in_place_type<decltype(__task)>,
+                              std::move(__task)));
+    return task_handle<_Res>(std::move(__state), this);
+  }
+};
+
+template <class _Res> struct task_handle {
+private:
+  intrusive_ptr<_TaskResult<_Res>> _M_state;
+  thread_pool *_M_pool = nullptr;
+
+  friend struct thread_pool;
+
+  task_handle(intrusive_ptr<_TaskResult<_Res>> __state,
+              thread_pool *__pool) noexcept
+      : _M_state(std::move(__state)), _M_pool(__pool) {}
+
+public:
+  task_handle() = default;
+
+  auto valid() const noexcept -> bool { return bool(_M_state); }
+
+  auto ready() const noexcept -> bool {
+    return _M_state->_M_ready.load(std::memory_order_acquire);
+  }
+
+  void wait() const {
+    if (ready()) {
+      return;
+    }
+    if (_M_pool->_M_local()) {
+      _M_pool->_M_help_until([this] { return ready(); });
+    } else {
+      _M_state->_M_ready.wait(false, std::memory_order_acquire);
+    }
+  }
+
+  // 只能调用一次，之后valid()为false
+  auto get() -> _Res {
+    wait();
+    auto __state = std::move(_M_state);
+    if (__state->_M_error) {
+      std::rethrow_exception(__state->_M_error);
+    }
+    if constexpr (!std::is_void_v<_Res>) {
+      return std::move(*__state->_M_value);
+    }
+  }
+};
+
+} // namespace MySTL
+
+#endif
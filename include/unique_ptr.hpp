@@ -1,6 +1,8 @@
 #ifndef UNIQUE_PTR_HPP
 #define UNIQUE_PTR_HPP
 
+#include "_optional_niche.hpp"
+#include "alloc_hooks.hpp"
 #include "default_deleter.hpp"
 #include <cstddef>
 #include <type_traits>
@@ -14,6 +16,7 @@ private:
   [[no_unique_address]] _Deleter _M_deleter;
 
   template <class _Up, class _UDeleter> friend struct unique_ptr;
+  template <class> friend struct optional_niche;
 
 public:
   using element_type = _Tp;
@@ -112,27 +115,49 @@ struct unique_ptr<_Tp[], _Deleter> : unique_ptr<_Tp, _Deleter> {
   _Tp &operator[](std::size_t __i) const noexcept { return this->get()[__i]; }
 };
 
+// optional<unique_ptr>的空标记是一个不可能的指针值，空指针仍是合法的值
+// 写入空标记时要构造删除器，删除器不能默认构造时退回到普通的optional
+template <class _Tp, class _Deleter>
+  requires(std::is_nothrow_default_constructible_v<_Deleter>)
+struct optional_niche<unique_ptr<_Tp, _Deleter>> {
+  static void set_empty(unique_ptr<_Tp, _Deleter> *__p) noexcept {
+    std::construct_at(__p);
+    __p->_M_p = _S_niche_pointer<std::remove_extent_t<_Tp>>();
+  }
+
+  static auto is_empty(unique_ptr<_Tp, _Deleter> const &__v) noexcept
+      -> bool {
+    return __v._M_p == _S_niche_pointer<std::remove_extent_t<_Tp>>();
+  }
+};
+
 template <class _Tp, class... _Args>
   requires(!std::is_unbounded_array_v<_Tp>)
 auto make_unique(_Args &&...__args) -> unique_ptr<_Tp> {
+  _S_hookRecord(alloc_site::make_unique, sizeof(_Tp));
   return unique_ptr<_Tp>(new _Tp(std::forward<_Args>(__args)...));
 }
 
 template <class _Tp>
   requires(!std::is_unbounded_array_v<_Tp>)
 auto make_unique_for_overwrite() -> unique_ptr<_Tp> {
+  _S_hookRecord(alloc_site::make_unique, sizeof(_Tp));
   return unique_ptr<_Tp>(new _Tp);
 }
 
 template <class _Tp>
   requires(std::is_unbounded_array_v<_Tp>)
 auto make_unique(std::size_t __len) -> unique_ptr<_Tp> {
+  _S_hookRecord(alloc_site::make_unique,
+                __len * sizeof(std::remove_extent_t<_Tp>));
   return unique_ptr<_Tp>(new std::remove_extent_t<_Tp>[__len]());
 }
 
 template <class _Tp>
   requires(std::is_unbounded_array_v<_Tp>)
 auto make_unique_for_overwrite(std::size_t __len) -> unique_ptr<_Tp> {
+  _S_hookRecord(alloc_site::make_unique,
+                __len * sizeof(std::remove_extent_t<_Tp>));
   return unique_ptr<_Tp>(new std::remove_extent_t<_Tp>[__len]);
 }
 
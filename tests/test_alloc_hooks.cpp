@@ -0,0 +1,160 @@
+#define MYSTL_ALLOC_HOOKS 1
+#include "alloc_hooks.hpp"
+#include "arena.hpp"
+#include "atomic_shared_ptr.hpp"
+#include "coroutine.hpp"
+#include "functional.hpp"
+#include "shared_ptr.hpp"
+#include "thread_pool.hpp"
+#include "unique_ptr.hpp"
+#include <gtest/gtest.h>
+#include <memory_resource>
+using namespace MySTL;
+
+// 统计经过的分配与释放，实际内存来自上游
+struct CountingResource : std::pmr::memory_resource {
+  std::size_t allocs = 0;
+  std::size_t deallocs = 0;
+  std::size_t live_bytes = 0;
+
+  auto do_allocate(std::size_t bytes, std::size_t align) -> void * override {
+    ++allocs;
+    live_bytes += bytes;
+    return std::pmr::new_delete_resource()->allocate(bytes, align);
+  }
+
+  void do_deallocate(void *p, std::size_t bytes,
+                     std::size_t align) override {
+    ++deallocs;
+    live_bytes -= bytes;
+    std::pmr::new_delete_resource()->deallocate(p, bytes, align);
+  }
+
+  auto do_is_equal(memory_resource const &that) const noexcept
+      -> bool override {
+    return this == &that;
+  }
+};
+
+class AllocHooksTest : public ::testing::Test {
+protected:
+  void SetUp() override { reset_alloc_stats(); }
+};
+
+TEST_F(AllocHooksTest, SharedPtrCounter) {
+  {
+    shared_ptr<int> sp(new int(1));
+    auto s = alloc_stats(alloc_site::shared_ptr_counter);
+    EXPECT_EQ(s.allocs, 1u);
+    EXPECT_EQ(s.live, 1u);
+    EXPECT_GT(s.bytes, 0u);
+  }
+  auto s = alloc_stats(alloc_site::shared_ptr_counter);
+  EXPECT_EQ(s.deallocs, 1u);
+  EXPECT_EQ(s.live, 0u);
+  EXPECT_EQ(s.live_bytes, 0u);
+}
+
+// 控制块在最后一个 weak_ptr 释放时才归还
+TEST_F(AllocHooksTest, MakeSharedLiveUntilWeakReleased) {
+  weak_ptr<int> wp;
+  {
+    auto sp = make_shared<int>(1);
+    wp = sp;
+  }
+  EXPECT_EQ(alloc_stats(alloc_site::make_shared).live, 1u);
+  wp.reset();
+  auto s = alloc_stats(alloc_site::make_shared);
+  EXPECT_EQ(s.allocs, 1u);
+  EXPECT_EQ(s.live, 0u);
+  EXPECT_EQ(s.live_bytes, 0u);
+}
+
+TEST_F(AllocHooksTest, MakeSharedArrayHistogram) {
+  { auto sp = make_shared<char[]>(1000); }
+  auto s = alloc_stats(alloc_site::make_shared_array);
+  EXPECT_EQ(s.allocs, 1u);
+  EXPECT_EQ(s.live_bytes, 0u);
+  EXPECT_GE(s.bytes, 1000u);
+  // 1000 多字节落在 (512, 1024] 或 (1024, 2048] 的桶里
+  EXPECT_EQ(s.histogram[10] + s.histogram[11], 1u);
+}
+
+TEST_F(AllocHooksTest, FunctionHeapFallback) {
+  {
+    long a = 1, b = 2, c = 3, d = 4, e = 5;
+    function<long()> small = [a] { return a; };
+    EXPECT_EQ(alloc_stats(alloc_site::function).allocs, 0u);
+    function<long()> big = [a, b, c, d, e] { return a + b + c + d + e; };
+    function<long()> copy = big;
+    EXPECT_EQ(alloc_stats(alloc_site::function).live, 2u);
+  }
+  EXPECT_EQ(alloc_stats(alloc_site::function).live, 0u);
+}
+
+TEST_F(AllocHooksTest, AtomicSharedPtr) {
+  {
+    MySTL::atomic<shared_ptr<int>> a(make_shared<int>(1));
+    a.store(make_shared<int>(2));
+    EXPECT_EQ(alloc_stats(alloc_site::atomic_shared_ptr).allocs, 2u);
+  }
+  EXPECT_EQ(alloc_stats(alloc_site::atomic_shared_ptr).live, 0u);
+}
+
+// make_unique 只统计分配
+TEST_F(AllocHooksTest, MakeUniqueRecordOnly) {
+  auto p = make_unique<int>(1);
+  auto s = alloc_stats(alloc_site::make_unique);
+  EXPECT_EQ(s.allocs, 1u);
+  EXPECT_EQ(s.bytes, sizeof(int));
+  EXPECT_EQ(s.live, 0u);
+}
+
+// 分配区只统计块，块内的对象不经过钩子
+TEST_F(AllocHooksTest, ArenaBlocks) {
+  {
+    monotonic_arena arena(256);
+    for (int i = 0; i < 64; ++i) {
+      auto p = make_arena_unique<long>(arena, i);
+    }
+    auto s = alloc_stats(alloc_site::arena);
+    EXPECT_EQ(s.allocs, arena.block_count());
+    EXPECT_GT(s.live, 0u);
+  }
+  EXPECT_EQ(alloc_stats(alloc_site::arena).live, 0u);
+}
+
+// 捕获不超过两个指针的任务直接构造在节点里，submit只分配节点与结果状态
+TEST_F(AllocHooksTest, ThreadPoolTasksInline) {
+  thread_pool pool(1);
+  int a = 1, b = 2;
+  reset_alloc_stats();
+  EXPECT_EQ(pool.submit([&a, &b] { return a + b; }).get(), 3);
+  pool.post([&a] { ++a; });
+  EXPECT_EQ(alloc_stats(alloc_site::function).allocs, 0u);
+  EXPECT_EQ(alloc_stats(alloc_site::thread_pool).allocs, 3u);
+}
+
+// 统计时不经过帧缓存，每个协程帧（包括sync_wait自己的）各分配一次
+TEST_F(AllocHooksTest, CoroutineFrames) {
+  auto inner = []() -> task<int> { co_return 1; };
+  auto outer = [&]() -> task<int> { co_return co_await inner() + 1; };
+  EXPECT_EQ(sync_wait(outer()), 2);
+  auto s = alloc_stats(alloc_site::coroutine_frame);
+  EXPECT_EQ(s.allocs, 3u);
+  EXPECT_EQ(s.live, 0u);
+}
+
+TEST_F(AllocHooksTest, RerouteToResource) {
+  CountingResource res;
+  auto *prev = set_alloc_resource(&res);
+  {
+    auto a = make_shared<int>(1);
+    shared_ptr<int> b(new int(2));
+    auto c = make_shared<int[]>(8);
+    EXPECT_EQ(res.allocs, 3u);
+  }
+  EXPECT_EQ(res.deallocs, 3u);
+  EXPECT_EQ(res.live_bytes, 0u);
+  set_alloc_resource(prev);
+}
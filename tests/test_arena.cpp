@@ -0,0 +1,154 @@
+#include "arena.hpp"
+#include <cstdint>
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+using namespace MySTL;
+
+namespace {
+
+struct Tracked {
+  static inline int alive = 0;
+  int value;
+
+  explicit Tracked(int v = 0) : value(v) { ++alive; }
+  Tracked(Tracked const &) = delete;
+  ~Tracked() { --alive; }
+};
+
+struct Base {
+  virtual ~Base() = default;
+  virtual auto id() const -> int { return 0; }
+};
+
+struct Derived : Base {
+  std::string name = "derived";
+  auto id() const -> int override { return 1; }
+};
+
+struct alignas(64) Wide {
+  char bytes[64];
+};
+
+struct ThrowOnThird {
+  static inline int constructed = 0;
+  static inline int alive = 0;
+
+  ThrowOnThird() {
+    if (++constructed == 3) {
+      throw 1;
+    }
+    ++alive;
+  }
+  ~ThrowOnThird() { --alive; }
+};
+
+} // namespace
+
+TEST(ArenaTest, OneWordWide) {
+  static_assert(sizeof(arena_unique_ptr<Tracked>) == sizeof(Tracked *));
+  static_assert(sizeof(arena_unique_ptr<Tracked[]>) == sizeof(Tracked *));
+  SUCCEED();
+}
+
+TEST(ArenaTest, AllocateRespectsAlignment) {
+  monotonic_arena arena;
+  for (std::size_t align : {1u, 2u, 8u, 16u, 64u, 256u}) {
+    (void)arena.allocate(1, 1);
+    void *p = arena.allocate(24, align);
+    EXPECT_EQ(reinterpret_cast<std::uintptr_t>(p) % align, 0u);
+  }
+  auto w = make_arena_unique<Wide>(arena);
+  EXPECT_EQ(reinterpret_cast<std::uintptr_t>(w.get()) % 64, 0u);
+}
+
+// 没有初始缓冲区时分配0字节也返回非空指针，release()之后同样如此
+TEST(ArenaTest, ZeroSizeIsNonNull) {
+  monotonic_arena arena;
+  EXPECT_NE(arena.allocate(0), nullptr);
+  arena.release();
+  EXPECT_NE(arena.allocate(0, 64), nullptr);
+  auto empty = make_arena_unique<int[]>(arena, 0);
+  EXPECT_NE(empty.get(), nullptr);
+}
+
+// 单独的对象由unique_ptr析构，内存留到分配区释放
+TEST(ArenaTest, DeleterRunsDestructorOnly) {
+  monotonic_arena arena;
+  {
+    auto a = make_arena_unique<Tracked>(arena, 1);
+    auto b = make_arena_unique<Tracked>(arena, 2);
+    EXPECT_EQ(Tracked::alive, 2);
+    EXPECT_EQ(a->value + b->value, 3);
+    a.reset();
+    EXPECT_EQ(Tracked::alive, 1);
+  }
+  EXPECT_EQ(Tracked::alive, 0);
+}
+
+TEST(ArenaTest, ConvertToBase) {
+  monotonic_arena arena;
+  arena_unique_ptr<Base> p = make_arena_unique<Derived>(arena);
+  EXPECT_EQ(p->id(), 1);
+}
+
+TEST(ArenaTest, Arrays) {
+  monotonic_arena arena;
+  {
+    auto v = make_arena_unique<int[]>(arena, 16);
+    for (int i = 0; i < 16; ++i) {
+      EXPECT_EQ(v[i], 0);
+    }
+    auto t = make_arena_unique<Tracked[]>(arena, 5);
+    EXPECT_EQ(Tracked::alive, 5);
+    auto w = make_arena_unique<Wide[]>(arena, 3);
+    EXPECT_EQ(reinterpret_cast<std::uintptr_t>(w.get()) % 64, 0u);
+  }
+  EXPECT_EQ(Tracked::alive, 0);
+}
+
+// 数组中途构造失败时已构造的元素被析构
+TEST(ArenaTest, ArrayConstructorThrows) {
+  monotonic_arena arena;
+  EXPECT_THROW(make_arena_unique<ThrowOnThird[]>(arena, 5), int);
+  EXPECT_EQ(ThrowOnThird::alive, 0);
+}
+
+// 初始缓冲区够用时不分配堆块，用完后按块链式增长，release()后回到初始缓冲区
+TEST(ArenaTest, InitialBufferThenBlocks) {
+  inline_arena<1024> arena(256);
+  void *first = arena.allocate(512);
+  EXPECT_EQ(arena.block_count(), 0u);
+  arena.allocate(1024);
+  EXPECT_EQ(arena.block_count(), 1u);
+  for (int i = 0; i < 64; ++i) {
+    arena.allocate(64);
+  }
+  EXPECT_GT(arena.block_count(), 1u);
+  arena.release();
+  EXPECT_EQ(arena.block_count(), 0u);
+  EXPECT_EQ(arena.allocate(512), first);
+}
+
+// 大量对象随分配区一起释放，不需要逐个delete
+TEST(ArenaTest, ObjectGraph) {
+  struct Node {
+    int value;
+    std::vector<Node *> children;
+  };
+  monotonic_arena arena;
+  std::vector<arena_unique_ptr<Node>> nodes;
+  for (int i = 0; i < 10000; ++i) {
+    nodes.push_back(make_arena_unique<Node>(arena, Node{i, {}}));
+    if (i > 0) {
+      nodes[(i - 1) / 2]->children.push_back(nodes.back().get());
+    }
+  }
+  long sum = 0;
+  for (auto const &n : nodes) {
+    sum += n->value;
+  }
+  EXPECT_EQ(sum, 10000L * 9999 / 2);
+  EXPECT_LT(arena.block_count(), 16u);
+}
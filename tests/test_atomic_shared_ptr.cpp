@@ -0,0 +1,136 @@
+#include "atomic_shared_ptr.hpp"
+#include <atomic>
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+
+using namespace MySTL;
+
+// 记录存活对象数
+struct Config {
+  static inline std::atomic<int> alive{0};
+  int version;
+  explicit Config(int v) : version(v) { ++alive; }
+  ~Config() { --alive; }
+};
+
+TEST(AtomicSharedPtrTest, DefaultIsNull) {
+  atomic<shared_ptr<int>> a;
+  EXPECT_EQ(a.load().get(), nullptr);
+  EXPECT_TRUE(a.is_lock_free());
+}
+
+TEST(AtomicSharedPtrTest, StoreAndLoad) {
+  atomic<shared_ptr<int>> a(make_shared<int>(1));
+  EXPECT_EQ(*a.load(), 1);
+  a.store(make_shared<int>(2));
+  shared_ptr<int> p = a;
+  EXPECT_EQ(*p, 2);
+  a = nullptr;
+  EXPECT_EQ(a.load().get(), nullptr);
+  EXPECT_EQ(*p, 2);
+}
+
+// 旧值在最后一个读者释放后才析构
+TEST(AtomicSharedPtrTest, ReplacedValueOutlivesReaders) {
+  Config::alive = 0;
+  {
+    atomic<shared_ptr<Config>> a(make_shared<Config>(1));
+    auto old = a.load();
+    a.store(make_shared<Config>(2));
+    EXPECT_EQ(Config::alive, 2);
+    EXPECT_EQ(old->version, 1);
+    old.reset();
+    EXPECT_EQ(Config::alive, 1);
+  }
+  EXPECT_EQ(Config::alive, 0);
+}
+
+TEST(AtomicSharedPtrTest, Exchange) {
+  atomic<shared_ptr<int>> a(make_shared<int>(1));
+  auto old = a.exchange(make_shared<int>(2));
+  EXPECT_EQ(*old, 1);
+  EXPECT_EQ(*a.load(), 2);
+}
+
+TEST(AtomicSharedPtrTest, CompareExchange) {
+  atomic<shared_ptr<int>> a(make_shared<int>(1));
+  auto stale = make_shared<int>(1);
+  EXPECT_FALSE(a.compare_exchange_strong(stale, make_shared<int>(3)));
+  EXPECT_EQ(*stale, 1); // 失败时更新为当前值
+  EXPECT_TRUE(a.compare_exchange_strong(stale, make_shared<int>(2)));
+  EXPECT_EQ(*a.load(), 2);
+
+  // 以写入时传入的shared_ptr作为期望值
+  auto stored = make_shared<int>(6);
+  a.store(stored);
+  auto expected_stored = stored;
+  EXPECT_TRUE(a.compare_exchange_strong(expected_stored, make_shared<int>(7)));
+  EXPECT_EQ(*a.load(), 7);
+  atomic<shared_ptr<int>> constructed(stored);
+  auto replacement = make_shared<int>(8);
+  EXPECT_TRUE(constructed.compare_exchange_strong(stored, replacement));
+  EXPECT_EQ(constructed.load().get(), replacement.get());
+  EXPECT_TRUE(constructed.compare_exchange_strong(replacement, nullptr));
+  EXPECT_FALSE(constructed.load());
+
+  atomic<shared_ptr<int>> empty;
+  shared_ptr<int> expected;
+  EXPECT_TRUE(empty.compare_exchange_strong(expected, make_shared<int>(5)));
+  EXPECT_EQ(*empty.load(), 5);
+}
+
+// 大量读取会触发预留引用的补充
+TEST(AtomicSharedPtrTest, ManyLoads) {
+  Config::alive = 0;
+  {
+    atomic<shared_ptr<Config>> a(make_shared<Config>(1));
+    std::vector<shared_ptr<Config>> held;
+    for (int i = 0; i < 200000; ++i) {
+      auto p = a.load();
+      if (i % 1000 == 0) {
+        held.push_back(p);
+      }
+    }
+    a.store(nullptr);
+    EXPECT_EQ(Config::alive, 1);
+    held.clear();
+    EXPECT_EQ(Config::alive, 0);
+  }
+}
+
+// 读者与写者并发，读到的对象必须始终有效
+TEST(AtomicSharedPtrTest, ConcurrentReadersAndWriter) {
+  Config::alive = 0;
+  {
+    atomic<shared_ptr<Config>> a(make_shared<Config>(0));
+    std::atomic<bool> stop{false};
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 3; ++t) {
+      readers.emplace_back([&] {
+        int last = 0;
+        while (!stop.load(std::memory_order_relaxed)) {
+          auto p = a.load();
+          ASSERT_TRUE(p);
+          EXPECT_GE(p->version, last);
+          last = p->version;
+        }
+      });
+    }
+    for (int v = 1; v <= 2000; ++v) {
+      if (v % 2) {
+        a.store(make_shared<Config>(v));
+      } else {
+        auto cur = a.load();
+        while (!a.compare_exchange_weak(cur, make_shared<Config>(v))) {
+        }
+      }
+    }
+    stop = true;
+    for (auto &th : readers) {
+      th.join();
+    }
+    EXPECT_EQ(a.load()->version, 2000);
+  }
+  EXPECT_EQ(Config::alive, 0);
+}
@@ -0,0 +1,246 @@
+#include "bounded_queue.hpp"
+#include "functional.hpp"
+#include "unique_ptr.hpp"
+#include <atomic>
+#include <chrono>
+#include <gtest/gtest.h>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace MySTL;
+
+namespace {
+
+// 没有默认构造函数，只能移动
+struct NoDefault {
+  static inline std::atomic<int> alive{0};
+  unique_ptr<int> p;
+
+  explicit NoDefault(int v) : p(new int(v)) { ++alive; }
+  NoDefault(NoDefault &&that) noexcept : p(std::move(that.p)) { ++alive; }
+  ~NoDefault() { --alive; }
+};
+
+} // namespace
+
+template <class _Queue> struct BoundedQueueTest : testing::Test {};
+
+
+struct MpmcTag {
+  template <class _Tp> using queue = mpmc_queue<_Tp>;
+};
+struct SpscTag {
+  template <class _Tp> using queue = spsc_queue<_Tp>;
+};
+
+using QueueKinds = testing::Types<MpmcTag, SpscTag>;
+TYPED_TEST_SUITE(BoundedQueueTest, QueueKinds);
+
+TYPED_TEST(BoundedQueueTest, FullAndEmpty) {
+  typename TypeParam::template queue<int> q(3);
+  EXPECT_EQ(q.capacity(), 4u);
+  EXPECT_FALSE(q.try_pop().has_value());
+  for (int i = 0; i < 4; ++i) {
+    EXPECT_TRUE(q.try_push(i));
+  }
+  int extra = 9;
+  EXPECT_FALSE(q.try_push(extra));
+  for (int i = 0; i < 4; ++i) {
+    EXPECT_EQ(*q.try_pop(), i);
+  }
+  EXPECT_FALSE(q.try_pop().has_value());
+}
+
+// 满时try_push不取走元素；析构时销毁剩余元素
+TYPED_TEST(BoundedQueueTest, MoveOnlyWithoutDefaultConstructor) {
+  NoDefault::alive = 0;
+  {
+    typename TypeParam::template queue<NoDefault> q(2);
+    EXPECT_TRUE(q.try_emplace(1));
+    EXPECT_TRUE(q.try_push(NoDefault(2)));
+    NoDefault third(3);
+    EXPECT_FALSE(q.try_push(std::move(third)));
+    EXPECT_NE(third.p, nullptr);
+    auto v = q.try_pop();
+    EXPECT_EQ(*v->p, 1);
+  }
+  EXPECT_EQ(NoDefault::alive, 0);
+}
+
+TYPED_TEST(BoundedQueueTest, MoveOnlyFunction) {
+  typename TypeParam::template queue<move_only_function<int()>> q(8);
+  auto p = std::make_unique<int>(5);
+  q.push([p = std::move(p)] { return *p; });
+  EXPECT_EQ(q.pop()(), 5);
+}
+
+TYPED_TEST(BoundedQueueTest, Bulk) {
+  typename TypeParam::template queue<unique_ptr<int>> q(8);
+  std::vector<unique_ptr<int>> in;
+  for (int i = 0; i < 10; ++i) {
+    in.push_back(make_unique<int>(i));
+  }
+  EXPECT_EQ(q.try_push_bulk(in.begin(), in.size()), 8u);
+  EXPECT_EQ(in[7], nullptr);
+  EXPECT_NE(in[8], nullptr);
+  std::vector<unique_ptr<int>> out;
+  EXPECT_EQ(q.try_pop_bulk(std::back_inserter(out), 5), 5u);
+  EXPECT_EQ(q.try_push_bulk(in.begin() + 8, 2), 2u);
+  EXPECT_EQ(q.try_pop_bulk(std::back_inserter(out), 100), 5u);
+  ASSERT_EQ(out.size(), 10u);
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_EQ(*out[i], i);
+  }
+}
+
+// 阻塞的一端在另一端推进后被唤醒
+TYPED_TEST(BoundedQueueTest, BlockingHandoff) {
+  constexpr int kCount = 100000;
+  typename TypeParam::template queue<int> q(16);
+  std::thread producer([&] {
+    for (int i = 0; i < kCount; ++i) {
+      q.push(i);
+    }
+  });
+  for (int i = 0; i < kCount; ++i) {
+    ASSERT_EQ(q.pop(), i);
+  }
+  producer.join();
+}
+
+// 两个队列来回传递，每一轮双方都会在空队列上休眠，漏掉一次唤醒就会卡住
+TYPED_TEST(BoundedQueueTest, PingPongWakesSleepers) {
+  constexpr int kRounds = 2000;
+  typename TypeParam::template queue<int> ping(2), pong(2);
+  std::thread peer([&] {
+    for (int i = 0; i < kRounds; ++i) {
+      pong.push(ping.pop() + 1);
+    }
+  });
+  for (int i = 0; i < kRounds; ++i) {
+    ping.push(i);
+    ASSERT_EQ(pong.pop(), i + 1);
+  }
+  peer.join();
+}
+
+// 多个生产者与消费者混用阻塞、非阻塞与批量接口，每个元素恰好取出一次
+TEST(MpmcQueueTest, ManyProducersManyConsumers) {
+  constexpr int kProducers = 3, kConsumers = 3, kPerProducer = 20000;
+  mpmc_queue<int> q(64);
+  std::vector<std::atomic<int>> seen(kProducers * kPerProducer);
+  std::atomic<int> consumed{0};
+  std::vector<std::thread> threads;
+  for (int p = 0; p < kProducers; ++p) {
+    threads.emplace_back([&, p] {
+      for (int i = 0; i < kPerProducer;) {
+        int const v = p * kPerProducer + i;
+        if (p == 0) {
+          q.push(v);
+          ++i;
+        } else if (p == 1) {
+          int batch[4] = {v, v + 1, v + 2, v + 3};
+          int const n = std::min(4, kPerProducer - i);
+          auto const pushed = static_cast<int>(q.try_push_bulk(batch, n));
+          if (pushed == 0) {
+            std::this_thread::yield();
+          }
+          i += pushed;
+        } else if (q.try_push(v)) {
+          ++i;
+        } else {
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+  for (int c = 0; c < kConsumers; ++c) {
+    threads.emplace_back([&, c] {
+      std::vector<int> buf;
+      while (consumed.load() < kProducers * kPerProducer) {
+        buf.clear();
+        if (c == 0) {
+          if (auto v = q.try_pop()) {
+            buf.push_back(*v);
+          }
+        } else {
+          q.try_pop_bulk(std::back_inserter(buf), 8);
+        }
+        if (buf.empty()) {
+          std::this_thread::yield();
+        }
+        for (int v : buf) {
+          ++seen[v];
+        }
+        consumed += static_cast<int>(buf.size());
+      }
+    });
+  }
+  for (auto &t : threads) {
+    t.join();
+  }
+  for (auto &s : seen) {
+    EXPECT_EQ(s, 1);
+  }
+}
+
+// 阻塞调用把下标推过对方时，批量的try_接口立即返回而不是等待
+TEST(MpmcQueueTest, BulkAlongsideBlockedCalls) {
+  mpmc_queue<int> q(4);
+  std::vector<int> out;
+  std::thread consumer([&] { EXPECT_EQ(q.pop(), 1); });
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  EXPECT_EQ(q.try_pop_bulk(std::back_inserter(out), 4), 0u);
+  int in[] = {1, 2, 3};
+  EXPECT_EQ(q.try_push_bulk(in, 3), 3u);
+  consumer.join();
+  EXPECT_EQ(q.try_pop_bulk(std::back_inserter(out), 4), 2u);
+  EXPECT_EQ(out, (std::vector<int>{2, 3}));
+
+  int full[] = {4, 5, 6, 7};
+  EXPECT_EQ(q.try_push_bulk(full, 4), 4u);
+  std::thread producer([&] { q.push(8); });
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  EXPECT_EQ(q.try_push_bulk(in, 1), 0u);
+  out.clear();
+  EXPECT_EQ(q.try_pop_bulk(std::back_inserter(out), 4), 4u);
+  producer.join();
+  EXPECT_EQ(q.pop(), 8);
+  EXPECT_EQ(out, (std::vector<int>{4, 5, 6, 7}));
+}
+
+TEST(SpscQueueTest, BulkStreaming) {
+  constexpr int kCount = 100000;
+  spsc_queue<std::string> q(32);
+  std::thread producer([&] {
+    std::vector<std::string> batch;
+    for (int i = 0; i < kCount;) {
+      batch.clear();
+      for (int j = i; j < std::min(kCount, i + 7); ++j) {
+        batch.push_back(std::to_string(j));
+      }
+      std::size_t done = 0;
+      while (done < batch.size()) {
+        std::size_t const pushed =
+            q.try_push_bulk(batch.begin() + done, batch.size() - done);
+        if (pushed == 0) {
+          std::this_thread::yield();
+        }
+        done += pushed;
+      }
+      i += static_cast<int>(batch.size());
+    }
+  });
+  std::vector<std::string> out;
+  while (out.size() < kCount) {
+    if (q.try_pop_bulk(std::back_inserter(out), 16) == 0) {
+      std::this_thread::yield();
+    }
+  }
+  producer.join();
+  for (int i = 0; i < kCount; i += 9973) {
+    EXPECT_EQ(out[i], std::to_string(i));
+  }
+}
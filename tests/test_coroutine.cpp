@@ -0,0 +1,257 @@
+#include "arena.hpp"
+#include "coroutine.hpp"
+#include "thread_pool.hpp"
+#include "unique_ptr.hpp"
+#include <gtest/gtest.h>
+#include <ranges>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace MySTL;
+
+namespace {
+
+auto answer() -> task<int> { co_return 42; }
+
+auto add(int a, int b) -> task<int> { co_return co_await answer() + a + b; }
+
+auto chain(int depth) -> task<int> {
+  if (depth == 0) {
+    co_return 0;
+  }
+  co_return co_await chain(depth - 1) + 1;
+}
+
+auto boom() -> task<int> {
+  throw std::runtime_error("boom");
+  co_return 0;
+}
+
+auto iota(int n) -> generator<int> {
+  for (int i = 0; i < n; ++i) {
+    co_yield i;
+  }
+}
+
+// 统计经过的帧分配与释放；帧内保存的是分配器的拷贝，计数放在分配器之外
+struct FrameCounts {
+  int allocs = 0;
+  int deallocs = 0;
+  // 仍然存活的分配器对象，释放帧时检查用的不是已析构的那个
+  std::set<void const *> live;
+};
+
+struct CountingFrameAllocator {
+  FrameCounts *counts;
+
+  explicit CountingFrameAllocator(FrameCounts &c) : counts(&c) {
+    counts->live.insert(this);
+  }
+
+  CountingFrameAllocator(CountingFrameAllocator const &other)
+      : counts(other.counts) {
+    counts->live.insert(this);
+  }
+
+  ~CountingFrameAllocator() { counts->live.erase(this); }
+
+  auto allocate(std::size_t n, std::size_t) -> void * {
+    ++counts->allocs;
+    return ::operator new(n);
+  }
+
+  void deallocate(void *p, std::size_t, std::size_t) noexcept {
+    EXPECT_TRUE(counts->live.contains(this));
+    ++counts->deallocs;
+    ::operator delete(p);
+  }
+};
+
+auto counted(std::allocator_arg_t, CountingFrameAllocator &, int v)
+    -> task<int> {
+  co_return v;
+}
+
+// 按值接收分配器：实参在调用表达式结束时就已析构
+auto countedByValue(std::allocator_arg_t, CountingFrameAllocator, int v)
+    -> task<int> {
+  co_return v;
+}
+
+} // namespace
+
+TEST(TaskTest, LazyStart) {
+  bool started = false;
+  // 带捕获的lambda协程通过this访问捕获，lambda要活到协程结束
+  auto body = [&]() -> task<void> {
+    started = true;
+    co_return;
+  };
+  auto t = body();
+  EXPECT_FALSE(started);
+  sync_wait(std::move(t));
+  EXPECT_TRUE(started);
+}
+
+TEST(TaskTest, NestedAwait) { EXPECT_EQ(sync_wait(add(1, 2)), 45); }
+
+TEST(TaskTest, DeepChain) { EXPECT_EQ(sync_wait(chain(1000)), 1000); }
+
+TEST(TaskTest, ExceptionPropagates) {
+  auto outer = []() -> task<std::string> {
+    try {
+      co_await boom();
+    } catch (std::runtime_error const &e) {
+      co_return e.what();
+    }
+    co_return "";
+  };
+  EXPECT_EQ(sync_wait(outer()), "boom");
+  EXPECT_THROW(sync_wait(boom()), std::runtime_error);
+}
+
+TEST(TaskTest, MoveOnlyAndReferenceResults) {
+  auto make = []() -> task<unique_ptr<int>> { co_return make_unique<int>(7); };
+  EXPECT_EQ(*sync_wait(make()), 7);
+
+  int x = 1;
+  auto ref = [](int &r) -> task<int &> { co_return r; };
+  sync_wait(ref(x)) = 5;
+  EXPECT_EQ(x, 5);
+}
+
+// 未被等待就析构的task销毁其帧
+TEST(TaskTest, DestroyWithoutAwait) {
+  auto p = std::make_shared<int>(0);
+  {
+    auto t = [](std::shared_ptr<int> q) -> task<int> { co_return *q; }(p);
+    EXPECT_EQ(p.use_count(), 2);
+  }
+  EXPECT_EQ(p.use_count(), 1);
+}
+
+TEST(TaskTest, ResumeOnExecutor) {
+  static_assert(executor<thread_pool>);
+  thread_pool pool(2);
+  auto const caller = std::this_thread::get_id();
+  auto t = [&]() -> task<int> {
+    co_await resume_on(pool);
+    EXPECT_NE(std::this_thread::get_id(), caller);
+    co_return co_await add(0, 0);
+  };
+  EXPECT_EQ(sync_wait(t()), 42);
+}
+
+TEST(TaskTest, CustomFrameAllocator) {
+  FrameCounts counts;
+  CountingFrameAllocator alloc(counts);
+  EXPECT_EQ(sync_wait(counted(std::allocator_arg, alloc, 3)), 3);
+  EXPECT_EQ(counts.allocs, 1);
+  EXPECT_EQ(counts.deallocs, 1);
+
+  // 分配区没有deallocate，帧随分配区释放
+  monotonic_arena arena;
+  auto in_arena = [](std::allocator_arg_t, monotonic_arena &) -> task<int> {
+    co_return 9;
+  };
+  EXPECT_EQ(sync_wait(in_arena(std::allocator_arg, arena)), 9);
+  EXPECT_EQ(arena.block_count(), 1u);
+}
+
+// 帧由分配器在帧内的拷贝释放，而不是早已析构的按值参数
+TEST(TaskTest, ByValueFrameAllocator) {
+  FrameCounts counts;
+  auto t = countedByValue(std::allocator_arg, CountingFrameAllocator(counts), 5);
+  EXPECT_EQ(counts.allocs, 1);
+  EXPECT_EQ(counts.live.size(), 2u);
+  EXPECT_EQ(sync_wait(std::move(t)), 5);
+  EXPECT_EQ(counts.deallocs, 1);
+  EXPECT_TRUE(counts.live.empty());
+}
+
+TEST(GeneratorTest, RangeFor) {
+  static_assert(std::ranges::input_range<generator<int>>);
+  std::vector<int> out;
+  for (int v : iota(5)) {
+    out.push_back(v);
+  }
+  EXPECT_EQ(out, (std::vector<int>{0, 1, 2, 3, 4}));
+}
+
+TEST(GeneratorTest, RangesAdaptors) {
+  int sum = 0;
+  for (int v : iota(10) | std::views::filter([](int v) { return v % 2; })) {
+    sum += v;
+  }
+  EXPECT_EQ(sum, 25);
+}
+
+TEST(GeneratorTest, MoveOnlyValues) {
+  auto gen = []() -> generator<unique_ptr<int>> {
+    for (int i = 0; i < 3; ++i) {
+      co_yield make_unique<int>(i);
+    }
+  };
+  int i = 0;
+  for (auto p : gen()) {
+    EXPECT_EQ(*p, i++);
+  }
+  EXPECT_EQ(i, 3);
+}
+
+// 以右值产出时，左值被复制，生成器中的原值不受影响
+TEST(GeneratorTest, LvalueYieldIsCopied) {
+  auto gen = []() -> generator<std::string> {
+    std::string s = "keep";
+    co_yield s;
+    co_yield s;
+  };
+  std::vector<std::string> out;
+  for (auto &&v : gen()) {
+    out.push_back(std::move(v));
+  }
+  EXPECT_EQ(out, (std::vector<std::string>{"keep", "keep"}));
+}
+
+TEST(GeneratorTest, ReferenceYield) {
+  std::vector<int> data{1, 2, 3};
+  auto refs = [](std::vector<int> &v) -> generator<int &> {
+    for (int &x : v) {
+      co_yield x;
+    }
+  };
+  for (int &x : refs(data)) {
+    x *= 10;
+  }
+  EXPECT_EQ(data, (std::vector<int>{10, 20, 30}));
+}
+
+TEST(GeneratorTest, ExceptionFromBody) {
+  auto gen = []() -> generator<int> {
+    co_yield 1;
+    throw std::runtime_error("stop");
+  };
+  auto g = gen();
+  auto it = g.begin();
+  EXPECT_EQ(*it, 1);
+  EXPECT_THROW(++it, std::runtime_error);
+}
+
+// 提前停止迭代时帧中的局部对象被析构
+TEST(GeneratorTest, EarlyDestroyRunsDestructors) {
+  auto p = std::make_shared<int>(0);
+  {
+    auto gen = [](std::shared_ptr<int> q) -> generator<int> {
+      while (true) {
+        co_yield *q;
+      }
+    }(p);
+    auto it = gen.begin();
+    EXPECT_EQ(*it, 0);
+    EXPECT_EQ(p.use_count(), 2);
+  }
+  EXPECT_EQ(p.use_count(), 1);
+}
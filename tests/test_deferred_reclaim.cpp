@@ -0,0 +1,146 @@
+#include "deferred_reclaim.hpp"
+#include "unique_ptr.hpp"
+#include <atomic>
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+
+using namespace MySTL;
+
+namespace {
+
+// 记录析构发生在哪个线程
+struct Tracked {
+  static inline std::atomic<int> alive{0};
+  static inline std::atomic<std::thread::id> last_thread{};
+  int value;
+
+  explicit Tracked(int v) : value(v) { ++alive; }
+  ~Tracked() {
+    last_thread = std::this_thread::get_id();
+    --alive;
+  }
+};
+
+// 析构时释放另一个推迟析构的对象
+struct Chained {
+  shared_ptr<Tracked> next;
+};
+
+} // namespace
+
+TEST(DeferredReclaimTest, BackgroundThreadDestroys) {
+  Tracked::alive = 0;
+  deferred_reclaimer reclaimer(1);
+  shared_ptr<Tracked> p(new Tracked(1), deferred_deleter<Tracked>(reclaimer));
+  auto q = p;
+  p.reset();
+  q.reset();
+  reclaimer.drain();
+  EXPECT_EQ(Tracked::alive, 0);
+  EXPECT_NE(Tracked::last_thread.load(), std::this_thread::get_id());
+  auto const s = reclaimer.stats();
+  EXPECT_EQ(s.handed_off, 1u);
+  EXPECT_EQ(s.reclaimed, 1u);
+  EXPECT_EQ(s.queued, 0u);
+  EXPECT_GE(s.max_queued, 1u);
+}
+
+// 单次分配布局：对象在回收器析构之前，弱引用已经观察到过期
+TEST(DeferredReclaimTest, FusedLayout) {
+  Tracked::alive = 0;
+  deferred_reclaimer reclaimer(8, deferred_mode::caller);
+  auto p = make_shared_deferred<Tracked>(reclaimer, 2);
+  weak_ptr<Tracked> w = p;
+  EXPECT_EQ(p.use_count(), 1);
+  p.reset();
+  EXPECT_TRUE(w.expired());
+  EXPECT_FALSE(w.lock());
+  EXPECT_EQ(Tracked::alive, 1);
+  EXPECT_EQ(reclaimer.pending(), 1u);
+  reclaimer.flush();
+  EXPECT_EQ(Tracked::alive, 0);
+  EXPECT_EQ(Tracked::last_thread.load(), std::this_thread::get_id());
+  w.reset();
+}
+
+// caller模式攒满一批后在本线程一次析构
+TEST(DeferredReclaimTest, CallerModeBatches) {
+  Tracked::alive = 0;
+  deferred_reclaimer reclaimer(4, deferred_mode::caller);
+  std::vector<shared_ptr<Tracked>> v;
+  for (int i = 0; i < 4; ++i) {
+    v.emplace_back(new Tracked(i), deferred_deleter<Tracked>(reclaimer));
+  }
+  for (int i = 0; i < 3; ++i) {
+    v.pop_back();
+  }
+  EXPECT_EQ(Tracked::alive, 4);
+  EXPECT_EQ(reclaimer.pending(), 3u);
+  v.pop_back();
+  EXPECT_EQ(Tracked::alive, 0);
+  EXPECT_EQ(reclaimer.pending(), 0u);
+  EXPECT_EQ(reclaimer.stats().reclaimed, 4u);
+}
+
+// 不指定回收器时使用default_deferred_reclaimer
+TEST(DeferredReclaimTest, UniquePtrUsesDefaultReclaimer) {
+  Tracked::alive = 0;
+  { unique_ptr<Tracked, deferred_deleter<Tracked>> u(new Tracked(3)); }
+  default_deferred_reclaimer().drain();
+  EXPECT_EQ(Tracked::alive, 0);
+}
+
+TEST(DeferredReclaimTest, StatefulDeleter) {
+  Tracked::alive = 0;
+  int calls = 0;
+  auto counting = [&calls](Tracked *p) {
+    ++calls;
+    delete p;
+  };
+  deferred_reclaimer reclaimer(16, deferred_mode::caller);
+  {
+    shared_ptr<Tracked> s(new Tracked(4),
+                          deferred_deleter<Tracked, decltype(counting)>(
+                              reclaimer, counting));
+  }
+  EXPECT_EQ(Tracked::alive, 1);
+  reclaimer.drain();
+  EXPECT_EQ(Tracked::alive, 0);
+  EXPECT_EQ(calls, 1);
+}
+
+// 析构中再次推迟的对象也在drain返回前析构
+TEST(DeferredReclaimTest, DrainCoversNestedDeferrals) {
+  Tracked::alive = 0;
+  deferred_reclaimer reclaimer;
+  {
+    auto inner = make_shared_deferred<Tracked>(reclaimer, 5);
+    auto outer = make_shared_deferred<Chained>(reclaimer, std::move(inner));
+  }
+  reclaimer.drain();
+  EXPECT_EQ(Tracked::alive, 0);
+  EXPECT_EQ(reclaimer.stats().reclaimed, 2u);
+}
+
+// 线程退出时未交出的对象由回收器析构时处理
+TEST(DeferredReclaimTest, DestructorReclaimsAbandonedBatches) {
+  Tracked::alive = 0;
+  {
+    deferred_reclaimer reclaimer(64);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+      threads.emplace_back([&] {
+        for (int i = 0; i < 100; ++i) {
+          auto p = make_shared_deferred<Tracked>(reclaimer, i);
+          auto q = p;
+          weak_ptr<Tracked> w = q;
+        }
+      });
+    }
+    for (auto &t : threads) {
+      t.join();
+    }
+  }
+  EXPECT_EQ(Tracked::alive, 0);
+}
@@ -0,0 +1,190 @@
+#include "expected.hpp"
+#include "unique_ptr.hpp"
+#include <gtest/gtest.h>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <vector>
+
+using namespace MySTL;
+
+namespace {
+
+enum class parse_error { empty, not_a_digit, overflow };
+
+// 不抛异常的解析，错误经由返回值传出
+constexpr auto parse_digit(char c) -> expected<int, parse_error> {
+  if (c < '0' || c > '9') {
+    return unexpected(parse_error::not_a_digit);
+  }
+  return c - '0';
+}
+
+constexpr auto parse_uint(std::string_view s) -> expected<unsigned, parse_error> {
+  if (s.empty()) {
+    return unexpected(parse_error::empty);
+  }
+  unsigned v = 0;
+  for (char c : s) {
+    auto d = parse_digit(c);
+    if (!d) {
+      return unexpected(d.error());
+    }
+    if (v > (~0u - *d) / 10) {
+      return unexpected(parse_error::overflow);
+    }
+    v = v * 10 + *d;
+  }
+  return v;
+}
+
+// 统计构造与析构，检查状态切换时对象的生存期
+struct Tracked {
+  static inline int alive = 0;
+  int v;
+
+  explicit Tracked(int x) noexcept : v(x) { ++alive; }
+  Tracked(Tracked const &that) : v(that.v) { ++alive; }
+  Tracked(Tracked &&that) noexcept : v(that.v) { ++alive; }
+  auto operator=(Tracked const &) -> Tracked & = default;
+  auto operator=(Tracked &&) -> Tracked & = default;
+  ~Tracked() { --alive; }
+};
+
+} // namespace
+
+// 两者都可平凡拷贝时expected也可平凡拷贝
+TEST(ExpectedTest, ConditionallyTrivial) {
+  static_assert(std::is_trivially_copyable_v<expected<int, parse_error>>);
+  static_assert(std::is_trivially_destructible_v<expected<int, parse_error>>);
+  static_assert(std::is_trivially_copyable_v<expected<void, int>>);
+  static_assert(!std::is_trivially_copyable_v<expected<std::string, int>>);
+  static_assert(!std::is_copy_constructible_v<expected<unique_ptr<int>, int>>);
+  static_assert(std::is_nothrow_move_constructible_v<
+                expected<unique_ptr<int>, std::string>>);
+  static_assert(sizeof(expected<int, parse_error>) == 2 * sizeof(int));
+}
+
+TEST(ExpectedTest, Constexpr) {
+  static_assert(*parse_uint("1234") == 1234u);
+  static_assert(parse_uint("12a").error() == parse_error::not_a_digit);
+  static_assert(parse_uint("99999999999") == unexpected(parse_error::overflow));
+}
+
+TEST(ExpectedTest, ValueAndError) {
+  expected<std::string, int> e("abc");
+  EXPECT_TRUE(e.has_value());
+  EXPECT_EQ(*e, "abc");
+  EXPECT_EQ(e->size(), 3u);
+  EXPECT_EQ(e.error_or(-1), -1);
+
+  expected<std::string, int> bad(unexpect, 7);
+  EXPECT_FALSE(bad);
+  EXPECT_EQ(bad.error(), 7);
+  EXPECT_EQ(bad.value_or("x"), "x");
+  EXPECT_THROW(bad.value(), bad_expected_access<int>);
+  try {
+    bad.value();
+  } catch (bad_expected_access<int> const &ex) {
+    EXPECT_EQ(ex.error(), 7);
+  }
+}
+
+TEST(ExpectedTest, AssignSwitchesState) {
+  Tracked::alive = 0;
+  {
+    expected<Tracked, std::string> e(in_place, 1);
+    EXPECT_EQ(Tracked::alive, 1);
+    e = unexpected(std::string("err"));
+    EXPECT_EQ(Tracked::alive, 0);
+    EXPECT_EQ(e.error(), "err");
+    e = Tracked(2);
+    EXPECT_EQ(Tracked::alive, 1);
+    EXPECT_EQ(e->v, 2);
+
+    expected<Tracked, std::string> other(unexpect, "other");
+    e.swap(other);
+    EXPECT_EQ(e.error(), "other");
+    EXPECT_EQ(other->v, 2);
+    EXPECT_EQ(Tracked::alive, 1);
+
+    e = other;
+    EXPECT_EQ(Tracked::alive, 2);
+    EXPECT_EQ(e.emplace(5).v, 5);
+    EXPECT_EQ(Tracked::alive, 2);
+  }
+  EXPECT_EQ(Tracked::alive, 0);
+}
+
+TEST(ExpectedTest, MoveOnly) {
+  expected<unique_ptr<int>, parse_error> e(make_unique<int>(3));
+  auto moved = std::move(e);
+  EXPECT_EQ(**moved, 3);
+  auto p = std::move(moved).value();
+  EXPECT_EQ(*p, 3);
+}
+
+TEST(ExpectedTest, Monadic) {
+  auto doubled = parse_uint("21").transform([](unsigned v) { return v * 2; });
+  EXPECT_EQ(*doubled, 42u);
+
+  auto chained = parse_uint("5").and_then(
+      [](unsigned v) -> expected<unsigned, parse_error> {
+        if (v > 3) {
+          return unexpected(parse_error::overflow);
+        }
+        return v;
+      });
+  EXPECT_EQ(chained.error(), parse_error::overflow);
+
+  auto recovered = parse_uint("").or_else(
+      [](parse_error) -> expected<unsigned, parse_error> { return 0u; });
+  EXPECT_EQ(*recovered, 0u);
+
+  auto as_code = parse_uint("x").transform_error(
+      [](parse_error e) { return static_cast<int>(e); });
+  static_assert(std::is_same_v<decltype(as_code), expected<unsigned, int>>);
+  EXPECT_EQ(as_code.error(), 1);
+
+  // 出错后的transform不调用函数
+  bool called = false;
+  auto skipped = parse_uint("").transform([&](unsigned) {
+    called = true;
+    return 0;
+  });
+  EXPECT_FALSE(called);
+  EXPECT_EQ(skipped.error(), parse_error::empty);
+
+  // 移走值时按右值传给函数
+  expected<unique_ptr<int>, int> owned(make_unique<int>(8));
+  auto taken = std::move(owned).transform([](unique_ptr<int> &&p) {
+    return *std::move(p);
+  });
+  EXPECT_EQ(*taken, 8);
+}
+
+TEST(ExpectedVoidTest, Basics) {
+  expected<void, std::string> ok;
+  EXPECT_TRUE(ok);
+  ok.value();
+  expected<void, std::string> bad = unexpected(std::string("no"));
+  EXPECT_EQ(bad.error(), "no");
+  EXPECT_THROW(bad.value(), bad_expected_access<std::string>);
+  EXPECT_EQ(bad.error_or("fine"), "no");
+
+  auto n = ok.transform([] { return 3; });
+  EXPECT_EQ(*n, 3);
+  auto size = bad.transform_error([](std::string const &s) { return s.size(); });
+  EXPECT_EQ(size.error(), 2u);
+  auto fixed = bad.or_else(
+      [](std::string const &) -> expected<void, std::string> { return {}; });
+  EXPECT_TRUE(fixed);
+
+  bad = ok;
+  EXPECT_TRUE(bad);
+  bad = unexpected(std::string("again"));
+  swap(ok, bad);
+  EXPECT_FALSE(ok);
+  EXPECT_TRUE(bad);
+  EXPECT_EQ(ok, unexpected(std::string("again")));
+}
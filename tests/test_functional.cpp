@@ -1,8 +1,28 @@
 #include "functional.hpp"
+#include <array>
+#include <cstdlib>
 #include <gtest/gtest.h>
+#include <new>
+#include <stdexcept>
+#include <string>
 
 using namespace MySTL;
 
+// 统计全局 operator new 的调用次数，用于验证小对象优化
+static std::size_t g_alloc_count = 0;
+
+void *operator new(std::size_t __size) {
+  ++g_alloc_count;
+  if (void *__p = std::malloc(__size ? __size : 1)) {
+    return __p;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void *__p) noexcept { std::free(__p); }
+
+void operator delete(void *__p, std::size_t) noexcept { std::free(__p); }
+
 // 测试 MySTL::function
 TEST(FunctionTest, EmptyFunction) {
   function<void()> f;
@@ -36,6 +56,13 @@ TEST(FunctionTest, MoveFunction) {
   EXPECT_EQ(x, 200);
 }
 
+TEST(FunctionTest, DiscardReturnValue) {
+  int x = 0;
+  function<void()> f = [&x]() { return ++x; };
+  f();
+  EXPECT_EQ(x, 1);
+}
+
 TEST(FunctionTest, SwapFunction) {
   function<void()> f1 = []() {};
   function<void()> f2 = []() {};
@@ -44,6 +71,75 @@ TEST(FunctionTest, SwapFunction) {
   EXPECT_TRUE(f2);
 }
 
+TEST(FunctionTest, SmallCallableStaysInline) {
+  int x = 0;
+  int *p = &x;
+  std::size_t const before = g_alloc_count;
+  function<void()> f1 = [p]() { ++*p; };
+  function<void()> f2 = f1;
+  function<void()> f3 = std::move(f2);
+  f1.swap(f3);
+  f1();
+  f3();
+  EXPECT_EQ(g_alloc_count, before);
+  EXPECT_EQ(x, 2);
+}
+
+TEST(FunctionTest, LargeCallableUsesHeap) {
+  std::array<long, 16> arr{};
+  arr[15] = 7;
+  std::size_t const before = g_alloc_count;
+  function<long()> f1 = [arr]() { return arr[15]; };
+  EXPECT_EQ(g_alloc_count, before + 1);
+  function<long()> f2 = f1;
+  EXPECT_EQ(g_alloc_count, before + 2);
+  function<long()> f3 = std::move(f2); // 堆上对象移动只转移指针
+  EXPECT_EQ(g_alloc_count, before + 2);
+  EXPECT_FALSE(f2);
+  EXPECT_EQ(f3(), 7);
+}
+
+TEST(FunctionTest, TargetForBothStorageKinds) {
+  auto small = [](int x) { return x + 1; };
+  std::array<int, 32> arr{};
+  auto large = [arr](int x) { return x + arr[0]; };
+  function<int(int)> f1 = small;
+  function<int(int)> f2 = large;
+  EXPECT_EQ(f1.target_type(), typeid(small));
+  EXPECT_EQ(f2.target_type(), typeid(large));
+  EXPECT_NE(f1.target<decltype(small)>(), nullptr);
+  EXPECT_NE(f2.target<decltype(large)>(), nullptr);
+  EXPECT_EQ(f1.target<decltype(large)>(), nullptr);
+  EXPECT_EQ(function<int(int)>().target_type(), typeid(void));
+}
+
+TEST(FunctionTest, SwapMixedStorage) {
+  std::array<int, 32> arr{};
+  arr[0] = 5;
+  function<int()> f1 = []() { return 1; };
+  function<int()> f2 = [arr]() { return arr[0]; };
+  function<int()> f3;
+  f1.swap(f2);
+  EXPECT_EQ(f1(), 5);
+  EXPECT_EQ(f2(), 1);
+  f2.swap(f3);
+  EXPECT_FALSE(f2);
+  EXPECT_EQ(f3(), 1);
+}
+
+TEST(FunctionTest, ThrowingMoveUsesHeap) {
+  struct ThrowingMove {
+    ThrowingMove() = default;
+    ThrowingMove(ThrowingMove const &) {}
+    ThrowingMove(ThrowingMove &&) noexcept(false) {}
+    int operator()() const { return 3; }
+  };
+  std::size_t const before = g_alloc_count;
+  function<int()> f = ThrowingMove{};
+  EXPECT_EQ(g_alloc_count, before + 1);
+  EXPECT_EQ(f(), 3);
+}
+
 // 测试 MySTL::move_only_function
 TEST(MoveOnlyFunctionTest, EmptyFunction) {
   move_only_function<void()> f;
@@ -78,6 +174,16 @@ TEST(MoveOnlyFunctionTest, InPlaceConstruction) {
   EXPECT_EQ(x, 300);
 }
 
+TEST(MoveOnlyFunctionTest, MoveOnlyCaptureStaysInline) {
+  auto p = std::make_unique<int>(7);
+  std::size_t const before = g_alloc_count;
+  move_only_function<int()> f1 = [p = std::move(p)]() { return *p; };
+  move_only_function<int()> f2 = std::move(f1);
+  EXPECT_EQ(g_alloc_count, before);
+  EXPECT_FALSE(f1);
+  EXPECT_EQ(f2(), 7);
+}
+
 TEST(MoveOnlyFunctionTest, SwapFunction) {
   move_only_function<void()> f1 = []() {};
   move_only_function<void()> f2 = []() {};
@@ -86,6 +192,129 @@ TEST(MoveOnlyFunctionTest, SwapFunction) {
   EXPECT_TRUE(f2);
 }
 
+// 测试 MySTL::function_ref
+static int twice(int x) { return x * 2; }
+
+static int apply(function_ref<int(int)> f, int x) { return f(x); }
+
+TEST(FunctionRefTest, Layout) {
+  static_assert(sizeof(function_ref<int(int)>) == 2 * sizeof(void *));
+  static_assert(std::is_trivially_copyable_v<function_ref<int(int)>>);
+}
+
+TEST(FunctionRefTest, FromLambdaAndFunctionPointer) {
+  int k = 3;
+  auto add_k = [&k](int x) { return x + k; };
+  std::size_t const before = g_alloc_count;
+  EXPECT_EQ(apply(add_k, 1), 4);
+  EXPECT_EQ(apply([](int x) { return x - 1; }, 1), 0);
+  EXPECT_EQ(apply(twice, 5), 10);
+  EXPECT_EQ(apply(&twice, 6), 12);
+  EXPECT_EQ(g_alloc_count, before);
+}
+
+TEST(FunctionRefTest, RefersToOriginalObject) {
+  int count = 0;
+  auto counter = [count]() mutable { return ++count; };
+  function_ref<int()> r1 = counter;
+  function_ref<int()> r2 = r1;
+  r1();
+  EXPECT_EQ(r2(), 2);
+  EXPECT_EQ(counter(), 3);
+}
+
+TEST(FunctionRefTest, FromMySTLFunctions) {
+  function<int(int)> f = [](int x) { return x + 10; };
+  move_only_function<int(int)> mf = [](int x) { return x + 20; };
+  std::size_t const before = g_alloc_count;
+  EXPECT_EQ(apply(f, 1), 11);
+  EXPECT_EQ(apply(mf, 1), 21);
+  EXPECT_EQ(g_alloc_count, before);
+}
+
+// 测试 MySTL::inplace_function
+TEST(InplaceFunctionTest, NeverAllocates) {
+  int x = 0;
+  std::size_t const before = g_alloc_count;
+  inplace_function<void(), 32> f1 = [&x]() { ++x; };
+  inplace_function<void(), 32> f2 = f1;
+  inplace_function<void(), 32> f3 = std::move(f1);
+  f2.swap(f3);
+  f2();
+  f3();
+  EXPECT_EQ(g_alloc_count, before);
+  EXPECT_EQ(x, 2);
+}
+
+TEST(InplaceFunctionTest, RejectsOversizedCallable) {
+  auto small = [p = (int *)nullptr]() { return p; };
+  auto large = [arr = std::array<char, 64>{}]() { return arr[0]; };
+  static_assert(
+      std::is_constructible_v<inplace_function<int *(), 16>, decltype(small)>);
+  static_assert(
+      !std::is_constructible_v<inplace_function<char(), 16>, decltype(large)>);
+  static_assert(
+      std::is_constructible_v<inplace_function<char(), 64>, decltype(large)>);
+  static_assert(sizeof(inplace_function<void(), 64>) >= 64);
+}
+
+// 缓冲区按对齐补齐到24字节，容量仍是声明的20字节
+TEST(InplaceFunctionTest, CapacityBoundary) {
+  auto fits = [arr = std::array<char, 20>{}]() { return arr[0]; };
+  auto over = [arr = std::array<char, 21>{}]() { return arr[0]; };
+  using padded = inplace_function<char(), 20, 8>;
+  static_assert(padded::capacity == 20);
+  static_assert(std::is_constructible_v<padded, decltype(fits)>);
+  static_assert(!std::is_constructible_v<padded, decltype(over)>);
+  static_assert(std::is_constructible_v<inplace_function<char(), 24, 8>,
+                                        decltype(over)>);
+}
+
+TEST(InplaceFunctionTest, NonTrivialCallable) {
+  std::string s = "a string that is long enough to live on the heap";
+  auto size_of_s = [s]() { return s.size(); };
+  inplace_function<std::size_t(), 64> f1 = size_of_s;
+  inplace_function<std::size_t(), 64> f2 = f1;
+  inplace_function<std::size_t(), 64> f3 = std::move(f1);
+  EXPECT_FALSE(f1);
+  EXPECT_EQ(f2(), s.size());
+  EXPECT_EQ(f3(), s.size());
+  EXPECT_EQ(f3.target_type(), typeid(size_of_s));
+  EXPECT_NE(f3.target<decltype(size_of_s)>(), nullptr);
+}
+
+TEST(InplaceFunctionTest, EmptyFunction) {
+  inplace_function<void()> f;
+  EXPECT_FALSE(f);
+  EXPECT_THROW(f(), std::bad_function_call);
+}
+
+// 空对象的try_invoke返回错误而不是抛出bad_function_call
+TEST(TryInvokeTest, AllFunctionWrappers) {
+  function<int(int)> f = [](int x) { return x + 1; };
+  EXPECT_EQ(*f.try_invoke(1), 2);
+  f = nullptr;
+  EXPECT_EQ(f.try_invoke(1).error(), call_errc::empty);
+
+  move_only_function<void()> m;
+  EXPECT_EQ(m.try_invoke(), unexpected(call_errc::empty));
+  int calls = 0;
+  m = [&calls] { ++calls; };
+  EXPECT_TRUE(m.try_invoke().has_value());
+  EXPECT_EQ(calls, 1);
+
+  inplace_function<std::string()> i;
+  EXPECT_FALSE(i.try_invoke());
+  i = [] { return std::string("ok"); };
+  EXPECT_EQ(i.try_invoke().value_or("empty"), "ok");
+}
+
+// 被调用对象自己抛出的异常不被吞掉
+TEST(TryInvokeTest, CalleeExceptionPropagates) {
+  function<int()> f = []() -> int { throw std::runtime_error("x"); };
+  EXPECT_THROW(f.try_invoke(), std::runtime_error);
+}
+
 int main(int argc, char **argv) {
   ::testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();
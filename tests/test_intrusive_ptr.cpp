@@ -0,0 +1,134 @@
+#include "intrusive_ptr.hpp"
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+using namespace MySTL;
+
+struct Node : intrusive_ref_counter<Node> {
+  static inline int destroyed = 0;
+  int value;
+  intrusive_ptr<Node> next;
+  explicit Node(int v) : value(v) {}
+  ~Node() { ++destroyed; }
+};
+
+struct Derived : Node {
+  explicit Derived(int v) : Node(v) {}
+};
+
+struct LocalNode : intrusive_ref_counter<LocalNode, thread_unsafe_counter> {
+  int value = 0;
+};
+
+static_assert(sizeof(intrusive_ptr<Node>) == sizeof(void *));
+
+// 测试基本的计数与析构
+TEST(IntrusivePtrTest, Basic) {
+  Node::destroyed = 0;
+  {
+    auto p = make_intrusive<Node>(1);
+    EXPECT_EQ(p->use_count(), 1u);
+    auto q = p;
+    EXPECT_EQ(p->use_count(), 2u);
+    EXPECT_EQ(q, p);
+    auto r = std::move(q);
+    EXPECT_EQ(q, nullptr);
+    EXPECT_EQ(p->use_count(), 2u);
+  }
+  EXPECT_EQ(Node::destroyed, 1);
+}
+
+// 测试接管与不接管已有引用
+TEST(IntrusivePtrTest, AdoptAndDetach) {
+  Node::destroyed = 0;
+  auto p = make_intrusive<Node>(2);
+  Node *raw = p.detach();
+  EXPECT_EQ(p.get(), nullptr);
+  EXPECT_EQ(raw->use_count(), 1u);
+  {
+    intrusive_ptr<Node> adopted(raw, false);
+    EXPECT_EQ(raw->use_count(), 1u);
+    intrusive_ptr<Node> shared(raw);
+    EXPECT_EQ(raw->use_count(), 2u);
+  }
+  EXPECT_EQ(Node::destroyed, 1);
+}
+
+// 测试从 unique_ptr 接管
+TEST(IntrusivePtrTest, FromUniquePtr) {
+  Node::destroyed = 0;
+  auto u = make_unique<Node>(3);
+  intrusive_ptr<Node> p(std::move(u));
+  EXPECT_EQ(u.get(), nullptr);
+  EXPECT_EQ(p->use_count(), 1u);
+  EXPECT_EQ(p->value, 3);
+  p.reset();
+  EXPECT_EQ(Node::destroyed, 1);
+}
+
+// 测试派生类转换与类型转换
+TEST(IntrusivePtrTest, Conversions) {
+  intrusive_ptr<Derived> d = make_intrusive<Derived>(4);
+  intrusive_ptr<Node> base = d;
+  EXPECT_EQ(d->use_count(), 2u);
+  auto back = static_pointer_cast<Derived>(base);
+  EXPECT_EQ(back.get(), d.get());
+  EXPECT_EQ(d->use_count(), 3u);
+}
+
+// 拷贝对象不拷贝计数
+TEST(IntrusivePtrTest, CopyingObjectResetsCount) {
+  auto p = make_intrusive<Node>(5);
+  Node copy(*p);
+  EXPECT_EQ(copy.use_count(), 0u);
+}
+
+// 非原子计数
+TEST(IntrusivePtrTest, ThreadUnsafeCounter) {
+  auto p = make_intrusive<LocalNode>();
+  auto q = p;
+  EXPECT_EQ(p->use_count(), 2u);
+  q.reset();
+  EXPECT_EQ(p->use_count(), 1u);
+}
+
+// 链表节点互相持有，释放头节点时逐个析构
+TEST(IntrusivePtrTest, Chain) {
+  Node::destroyed = 0;
+  {
+    auto head = make_intrusive<Node>(0);
+    auto cur = head;
+    for (int i = 1; i < 10; ++i) {
+      cur->next = make_intrusive<Node>(i);
+      cur = cur->next;
+    }
+    int sum = 0;
+    for (auto p = head; p; p = p->next) {
+      sum += p->value;
+    }
+    EXPECT_EQ(sum, 45);
+  }
+  EXPECT_EQ(Node::destroyed, 10);
+}
+
+// 多线程拷贝与释放同一个对象
+TEST(IntrusivePtrTest, ConcurrentCopyAndRelease) {
+  Node::destroyed = 0;
+  {
+    auto p = make_intrusive<Node>(6);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+      threads.emplace_back([p] {
+        for (int i = 0; i < 10000; ++i) {
+          auto copy = p;
+          EXPECT_EQ(copy->value, 6);
+        }
+      });
+    }
+    for (auto &t : threads) {
+      t.join();
+    }
+    EXPECT_EQ(p->use_count(), 1u);
+  }
+  EXPECT_EQ(Node::destroyed, 1);
+}
@@ -0,0 +1,82 @@
+#include "local_shared_ptr.hpp"
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+using namespace MySTL;
+
+// 测试默认构造函数
+TEST(LocalSharedPtrTest, DefaultConstructor) {
+  local_shared_ptr<int> sp;
+  EXPECT_EQ(sp.get(), nullptr);
+  EXPECT_EQ(sp.use_count(), 0);
+  EXPECT_FALSE(sp);
+}
+
+// 测试原始指针构造和拷贝
+TEST(LocalSharedPtrTest, CopyAndMove) {
+  local_shared_ptr<int> sp1(new int(42));
+  local_shared_ptr<int> sp2 = sp1;
+  EXPECT_EQ(sp1.use_count(), 2);
+  local_shared_ptr<int> sp3 = std::move(sp2);
+  EXPECT_EQ(sp2.get(), nullptr);
+  EXPECT_EQ(sp3.use_count(), 2);
+  sp3.reset();
+  EXPECT_TRUE(sp1.unique());
+  EXPECT_EQ(*sp1, 42);
+}
+
+// 测试 make_local_shared
+TEST(LocalSharedPtrTest, MakeLocalShared) {
+  auto sp = make_local_shared<std::string>("hello");
+  EXPECT_EQ(*sp, "hello");
+  EXPECT_EQ(sp->size(), 5u);
+  local_shared_ptr<std::string const> sp2 = sp;
+  EXPECT_EQ(sp.use_count(), 2);
+}
+
+// 测试自定义删除器
+TEST(LocalSharedPtrTest, CustomDeleter) {
+  int deleted = 0;
+  {
+    local_shared_ptr<int> sp(new int(1), [&deleted](int *p) {
+      ++deleted;
+      delete p;
+    });
+    auto sp2 = sp;
+  }
+  EXPECT_EQ(deleted, 1);
+}
+
+// 独占时转换为 shared_ptr 后可以交给其他线程
+TEST(LocalSharedPtrTest, ConvertToSharedPtr) {
+  auto local = make_local_shared<int>(7);
+  auto shared = static_cast<shared_ptr<int>>(std::move(local));
+  EXPECT_FALSE(local);
+  EXPECT_EQ(shared.use_count(), 1);
+  std::thread t([copy = shared] { EXPECT_EQ(*copy, 7); });
+  t.join();
+  EXPECT_EQ(shared.use_count(), 1);
+}
+
+// 非独占时拒绝转换
+TEST(LocalSharedPtrTest, ConvertRequiresUnique) {
+  auto local = make_local_shared<int>(7);
+  auto copy = local;
+  EXPECT_THROW(static_cast<shared_ptr<int>>(std::move(local)),
+               std::logic_error);
+  EXPECT_EQ(local.use_count(), 2);
+}
+
+struct Node : enable_shared_from_this<Node> {
+  auto self() { return shared_from_this(); }
+};
+
+// 转换时才设置 enable_shared_from_this
+TEST(LocalSharedPtrTest, ConvertSetsUpSharedFromThis) {
+  auto local = make_local_shared<Node>();
+  EXPECT_THROW(local->self(), std::bad_weak_ptr);
+  auto shared = static_cast<shared_ptr<Node>>(std::move(local));
+  EXPECT_EQ(shared->self(), shared);
+}
@@ -0,0 +1,105 @@
+#include "lockfree.hpp"
+#include <atomic>
+#include <gtest/gtest.h>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace MySTL;
+
+template <class _Container> struct LockFreeTest : testing::Test {};
+
+using Containers =
+    testing::Types<treiber_stack<int, epoch_domain>,
+                   treiber_stack<int, hazard_domain>,
+                   ms_queue<int, epoch_domain>, ms_queue<int, hazard_domain>>;
+TYPED_TEST_SUITE(LockFreeTest, Containers);
+
+TYPED_TEST(LockFreeTest, EmptyPop) {
+  TypeParam c;
+  EXPECT_FALSE(c.try_pop().has_value());
+}
+
+// 每个元素恰好被取出一次
+TYPED_TEST(LockFreeTest, ConcurrentPushPop) {
+  constexpr int kThreads = 4, kPerThread = 20000;
+  TypeParam c;
+  std::vector<std::atomic<int>> seen(kThreads * kPerThread);
+  std::atomic<int> popped{0};
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreads; ++t) {
+    threads.emplace_back([&, t] {
+      for (int i = 0; i < kPerThread; ++i) {
+        c.push(t * kPerThread + i);
+        if (auto v = c.try_pop()) {
+          ++seen[*v];
+          ++popped;
+        }
+      }
+    });
+  }
+  for (auto &th : threads) {
+    th.join();
+  }
+  while (auto v = c.try_pop()) {
+    ++seen[*v];
+    ++popped;
+  }
+  EXPECT_EQ(popped, kThreads * kPerThread);
+  for (auto &s : seen) {
+    EXPECT_EQ(s, 1);
+  }
+}
+
+TEST(TreiberStackTest, Lifo) {
+  treiber_stack<std::string> s;
+  s.push("a");
+  s.emplace(3, 'b');
+  EXPECT_FALSE(s.empty());
+  EXPECT_EQ(*s.try_pop(), "bbb");
+  EXPECT_EQ(*s.try_pop(), "a");
+  EXPECT_TRUE(s.empty());
+}
+
+// 析构时释放仍在容器中的元素
+TEST(MsQueueTest, FifoAndMoveOnly) {
+  ms_queue<std::unique_ptr<int>, hazard_domain> q;
+  for (int i = 0; i < 10; ++i) {
+    q.push(std::make_unique<int>(i));
+  }
+  for (int i = 0; i < 5; ++i) {
+    auto v = q.try_pop();
+    ASSERT_TRUE(v.has_value());
+    EXPECT_EQ(**v, i);
+  }
+}
+
+// 单个生产者的入队顺序在每个消费者看来保持不变
+TEST(MsQueueTest, PerProducerOrder) {
+  constexpr int kProducers = 2, kPerProducer = 20000;
+  ms_queue<int> q;
+  std::atomic<int> done{0};
+  std::vector<std::thread> threads;
+  for (int p = 0; p < kProducers; ++p) {
+    threads.emplace_back([&, p] {
+      for (int i = 0; i < kPerProducer; ++i) {
+        q.push(p * kPerProducer + i);
+      }
+      ++done;
+    });
+  }
+  std::vector<int> last(kProducers, -1);
+  int count = 0;
+  while (count < kProducers * kPerProducer) {
+    if (auto v = q.try_pop()) {
+      int const p = *v / kPerProducer;
+      EXPECT_GT(*v % kPerProducer, last[p]);
+      last[p] = *v % kPerProducer;
+      ++count;
+    }
+  }
+  for (auto &th : threads) {
+    th.join();
+  }
+}
@@ -1,5 +1,11 @@
 #include "optional.hpp"
+#include "functional.hpp"
+#include "shared_ptr.hpp"
+#include "unique_ptr.hpp"
+#include <cmath>
 #include <gtest/gtest.h>
+#include <memory>
+#include <stdexcept>
 #include <string>
 using namespace MySTL;
 
@@ -124,3 +130,240 @@ TEST(OptionalTest, OrElse) {
   EXPECT_TRUE(result.has_value());
   EXPECT_EQ(result.value(), 42);
 }
+
+// 平凡可拷贝的T使optional<T>同样平凡
+struct Point {
+  int x, y;
+};
+static_assert(std::is_trivially_copyable_v<optional<int>>);
+static_assert(std::is_trivially_copyable_v<optional<Point>>);
+static_assert(std::is_trivially_destructible_v<optional<int>>);
+static_assert(std::is_trivially_copy_assignable_v<optional<Point>>);
+static_assert(std::is_trivially_move_assignable_v<optional<Point>>);
+static_assert(!std::is_trivially_copyable_v<optional<std::string>>);
+static_assert(!std::is_trivially_destructible_v<optional<std::string>>);
+static_assert(std::is_copy_constructible_v<optional<std::string>>);
+static_assert(!std::is_copy_constructible_v<optional<std::unique_ptr<int>>>);
+static_assert(std::is_move_constructible_v<optional<std::unique_ptr<int>>>);
+static_assert(std::is_nothrow_move_constructible_v<optional<std::string>>);
+
+// 常量表达式中的构造、赋值与访问
+constexpr auto constexpr_sum() -> int {
+  optional<int> a(1);
+  optional<int> b;
+  b = a;
+  b.emplace(*b + 1);
+  optional<int> c = b;
+  c.reset();
+  return a.value() + b.value() + c.value_or(10);
+}
+static_assert(constexpr_sum() == 13);
+
+constexpr auto constexpr_swap() -> bool {
+  optional<Point> a(Point{1, 2});
+  optional<Point> b;
+  a.swap(b);
+  return !a.has_value() && b->y == 2;
+}
+static_assert(constexpr_swap());
+
+// 非平凡类型走用户定义的特殊成员函数
+TEST(OptionalTest, NonTrivialCopyAndMove) {
+  optional<std::string> a("hello");
+  optional<std::string> b = a;
+  EXPECT_EQ(*b, "hello");
+  optional<std::string> c;
+  c = std::move(a);
+  EXPECT_EQ(*c, "hello");
+  b = nullopt;
+  c = b;
+  EXPECT_FALSE(c.has_value());
+}
+
+TEST(OptionalTest, SwapEngagedWithEmpty) {
+  optional<std::string> a("x");
+  optional<std::string> b;
+  a.swap(b);
+  EXPECT_FALSE(a.has_value());
+  EXPECT_EQ(*b, "x");
+}
+
+// 用保留值作为空标记的 ID 类型
+struct UserId {
+  long long v;
+  constexpr auto operator==(UserId const &) const -> bool = default;
+};
+
+template <>
+struct MySTL::optional_niche<UserId>
+    : optional_niche_sentinel<UserId, UserId{-1}> {};
+
+template <> struct MySTL::optional_niche<float> : optional_niche_nan<float> {};
+
+static_assert(sizeof(optional<UserId>) == sizeof(UserId));
+static_assert(sizeof(optional<float>) == sizeof(float));
+static_assert(sizeof(optional<int &>) == sizeof(void *));
+static_assert(sizeof(optional<MySTL::unique_ptr<Point>>) == sizeof(void *));
+static_assert(sizeof(optional<MySTL::shared_ptr<Point>>) ==
+              sizeof(MySTL::shared_ptr<Point>));
+static_assert(sizeof(optional<MySTL::function<void()>>) ==
+              sizeof(MySTL::function<void()>));
+static_assert(std::is_trivially_copyable_v<optional<UserId>>);
+
+constexpr auto constexpr_niche() -> bool {
+  optional<UserId> id;
+  bool empty = !id.has_value();
+  id = UserId{7};
+  optional<UserId> copy = id;
+  copy.reset();
+  return empty && id->v == 7 && !copy.has_value();
+}
+static_assert(constexpr_niche());
+
+TEST(OptionalNicheTest, Sentinel) {
+  optional<UserId> id;
+  EXPECT_FALSE(id.has_value());
+  id.emplace(UserId{0});
+  EXPECT_TRUE(id.has_value());
+  EXPECT_EQ(id->v, 0);
+  EXPECT_EQ(id.value_or(UserId{5}).v, 0);
+  id = nullopt;
+  EXPECT_EQ(id.value_or(UserId{5}).v, 5);
+}
+
+// 计算产生的 NaN 仍然是有效值
+TEST(OptionalNicheTest, NaN) {
+  optional<float> f;
+  EXPECT_FALSE(f.has_value());
+  f = std::nanf("");
+  EXPECT_TRUE(f.has_value());
+  EXPECT_TRUE(std::isnan(*f));
+  f = 0.0f / 0.0f;
+  EXPECT_TRUE(f.has_value());
+  f.reset();
+  EXPECT_FALSE(f.has_value());
+}
+
+// 构造时先写入成员再抛出异常，存储里留下的不是空标记
+struct Slot {
+  int v;
+  constexpr explicit Slot(int x, bool fail = false) : v(x) {
+    if (fail) {
+      throw std::runtime_error("slot");
+    }
+  }
+  constexpr auto operator==(Slot const &) const -> bool = default;
+};
+
+template <>
+struct MySTL::optional_niche<Slot> : optional_niche_sentinel<Slot, Slot(-1)> {};
+
+static_assert(sizeof(optional<Slot>) == sizeof(Slot));
+
+// 构造抛出异常后 optional 为空，析构时不会析构未构造的值
+TEST(OptionalNicheTest, ThrowingConstructor) {
+  optional<Slot> s(Slot(1));
+  EXPECT_THROW(s.emplace(2, true), std::runtime_error);
+  EXPECT_FALSE(s.has_value());
+  s.emplace(3);
+  EXPECT_EQ(s->v, 3);
+
+  optional<Slot> t;
+  EXPECT_THROW(t.emplace(4, true), std::runtime_error);
+  EXPECT_FALSE(t.has_value());
+}
+
+// 持有空指针的 optional 仍然有值
+TEST(OptionalNicheTest, UniquePtr) {
+  optional<MySTL::unique_ptr<int>> p;
+  EXPECT_FALSE(p.has_value());
+  p.emplace(nullptr);
+  EXPECT_TRUE(p.has_value());
+  EXPECT_EQ(p->get(), nullptr);
+  p = MySTL::make_unique<int>(3);
+  EXPECT_EQ(**p, 3);
+  optional<MySTL::unique_ptr<int>> q = std::move(p);
+  EXPECT_EQ(**q, 3);
+  EXPECT_TRUE(p.has_value());
+  q.reset();
+  EXPECT_FALSE(q.has_value());
+}
+
+// 删除器不能默认构造时不使用空标记
+struct TaggedDeleter {
+  explicit TaggedDeleter(int) {}
+  void operator()(int *p) const { delete p; }
+};
+
+TEST(OptionalNicheTest, UniquePtrWithoutDefaultDeleter) {
+  using Ptr = MySTL::unique_ptr<int, TaggedDeleter>;
+  static_assert(sizeof(optional<Ptr>) > sizeof(Ptr));
+  static_assert(sizeof(optional<MySTL::unique_ptr<int>>) ==
+                sizeof(MySTL::unique_ptr<int>));
+  optional<Ptr> p;
+  EXPECT_FALSE(p.has_value());
+  p.reset();
+  EXPECT_FALSE(p.has_value());
+}
+
+TEST(OptionalNicheTest, SharedPtr) {
+  auto sp = MySTL::make_shared<int>(4);
+  {
+    optional<MySTL::shared_ptr<int>> p;
+    EXPECT_FALSE(p.has_value());
+    p = sp;
+    EXPECT_EQ(sp.use_count(), 2);
+    optional<MySTL::shared_ptr<int>> q = p;
+    EXPECT_EQ(sp.use_count(), 3);
+    q = nullopt;
+    EXPECT_EQ(sp.use_count(), 2);
+  }
+  EXPECT_EQ(sp.use_count(), 1);
+}
+
+TEST(OptionalNicheTest, Function) {
+  optional<MySTL::function<int(int)>> f;
+  EXPECT_FALSE(f.has_value());
+  f.emplace(nullptr);
+  EXPECT_TRUE(f.has_value());
+  EXPECT_FALSE(*f);
+  f = MySTL::function<int(int)>([](int x) { return x + 1; });
+  EXPECT_EQ((*f)(1), 2);
+}
+
+// optional<T&> 赋值时重新绑定
+TEST(OptionalRefTest, Rebind) {
+  int a = 1, b = 2;
+  optional<int &> r;
+  EXPECT_FALSE(r.has_value());
+  EXPECT_THROW(r.value(), bad_optional_access);
+  r = a;
+  *r = 10;
+  EXPECT_EQ(a, 10);
+  r = b;
+  EXPECT_EQ(a, 10);
+  EXPECT_EQ(&r.value(), &b);
+  EXPECT_EQ(r.value_or(0), 2);
+  auto doubled = r.transform([](int &x) { return x * 2; });
+  EXPECT_EQ(*doubled, 4);
+  r.reset();
+  EXPECT_EQ(r.value_or(7), 7);
+  static_assert(!std::is_constructible_v<optional<int &>, int &&>);
+}
+
+// try_value不抛异常，为空时返回空指针
+TEST(OptionalTest, TryValue) {
+  optional<int> opt;
+  EXPECT_EQ(opt.try_value(), nullptr);
+  opt = 3;
+  ASSERT_NE(opt.try_value(), nullptr);
+  *opt.try_value() = 4;
+  EXPECT_EQ(*std::as_const(opt).try_value(), 4);
+
+  int a = 1;
+  optional<int &> r;
+  EXPECT_EQ(r.try_value(), nullptr);
+  r = a;
+  EXPECT_EQ(r.try_value(), &a);
+  static_assert(noexcept(opt.try_value()));
+}
@@ -0,0 +1,207 @@
+#include "epoch.hpp"
+#include "hazard_pointer.hpp"
+#include <atomic>
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+
+using namespace MySTL;
+
+namespace {
+
+struct Tracked {
+  static inline std::atomic<int> alive{0};
+  int value;
+
+  explicit Tracked(int v) : value(v) { ++alive; }
+  ~Tracked() { --alive; }
+};
+
+// 有状态的删除器，记录被调用的次数
+struct CountingDeleter {
+  int *calls;
+
+  void operator()(Tracked *p) const {
+    ++*calls;
+    delete p;
+  }
+};
+
+} // namespace
+
+TEST(EpochTest, RetireFreesAfterTwoEpochs) {
+  Tracked::alive = 0;
+  epoch_domain domain;
+  domain.retire(new Tracked(1));
+  EXPECT_EQ(Tracked::alive, 1);
+  EXPECT_EQ(domain.pending(), 1u);
+  domain.reclaim();
+  EXPECT_EQ(Tracked::alive, 0);
+  EXPECT_EQ(domain.pending(), 0u);
+}
+
+// 临界区中的线程阻止纪元前进，离开后才能释放
+TEST(EpochTest, GuardBlocksReclamation) {
+  Tracked::alive = 0;
+  epoch_domain domain;
+  std::atomic<int> stage{0};
+  std::thread reader([&] {
+    epoch_guard g(domain);
+    stage = 1;
+    while (stage != 2) {
+      std::this_thread::yield();
+    }
+  });
+  while (stage != 1) {
+    std::this_thread::yield();
+  }
+  domain.retire(new Tracked(1));
+  domain.reclaim();
+  domain.reclaim();
+  EXPECT_EQ(Tracked::alive, 1);
+  stage = 2;
+  reader.join();
+  domain.reclaim();
+  EXPECT_EQ(Tracked::alive, 0);
+}
+
+TEST(EpochTest, NestedGuards) {
+  Tracked::alive = 0;
+  epoch_domain domain;
+  {
+    epoch_guard outer(domain);
+    {
+      epoch_guard inner(domain);
+    }
+    domain.retire(new Tracked(1));
+    std::thread([&] { domain.reclaim(); }).join();
+    domain.reclaim();
+    EXPECT_EQ(Tracked::alive, 1);
+  }
+  domain.reclaim();
+  EXPECT_EQ(Tracked::alive, 0);
+}
+
+// 攒满一批后自动回收，待回收对象数保持在一批左右
+TEST(EpochTest, BatchedCollection) {
+  Tracked::alive = 0;
+  epoch_domain domain(16);
+  for (int i = 0; i < 1000; ++i) {
+    domain.retire(new Tracked(i));
+    EXPECT_LE(domain.pending(), 32u);
+  }
+  EXPECT_LE(Tracked::alive, 32);
+}
+
+TEST(EpochTest, StatefulDeleterAndDomainTeardown) {
+  Tracked::alive = 0;
+  int calls = 0;
+  {
+    epoch_domain domain;
+    domain.retire(new Tracked(1), CountingDeleter{&calls});
+    domain.retire(new Tracked(2), CountingDeleter{&calls});
+    EXPECT_EQ(calls, 0);
+  }
+  EXPECT_EQ(calls, 2);
+  EXPECT_EQ(Tracked::alive, 0);
+}
+
+TEST(HazardPointerTest, ProtectedObjectSurvivesScan) {
+  Tracked::alive = 0;
+  hazard_domain domain;
+  std::atomic<Tracked *> slot{new Tracked(1)};
+  {
+    hazard_pointer hp(domain);
+    Tracked *p = hp.protect(slot);
+    slot.store(nullptr);
+    domain.retire(p);
+    domain.reclaim();
+    EXPECT_EQ(Tracked::alive, 1);
+    EXPECT_EQ(p->value, 1);
+  }
+  domain.reclaim();
+  EXPECT_EQ(Tracked::alive, 0);
+}
+
+TEST(HazardPointerTest, TryProtectReportsChange) {
+  hazard_domain domain;
+  int a = 1, b = 2;
+  std::atomic<int *> slot{&a};
+  hazard_pointer hp(domain);
+  int *p = &b;
+  EXPECT_FALSE(hp.try_protect(p, slot));
+  EXPECT_EQ(p, &a);
+  EXPECT_TRUE(hp.try_protect(p, slot));
+}
+
+TEST(HazardPointerTest, SlotsPerThreadAreLimited) {
+  hazard_domain domain;
+  std::vector<std::unique_ptr<hazard_pointer>> hps;
+  for (unsigned i = 0; i < _HazardRecord::_S_slots; ++i) {
+    hps.push_back(std::make_unique<hazard_pointer>(domain));
+  }
+  EXPECT_THROW(hazard_pointer{domain}, std::length_error);
+  hps.pop_back();
+  hazard_pointer again(domain);
+}
+
+// 一个读者一直保护同一个对象时，其余对象照常释放，待回收数有上界
+TEST(HazardPointerTest, BoundedGarbage) {
+  Tracked::alive = 0;
+  hazard_domain domain(16);
+  std::atomic<Tracked *> slot{new Tracked(0)};
+  hazard_pointer hp(domain);
+  Tracked *pinned = hp.protect(slot);
+  for (int i = 1; i <= 1000; ++i) {
+    Tracked *old = slot.exchange(new Tracked(i));
+    domain.retire(old);
+    EXPECT_LE(domain.pending(), 2 * 16u + 1);
+  }
+  EXPECT_EQ(pinned->value, 0);
+  hp.reset_protection();
+  domain.retire(slot.exchange(nullptr));
+  domain.reclaim();
+  EXPECT_EQ(Tracked::alive, 0);
+}
+
+// 多个线程不断替换并读取同一个指针，读到的对象在保护期间始终有效
+template <class _Domain, class _Read>
+static void ConcurrentReplace(_Domain &domain, _Read read) {
+  Tracked::alive = 0;
+  std::atomic<Tracked *> slot{new Tracked(0)};
+  std::atomic<bool> stop{false};
+  std::vector<std::thread> readers;
+  for (int t = 0; t < 3; ++t) {
+    readers.emplace_back([&] {
+      while (!stop.load()) {
+        EXPECT_GE(read(slot), 0);
+      }
+    });
+  }
+  for (int i = 1; i <= 20000; ++i) {
+    domain.retire(slot.exchange(new Tracked(i)));
+  }
+  stop = true;
+  for (auto &r : readers) {
+    r.join();
+  }
+  domain.retire(slot.exchange(nullptr));
+  domain.reclaim();
+  EXPECT_EQ(Tracked::alive, 0);
+}
+
+TEST(EpochTest, ConcurrentReplace) {
+  epoch_domain domain;
+  ConcurrentReplace(domain, [&](std::atomic<Tracked *> &slot) {
+    epoch_guard g(domain);
+    return slot.load(std::memory_order_acquire)->value;
+  });
+}
+
+TEST(HazardPointerTest, ConcurrentReplace) {
+  hazard_domain domain;
+  ConcurrentReplace(domain, [&](std::atomic<Tracked *> &slot) {
+    hazard_pointer hp(domain);
+    return hp.protect(slot)->value;
+  });
+}
@@ -1,6 +1,13 @@
 #include "shared_ptr.hpp"
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
 #include <gtest/gtest.h>
+#include <new>
+#include <stdexcept>
 #include <string>
+#include <thread>
+#include <vector>
 
 using namespace MySTL;
 
@@ -94,8 +101,24 @@ TEST(SharedPtrTest, ArraySupport) {
 struct MyClass : public enable_shared_from_this<MyClass> {
   int value;
   MyClass(int v) : value(v) {}
+  auto self() { return shared_from_this(); }
 };
 
+TEST(SharedPtrTest, SharedFromThis) {
+  auto sp = make_shared<MyClass>(7);
+  auto sp2 = sp->self();
+  EXPECT_EQ(sp2.get(), sp.get());
+  EXPECT_EQ(sp.use_count(), 2);
+  // 对象内部只持有弱引用
+  sp2.reset();
+  EXPECT_EQ(sp.use_count(), 1);
+}
+
+TEST(SharedPtrTest, SharedFromThisWithoutOwner) {
+  MyClass obj(1);
+  EXPECT_THROW(obj.self(), std::bad_weak_ptr);
+}
+
 // 测试 make_shared
 TEST(SharedPtrTest, MakeShared) {
   auto sp = make_shared<int>(42);
@@ -141,3 +164,704 @@ TEST(SharedPtrTest, ReinterpretPointerCast) {
   auto spReinterpret = reinterpret_pointer_cast<void>(sp);
   EXPECT_EQ(sp.use_count(), spReinterpret.use_count());
 }
+
+// 记录析构次数
+struct Tracked {
+  static inline int destroyed = 0;
+  int value;
+  Tracked(int v) : value(v) {}
+  ~Tracked() { ++destroyed; }
+};
+
+// 测试 weak_ptr 基本操作
+TEST(WeakPtrTest, LockAndExpire) {
+  weak_ptr<int> wp;
+  EXPECT_TRUE(wp.expired());
+  EXPECT_EQ(wp.lock().get(), nullptr);
+
+  shared_ptr<int> sp(new int(42));
+  wp = sp;
+  EXPECT_EQ(wp.use_count(), 1);
+  {
+    shared_ptr<int> locked = wp.lock();
+    EXPECT_EQ(*locked, 42);
+    EXPECT_EQ(sp.use_count(), 2);
+  }
+  sp.reset();
+  EXPECT_TRUE(wp.expired());
+  EXPECT_EQ(wp.lock().get(), nullptr);
+  EXPECT_THROW(shared_ptr<int>{wp}, std::bad_weak_ptr);
+}
+
+// 测试强引用归零时对象立即析构，不受弱引用影响
+TEST(WeakPtrTest, ObjectDestroyedBeforeBlock) {
+  Tracked::destroyed = 0;
+  weak_ptr<Tracked> wp1, wp2;
+  {
+    auto sp1 = make_shared<Tracked>(1);
+    shared_ptr<Tracked> sp2(new Tracked(2));
+    wp1 = sp1;
+    wp2 = sp2;
+  }
+  EXPECT_EQ(Tracked::destroyed, 2);
+  EXPECT_TRUE(wp1.expired());
+  EXPECT_TRUE(wp2.expired());
+}
+
+TEST(WeakPtrTest, CopyAndMove) {
+  auto sp = make_shared<int>(1);
+  weak_ptr<int> wp1 = sp;
+  weak_ptr<int> wp2 = wp1;
+  weak_ptr<int> wp3 = std::move(wp1);
+  EXPECT_TRUE(wp1.expired());
+  EXPECT_EQ(wp2.lock(), sp);
+  EXPECT_EQ(wp3.lock(), sp);
+  weak_ptr<void const> wp4 = wp3;
+  EXPECT_FALSE(wp4.expired());
+}
+
+// 多线程下 lock 与最后一次释放竞争，lock 成功时对象必须仍然有效
+TEST(WeakPtrTest, ConcurrentLockAndRelease) {
+  for (int round = 0; round < 200; ++round) {
+    auto sp = make_shared<std::string>("alive");
+    weak_ptr<std::string> wp = sp;
+    std::atomic<bool> start{false};
+    std::thread locker([&] {
+      while (!start.load()) {
+      }
+      for (int i = 0; i < 100; ++i) {
+        if (auto p = wp.lock()) {
+          EXPECT_EQ(*p, "alive");
+        }
+      }
+    });
+    start.store(true);
+    sp.reset();
+    locker.join();
+    EXPECT_TRUE(wp.expired());
+  }
+}
+
+// 多个线程反复拷贝、写入对象再释放，最后释放的线程必须看到所有写入
+TEST(SharedPtrTest, ConcurrentCopyAndRelease) {
+  constexpr int kThreads = 4;
+  constexpr int kIters = 10000;
+  struct Slots {
+    int counts[kThreads] = {};
+    int *total;
+    ~Slots() {
+      for (int c : counts) {
+        *total += c;
+      }
+    }
+  };
+  for (int round = 0; round < 20; ++round) {
+    int total = 0;
+    {
+      auto sp = make_shared<Slots>();
+      sp->total = &total;
+      std::vector<std::thread> threads;
+      for (int t = 0; t < kThreads; ++t) {
+        threads.emplace_back([t, local = sp] {
+          for (int i = 0; i < kIters; ++i) {
+            shared_ptr<Slots> copy = local;
+            ++copy->counts[t];
+          }
+        });
+      }
+      sp.reset();
+      for (auto &th : threads) {
+        th.join();
+      }
+    }
+    EXPECT_EQ(total, kThreads * kIters);
+  }
+}
+
+// 唯一持有者释放走不带原子读改写的快速路径，弱引用仍能阻止快速路径误判
+TEST(SharedPtrTest, LastOwnerRelease) {
+  Tracked::destroyed = 0;
+  {
+    auto sp = make_shared<Tracked>(1);
+  }
+  EXPECT_EQ(Tracked::destroyed, 1);
+  weak_ptr<Tracked> wp;
+  {
+    auto sp = make_shared<Tracked>(2);
+    wp = sp;
+  }
+  EXPECT_EQ(Tracked::destroyed, 2);
+  EXPECT_TRUE(wp.expired());
+}
+
+// 统计分配/释放次数的分配器，模拟内存池
+struct PoolStats {
+  int allocs = 0;
+  int deallocs = 0;
+};
+
+template <class T> struct CountingAllocator {
+  using value_type = T;
+  PoolStats *stats;
+
+  explicit CountingAllocator(PoolStats *s) noexcept : stats(s) {}
+
+  template <class U>
+  CountingAllocator(CountingAllocator<U> const &that) noexcept
+      : stats(that.stats) {}
+
+  T *allocate(std::size_t n) {
+    ++stats->allocs;
+    return static_cast<T *>(::operator new(n * sizeof(T)));
+  }
+
+  void deallocate(T *p, std::size_t) noexcept {
+    ++stats->deallocs;
+    ::operator delete(p);
+  }
+
+  template <class U>
+  bool operator==(CountingAllocator<U> const &that) const noexcept {
+    return stats == that.stats;
+  }
+};
+
+// 测试 allocate_shared：对象析构与内存释放分别在强/弱引用归零时发生
+TEST(AllocateSharedTest, UsesAllocator) {
+  PoolStats stats;
+  Tracked::destroyed = 0;
+  weak_ptr<Tracked> wp;
+  {
+    auto sp = allocate_shared<Tracked>(CountingAllocator<Tracked>(&stats), 5);
+    EXPECT_EQ(sp->value, 5);
+    EXPECT_EQ(stats.allocs, 1);
+    wp = sp;
+  }
+  EXPECT_EQ(Tracked::destroyed, 1);
+  EXPECT_EQ(stats.deallocs, 0);
+  wp.reset();
+  EXPECT_EQ(stats.deallocs, 1);
+}
+
+TEST(AllocateSharedTest, ForOverwrite) {
+  PoolStats stats;
+  {
+    auto sp =
+        allocate_shared_for_overwrite<int>(CountingAllocator<int>(&stats));
+    *sp = 3;
+    EXPECT_EQ(*sp, 3);
+  }
+  EXPECT_EQ(stats.allocs, 1);
+  EXPECT_EQ(stats.deallocs, 1);
+}
+
+// 构造抛出异常时内存归还给分配器
+TEST(AllocateSharedTest, ConstructorThrows) {
+  struct Throws {
+    Throws() { throw std::runtime_error("ctor"); }
+  };
+  PoolStats stats;
+  EXPECT_THROW(allocate_shared<Throws>(CountingAllocator<Throws>(&stats)),
+               std::runtime_error);
+  EXPECT_EQ(stats.allocs, 1);
+  EXPECT_EQ(stats.deallocs, 1);
+}
+
+TEST(AllocateSharedTest, SharedFromThis) {
+  PoolStats stats;
+  {
+    auto sp = allocate_shared<MyClass>(CountingAllocator<MyClass>(&stats), 1);
+    EXPECT_EQ(sp->self(), sp);
+  }
+  EXPECT_EQ(stats.deallocs, 1);
+}
+
+// 测试带删除器和分配器的构造：控制块由分配器分配
+TEST(AllocateSharedTest, DeleterAndAllocator) {
+  PoolStats stats;
+  int deleted = 0;
+  {
+    shared_ptr<int> sp(
+        new int(1),
+        [&deleted](int *p) {
+          ++deleted;
+          delete p;
+        },
+        CountingAllocator<int>(&stats));
+    auto sp2 = sp;
+    EXPECT_EQ(stats.allocs, 1);
+  }
+  EXPECT_EQ(deleted, 1);
+  EXPECT_EQ(stats.deallocs, 1);
+
+  shared_ptr<int> sp;
+  sp.reset(new int(2), DefaultDeleter<int>(), CountingAllocator<int>(&stats));
+  EXPECT_EQ(stats.allocs, 2);
+  sp.reset();
+  EXPECT_EQ(stats.deallocs, 2);
+}
+
+// 测试数组的单次分配 make_shared
+TEST(MakeSharedArrayTest, ValueInitialized) {
+  auto sp = make_shared<int[]>(4);
+  for (std::size_t i = 0; i < 4; ++i) {
+    EXPECT_EQ(sp[i], 0);
+  }
+  sp[2] = 7;
+  EXPECT_EQ(sp.get()[2], 7);
+  EXPECT_EQ(sp.use_count(), 1);
+}
+
+TEST(MakeSharedArrayTest, ElementsAligned) {
+  struct alignas(64) Wide {
+    int value = 3;
+  };
+  auto sp = make_shared<Wide[]>(3);
+  for (std::size_t i = 0; i < 3; ++i) {
+    EXPECT_EQ(reinterpret_cast<std::uintptr_t>(&sp[i]) % 64, 0u);
+    EXPECT_EQ(sp[i].value, 3);
+  }
+}
+
+struct Counted {
+  static inline int alive = 0;
+  Counted() { ++alive; }
+  ~Counted() { --alive; }
+};
+
+TEST(MakeSharedArrayTest, DestroysEveryElement) {
+  auto sp = make_shared<Counted[]>(5);
+  EXPECT_EQ(Counted::alive, 5);
+  auto sp2 = sp;
+  sp.reset();
+  EXPECT_EQ(Counted::alive, 5);
+  sp2.reset();
+  EXPECT_EQ(Counted::alive, 0);
+}
+
+// 第三个元素构造失败时，已构造的两个逆序析构
+struct Fragile {
+  static inline int constructed = 0;
+  static inline int destroyed = 0;
+  Fragile() {
+    if (constructed == 2) {
+      throw std::runtime_error("ctor");
+    }
+    ++constructed;
+  }
+  ~Fragile() { ++destroyed; }
+};
+
+TEST(MakeSharedArrayTest, ConstructorThrows) {
+  EXPECT_THROW(make_shared<Fragile[]>(4), std::runtime_error);
+  EXPECT_EQ(Fragile::constructed, 2);
+  EXPECT_EQ(Fragile::destroyed, 2);
+}
+
+TEST(MakeSharedArrayTest, ForOverwrite) {
+  auto sp = make_shared_for_overwrite<int[]>(3);
+  for (std::size_t i = 0; i < 3; ++i) {
+    sp[i] = static_cast<int>(i);
+  }
+  EXPECT_EQ(sp[2], 2);
+
+  auto strs = make_shared_for_overwrite<std::string[]>(2);
+  EXPECT_TRUE(strs[0].empty());
+
+  auto one = make_shared_for_overwrite<int>();
+  *one = 7;
+  EXPECT_EQ(*one, 7);
+}
+
+// 旧名字仍可使用，只是会给出弃用警告
+TEST(MakeSharedArrayTest, DeprecatedForOverWriteSpelling) {
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wdeprecated-declarations"
+  auto arr = make_shared_for_over_write<int[]>(2);
+  auto one = make_shared_for_over_write<int>();
+#pragma GCC diagnostic pop
+  arr[1] = 1;
+  *one = 2;
+  EXPECT_EQ(arr[1] + *one, 3);
+}
+
+// 元素紧跟在整个控制块之后，过对齐的元素也满足对齐要求
+TEST(MakeSharedArrayTest, OverAlignedElements) {
+  struct alignas(64) Wide {
+    unsigned char bytes[64];
+  };
+  auto sp = make_shared<Wide[]>(3);
+  EXPECT_EQ(reinterpret_cast<std::uintptr_t>(sp.get()) % alignof(Wide), 0u);
+  sp[2].bytes[63] = 1;
+  EXPECT_EQ(sp[2].bytes[63], 1);
+}
+
+TEST(MakeSharedArrayTest, Empty) {
+  auto sp = make_shared<int[]>(0);
+  EXPECT_NE(sp.get(), nullptr);
+  EXPECT_EQ(sp.use_count(), 1);
+}
+
+// 统计池向系统申请的slab：它们是唯一按64KiB对齐分配的内存
+static std::atomic<long> g_live_slabs{0};
+
+void *operator new(std::size_t n, std::align_val_t al) {
+  if (n == 64 * 1024) {
+    ++g_live_slabs;
+  }
+  std::size_t const a = static_cast<std::size_t>(al);
+  if (void *p = std::aligned_alloc(a, (n + a - 1) / a * a)) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void *p, std::align_val_t) noexcept { std::free(p); }
+
+void operator delete(void *p, std::size_t n, std::align_val_t) noexcept {
+  if (n == 64 * 1024) {
+    --g_live_slabs;
+  }
+  std::free(p);
+}
+
+// 一次性的大量控制块释放后，空出的slab还给系统，只留当前与一个备用
+TEST(SharedPtrPoolTest, BurstReleasesSlabs) {
+  long const before = g_live_slabs.load();
+  {
+    std::vector<shared_ptr<int>> burst;
+    for (int i = 0; i < 20000; ++i) {
+      burst.emplace_back(new int(i));
+    }
+    EXPECT_GE(g_live_slabs.load() - before, 5);
+  }
+  EXPECT_LE(g_live_slabs.load() - before, 2);
+}
+
+// 分配线程退出后，其他线程归还的块由归还者取回，孤儿堆的slab同样释放
+TEST(SharedPtrPoolTest, OrphanHeapShrinks) {
+  long const before = g_live_slabs.load();
+  std::vector<shared_ptr<int>> burst;
+  std::thread([&] {
+    for (int i = 0; i < 20000; ++i) {
+      burst.emplace_back(new int(i));
+    }
+  }).join();
+  EXPECT_GE(g_live_slabs.load() - before, 5);
+  burst.clear();
+  EXPECT_LE(g_live_slabs.load(), before);
+}
+
+// 控制块在一个线程分配、在另一个线程释放，归还到分配线程的远程链表
+TEST(SharedPtrPoolTest, CrossThreadRelease) {
+  constexpr int kRounds = 50;
+  constexpr int kBatch = 1000;
+  for (int r = 0; r < kRounds; ++r) {
+    std::vector<shared_ptr<int>> batch;
+    std::thread producer([&] {
+      for (int i = 0; i < kBatch; ++i) {
+        batch.emplace_back(new int(i));
+      }
+    });
+    producer.join();
+    std::thread consumer([&] {
+      for (int i = 0; i < kBatch; ++i) {
+        EXPECT_EQ(*batch[i], i);
+      }
+      batch.clear();
+    });
+    consumer.join();
+  }
+}
+
+// 线程退出后其他线程仍持有的控制块可以安全释放
+TEST(SharedPtrPoolTest, OwnerThreadExitsFirst) {
+  std::vector<shared_ptr<Tracked>> kept;
+  Tracked::destroyed = 0;
+  std::thread([&] {
+    for (int i = 0; i < 100; ++i) {
+      kept.emplace_back(new Tracked(i));
+    }
+  }).join();
+  kept.clear();
+  EXPECT_EQ(Tracked::destroyed, 100);
+  std::thread([] { shared_ptr<int> sp(new int(3)); }).join();
+}
+
+// 赋值的来源由旧值管理的对象持有时，必须先取得新值再释放旧值
+struct ListNode {
+  int value;
+  shared_ptr<ListNode> next;
+};
+
+TEST(SharedPtrTest, AssignFromOwnedMember) {
+  auto head = make_shared<ListNode>(ListNode{0, nullptr});
+  head->next = make_shared<ListNode>(ListNode{1, nullptr});
+  head->next->next = make_shared<ListNode>(ListNode{2, nullptr});
+  head = head->next;
+  EXPECT_EQ(head->value, 1);
+  head = std::move(head->next);
+  EXPECT_EQ(head->value, 2);
+  EXPECT_EQ(head.use_count(), 1);
+  head->next = make_shared<ListNode>(ListNode{3, nullptr});
+  head->next->next.reset();
+  head.reset();
+  EXPECT_EQ(head.get(), nullptr);
+}
+
+// 转换赋值同样先取得新值
+struct Branch : ListNode {
+  shared_ptr<Branch> child;
+};
+
+TEST(SharedPtrTest, ConvertingAssignFromOwnedMember) {
+  auto root = make_shared<Branch>();
+  root->child = make_shared<Branch>();
+  root->child->value = 1;
+  root->child->child = make_shared<Branch>();
+  root->child->child->value = 2;
+  shared_ptr<ListNode> cur = std::move(root);
+  cur = static_cast<Branch *>(cur.get())->child;
+  EXPECT_EQ(cur->value, 1);
+  EXPECT_EQ(cur.use_count(), 1);
+  cur = std::move(static_cast<Branch *>(cur.get())->child);
+  EXPECT_EQ(cur->value, 2);
+  EXPECT_EQ(cur.use_count(), 1);
+}
+
+namespace {
+
+struct BiasedTracked : enable_shared_from_this<BiasedTracked> {
+  static inline std::atomic<int> alive{0};
+  int value;
+
+  explicit BiasedTracked(int v) : value(v) { ++alive; }
+  ~BiasedTracked() { --alive; }
+
+  auto self() -> shared_ptr<BiasedTracked> { return shared_from_this(); }
+};
+
+} // namespace
+
+// 所有者线程内的拷贝只改偏向计数，use_count仍是总数
+TEST(BiasedSharedPtrTest, OwnerCopies) {
+  BiasedTracked::alive = 0;
+  {
+    auto p = make_shared_biased<BiasedTracked>(1);
+    EXPECT_EQ(p.use_count(), 1);
+    std::vector<shared_ptr<BiasedTracked>> copies(10, p);
+    EXPECT_EQ(p.use_count(), 11);
+    copies.clear();
+    EXPECT_EQ(p.use_count(), 1);
+    EXPECT_EQ(p->self().use_count(), 2);
+    EXPECT_EQ(BiasedTracked::alive, 1);
+  }
+  EXPECT_EQ(BiasedTracked::alive, 0);
+}
+
+TEST(BiasedSharedPtrTest, WeakPtr) {
+  BiasedTracked::alive = 0;
+  weak_ptr<BiasedTracked> w;
+  {
+    auto p = make_shared_biased<BiasedTracked>(2);
+    w = p;
+    auto q = w.lock();
+    ASSERT_TRUE(q);
+    EXPECT_EQ(q.use_count(), 2);
+  }
+  EXPECT_TRUE(w.expired());
+  EXPECT_FALSE(w.lock());
+  EXPECT_EQ(BiasedTracked::alive, 0);
+}
+
+// 其他线程持有的引用比所有者活得久：所有者的偏向计数归零时合并，
+// 最后由其他线程按普通计数析构
+TEST(BiasedSharedPtrTest, OwnerReleasesFirst) {
+  BiasedTracked::alive = 0;
+  auto p = make_shared_biased<BiasedTracked>(3);
+  shared_ptr<BiasedTracked> remote = p;
+  std::thread t([moved = std::move(remote)]() mutable {
+    auto copy = moved;
+    EXPECT_EQ(copy->value, 3);
+  });
+  t.join();
+  EXPECT_EQ(p.use_count(), 1);
+  p.reset();
+  EXPECT_EQ(BiasedTracked::alive, 0);
+}
+
+// 所有者创建的引用被移到其他线程并在那里释放：共享计数减为负，
+// 控制块排入所有者的合并队列，所有者合并后析构
+TEST(BiasedSharedPtrTest, RemoteReleaseQueuesForOwner) {
+  BiasedTracked::alive = 0;
+  auto p = make_shared_biased<BiasedTracked>(4);
+  weak_ptr<BiasedTracked> w = p;
+  std::thread t([moved = std::move(p)]() mutable { moved.reset(); });
+  t.join();
+  EXPECT_EQ(w.use_count(), 0);
+  EXPECT_EQ(BiasedTracked::alive, 1);
+  merge_biased_shared();
+  EXPECT_EQ(BiasedTracked::alive, 0);
+  EXPECT_TRUE(w.expired());
+}
+
+// 所有者线程先退出，之后由把共享计数减为负的线程自己合并
+TEST(BiasedSharedPtrTest, OwnerThreadExitsFirst) {
+  BiasedTracked::alive = 0;
+  shared_ptr<BiasedTracked> p;
+  std::thread t([&] { p = make_shared_biased<BiasedTracked>(5); });
+  t.join();
+  auto q = p;
+  EXPECT_EQ(q.use_count(), 2);
+  p.reset();
+  EXPECT_EQ(BiasedTracked::alive, 1);
+  q.reset();
+  EXPECT_EQ(BiasedTracked::alive, 0);
+}
+
+TEST(BiasedSharedPtrTest, ConcurrentMixedCopies) {
+  BiasedTracked::alive = 0;
+  {
+    auto p = make_shared_biased<BiasedTracked>(6);
+    std::vector<std::thread> threads;
+    std::atomic<bool> go{false};
+    for (int t = 0; t < 4; ++t) {
+      threads.emplace_back([&, mine = p]() {
+        while (!go.load()) {
+          std::this_thread::yield();
+        }
+        for (int i = 0; i < 10000; ++i) {
+          auto copy = mine;
+          EXPECT_EQ(copy->value, 6);
+        }
+      });
+    }
+    go = true;
+    for (int i = 0; i < 10000; ++i) {
+      auto copy = p;
+      EXPECT_EQ(copy->value, 6);
+    }
+    for (auto &t : threads) {
+      t.join();
+    }
+    EXPECT_EQ(p.use_count(), 1);
+  }
+  EXPECT_EQ(BiasedTracked::alive, 0);
+}
+
+// 分片计数期间各线程的拷贝记在各自的分片上，use_count仍是总数；
+// 提前关闭后按普通计数
+TEST(ShardedSharedPtrTest, CopiesAndClose) {
+  BiasedTracked::alive = 0;
+  auto p = make_shared_sharded<BiasedTracked>(1);
+  EXPECT_EQ(p.use_count(), 1);
+  std::vector<shared_ptr<BiasedTracked>> copies(10, p);
+  EXPECT_EQ(p.use_count(), 11);
+  EXPECT_EQ(p->self().use_count(), 12);
+  copies.clear();
+  close_sharded(p);
+  EXPECT_EQ(p.use_count(), 1);
+  close_sharded(p);
+  auto q = p;
+  EXPECT_EQ(q.use_count(), 2);
+  p.reset();
+  EXPECT_EQ(BiasedTracked::alive, 1);
+  q.reset();
+  EXPECT_EQ(BiasedTracked::alive, 0);
+}
+
+// 在其他线程拷贝、释放的引用与创建线程的分片互相抵消，关闭时汇总
+TEST(ShardedSharedPtrTest, ReleasedOnOtherThread) {
+  BiasedTracked::alive = 0;
+  auto p = make_shared_sharded<BiasedTracked>(2);
+  weak_ptr<BiasedTracked> w = p;
+  auto keep = p;
+  std::thread t([moved = std::move(p)]() mutable {
+    auto copy = moved;
+    moved.reset();
+    EXPECT_EQ(copy.use_count(), 2);
+  });
+  t.join();
+  EXPECT_EQ(keep.use_count(), 1);
+  auto locked = w.lock();
+  ASSERT_TRUE(locked);
+  EXPECT_EQ(locked.use_count(), 2);
+  locked.reset();
+  close_sharded(keep);
+  keep.reset();
+  EXPECT_EQ(BiasedTracked::alive, 0);
+  EXPECT_TRUE(w.expired());
+}
+
+// 不调用close_sharded，最后一个引用释放时也会析构
+TEST(ShardedSharedPtrTest, ReleasedWithoutClose) {
+  BiasedTracked::alive = 0;
+  {
+    auto p = make_shared_sharded<BiasedTracked>(3);
+    std::vector<shared_ptr<BiasedTracked>> copies(4, p);
+  }
+  EXPECT_EQ(BiasedTracked::alive, 0);
+
+  // 发布者先释放，其他线程仍持有的引用在之后释放
+  auto p = make_shared_sharded<BiasedTracked>(3);
+  weak_ptr<BiasedTracked> w = p;
+  std::vector<std::thread> threads;
+  std::atomic<bool> go{false};
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&go, mine = p]() mutable {
+      while (!go.load()) {
+        std::this_thread::yield();
+      }
+      for (int i = 0; i < 2000; ++i) {
+        auto copy = mine;
+        EXPECT_EQ(copy->value, 3);
+      }
+    });
+  }
+  p.reset();
+  EXPECT_EQ(BiasedTracked::alive, 1);
+  go = true;
+  for (auto &t : threads) {
+    t.join();
+  }
+  EXPECT_EQ(BiasedTracked::alive, 0);
+  EXPECT_TRUE(w.expired());
+}
+
+// 对普通shared_ptr关闭什么也不做
+TEST(ShardedSharedPtrTest, CloseOrdinaryIsNoop) {
+  auto p = make_shared<int>(3);
+  auto q = p;
+  close_sharded(p);
+  close_sharded(shared_ptr<int>());
+  EXPECT_EQ(p.use_count(), 2);
+}
+
+// 关闭与其他线程的拷贝、释放并发，之后的增减都转到普通计数
+TEST(ShardedSharedPtrTest, CloseWhileCopying) {
+  BiasedTracked::alive = 0;
+  for (int round = 0; round < 20; ++round) {
+    auto p = make_shared_sharded<BiasedTracked>(4);
+    std::vector<std::thread> threads;
+    std::atomic<int> ready{0};
+    for (int t = 0; t < 4; ++t) {
+      threads.emplace_back([&, mine = p]() mutable {
+        ++ready;
+        for (int i = 0; i < 2000; ++i) {
+          auto copy = mine;
+          EXPECT_EQ(copy->value, 4);
+        }
+        mine.reset();
+      });
+    }
+    while (ready.load() < 4) {
+      std::this_thread::yield();
+    }
+    close_sharded(p);
+    p.reset();
+    for (auto &t : threads) {
+      t.join();
+    }
+    EXPECT_EQ(BiasedTracked::alive, 0);
+  }
+}
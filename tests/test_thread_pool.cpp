@@ -0,0 +1,97 @@
+#include "thread_pool.hpp"
+#include <atomic>
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace MySTL;
+
+TEST(ThreadPoolTest, SubmitReturnsResult) {
+  thread_pool pool(2);
+  auto h = pool.submit([] { return 42; });
+  EXPECT_TRUE(h.valid());
+  EXPECT_EQ(h.get(), 42);
+  EXPECT_FALSE(h.valid());
+
+  auto s = pool.submit([] { return std::string(100, 'x'); });
+  EXPECT_EQ(s.get().size(), 100u);
+}
+
+TEST(ThreadPoolTest, VoidAndMoveOnly) {
+  thread_pool pool(2);
+  std::atomic<int> n{0};
+  auto h = pool.submit([&] { ++n; });
+  h.get();
+  EXPECT_EQ(n, 1);
+
+  auto p = std::make_unique<int>(7);
+  auto m = pool.submit([p = std::move(p)] { return *p; });
+  EXPECT_EQ(m.get(), 7);
+}
+
+TEST(ThreadPoolTest, ExceptionPropagates) {
+  thread_pool pool(1);
+  auto h = pool.submit([]() -> int { throw std::runtime_error("boom"); });
+  EXPECT_THROW(h.get(), std::runtime_error);
+}
+
+// 析构时等待已提交的任务全部完成
+TEST(ThreadPoolTest, DestructorDrains) {
+  std::atomic<int> n{0};
+  {
+    thread_pool pool(3);
+    for (int i = 0; i < 10000; ++i) {
+      pool.post([&] { ++n; });
+    }
+  }
+  EXPECT_EQ(n, 10000);
+}
+
+// 任务中继续提交任务，父任务等待子任务时执行其他任务而不是阻塞
+static auto Fib(thread_pool &pool, int n) -> long {
+  if (n < 2) {
+    return n;
+  }
+  auto a = pool.submit([&pool, n] { return Fib(pool, n - 1); });
+  long const b = Fib(pool, n - 2);
+  return a.get() + b;
+}
+
+TEST(ThreadPoolTest, ForkJoin) {
+  thread_pool pool(4);
+  auto h = pool.submit([&pool] { return Fib(pool, 20); });
+  EXPECT_EQ(h.get(), 6765);
+}
+
+// 工作线程休眠后仍能被新任务唤醒
+TEST(ThreadPoolTest, WakesParkedWorkers) {
+  thread_pool pool(2);
+  for (int round = 0; round < 20; ++round) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    EXPECT_EQ(pool.submit([round] { return round; }).get(), round);
+  }
+}
+
+// 本地队列扩容，同时其他线程在窃取
+TEST(ThreadPoolTest, DequeGrowsUnderStealing) {
+  std::atomic<int> n{0};
+  thread_pool pool(4);
+  pool.submit([&] {
+    for (int i = 0; i < 5000; ++i) {
+      pool.post([&] { ++n; });
+    }
+  }).get();
+  std::vector<task_handle<int>> hs;
+  for (int i = 0; i < 100; ++i) {
+    hs.push_back(pool.submit([i] { return i; }));
+  }
+  int sum = 0;
+  for (auto &h : hs) {
+    sum += h.get();
+  }
+  EXPECT_EQ(sum, 4950);
+  while (n != 5000) {
+    std::this_thread::yield();
+  }
+}